@@ -0,0 +1,91 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include "../src/lib/module.h"
+#include "../src/lib/output_sink.h"
+#include "../src/lib/scanner.h"
+#include "../src/lib/parser.h"
+#include "../src/lib/vm.h"
+
+namespace {
+const std::string SIZE = "1000000";
+const int64_t ROUNDS = 10;
+
+// Runs the statement ROUNDS times on two arrays of a million longs, a and b, filled with
+// array_fill. The loop variable r and the long result can be used by the statement.
+void run_rounds(benchmark::State& state, const std::string& statement) {
+    std::string code =
+        "long[" + SIZE + "] a; "
+        "long[" + SIZE + "] b; "
+        "array_fill(a, 3); "
+        "array_fill(b, 2); "
+        "long result = 0; "
+        "for (long r = 0; r < " + std::to_string(ROUNDS) + "; r++) { " + statement + " } "
+        "print result;";
+    auto tokens = scanner::scan(code.c_str());
+    auto bytes = module::link(module::compile(parser::parse(tokens)));
+    for (auto _ : state) {
+        Vm(bytes, {}, std::make_shared<MemorySink>()).execute();
+    }
+    state.SetBytesProcessed(state.iterations() * ROUNDS * std::stol(SIZE) * sizeof(int64_t));
+}
+
+std::string loop(const std::string& body) {
+    return "for (long i = 0; i < " + SIZE + "; i++) { " + body + " }";
+}
+}
+
+static void bm_array_sum_loop(benchmark::State& state) {
+    run_rounds(state, loop("result += a[i];"));
+}
+BENCHMARK(bm_array_sum_loop)->Unit(benchmark::kMillisecond);
+
+static void bm_array_sum(benchmark::State& state) {
+    run_rounds(state, "result += array_sum(a);");
+}
+BENCHMARK(bm_array_sum)->Unit(benchmark::kMillisecond);
+
+static void bm_array_dot_loop(benchmark::State& state) {
+    run_rounds(state, loop("result += a[i] * b[i];"));
+}
+BENCHMARK(bm_array_dot_loop)->Unit(benchmark::kMillisecond);
+
+static void bm_array_dot(benchmark::State& state) {
+    run_rounds(state, "result += array_dot(a, b);");
+}
+BENCHMARK(bm_array_dot)->Unit(benchmark::kMillisecond);
+
+static void bm_array_count_loop(benchmark::State& state) {
+    run_rounds(state, loop("if (a[i] == r) { result++; }"));
+}
+BENCHMARK(bm_array_count_loop)->Unit(benchmark::kMillisecond);
+
+static void bm_array_count(benchmark::State& state) {
+    run_rounds(state, "result += array_count(a, r);");
+}
+BENCHMARK(bm_array_count)->Unit(benchmark::kMillisecond);
+
+static void bm_array_add_loop(benchmark::State& state) {
+    run_rounds(state, loop("a[i] += b[i];"));
+}
+BENCHMARK(bm_array_add_loop)->Unit(benchmark::kMillisecond);
+
+static void bm_array_add(benchmark::State& state) {
+    run_rounds(state, "array_add(a, b);");
+}
+BENCHMARK(bm_array_add)->Unit(benchmark::kMillisecond);
+
+static void bm_array_fill_loop(benchmark::State& state) {
+    run_rounds(state, loop("a[i] = r;"));
+}
+BENCHMARK(bm_array_fill_loop)->Unit(benchmark::kMillisecond);
+
+static void bm_array_fill(benchmark::State& state) {
+    run_rounds(state, "array_fill(a, r);");
+}
+BENCHMARK(bm_array_fill)->Unit(benchmark::kMillisecond);
+
+// Sorts a million pseudo-random longs each round.
+static void bm_array_sort(benchmark::State& state) {
+    run_rounds(state, loop("a[i] = (i * 7919 + r) % 1000003;") + " array_sort(a);");
+}
+BENCHMARK(bm_array_sort)->Unit(benchmark::kMillisecond);
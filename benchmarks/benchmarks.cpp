@@ -2,6 +2,7 @@
 #include "../src/lib/ast.h"
 #include "../src/lib/vm.h"
 #include "../src/lib/instructions.h"
+#include "../src/lib/module.h"
 #include "../src/lib/fileutils.h"
 #include "../src/lib/scanner.h"
 #include "../src/lib/parser.h"
@@ -13,8 +14,7 @@ static void bm_##name(benchmark::State &state) { \
     auto content = fileutils::read_string(PATH(name)); \
     auto tokens = scanner::scan(content.c_str()); \
     auto tree = parser::parse(tokens); \
-    auto instructions = ast::to_instructions(tree); \
-    auto bytes = Instruction::to_bytes(instructions); \
+    auto bytes = module::link(module::compile(tree)); \
     for (auto _ : state) { \
         Vm(bytes).execute(); \
     } \
@@ -22,8 +22,12 @@ static void bm_##name(benchmark::State &state) { \
 BENCHMARK(bm_##name) \
 
 NA_BENCHMARK(fib);
+NA_BENCHMARK(leibniz);
 NA_BENCHMARK(primes);
+NA_BENCHMARK(sieve);
 NA_BENCHMARK(while_loop);
+NA_BENCHMARK(vectors);
+NA_BENCHMARK(globals);
 
 // Run the benchmark
 BENCHMARK_MAIN();
\ No newline at end of file
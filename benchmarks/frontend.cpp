@@ -0,0 +1,174 @@
+#include <benchmark/benchmark.h>
+#include <sstream>
+#include <string>
+#include "../src/lib/ast.h"
+#include "../src/lib/instructions.h"
+#include "../src/lib/scanner.h"
+#include "../src/lib/parser.h"
+
+namespace {
+// Deterministic generator of synthetic programs: many functions calling each
+// other, deeply nested control flow and long arithmetic expressions.
+class ProgramGenerator {
+    public:
+    ProgramGenerator(const uint64_t& seed = 42) {
+        state = seed;
+        variables = 0;
+        functions = 0;
+    }
+
+    std::string generate(const size_t& lines) {
+        std::stringstream ss;
+        size_t count = 0;
+        while (count < lines) {
+            count += function(ss);
+        }
+        ss << "long result = f" << functions - 1 << "(1, 2, 3);" << std::endl;
+        return ss.str();
+    }
+
+    private:
+    uint64_t next(const uint64_t& bound) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return (state >> 33) % bound;
+    }
+
+    std::string operand() {
+        switch (next(5)) {
+            case 0: return "a";
+            case 1: return "b";
+            case 2: return "c";
+            default: return std::to_string(next(1000));
+        }
+    }
+
+    std::string expression(const size_t& length) {
+        static const char* operators[] = {"+", "-", "*", "/", "%", "^", "&", "|"};
+        std::stringstream ss;
+        ss << operand();
+        for (size_t i = 1; i < length; i++) {
+            ss << " " << operators[next(8)] << " ";
+            if (next(4) == 0) {
+                ss << "(" << operand() << " + " << operand() << ")";
+            } else {
+                ss << operand();
+            }
+        }
+        return ss.str();
+    }
+
+    size_t block(std::stringstream& ss, const size_t& depth) {
+        const std::string indent(4 * depth, ' ');
+        size_t lines = 0;
+        size_t statements = 2 + next(3);
+        for (size_t i = 0; i < statements; i++) {
+            std::string var = "v" + std::to_string(variables++);
+            switch (depth < 6 ? next(5) : 0) {
+                case 0:
+                    ss << indent << "long " << var << " = " << expression(4 + next(12)) << ";" << std::endl;
+                    lines++;
+                    break;
+                case 1:
+                    ss << indent << "if (" << expression(3) << " < " << expression(3) << " and a != b) {" << std::endl;
+                    lines += 1 + block(ss, depth + 1);
+                    ss << indent << "} else {" << std::endl;
+                    lines += 1 + block(ss, depth + 1);
+                    ss << indent << "}" << std::endl;
+                    lines++;
+                    break;
+                case 2:
+                    ss << indent << "for (long " << var << " = 0; " << var << " < " << next(10) << "; " << var << "++) {" << std::endl;
+                    lines += 1 + block(ss, depth + 1);
+                    ss << indent << "}" << std::endl;
+                    lines++;
+                    break;
+                case 3:
+                    ss << indent << "long " << var << " = " << next(10) << ";" << std::endl;
+                    ss << indent << "while (" << var << " > 0) {" << std::endl;
+                    lines += 2 + block(ss, depth + 1);
+                    ss << indent << "    " << var << " -= 1;" << std::endl;
+                    ss << indent << "}" << std::endl;
+                    lines += 2;
+                    break;
+                default:
+                    if (functions == 0) {
+                        ss << indent << "a += " << expression(6) << ";" << std::endl;
+                    } else {
+                        ss << indent << "long " << var << " = f" << next(functions) << "(a, " << expression(3) << ", c);" << std::endl;
+                    }
+                    lines++;
+                    break;
+            }
+        }
+        return lines;
+    }
+
+    size_t function(std::stringstream& ss) {
+        ss << "long f" << functions << "(long a, long b, int c) {" << std::endl;
+        size_t lines = block(ss, 1);
+        ss << "    return " << expression(8) << ";" << std::endl;
+        ss << "}" << std::endl;
+        functions++;
+        return lines + 3;
+    }
+
+    uint64_t state;
+    size_t variables;
+    size_t functions;
+};
+
+void set_throughput(benchmark::State& state, const std::string& source, const std::vector<Token>& tokens) {
+    state.SetBytesProcessed(state.iterations() * source.size());
+    state.counters["tokens"] = benchmark::Counter(state.iterations() * tokens.size(), benchmark::Counter::kIsRate);
+}
+}
+
+static void bm_scan(benchmark::State& state) {
+    std::string source = ProgramGenerator().generate(state.range(0));
+    std::vector<Token> tokens;
+    for (auto _ : state) {
+        tokens = scanner::scan(source);
+        benchmark::DoNotOptimize(tokens.data());
+    }
+    set_throughput(state, source, tokens);
+}
+
+static void bm_parse(benchmark::State& state) {
+    std::string source = ProgramGenerator().generate(state.range(0));
+    std::vector<Token> tokens = scanner::scan(source);
+    for (auto _ : state) {
+        auto tree = parser::parse(tokens);
+        benchmark::DoNotOptimize(tree.get());
+    }
+    set_throughput(state, source, tokens);
+}
+
+static void bm_codegen(benchmark::State& state) {
+    std::string source = ProgramGenerator().generate(state.range(0));
+    std::vector<Token> tokens = scanner::scan(source);
+    auto tree = parser::parse(tokens);
+    for (auto _ : state) {
+        auto instructions = ast::to_instructions(tree);
+        benchmark::DoNotOptimize(instructions.data());
+    }
+    set_throughput(state, source, tokens);
+}
+
+static void bm_serialize(benchmark::State& state) {
+    std::string source = ProgramGenerator().generate(state.range(0));
+    std::vector<Token> tokens = scanner::scan(source);
+    auto instructions = ast::to_instructions(parser::parse(tokens));
+    for (auto _ : state) {
+        auto bytes = Instruction::to_bytes(instructions);
+        benchmark::DoNotOptimize(bytes.data());
+    }
+    set_throughput(state, source, tokens);
+}
+
+#define FRONTEND_BENCHMARK(name) \
+BENCHMARK(name)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond) \
+
+FRONTEND_BENCHMARK(bm_scan);
+FRONTEND_BENCHMARK(bm_parse);
+FRONTEND_BENCHMARK(bm_codegen);
+FRONTEND_BENCHMARK(bm_serialize);
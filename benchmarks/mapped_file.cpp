@@ -0,0 +1,161 @@
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "../src/lib/module.h"
+#include "../src/lib/fileutils.h"
+#include "../src/lib/output_sink.h"
+#include "../src/lib/scanner.h"
+#include "../src/lib/parser.h"
+#include "../src/lib/vm.h"
+
+namespace {
+// Scanned file, 1 GB unless BANANA_SCAN_BYTES says otherwise. It is written once
+// and removed when the benchmarks exit.
+class ScanFile {
+    public:
+    ScanFile() {
+        const char* bytes = std::getenv("BANANA_SCAN_BYTES");
+        size = bytes == nullptr ? 1L << 30 : std::stol(bytes);
+        path = (std::filesystem::temp_directory_path() / ("banana_scan_" + std::to_string(getpid()))).string();
+        std::ofstream os(path, std::ios::binary);
+        std::vector<int64_t> block(1 << 16);
+        for (int64_t written = 0; written < size; written += block.size() * sizeof(int64_t)) {
+            for (size_t i = 0; i < block.size(); i++) {
+                block[i] = (written / sizeof(int64_t) + i) % 1000;
+            }
+            os.write((const char*) block.data(), std::min<int64_t>(size - written, block.size() * sizeof(int64_t)));
+        }
+    }
+
+    ~ScanFile() {
+        std::remove(path.c_str());
+        if (!library.empty()) {
+            std::remove(library.c_str());
+        }
+    }
+
+    // Native library mapping the same file, the way programs read files before map_file.
+    // scan::read goes through libffi, scan::read_direct is called on the operand stack,
+    // scan::sum gets the mapping of the VM as an array.
+    const std::string& get_library() {
+        if (!library.empty()) {
+            return library;
+        }
+        std::string include = std::filesystem::current_path().string() + "/src/lib/c_interface.h";
+        std::string code =
+            "#include \"" + include + "\"\n"
+            "#include <fcntl.h>\n"
+            "#include <string.h>\n"
+            "#include <sys/mman.h>\n"
+            "#include <sys/stat.h>\n"
+            "const unsigned char* data = nullptr; long length = 0; "
+            "void open_file() { "
+            "    if (data != nullptr) { return; } "
+            "    int fd = open(\"" + path + "\", O_RDONLY); "
+            "    struct stat status; fstat(fd, &status); length = status.st_size; "
+            "    data = (const unsigned char*) mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0); "
+            "} "
+            "long scan_size() { open_file(); return length; } "
+            "long scan_read(long offset) { long value; memcpy(&value, data + offset, sizeof(long)); return value; } "
+            "long scan_sum(cinterface::Array<const long> values) { "
+            "    long sum = 0; for (long i = 0; i < values.size; i++) { sum += values.data[i]; } return sum; "
+            "} "
+            "class ScanSize : public CInterface { "
+            "   cinterface::ArgType get_return_type() const { return cinterface::LONG; } "
+            "   std::vector<cinterface::ArgType> get_arg_types() const { return {}; } "
+            "   std::string get_name() const { return \"scan::size\"; } "
+            "   void* get_function() const { return (void*) scan_size; } "
+            "}; "
+            "class ScanRead : public CInterface { "
+            "   cinterface::ArgType get_return_type() const { return cinterface::LONG; } "
+            "   std::vector<cinterface::ArgType> get_arg_types() const { return {cinterface::LONG}; } "
+            "   std::string get_name() const { return \"scan::read\"; } "
+            "   void* get_function() const { return (void*) scan_read; } "
+            "}; "
+            "std::vector<CInterface*> get_classes() { "
+            "   return {new ScanSize(), new ScanRead(), new CFunction<scan_read>(\"scan::read_direct\"), new CFunction<scan_sum>(\"scan::sum\")}; "
+            "}";
+        std::string source = path + ".cpp";
+        fileutils::write_lines({code}, source);
+        std::string compiled = path + ".so";
+        std::string cmd = "g++ -std=c++17 -O2 " + source + " -o " + compiled + " -shared -fPIC";
+        int status = system(cmd.c_str());
+        std::remove(source.c_str());
+        if (status != 0) {
+            std::cout << "Could not compile the native scan library." << std::endl;
+            exit(1);
+        }
+        library = compiled;
+        return library;
+    }
+
+    std::string path;
+    int64_t size;
+
+    private:
+    std::string library;
+};
+
+ScanFile& scan_file() {
+    static ScanFile file;
+    return file;
+}
+
+void run_scan(benchmark::State& state, const std::string& code, const std::vector<std::string>& shared_libraries) {
+    auto tokens = scanner::scan(code.c_str());
+    auto bytes = module::link(module::compile(parser::parse(tokens, shared_libraries)));
+    for (auto _ : state) {
+        Vm(bytes, shared_libraries, std::make_shared<MemorySink>()).execute();
+    }
+    state.SetBytesProcessed(state.iterations() * scan_file().size);
+}
+
+// Scans the file with a native function call per long.
+std::string native_scan(const std::string& read) {
+    return
+        "@native(\"scan::size\") long scan_size(); "
+        "@native(\"" + read + "\") long scan_read(long offset); "
+        "long size = scan_size(); "
+        "long sum = 0; "
+        "for (long i = 0; i < size; i += 8) { sum += scan_read(i); } "
+        "print sum;";
+}
+}
+
+// Sums the file a long at a time, reading the mapping with mapped_long.
+static void bm_scan_mapped(benchmark::State& state) {
+    std::string code =
+        "int f = map_file(\"" + scan_file().path + "\"); "
+        "long size = mapped_size(f); "
+        "long sum = 0; "
+        "for (long i = 0; i < size; i += 8) { sum += mapped_long(f, i); } "
+        "print sum;";
+    run_scan(state, code, {});
+}
+BENCHMARK(bm_scan_mapped)->Iterations(1)->Unit(benchmark::kMillisecond);
+
+static void bm_scan_native(benchmark::State& state) {
+    run_scan(state, native_scan("scan::read"), {scan_file().get_library()});
+}
+BENCHMARK(bm_scan_native)->Iterations(1)->Unit(benchmark::kMillisecond);
+
+static void bm_scan_native_direct(benchmark::State& state) {
+    run_scan(state, native_scan("scan::read_direct"), {scan_file().get_library()});
+}
+BENCHMARK(bm_scan_native_direct)->Iterations(1)->Unit(benchmark::kMillisecond);
+
+// Sums the whole mapping in a single native call, without copying it.
+static void bm_scan_native_slice(benchmark::State& state) {
+    std::string code =
+        "@native(\"scan::sum\") long scan_sum(long[] values); "
+        "int f = map_file(\"" + scan_file().path + "\"); "
+        "print scan_sum(mapped_slice(f, 0, mapped_size(f)));";
+    run_scan(state, code, {scan_file().get_library()});
+}
+BENCHMARK(bm_scan_native_slice)->Iterations(1)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,122 @@
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "../src/lib/module.h"
+#include "../src/lib/fileutils.h"
+#include "../src/lib/output_sink.h"
+#include "../src/lib/scanner.h"
+#include "../src/lib/parser.h"
+#include "../src/lib/vm.h"
+
+namespace {
+// Native library keeping a std::unordered_map, the way programs counted before map_new.
+// It is compiled once and removed when the benchmarks exit.
+class UnorderedMapLibrary {
+    public:
+    ~UnorderedMapLibrary() {
+        if (!path.empty()) {
+            std::remove(path.c_str());
+        }
+    }
+
+    const std::string& get_path() {
+        if (!path.empty()) {
+            return path;
+        }
+        std::string include = std::filesystem::current_path().string() + "/src/lib/c_interface.h";
+        std::string code =
+            "#include \"" + include + "\"\n"
+            "#include <unordered_map>\n"
+            "std::unordered_map<long, long> map; "
+            "long umap_clear() { map.clear(); return 0; } "
+            "long umap_get(long key) { auto it = map.find(key); return it == map.end() ? 0 : it->second; } "
+            "long umap_put(long key, long value) { map[key] = value; return value; } "
+            "long umap_contains(long key) { return map.count(key); } "
+            "std::vector<CInterface*> get_classes() { "
+            "   return { "
+            "       new CFunction<umap_clear>(\"umap::clear\"), new CFunction<umap_get>(\"umap::get\"), "
+            "       new CFunction<umap_put>(\"umap::put\"), new CFunction<umap_contains>(\"umap::contains\") "
+            "   }; "
+            "}";
+        std::string base = (std::filesystem::temp_directory_path() / ("banana_umap_" + std::to_string(getpid()))).string();
+        std::string source = base + ".cpp";
+        fileutils::write_lines({code}, source);
+        std::string compiled = base + ".so";
+        std::string cmd = "g++ -std=c++17 -O2 " + source + " -o " + compiled + " -shared -fPIC";
+        int status = system(cmd.c_str());
+        std::remove(source.c_str());
+        if (status != 0) {
+            std::cout << "Could not compile the native map library." << std::endl;
+            exit(1);
+        }
+        path = compiled;
+        return path;
+    }
+
+    private:
+    std::string path;
+};
+
+UnorderedMapLibrary& unordered_map_library() {
+    static UnorderedMapLibrary library;
+    return library;
+}
+
+void run_map(benchmark::State& state, const std::string& code, const std::vector<std::string>& shared_libraries) {
+    auto tokens = scanner::scan(code.c_str());
+    auto bytes = module::link(module::compile(parser::parse(tokens, shared_libraries)));
+    for (auto _ : state) {
+        Vm(bytes, shared_libraries, std::make_shared<MemorySink>()).execute();
+    }
+}
+
+// Counts 1M keys spread over 100003 values, then looks each value up.
+std::string count_keys(const std::string& get, const std::string& put, const std::string& contains) {
+    return
+        "for (long i = 0; i < 1000000; i++) { long k = i * 7919 % 100003; " + put + "(k, " + get + "(k) + 1); } "
+        "long found = 0; "
+        "for (long j = 0; j < 100003; j++) { if (" + contains + "(j)) { found++; } } "
+        "print found;";
+}
+}
+
+static void bm_map_builtin(benchmark::State& state) {
+    std::string code =
+        "int m = map_new(); "
+        "long get(long k) { return map_get(m, k); } "
+        "void put(long k, long v) { map_put(m, k, v); } "
+        "bool contains(long k) { return map_contains(m, k); } " +
+        count_keys("get", "put", "contains");
+    run_map(state, code, {});
+}
+BENCHMARK(bm_map_builtin)->Unit(benchmark::kMillisecond);
+
+// The same counting with the builtins called inline, without a function per operation.
+static void bm_map_builtin_inline(benchmark::State& state) {
+    std::string code =
+        "int m = map_new(); "
+        "for (long i = 0; i < 1000000; i++) { long k = i * 7919 % 100003; map_put(m, k, map_get(m, k) + 1); } "
+        "long found = 0; "
+        "for (long j = 0; j < 100003; j++) { if (map_contains(m, j)) { found++; } } "
+        "print found;";
+    run_map(state, code, {});
+}
+BENCHMARK(bm_map_builtin_inline)->Unit(benchmark::kMillisecond);
+
+static void bm_map_native(benchmark::State& state) {
+    std::string code =
+        "@native(\"umap::clear\") long umap_clear(); "
+        "@native(\"umap::get\") long umap_get(long key); "
+        "@native(\"umap::put\") long umap_put(long key, long value); "
+        "@native(\"umap::contains\") long umap_contains(long key); "
+        "bool contains(long k) { return umap_contains(k) == 1; } "
+        "umap_clear(); " +
+        count_keys("umap_get", "umap_put", "contains");
+    run_map(state, code, {unordered_map_library().get_path()});
+}
+BENCHMARK(bm_map_native)->Unit(benchmark::kMillisecond);
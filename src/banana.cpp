@@ -1,40 +1,79 @@
 #include <iostream>
 #include <vector>
 #include <map>
+#include "lib/assembler.h"
 #include "lib/ast.h"
+#include "lib/executable.h"
+#include "lib/module.h"
 #include "lib/scanner.h"
 #include "lib/parser.h"
 #include "lib/fileutils.h"
 
-std::vector<std::unique_ptr<const Instruction>> get_instructions(
+std::shared_ptr<AbstractSyntaxTree> get_tree(
     const std::string& filename,
     const std::vector<std::string>& shared_libraries
 ) {
     std::string content = fileutils::read_string(filename);
     std::vector<Token> tokens = scanner::scan(content.c_str());
-    std::shared_ptr<AbstractSyntaxTree> root = parser::parse(tokens, shared_libraries);
-    return ast::to_instructions(root);
+    return parser::parse(tokens, shared_libraries, fileutils::directory(filename));
+}
+
+std::vector<uint8_t> get_program(
+    const std::string& filename,
+    const std::vector<std::string>& shared_libraries
+) {
+    return module::link(module::compile(get_tree(filename, shared_libraries)), fileutils::directory(filename));
 }
 
 void compile(const std::string& filename, const std::string& output, const std::vector<std::string>& shared_libraries) {
-    auto bytes = Instruction::to_bytes(get_instructions(filename, shared_libraries));
-    fileutils::write_bytes(bytes, output);
+    fileutils::write_bytes(get_program(filename, shared_libraries), output);
 }
 
-void compile_and_execute(const std::string& filename, const std::vector<std::string>& shared_libraries) {
-    Vm(Instruction::to_bytes(get_instructions(filename, shared_libraries)), shared_libraries).execute();
+void compile_module(const std::string& filename, const std::string& output, const std::vector<std::string>& shared_libraries) {
+    module::write(module::compile(get_tree(filename, shared_libraries)), output);
 }
 
-void execute(const std::string& filename, const std::vector<std::string>& shared_libraries) {
-    Vm(fileutils::read_bytes(filename), shared_libraries).execute();
+void link(const std::string& filename, const std::string& output) {
+    fileutils::write_bytes(module::link(module::read(filename), fileutils::directory(filename)), output);
 }
 
-void print_assembly(const std::string& filename, const std::vector<std::string>& shared_libraries) {
-    for (auto pair : Instruction::to_asm(get_instructions(filename, shared_libraries))) {
-        std::cout << pair.first << "\t" << pair.second << std::endl;
+std::string flush_policy;
+
+void run(Vm& vm, const std::string& snapshot) {
+    if (flush_policy == "line") {
+        vm.output.set_policy(output::LINE);
+    } else if (flush_policy == "block") {
+        vm.output.set_policy(output::BLOCK);
+    }
+    vm.snapshot_path = snapshot;
+    vm.execute();
+    // the path is cleared once the snapshot is saved
+    if (!vm.snapshot_path.empty()) {
+        std::cout << "Program ended before reaching a snapshot point." << std::endl;
+        exit(1);
     }
 }
 
+void compile_and_execute(const std::string& filename, const std::vector<std::string>& shared_libraries, const std::string& snapshot) {
+    Vm vm(get_program(filename, shared_libraries), shared_libraries);
+    run(vm, snapshot);
+}
+
+void execute(const std::string& filename, const std::vector<std::string>& shared_libraries, const std::string& snapshot) {
+    Vm vm(fileutils::map_file(filename), shared_libraries);
+    run(vm, snapshot);
+}
+
+void resume(const std::string& filename) {
+    run(*Vm::resume(fileutils::map_file(filename)), "");
+}
+
+// The listing of the linked program, with its sections, which the assembler reads back.
+void print_assembly(const std::string& filename, const std::vector<std::string>& shared_libraries) {
+    std::vector<uint8_t> program = get_program(filename, shared_libraries);
+    assembler::disassemble(executable::from_bytes(program.data(), program.size()), std::cout);
+}
+
 std::map<std::string, std::string> parse_flags(int argc, char** argv) {
     std::map<std::string, std::string> flags;
     int i = 1;
@@ -72,10 +111,15 @@ std::string replace_extension(const std::string& filename, const std::string& ex
 }
 
 void help(const std::string& exe) {
-    std::cout << "Syntax is: " << exe << " [-c] [-a] [-i]" << " [bytecode|source]" << std::endl;
-    std::cout << "  -c\t Compiles banana code to vm bytecode." << std::endl;
+    std::cout << "Syntax is: " << exe << " [-c] [-m] [-l] [-a] [-i]" << " [bytecode|source|module]" << std::endl;
+    std::cout << "  -c\t Compiles banana code to vm bytecode, linking imported modules." << std::endl;
+    std::cout << "  -m\t Compiles banana code to a module that can be imported." << std::endl;
+    std::cout << "  -l\t Links a compiled module and its imports to vm bytecode." << std::endl;
     std::cout << "  -a\t Translates banana code to vm instructions." << std::endl;
     std::cout << "  -i\t Execute banana code from source file." << std::endl;
+    std::cout << "  --snapshot <file>\t Runs up to the first 'snapshot;' and saves the state of the program." << std::endl;
+    std::cout << "  --resume <file>\t Continues a program from a snapshot." << std::endl;
+    std::cout << "  --flush <line|block>\t Flushes the output at every line, or when the buffer is full. Defaults to line for terminals." << std::endl;
 }
 
 int main(int argc, char** argv) {
@@ -86,22 +130,38 @@ int main(int argc, char** argv) {
     if (has_flag(flags, "--lib")) {
         shared_libraries = fileutils::list_files(flags["--lib"], ".so");
     }
+    std::string snapshot = has_flag(flags, "--snapshot") ? flags["--snapshot"] : "";
+    if (has_flag(flags, "--flush")) {
+        flush_policy = flags["--flush"];
+    }
 
     if (has_flag(flags, "-c")) {
         compile(filename, replace_extension(filename, "obj"), shared_libraries);
         return 0;
     }
+    if (has_flag(flags, "-m")) {
+        compile_module(filename, replace_extension(filename, module::EXTENSION), shared_libraries);
+        return 0;
+    }
+    if (has_flag(flags, "-l")) {
+        link(filename, replace_extension(filename, "obj"));
+        return 0;
+    }
     if (has_flag(flags, "-a")) {
         print_assembly(filename, shared_libraries);
         return 0;
     }
     if (has_flag(flags, "-i")) {
-        compile_and_execute(filename, shared_libraries);
+        compile_and_execute(filename, shared_libraries, snapshot);
+        return 0;
+    }
+    if (has_flag(flags, "--resume")) {
+        resume(flags["--resume"]);
         return 0;
     }
     if (has_flag(flags, "-h")) {
         help(argv[0]);
     }
-    execute(filename, shared_libraries);
+    execute(filename, shared_libraries, snapshot);
     return 0;
 }
\ No newline at end of file
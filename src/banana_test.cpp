@@ -2,22 +2,95 @@
 #include <sstream>
 #include <cstdio>
 #include <filesystem>
+#include <limits>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <unistd.h>
 #include <gtest/gtest.h>
+#include "lib/arrayutils.h"
+#include "lib/assembler.h"
 #include "lib/ast.h"
+#include "lib/byteutils.h"
+#include "lib/executable.h"
+#include "lib/hash_map.h"
 #include "lib/scanner.h"
 #include "lib/fileutils.h"
+#include "lib/input_buffer.h"
+#include "lib/module.h"
+#include "lib/output_buffer.h"
+#include "lib/output_sink.h"
 #include "lib/parser.h"
+#include "lib/textutils.h"
 #include "lib/vm.h"
 
 namespace {
+// Path in the temporary directory that no other test or test run uses, without a file yet.
+std::string temp_path() {
+    static int count = 0;
+    std::string name = "banana_test_" + std::to_string(getpid()) + "_" + std::to_string(count++);
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
 std::string exe(const std::string& code, const std::vector<std::string>& shared_libraries = std::vector<std::string>()) {
     std::vector<Token> tokens = scanner::scan(code.c_str());
     std::shared_ptr<AbstractSyntaxTree> root = parser::parse(tokens, shared_libraries);
-    std::stringstream ss;
-    auto origin = std::cout.rdbuf(ss.rdbuf());
-    Vm(Instruction::to_bytes(ast::to_instructions(root)), shared_libraries).execute();
-    std::cout.rdbuf(origin);
-    return ss.str();
+    auto sink = std::make_shared<MemorySink>();
+    Vm(module::link(module::compile(root)), shared_libraries, sink).execute();
+    return sink->get_content();
+}
+
+Module compile_module(const std::string& code) {
+    return module::compile(parser::parse(scanner::scan(code.c_str())));
+}
+
+std::string exe_linked(const std::string& code) {
+    auto sink = std::make_shared<MemorySink>();
+    Vm(module::link(compile_module(code)), {}, sink).execute();
+    return sink->get_content();
+}
+
+std::vector<uint8_t> assemble(const std::vector<std::string>& lines) {
+  std::vector<uint8_t> bytes;
+  for (const auto& line : lines) {
+    Instruction::from_string(line)->write(bytes);
+  }
+  return bytes;
+}
+
+// Runs every array operation on copies of the same random arrays with the current implementation.
+template <class T>
+std::vector<int64_t> array_results(const size_t& size) {
+  std::mt19937 random(size);
+  std::vector<T> a(size), b(size);
+  for (size_t i = 0; i < size; i++) {
+    a[i] = (T) random();
+    b[i] = (T) (random() % 7);
+  }
+  std::vector<int64_t> results = {arrayutils::sum(a.data(), size), arrayutils::dot(a.data(), b.data(), size), arrayutils::count(b.data(), size, (T) 3)};
+  if (size > 0) {
+    results.push_back(arrayutils::min(a.data(), size));
+    results.push_back(arrayutils::max(a.data(), size));
+  }
+  arrayutils::add(a.data(), size, (T) 12345);
+  arrayutils::mul(a.data(), b.data(), size);
+  arrayutils::mul(b.data(), size, (T) -3);
+  arrayutils::add(a.data(), b.data(), size);
+  arrayutils::sort(a.data(), size);
+  results.push_back(arrayutils::search(a.data(), size, size > 0 ? a[size / 2] : 0));
+  arrayutils::fill(b.data(), size / 2, (T) -7);
+  results.insert(results.end(), a.begin(), a.end());
+  results.insert(results.end(), b.begin(), b.end());
+  return results;
+}
+
+void expect_same_tokens(const std::vector<Token>& expected, const std::vector<Token>& actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        EXPECT_EQ(expected[i].type, actual[i].type);
+        EXPECT_EQ(expected[i].value, actual[i].value);
+        EXPECT_EQ(expected[i].line, actual[i].line);
+    }
 }
 
 TEST(Print, Literal) {
@@ -101,6 +174,47 @@ TEST(Expression, CrossType) {
   EXPECT_EQ("2\n", exe("int x = 1; long y = 1; long z = x + y; print z;"));
 }
 
+TEST(Expression, Double) {
+  EXPECT_EQ("0.30000000000000004\n", exe("print 0.1 + 0.2;"));
+  EXPECT_EQ("3.5\n-0.0025\n1e+300\n", exe("print 7 / 2.0; print -2.5e-3; print 1e300;"));
+  EXPECT_EQ("2.5\n", exe("double x = 5; long y = 2; print x / y;"));
+  EXPECT_EQ("true\nfalse\n", exe("double x = 1.5; print x < 2; print x == 1;"));
+  EXPECT_EQ("2\n", exe("double x = 2.75; long y = x; print y;"));
+  EXPECT_EQ("2.9289682539682538\n", exe("double s = 0; for (long i = 1; i <= 10; i++) { s += 1.0 / i; } print s;"));
+  EXPECT_EQ("12.25\n", exe("double square(double x) { return x * x; } print square(3.5);"));
+  EXPECT_EQ("-0\n-0\n-0.5\n-3\n", exe("print -0.0; double z = 0; print -z; print -0.5; long n = 3; double d = -n; print d;"));
+  // doubles are truncated where integers are expected
+  EXPECT_EQ("1\n-2\n3\n", exe("long x = 1.5; print x; int i = -2.9; print i; char c = 3.99; print c + 0;"));
+  EXPECT_EQ("false\ntrue\n", exe("double d = 0; bool b = d; print b; if (d + 0.5) { print true; }"));
+  // the operations on bits and the modulo are rejected by the parser, not only by the verifier
+  EXPECT_EXIT(compile_module("double x = 1.5; print x % 2;"), ::testing::ExitedWithCode(1), "");
+  EXPECT_EXIT(compile_module("double x = 1.5; print ~x;"), ::testing::ExitedWithCode(1), "");
+  EXPECT_EXIT(compile_module("double x = 1.5; print 1 | x;"), ::testing::ExitedWithCode(1), "");
+  EXPECT_EXIT(compile_module("double x = 1.5; x ^= 1;"), ::testing::ExitedWithCode(1), "");
+  EXPECT_EQ("1\n", exe("double x = 3.5; long y = x % 2; print y;"));
+}
+
+TEST(String, Values) {
+  EXPECT_EQ("hi\n2\ni\n", exe("string s = \"hi\"; print s; print string_length(s); print s[1];"));
+  EXPECT_EQ("true\nfalse\n", exe("string s = \"short\"; print s == \"short\"; print s != \"short\";"));
+  EXPECT_EQ("true\nfalse\n", exe("string s = \"a string that is interned\"; string t = \"another interned string\"; print s == \"a string that is interned\"; print s == t;"));
+  EXPECT_EQ("5\n", exe("long size(string s) { return string_length(s); } print size(\"hello\");"));
+  EXPECT_EQ("ab, a string that is interned\ntrue\n", exe("\
+    int b = string_builder(); \
+    string_append(b, \"ab\"); \
+    string_append_char(b, 44); \
+    string_append_char(b, 32); \
+    string_append(b, \"a string that is interned\"); \
+    string s = string_build(b); \
+    print s; \
+    print s == \"ab, a string that is interned\";"));
+  EXPECT_EXIT(exe("string s = \"hi\"; print s[2];"), ::testing::ExitedWithCode(1), "");
+  EXPECT_EXIT(exe("string s = \"hi\"; s[0] = 1;"), ::testing::ExitedWithCode(1), "");
+  EXPECT_EXIT(exe("string s = \"a\"; string t = \"b\"; print s + t;"), ::testing::ExitedWithCode(1), "");
+  EXPECT_EXIT(exe("string s = \"a\"; string t = \"b\"; print s < t;"), ::testing::ExitedWithCode(1), "");
+  EXPECT_EXIT(exe("long x = \"a\";"), ::testing::ExitedWithCode(1), "");
+}
+
 TEST(IfCondition, EvaluateCondition) {
   EXPECT_EQ("1\n", exe("if (1 == 1) { print 1; }"));
   EXPECT_EQ("", exe("if (1 == 2) { print 1; }"));
@@ -143,32 +257,826 @@ TEST(Function, Void) {
   EXPECT_EQ("true\n", exe("void hello() { print true; } hello();"));
 }
 
+TEST(Function, ParameterOrder) {
+  EXPECT_EQ("3\n", exe("long sub(long a, long b) { return a - b; } print sub(5, 2);"));
+  EXPECT_EQ("7\n", exe("long pick(bool first, long a, long b) { if (first) { return a; } return b; } print pick(false, 5, 7);"));
+}
+
 TEST(Function, ParametersConversion) {
   EXPECT_EQ("11\n", exe("long add(long x, long y) { return x + y; } int x = add(5, 6); print x;"));
   EXPECT_EQ("A\n", exe("long num() { return 65; } char z = num(); print z;"));
 }
 
+TEST(Array, IndexAndAssign) {
+  std::string sieve = "\
+    char[100] composite; \
+    long count = 0; \
+    for (long i = 2; i < 100; i++) { \
+      if (composite[i] == 0) { \
+        count++; \
+        for (long j = i * i; j < 100; j += i) { composite[j] = 1; } \
+      } \
+    } \
+    print count;";
+  EXPECT_EQ("25\n", exe(sieve));
+  EXPECT_EQ("285\n", exe("long total(long[] values) { long s = 0; for (long i = 0; i < 10; i++) { s += values[i]; } return s; } long[10] a; for (long i = 0; i < 10; i++) { a[i] = i; a[i] *= i; } print total(a);"));
+  EXPECT_EQ("17\n", exe("void fill(int[5] values) { for (long i = 0; i < 5; i++) { values[i] = i * i; } } int[5] a; fill(a); a[4]++; print a[4];"));
+  EXPECT_EXIT(exe("int[4] a; long i = 4; a[i] = 1;"), ::testing::ExitedWithCode(1), "");
+  EXPECT_EXIT(exe("void f(int[5] values) {} int[4] a; f(a);"), ::testing::ExitedWithCode(1), "");
+}
+
+TEST(Array, BulkBuiltins) {
+  std::string code = "\
+    long[100] a; \
+    long[100] b; \
+    for (long i = 0; i < 100; i++) { a[i] = 99 - i; b[i] = i % 3; } \
+    print array_sum(a); \
+    print array_dot(a, b); \
+    print array_count(b, 2); \
+    array_sort(a); \
+    print array_search(a, 42); \
+    array_mul(b, 2); \
+    array_add(a, b); \
+    print array_max(a); \
+    array_copy(b, a); \
+    array_fill(a, -1); \
+    print array_min(a) + array_sum(b);";
+  EXPECT_EQ("4950\n4884\n33\n42\n102\n5147\n", exe(code));
+  EXPECT_EXIT(exe("long[4] a; long[5] b; print array_dot(a, b);"), ::testing::ExitedWithCode(1), "");
+  EXPECT_EXIT(exe("long[4] a; array_sum(5);"), ::testing::ExitedWithCode(1), "");
+}
+
+TEST(Global, ReadAndWriteFromFunctions) {
+  std::string code = "\
+    long calls = 0; \
+    double scale = 0.5; \
+    string name = \"banana\"; \
+    long total = calls + 40; \
+    long count(long n) { calls++; total += n; return calls; } \
+    void rename() { name = \"split\"; } \
+    long shadow(long calls) { return calls; } \
+    count(1); \
+    count(2); \
+    rename(); \
+    print calls; \
+    print total * scale; \
+    print name; \
+    print shadow(7);";
+  EXPECT_EQ("2\n21.5\nsplit\n7\n", exe(code));
+  // literals are written to the data section, other values are stored by the code
+  Module module = compile_module("long x = 5; double y = 1.5; string s = \"a\"; long z = x + 1;");
+  ASSERT_EQ(4, module.globals.size());
+  EXPECT_EQ(5, module.globals[0].data._long);
+  EXPECT_EQ(1.5, module.globals[1].data._double);
+  EXPECT_EQ(0, module.globals[2].length);
+  EXPECT_EQ(0, module.globals[3].data._long);
+  // arrays and variables of blocks stay in the top-level frame
+  EXPECT_EXIT(exe("long[4] a; long f() { return a[0]; }"), ::testing::ExitedWithCode(1), "");
+  EXPECT_EXIT(exe("if (true) { long x = 1; } long f() { return x; }"), ::testing::ExitedWithCode(1), "");
+}
+
+TEST(HashMap, MatchesUnorderedMap) {
+  std::mt19937 random(7);
+  HashMap map;
+  std::unordered_map<int64_t, int64_t> expected;
+  for (int i = 0; i < 100000; i++) {
+    // few distinct keys, so that removals and puts hit keys already in the map
+    int64_t key = random() % 2000 - 1000;
+    if (i % 97 == 0) {
+      key = std::numeric_limits<int64_t>::min();
+    }
+    switch (random() % 3) {
+      case 0:
+        map.put(key, i);
+        expected[key] = i;
+        break;
+      case 1:
+        EXPECT_EQ(expected.erase(key) == 1, map.remove(key));
+        break;
+      default:
+        EXPECT_EQ(expected.count(key) == 1, map.contains(key));
+        EXPECT_EQ(expected.count(key) == 1 ? expected[key] : 0, map.get(key));
+    }
+    ASSERT_EQ(expected.size(), map.size());
+  }
+  auto entries = map.entries();
+  EXPECT_EQ(expected.size(), entries.size());
+  for (const auto& [key, value] : entries) {
+    EXPECT_EQ(expected[key], value);
+  }
+}
+
+TEST(Map, Builtins) {
+  std::string code = "\
+    int m = map_new(); \
+    for (long i = 0; i < 1000; i++) { long k = i % 7; map_put(m, k, map_get(m, k) + 1); } \
+    print map_size(m); \
+    print map_get(m, 3); \
+    print map_get(m, 100); \
+    print map_contains(m, 6); \
+    print map_remove(m, 6); \
+    print map_remove(m, 6); \
+    char c = 65; \
+    map_put(m, c, 1); \
+    print map_contains(m, 65); \
+    print map_size(m);";
+  EXPECT_EQ("7\n143\n0\ntrue\ntrue\nfalse\ntrue\n7\n", exe(code));
+  EXPECT_EXIT(exe("print map_get(3, 1);"), ::testing::ExitedWithCode(1), "");
+}
+
+TEST(Map, FreesMaps) {
+  // handles of freed maps are given again, to empty maps
+  std::string code = "\
+    for (long i = 0; i < 10000; i++) { int m = map_new(); map_put(m, i, i); map_free(m); } \
+    int a = map_new(); \
+    int b = map_new(); \
+    map_put(b, 1, 2); \
+    map_free(a); \
+    int c = map_new(); \
+    print c == a; \
+    print map_size(c); \
+    print map_get(b, 1);";
+  auto sink = std::make_shared<MemorySink>();
+  Vm vm(module::link(compile_module(code)), {}, sink);
+  vm.execute();
+  EXPECT_EQ("false\n0\n2\n", sink->get_content());
+  EXPECT_EQ(2, vm.maps.size());
+  // freed maps can't be used or freed again, even once their slot holds another map
+  EXPECT_EXIT(exe("int m = map_new(); map_free(m); print map_size(m);"), ::testing::ExitedWithCode(1), "");
+  EXPECT_EXIT(exe("int m = map_new(); map_free(m); map_free(m);"), ::testing::ExitedWithCode(1), "");
+  EXPECT_EXIT(exe("int m = map_new(); map_free(m); int n = map_new(); map_put(m, 1, 2);"), ::testing::ExitedWithCode(1), "");
+
+  // snapshots keep the freed slots and their generations
+  std::string filename = temp_path() + ".snap";
+  Vm saved(module::link(compile_module("\
+    int a = map_new(); int b = map_new(); int c = map_new(); \
+    map_put(b, 5, 6); map_free(c); map_free(a); \
+    snapshot; \
+    print map_new(); print map_new(); print map_new(); print map_get(b, 5);")), {}, sink);
+  saved.snapshot_path = filename;
+  saved.execute();
+  testing::internal::CaptureStdout();
+  Vm::resume(fileutils::map_file(filename))->execute();
+  // the slots are given again with their next generation
+  EXPECT_EQ("16777216\n16777218\n3\n6\n", testing::internal::GetCapturedStdout());
+  std::remove(filename.c_str());
+}
+
+TEST(Struct, FieldsAndCalls) {
+  std::string code = "\
+    struct Point { long x; long y; } \
+    struct Segment { Point from; Point to; string name; } \
+    Point add(Point a, Point b) { Point c; c.x = a.x + b.x; c.y = a.y + b.y; return c; } \
+    long length2(Segment s) { long dx = s.to.x - s.from.x; long dy = s.to.y - s.from.y; return dx * dx + dy * dy; } \
+    Segment segment(Point a, Point b) { Segment s; s.from = a; s.to = b; s.name = \"seg\"; return s; } \
+    Point p; \
+    print p.x; \
+    p.x = 3; \
+    p.y = 4; \
+    Point q = p; \
+    q.x++; \
+    q.y *= 2; \
+    Point r = add(p, q); \
+    print r.y; \
+    Segment s = segment(p, r); \
+    print length2(s); \
+    print s.name; \
+    add(p, q); \
+    print s.to.x;";
+  EXPECT_EQ("0\n12\n80\nseg\n7\n", exe(code));
+  // fields of returned structs are read from the call
+  std::string make = "struct P { long x; long y; } struct S { P p; string name; } P make(long x) { P p; p.x = x; p.y = x * 2; return p; } ";
+  EXPECT_EQ("14\n3\n2.5\n", exe(make + "print make(4).x + make(5).y; long s = 0; for (long i = 0; i < 3; i++) { s += make(i).y - make(i).x; } print s; print make(1).y + 0.5;"));
+  EXPECT_EQ("7\nab\n", exe(make + "S named() { S s; s.p = make(7); s.name = \"ab\"; return s; } print named().p.x; print named().name;"));
+  EXPECT_EXIT(exe(make + "print make(1);"), ::testing::ExitedWithCode(1), "");
+  EXPECT_EXIT(exe(make + "S named() { S s; return s; } long x = named().p;"), ::testing::ExitedWithCode(1), "");
+  EXPECT_EXIT(exe("struct P { long x; } P p; print p;"), ::testing::ExitedWithCode(1), "");
+  EXPECT_EXIT(exe("struct P { long x; } P p; print p.y;"), ::testing::ExitedWithCode(1), "");
+  EXPECT_EXIT(exe("struct P { long x; } struct Q { long x; } long f(P p) { return p.x; } Q q; f(q);"), ::testing::ExitedWithCode(1), "");
+  EXPECT_EXIT(exe("struct P { long x; } P p; P q; p += q;"), ::testing::ExitedWithCode(1), "");
+}
+
+TEST(ArrayUtils, VectorizedMatchesScalar) {
+  auto implementation = arrayutils::get_implementation();
+  for (size_t size : {0, 1, 7, 31, 32, 33, 100, 1000}) {
+    arrayutils::set_implementation(arrayutils::SCALAR);
+    auto chars = array_results<int8_t>(size);
+    auto ints = array_results<int32_t>(size);
+    auto longs = array_results<int64_t>(size);
+    for (auto vectorized : {arrayutils::SSE2, arrayutils::AVX2}) {
+      if (arrayutils::is_supported(vectorized)) {
+        arrayutils::set_implementation(vectorized);
+        EXPECT_EQ(chars, array_results<int8_t>(size));
+        EXPECT_EQ(ints, array_results<int32_t>(size));
+        EXPECT_EQ(longs, array_results<int64_t>(size));
+      }
+    }
+  }
+  arrayutils::set_implementation(implementation);
+}
+
 TEST(NATIVE, PRIMES) {
   std::string cwd = std::filesystem::current_path();
   std::string include = cwd + "/src/lib/c_interface.h";
   std::string code =
     "#include \"" + include + "\"\n"
     "long twice(long n) { return 2 * n; } "
+    "int combine(char a, int b, long c) { return a * 100 + b * 10 + c; } "
+    "double scale(double x, int n) { return x * n; } "
+    "long sum(cinterface::Array<const long> values) { long s = 0; for (long i = 0; i < values.size; i++) { s += values.data[i]; } return s; } "
+    "long fill(cinterface::Array<long> values) { for (long i = 0; i < values.size; i++) { values.data[i] = i; } return values.size; } "
     "class MyNativeFunction : public CInterface { "
     "   cinterface::ArgType get_return_type() const { return cinterface::LONG; } "
     "   std::vector<cinterface::ArgType> get_arg_types() const { return {cinterface::LONG}; } "
     "   std::string get_name() const { return \"math::twice\"; } "
     "   void* get_function() const { return (void*) twice; } "
     "}; "
-    "std::vector<CInterface*> get_classes() { return {new MyNativeFunction()}; }";
-  std::string tmp = std::tmpnam(nullptr);
+    "class Combine : public CInterface { "
+    "   cinterface::ArgType get_return_type() const { return cinterface::INT; } "
+    "   std::vector<cinterface::ArgType> get_arg_types() const { return {cinterface::CHAR, cinterface::INT, cinterface::LONG}; } "
+    "   std::string get_name() const { return \"math::combine\"; } "
+    "   void* get_function() const { return (void*) combine; } "
+    "}; "
+    "class Scale : public CInterface { "
+    "   cinterface::ArgType get_return_type() const { return cinterface::DOUBLE; } "
+    "   std::vector<cinterface::ArgType> get_arg_types() const { return {cinterface::DOUBLE, cinterface::INT}; } "
+    "   std::string get_name() const { return \"math::scale\"; } "
+    "   void* get_function() const { return (void*) scale; } "
+    "}; "
+    "class Sum : public CInterface { "
+    "   cinterface::ArgType get_return_type() const { return cinterface::LONG; } "
+    "   std::vector<cinterface::ArgType> get_arg_types() const { return {cinterface::CONST_LONG_ARRAY}; } "
+    "   std::string get_name() const { return \"math::sum\"; } "
+    "   void* get_function() const { return (void*) sum; } "
+    "}; "
+    "std::vector<CInterface*> get_classes() { "
+    "   return {new MyNativeFunction(), new Combine(), new CFunction<combine>(\"math::combine_direct\"), "
+    "           new Scale(), new CFunction<scale>(\"math::scale_direct\"), "
+    "           new Sum(), new CFunction<sum>(\"math::sum_direct\"), new CFunction<fill>(\"math::fill\")}; "
+    "}";
+  std::string tmp = temp_path();
   std::string source = tmp + ".cpp";
   std::string compiled = tmp + ".so";
   fileutils::write_lines({code}, source);
-  std::string cmd = "g++ " + source + " -o " + compiled + " -shared -fPIC";
+  std::string cmd = "g++ -std=c++17 " + source + " -o " + compiled + " -shared -fPIC";
   EXPECT_EQ(system(cmd.c_str()), 0);
 
   EXPECT_EQ("200\n", exe("@native(\"math::twice\") long twice(long n); print twice(100);", {compiled}));
+  EXPECT_EQ("200\n", exe("@native(\"math::twice\") long twice(long n); long g = twice(100); print g;", {compiled}));
+  EXPECT_EQ("-77\n", exe("@native(\"math::combine\") int combine(char a, int b, long c); print combine(-1, 2, 3);", {compiled}));
+  EXPECT_EQ("-77\n", exe("@native(\"math::combine_direct\") int combine(char a, int b, long c); print combine(-1, 2, 3);", {compiled}));
+  EXPECT_EQ("3.75\n", exe("@native(\"math::scale\") double scale(double x, int n); print scale(1.25, 3);", {compiled}));
+  // arguments are evaluated in source order, like the ones of Banana functions
+  std::string next = "long n = 0; long next() { n++; return n; } ";
+  EXPECT_EQ("123\n", exe("@native(\"math::combine\") int combine(char a, int b, long c); " + next + "print combine(next(), next(), next());", {compiled}));
+  EXPECT_EQ("123\n", exe("@native(\"math::combine_direct\") int combine(char a, int b, long c); " + next + "print combine(next(), next(), next());", {compiled}));
+  EXPECT_EQ("3.75\n", exe("@native(\"math::scale_direct\") double scale(double x, int n); print scale(1.25, 3);", {compiled}));
+
+  // arrays are passed as a pointer to the mapped file and a length
+  std::string filename = tmp + ".bin";
+  std::vector<uint8_t> longs;
+  for (long i = 1; i <= 100; i++) {
+    byteutils::push_long(longs, i);
+  }
+  fileutils::write_bytes(longs, filename);
+  std::string map = "int f = map_file(\"" + filename + "\"); ";
+  std::string total = "long total(long[] values) { return sum(values); } ";
+  EXPECT_EQ("5050\n", exe("@native(\"math::sum\") long sum(long[] values); " + map + "print sum(mapped_slice(f, 0, mapped_size(f)));", {compiled}));
+  EXPECT_EQ("15\n", exe("@native(\"math::sum_direct\") long sum(long[] values); " + total + map + "print total(mapped_slice(f, 0, 43));", {compiled}));
+  EXPECT_EXIT(exe("@native(\"math::sum\") long sum(long[] values); " + map + "print sum(mapped_slice(f, 8, 800));", {compiled}), ::testing::ExitedWithCode(1), "");
+  // only functions taking const arrays get the read-only memory of mapped files
+  std::string fill = "@native(\"math::fill\") long fill(long[] values); ";
+  EXPECT_EQ("3\n2\n", exe(fill + "long[3] a; print fill(a); print a[2];", {compiled}));
+  EXPECT_EXIT(exe(fill + map + "print fill(mapped_slice(f, 0, 16));", {compiled}), ::testing::ExitedWithCode(1), "");
+  std::remove(filename.c_str());
+
+  // libraries are opened only until the function is found, and the program records it
+  std::string missing = tmp + "_missing.so";
+  std::string twice = "@native(\"math::twice\") long twice(long n); print twice(21);";
+  auto bytes = module::link(module::compile(parser::parse(scanner::scan(twice.c_str()), {compiled, missing})));
+  Executable executable = executable::from_bytes(bytes.data(), bytes.size());
+  ASSERT_EQ(1, executable.natives.size());
+  EXPECT_EQ("math::twice", executable.natives[0].name);
+  EXPECT_EQ(compiled, executable.natives[0].library);
+  EXPECT_EQ(var::LONG, executable.natives[0].return_type);
+  // the call site calls the native function directly, not its wrapper
+  std::stringstream listing;
+  assembler::disassemble(executable, listing);
+  EXPECT_EQ(std::string::npos, listing.str().find("call"));
+  EXPECT_NE(std::string::npos, listing.str().find("@native long \"math::twice\""));
+  EXPECT_EQ(bytes, assembler::assemble(listing));
+  auto sink = std::make_shared<MemorySink>();
+  Vm(bytes, {missing}, sink).execute();
+  EXPECT_EQ("42\n", sink->get_content());
+  // the library must return the type the program was compiled with
+  executable.natives[0].return_type = var::INT;
+  auto changed = executable::to_bytes(executable);
+  EXPECT_EXIT(Vm(changed, {}, sink).execute(), ::testing::ExitedWithCode(1), "");
+  std::remove(source.c_str());
+  std::remove(compiled.c_str());
+}
+
+TEST(Module, ImportAndLink) {
+  std::string utils = temp_path();
+  module::write(compile_module("long square(long n) { return n * n; } long cube(long n) { return n * square(n); }"), module::filename(utils));
+  std::string math = temp_path();
+  module::write(compile_module("import \"" + utils + "\"; long twice(long n) { return 2 * square(n); }"), module::filename(math));
+
+  EXPECT_EQ("27\n", exe_linked("import \"" + utils + "\"; print cube(3);"));
+  EXPECT_EQ("18\n", exe_linked("import \"" + math + "\"; print twice(3);"));
+  EXPECT_EQ("35\n", exe_linked("import \"" + utils + "\"; int main() { long x = cube(3); print x + square(2) * 2; }"));
+
+  // each module has its own globals
+  std::string counter = temp_path();
+  module::write(compile_module("long count = 10; long next() { count++; return count; }"), module::filename(counter));
+  EXPECT_EQ("112\n", exe_linked("import \"" + counter + "\"; long count = 100; next(); print count + next();"));
+
+  // imports are relative to the directory of the importing file, the one of modules included
+  std::string directory = temp_path();
+  std::filesystem::create_directories(directory + "/lib");
+  module::write(compile_module("long half(long n) { return n / 2; }"), module::filename(directory + "/lib/half"));
+  module::write(module::compile(parser::parse(scanner::scan("import \"half\"; long quarter(long n) { return half(half(n)); }"), {}, directory + "/lib")),
+    module::filename(directory + "/lib/quarter"));
+  auto main = module::compile(parser::parse(scanner::scan("import \"lib/quarter\"; import \"./lib/half\"; print quarter(20) + half(2);"), {}, directory));
+  auto sink = std::make_shared<MemorySink>();
+  Vm(module::link(main, directory), {}, sink).execute();
+  EXPECT_EQ("6\n", sink->get_content());
+  std::filesystem::remove_all(directory);
+  for (const auto& path : {utils, math, counter}) {
+    std::remove(module::filename(path).c_str());
+  }
+}
+
+TEST(Module, LinkWithoutImports) {
+  std::string code = "long add(long a, long b) { return a + b; } for (long i = 0; i < 3; i++) { print add(i, 1); }";
+  auto tree = parser::parse(scanner::scan(code.c_str()));
+  std::vector<uint8_t> program = module::link(compile_module(code));
+  Executable executable = executable::from_bytes(program.data(), program.size());
+  EXPECT_EQ(Instruction::to_bytes(ast::to_instructions(tree)), std::vector<uint8_t>(executable.code, executable.code + executable.code_size));
+  EXPECT_EQ("1\n2\n3\n", exe_linked(code));
+}
+
+TEST(Module, RejectsMalformedModule) {
+  Module module = compile_module("long x = 2; string s = \"hello world\"; long twice(long a) { return 2 * a; } print twice(x);");
+  std::vector<uint8_t> bytes = module::to_bytes(module);
+  EXPECT_EQ(bytes, module::to_bytes(module::from_bytes(bytes)));
+  for (size_t size = module::MAGIC.size() + 1; size < bytes.size(); size += bytes.size() / 16) {
+    std::vector<uint8_t> truncated(bytes.begin(), bytes.begin() + size);
+    EXPECT_EXIT(module::from_bytes(truncated), ::testing::ExitedWithCode(1), "");
+  }
+
+  Module bad_type = module;
+  bad_type.exports[0].parameter_types[0] = ast::VOID;
+  EXPECT_EXIT(module::from_bytes(module::to_bytes(bad_type)), ::testing::ExitedWithCode(1), "");
+
+  Module bad_relocation = module;
+  bad_relocation.relocations[0].offset = module.code.size() - 2;
+  EXPECT_EXIT(module::link(module::from_bytes(module::to_bytes(bad_relocation))), ::testing::ExitedWithCode(1), "");
+}
+
+TEST(Executable, FunctionTable) {
+  std::string code = "long add(long a, long b) {\n  long c = a + b;\n  return c;\n}\nlong x = 1;\nlong y = 2;\nadd(x, y);\nprint add(x, add(x, y));\n";
+  std::vector<uint8_t> program = module::link(compile_module(code));
+  ASSERT_TRUE(executable::is_container(program.data(), program.size()));
+  Executable executable = executable::from_bytes(program.data(), program.size());
+
+  ASSERT_EQ(2, executable.functions.size());
+  const auto& top_level = executable.functions[0];
+  EXPECT_EQ(0, top_level.entry);
+  // x and y are globals
+  EXPECT_EQ(0, top_level.frame_size);
+  // arguments are pushed in order, x stays on the stack during the inner call
+  EXPECT_EQ(3, top_level.max_stack);
+  const auto& add = executable.functions[1];
+  EXPECT_EQ(2, add.params);
+  EXPECT_EQ(1, add.returns);
+  EXPECT_EQ(3, add.frame_size);
+  EXPECT_EQ(2, add.max_stack);
+
+  ASSERT_EQ(7, executable.lines.size());
+  EXPECT_EQ(2, executable.lines[1].line);
+  EXPECT_EQ(5, executable.lines[3].line);
+
+  // the unused result of the statement call is popped, only the printed one remains
+  Vm vm(program);
+  testing::internal::CaptureStdout();
+  vm.execute();
+  EXPECT_EQ("4\n", testing::internal::GetCapturedStdout());
+  EXPECT_TRUE(vm.stack->empty());
+}
+
+TEST(Executable, RecognizesContainers) {
+  std::vector<uint8_t> program = module::link(compile_module("print 1;"));
+  EXPECT_TRUE(executable::is_container(program.data(), program.size()));
+  // the magic alone, or followed by a version that was never written, isn't a container
+  std::vector<uint8_t> magic(executable::MAGIC.begin(), executable::MAGIC.end());
+  EXPECT_FALSE(executable::is_container(magic.data(), magic.size()));
+  magic.push_back(0);
+  EXPECT_FALSE(executable::is_container(magic.data(), magic.size()));
+  magic.back() = executable::VERSION + 1;
+  EXPECT_FALSE(executable::is_container(magic.data(), magic.size()));
+  // containers of earlier versions are recognized, then rejected
+  program[executable::MAGIC.size()] = executable::FIRST_VERSION;
+  EXPECT_TRUE(executable::is_container(program.data(), program.size()));
+  EXPECT_EXIT(executable::from_bytes(program.data(), program.size()), ::testing::ExitedWithCode(1), "");
+}
+
+TEST(Scanner, VectorizedMatchesScalar) {
+  std::vector<std::string> corpus = {
+    fileutils::read_string("benchmarks/fib.na"),
+    fileutils::read_string("benchmarks/primes.na"),
+    fileutils::read_string("benchmarks/while_loop.na"),
+    "long a_very_long_identifier_name_that_spans_several_vector_blocks = 12345678901234567890123456789012345;",
+    "print   \t\t  \r\n\n\n                                         \n\n  x;\n",
+    "@native(\"some::function_with_a_long_name_exceeding_thirty_two_bytes\") long f(long n);",
+    "@native(\"escaped \\\" quote and \\\\ backslash, long enough to need several blocks\") long g();",
+  };
+  std::string all;
+  for (const auto& code : corpus) {
+    all += code + "\n";
+  }
+  corpus.push_back(all);
+
+  auto implementation = textutils::get_implementation();
+  for (const auto& code : corpus) {
+    textutils::set_implementation(textutils::SCALAR);
+    auto expected = scanner::scan(code);
+    for (auto vectorized : {textutils::SSE2, textutils::AVX2}) {
+      if (textutils::is_supported(vectorized)) {
+        textutils::set_implementation(vectorized);
+        expect_same_tokens(expected, scanner::scan(code));
+      }
+    }
+  }
+  textutils::set_implementation(implementation);
+}
+
+TEST(Vm, ExecuteMappedFile) {
+  std::string code = "long add(long a, long b) { return a + b; } print add(20, 22);";
+  std::string filename = temp_path() + ".obj";
+  fileutils::write_bytes(module::link(compile_module(code)), filename);
+
+  testing::internal::CaptureStdout();
+  Vm(fileutils::map_file(filename)).execute();
+  EXPECT_EQ("42\n", testing::internal::GetCapturedStdout());
+  std::remove(filename.c_str());
+}
+
+TEST(Vm, ExecuteFlatProgramOfFirstCompiler) {
+  // src/testdata/legacy.na compiled by the first version of the compiler, before the container format
+  std::vector<uint8_t> program = fileutils::read_bytes("src/testdata/legacy.obj");
+  ASSERT_FALSE(executable::is_container(program.data(), program.size()));
+
+  testing::internal::CaptureStdout();
+  Vm(program).execute();
+  // the first VM reversed the arguments of calls, sub(10, 3) gave -7 instead of 7
+  EXPECT_EQ("1\n2\n3\n5\n8\n13\n21\n34\n55\n7\ntrue\nA\n128\n", testing::internal::GetCapturedStdout());
+}
+
+TEST(Vm, ResumesFromSnapshot) {
+  std::string code = "\
+    long calls = 0; \
+    long f(long a) { \
+      calls++; \
+      long b = a * 2; \
+      snapshot; \
+      return b + calls; \
+    } \
+    long x = 4; \
+    print f(x) + x;";
+  std::string filename = temp_path() + ".snap";
+  Vm vm(module::link(compile_module(code)));
+  vm.snapshot_path = filename;
+  vm.execute();
+  EXPECT_TRUE(vm.snapshot_path.empty());
+
+  testing::internal::CaptureStdout();
+  auto resumed = Vm::resume(fileutils::map_file(filename));
+  EXPECT_EQ(2, resumed->heaps.size());
+  resumed->execute();
+  EXPECT_EQ("13\n", testing::internal::GetCapturedStdout());
+  std::remove(filename.c_str());
+  EXPECT_EQ("13\n", exe(code));
+}
+
+TEST(Vm, RejectsCorruptedSnapshot) {
+  std::string code = "\
+    long calls = 0; \
+    long f(long a) { \
+      calls++; \
+      long b = a * 2; \
+      snapshot; \
+      return b + calls; \
+    } \
+    long x = 4; \
+    print f(x) + x;";
+  std::string filename = temp_path() + ".snap";
+  Vm vm(module::link(compile_module(code)));
+  vm.snapshot_path = filename;
+  vm.execute();
+  const std::vector<uint8_t> snapshot = fileutils::read_bytes(filename);
+  // corrupted snapshots are rejected when they are loaded, before running
+  auto resume = [&](const std::vector<uint8_t>& bytes) {
+    fileutils::write_bytes(bytes, filename);
+    return Vm::resume(fileutils::map_file(filename));
+  };
+
+  // the executable, then no libraries, mapped files, builders nor maps before the ip
+  uint64_t ip = snapshot::MAGIC.size() + SIZE_OF_BYTE + SIZE_OF_LONG + byteutils::read_ulong(snapshot.data(), snapshot::MAGIC.size() + SIZE_OF_BYTE) + 4 * SIZE_OF_LONG;
+  std::vector<uint8_t> bytes = snapshot;
+  byteutils::write_ulong(bytes, ip, byteutils::read_ulong(snapshot.data(), ip) + 1);
+  EXPECT_EXIT(resume(bytes), ::testing::ExitedWithCode(1), "");
+  // the return address of the call to f follows the number of return addresses
+  bytes = snapshot;
+  uint64_t return_address = ip + 2 * SIZE_OF_LONG;
+  byteutils::write_ulong(bytes, return_address, byteutils::read_ulong(snapshot.data(), return_address) - 1);
+  EXPECT_EXIT(resume(bytes), ::testing::ExitedWithCode(1), "");
+  // b is a long in f
+  bytes = snapshot;
+  std::vector<uint8_t> b;
+  var::push(var::create_long(8), b);
+  auto local = std::search(bytes.begin() + ip, bytes.end(), b.begin(), b.end());
+  ASSERT_NE(bytes.end(), local);
+  *local = var::DOUBLE;
+  EXPECT_EXIT(resume(bytes), ::testing::ExitedWithCode(1), "");
+
+  testing::internal::CaptureStdout();
+  resume(snapshot)->execute();
+  EXPECT_EQ("13\n", testing::internal::GetCapturedStdout());
+  std::remove(filename.c_str());
+}
+
+TEST(Output, FlushesByPolicy) {
+  std::string filename = temp_path();
+  FILE* file = fopen(filename.c_str(), "w+");
+  {
+    OutputBuffer output(std::make_shared<FileSink>(fileno(file)));
+    EXPECT_EQ(output::BLOCK, output.get_policy());
+    output.write(var::create_long(-9223372036854775807L - 1));
+    output.write(" ", 1);
+    output.write(var::create_bool(false));
+    output.write(var::create_char('\n'));
+    EXPECT_EQ("", fileutils::read_string(filename));
+    output.flush();
+    EXPECT_EQ("-9223372036854775808 false\n", fileutils::read_string(filename));
+
+    output.set_policy(output::LINE);
+    output.write(var::create_int(42));
+    EXPECT_EQ("-9223372036854775808 false\n", fileutils::read_string(filename));
+    output.write("\n", 1);
+    EXPECT_EQ("-9223372036854775808 false\n42\n", fileutils::read_string(filename));
+
+    output.set_policy(output::BLOCK);
+    std::string large(OutputBuffer::CAPACITY + 1, 'x');
+    output.write(large.data(), large.size());
+    EXPECT_EQ(30 + large.size(), fileutils::read_string(filename).size());
+    output.write("end", 3);
+  }
+  EXPECT_EQ(33 + OutputBuffer::CAPACITY + 1, fileutils::read_string(filename).size());
+  fclose(file);
+  std::remove(filename.c_str());
+}
+
+TEST(Output, SeparateSinksPerVm) {
+  auto program = module::link(compile_module("long s = 0; for (long i = 0; i < 1000; i++) { s += i; print s; }"));
+  std::string expected = exe_linked("long s = 0; for (long i = 0; i < 1000; i++) { s += i; print s; }");
+  std::vector<std::shared_ptr<MemorySink>> sinks;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    sinks.push_back(std::make_shared<MemorySink>());
+    threads.emplace_back([&program, sink = sinks.back()]() { Vm(program, {}, sink).execute(); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& sink : sinks) {
+    EXPECT_EQ(expected, sink->get_content());
+  }
+
+  std::vector<std::string> chunks;
+  auto callback = std::make_shared<CallbackSink>([&chunks](const char* data, size_t size) { chunks.emplace_back(data, size); });
+  Vm vm(module::link(compile_module("print 1; flush; print 2;")), {}, callback);
+  vm.output.set_policy(output::BLOCK);
+  vm.execute();
+  EXPECT_EQ(std::vector<std::string>({"1\n", "2\n"}), chunks);
+}
+
+std::string exe_with_input(const std::string& code, const std::string& input) {
+  std::string filename = temp_path();
+  fileutils::write_bytes(std::vector<uint8_t>(input.begin(), input.end()), filename);
+  FILE* file = fopen(filename.c_str(), "r");
+  auto sink = std::make_shared<MemorySink>();
+  Vm vm(module::link(compile_module(code)), {}, sink);
+  vm.input.set_fd(fileno(file));
+  vm.execute();
+  fclose(file);
+  std::remove(filename.c_str());
+  return sink->get_content();
+}
+
+TEST(Input, ReadBuiltins) {
+  std::string sum = "long s = 0; while (!eof()) { s += read_long(); } print s;";
+  EXPECT_EQ("6\n", exe_with_input(sum, "1 2\n3\n"));
+  EXPECT_EQ("0\n", exe_with_input(sum, ""));
+  EXPECT_EQ("-9223372036854775808\n", exe_with_input(sum, "  -9223372036854775808  \n"));
+  EXPECT_EQ("12\n \na\n", exe_with_input("int x = read_int(); read_char(); char c = read_char(); print x; print \" \"; print c;", "12 a"));
+  // input that isn't an integer stops the program instead of being read as 0 forever
+  EXPECT_EXIT(exe_with_input(sum, "1 abc"), ::testing::ExitedWithCode(1), "");
+  EXPECT_EXIT(exe_with_input("print read_int();", "-x"), ::testing::ExitedWithCode(1), "");
+
+  // numbers spanning several blocks of the buffer
+  std::string input;
+  long expected = 0;
+  for (long i = 0; i < 300000; i++) {
+    input += std::to_string(i * 7) + (i % 10 == 0 ? "\n" : " ");
+    expected += i * 7;
+  }
+  ASSERT_GT(input.size(), InputBuffer::CAPACITY);
+  EXPECT_EQ(std::to_string(expected) + "\n", exe_with_input(sum, input));
+}
+
+TEST(Input, MappedFileBuiltins) {
+  std::string filename = temp_path();
+  std::vector<uint8_t> bytes = {'a', 0xff};
+  byteutils::push_int(bytes, -5);
+  byteutils::push_long(bytes, 1L << 40);
+  fileutils::write_bytes(bytes, filename);
+  std::string map = "int f = map_file(\"" + filename + "\");";
+  EXPECT_EQ("14\n97\n255\n-5\n1099511627776\n", exe(map + "\
+    print mapped_size(f); \
+    print mapped_byte(f, 0); \
+    print mapped_byte(f, 1); \
+    print mapped_int(f, 2); \
+    print mapped_long(f, 6);"));
+  EXPECT_EXIT(exe(map + "print mapped_long(f, 7);"), ::testing::ExitedWithCode(1), "");
+  EXPECT_EXIT(exe(map + "print mapped_byte(f + 1, 0);"), ::testing::ExitedWithCode(1), "");
+  std::remove(filename.c_str());
+}
+
+TEST(Vm, RejectsMalformedProgram) {
+  auto bytes = module::link(compile_module("print 1;"));
+  std::vector<uint8_t> truncated(bytes.begin(), bytes.begin() + 3);
+  EXPECT_EXIT(Vm{truncated}, ::testing::ExitedWithCode(1), "");
+  std::vector<uint8_t> unterminated(bytes.begin(), bytes.end() - 1);
+  EXPECT_EXIT(Vm{unterminated}, ::testing::ExitedWithCode(1), "");
+  EXPECT_EXIT(Vm{std::vector<uint8_t>({OP_JUMP, 0xff, 0, 0, 0, 0, 0, 0, 0})}, ::testing::ExitedWithCode(1), "");
+}
+
+TEST(Assembler, ResolvesForwardLabels) {
+  std::stringstream listing(
+    "; counts down from 3\n"
+    "push long 3\n"
+    "store 0\n"
+    ".loop\n"
+    "load 0\n"
+    "push long 0\n"
+    "gt\n"
+    "jump_if_false .end   ; forward reference\n"
+    "load 0\n"
+    "print\n"
+    "load 0\n"
+    "push long 1\n"
+    "sub\n"
+    "store 0\n"
+    "jump .loop\n"
+    ".end\n"
+    "halt\n"
+  );
+  auto bytes = assembler::assemble(listing);
+  testing::internal::CaptureStdout();
+  Vm(bytes).execute();
+  EXPECT_EQ("321", testing::internal::GetCapturedStdout());
+}
+
+TEST(Assembler, DisassemblyRoundTrips) {
+  auto program = module::link(compile_module("long x = 7; for (int i = 0; i < 3; i++) { x = x * 3; } print x;"));
+  Executable executable = executable::from_bytes(program.data(), program.size());
+  std::stringstream listing;
+  assembler::disassemble(executable, listing);
+  EXPECT_NE(std::string::npos, listing.str().find("push_const 2\t; long 3"));
+  EXPECT_EQ(program, assembler::assemble(listing));
+
+  // the sections are read back, so the reassembled program runs like the compiled one
+  std::string code = "\
+    string s = \"a; \\\"b\\\"\\t\"; \
+    long sub(long a, long b) { return a - b; } \
+    double half(long n) { return n / 2.0; } \
+    print sub(10, 3); \
+    print half(7); \
+    print s; \
+    s = \"longer than eight bytes\"; \
+    print s;";
+  program = module::link(compile_module(code));
+  listing = std::stringstream();
+  assembler::disassemble(executable::from_bytes(program.data(), program.size()), listing);
+  std::vector<uint8_t> reassembled = assembler::assemble(listing);
+  EXPECT_EQ(program, reassembled);
+  auto sink = std::make_shared<MemorySink>();
+  Vm(reassembled, {}, sink).execute();
+  EXPECT_EQ("7\n3.5\na; \"b\"\t\nlonger than eight bytes\n", sink->get_content());
+
+  // strings keep the characters that end lines and quotes
+  std::vector<uint8_t> code_bytes = assemble({"halt"});
+  Executable strings;
+  strings.code = code_bytes.data();
+  strings.code_size = code_bytes.size();
+  strings.strings = {std::string("\x01\x7f;\\\n", 5), ""};
+  strings.natives = {{"math::f", "/tmp/a \"b\".so"}};
+  listing = std::stringstream();
+  assembler::disassemble(strings, listing);
+  std::vector<uint8_t> bytes = assembler::assemble(listing);
+  Executable read = executable::from_bytes(bytes.data(), bytes.size());
+  EXPECT_EQ(strings.strings, read.strings);
+  ASSERT_EQ(1, read.natives.size());
+  EXPECT_EQ("/tmp/a \"b\".so", read.natives[0].library);
+}
+
+TEST(Verifier, AcceptsIntegerConditions) {
+  // integers and doubles are true when they are not zero, in conditions and in bools
+  EXPECT_EQ("1\n", exe("long a = 2; if (a) { print 1; }"));
+  EXPECT_EQ("0\n", exe("long n = 3; while (n) { n--; } print n;"));
+  EXPECT_EQ("5\n", exe("long n = 0; if (!n) { print 5; }"));
+  EXPECT_EQ("true\n", exe("long a = 2; bool b = a; print b;"));
+  EXPECT_EQ("2\n1\n", exe("for (int i = 2; i; i--) { print i; }"));
+  EXPECT_EQ("true\n", exe("bool f(long x) { return x; } print f(256);"));
+  EXPECT_EQ("7\n", exe("void f() { long a = 256; char c = 1; if (a and c) { print 7; } } f();"));
+  EXPECT_EQ("1\nfalse\n", exe("double d = 0.5; if (d) { print 1; } bool b = d - 0.5; print b;"));
+}
+
+TEST(Verifier, RejectsUnsafeBytecode) {
+  // operand stack underflow
+  EXPECT_EXIT(Vm{assemble({"push long 1", "add", "halt"})}, ::testing::ExitedWithCode(1), "");
+  // jump into the operand of an instruction
+  EXPECT_EXIT(Vm{assemble({"jump 1", "halt"})}, ::testing::ExitedWithCode(1), "");
+  // load of a local never stored
+  EXPECT_EXIT(Vm{assemble({"load 0", "print", "halt"})}, ::testing::ExitedWithCode(1), "");
+  // condition that is not a bool
+  EXPECT_EXIT(Vm{assemble({"push long 1", "jump_if 19", "halt"})}, ::testing::ExitedWithCode(1), "");
+  // stack growing on each iteration of a loop
+  EXPECT_EXIT(Vm{assemble({"push long 1", "jump 0"})}, ::testing::ExitedWithCode(1), "");
+  // return from the top-level code
+  EXPECT_EXIT(Vm{assemble({"ret 0"})}, ::testing::ExitedWithCode(1), "");
+  // elements of an array read as a local
+  EXPECT_EXIT(Vm{assemble({"new_array 0 16", "load 1", "print", "halt"})}, ::testing::ExitedWithCode(1), "");
+  // long used as an array
+  EXPECT_EXIT(Vm{assemble({"push long 1", "array_sum long", "halt"})}, ::testing::ExitedWithCode(1), "");
+  // bits of a double
+  EXPECT_EXIT(Vm{assemble({"push double 1.5", "push long 1", "xor", "print", "halt"})}, ::testing::ExitedWithCode(1), "");
+  // long used as a string
+  EXPECT_EXIT(Vm{assemble({"push long 1", "string_length", "print", "halt"})}, ::testing::ExitedWithCode(1), "");
+  // index into a local that is not an array
+  EXPECT_EXIT(Vm{assemble({"push long 0", "store 0", "push long 0", "load_index 0 long", "halt"})}, ::testing::ExitedWithCode(1), "");
+  // global outside of the data section
+  EXPECT_EXIT(Vm{assemble({"push long 1", "store_global 0", "halt"})}, ::testing::ExitedWithCode(1), "");
+  // double stored into a long global
+  std::vector<uint8_t> code = assemble({"push double 1.5", "store_global 0", "halt"});
+  Executable executable;
+  executable.code = code.data();
+  executable.code_size = code.size();
+  executable.globals = {var::create_long(0)};
+  EXPECT_EXIT(Vm{executable::to_bytes(executable)}, ::testing::ExitedWithCode(1), "");
+  // block of locals read before all of them are stored
+  EXPECT_EXIT(Vm{assemble({"push long 1", "store 0", "load_block 0 2", "halt"})}, ::testing::ExitedWithCode(1), "");
+}
+
+TEST(Verifier, SizesFramesOfFlatPrograms) {
+  Vm vm(assemble({
+    "jump 48",
+    "store 1",
+    "store 0",
+    "load 0",
+    "load 1",
+    "sub",
+    "ret 1",
+    "push long 5",
+    "push long 2",
+    "call 9 2",
+    "print",
+    "halt",
+  }));
+  ASSERT_EQ(2, vm.functions.size());
+  EXPECT_EQ(0, vm.functions.at(0).frame_size);
+  EXPECT_EQ(2, vm.functions.at(0).max_stack);
+  const auto& sub = vm.functions.at(9);
+  EXPECT_EQ(2, sub.params);
+  EXPECT_EQ(1, sub.returns);
+  EXPECT_EQ(2, sub.frame_size);
+  EXPECT_EQ(2, sub.max_stack);
+  testing::internal::CaptureStdout();
+  vm.execute();
+  EXPECT_EQ("3", testing::internal::GetCapturedStdout());
+}
+
+TEST(ConstantPool, DeduplicatesLiterals) {
+  std::string code = "long a = 100000; long b = 100000; int c = 7; print a + b + c; print \"done\\t!\"; print 100000;";
+  auto bytes = module::link(compile_module(code));
+  Executable executable = executable::from_bytes(bytes.data(), bytes.size());
+  ASSERT_EQ(2, executable.constants.size());
+  EXPECT_EQ(var::LONG, executable.constants[0].type);
+  EXPECT_EQ(100000, executable.constants[0].data._long);
+  EXPECT_EQ(var::INT, executable.constants[1].type);
+  EXPECT_EQ(std::vector<std::string>({"\n", "done\t!\n"}), executable.strings);
+  EXPECT_EQ("200007\ndone\t!\n100000\n", exe_linked(code));
 }
 
 TEST(FIBONACCI, RECURSION) {
@@ -0,0 +1,797 @@
+#include "arrayutils.h"
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ARRAY_UTILS_X86
+#include <immintrin.h>
+#endif
+
+// Stores the value in blocks of the array, then in the remaining tail.
+#define FILL_BLOCKS(vector, lanes, splat, store) \
+    vector v = splat(value); \
+    for (; i + lanes <= size; i += lanes) { \
+        store((vector*) (data + i), v); \
+    } \
+    fill_scalar(data, i, size, value); \
+
+// Replaces blocks of the array by their combination with the value, then the tail.
+#define MAP_VALUE_BLOCKS(vector, lanes, splat, load, store, operation, scalar) \
+    vector v = splat(value); \
+    for (; i + lanes <= size; i += lanes) { \
+        store((vector*) (data + i), operation(load((const vector*) (data + i)), v)); \
+    } \
+    scalar(data, i, size, value); \
+
+// Replaces blocks of the array by their combination with the blocks of the other one, then the tail.
+#define MAP_ARRAY_BLOCKS(vector, lanes, load, store, operation, scalar) \
+    for (; i + lanes <= size; i += lanes) { \
+        store((vector*) (data + i), operation(load((const vector*) (data + i)), load((const vector*) (other + i)))); \
+    } \
+    scalar(data, other, i, size); \
+
+// Accumulates the 64-bit partial sums of blocks of the array, then adds the tail.
+// Each element of a block adds bias to the partial sums.
+#define SUM_BLOCKS(vector, lanes, zero, load, add_epi64, partial_sums, bias) \
+    vector sums = zero(); \
+    size_t begin = i; \
+    for (; i + lanes <= size; i += lanes) { \
+        sums = add_epi64(sums, partial_sums(load((const vector*) (data + i)))); \
+    } \
+    return sum_lanes(&sums, sizeof(vector)) - (uint64_t) bias * (i - begin) + sum_scalar(data, i, size); \
+
+// Same as SUM_BLOCKS for the products of the elements of two arrays.
+#define DOT_BLOCKS(vector, lanes, zero, load, add_epi64, partial_products) \
+    vector sums = zero(); \
+    for (; i + lanes <= size; i += lanes) { \
+        sums = add_epi64(sums, partial_products(load((const vector*) (a + i)), load((const vector*) (b + i)))); \
+    } \
+    return sum_lanes(&sums, sizeof(vector)) + dot_scalar(a, b, i, size); \
+
+// Keeps the minimum or maximum of every lane over blocks of the array, then reduces the lanes and the tail.
+#define REDUCE_BLOCKS(type, vector, lanes, splat, load, combine, scalar) \
+    vector best_lanes = splat(best); \
+    for (; i + lanes <= size; i += lanes) { \
+        best_lanes = combine(best_lanes, load((const vector*) (data + i))); \
+    } \
+    type values[lanes]; \
+    std::memcpy(values, &best_lanes, sizeof(vector)); \
+    return scalar(data, i, size, scalar(values, 0, lanes, best)); \
+
+// Counts the bytes of the equal elements in blocks of the array, then counts the tail.
+#define COUNT_BLOCKS(vector, lanes, splat, load, equal, movemask) \
+    vector v = splat(value); \
+    int64_t bytes = 0; \
+    for (; i + lanes <= size; i += lanes) { \
+        bytes += __builtin_popcount((uint32_t) movemask(equal(load((const vector*) (data + i)), v))); \
+    } \
+    return bytes / (int64_t) sizeof(*data) + count_scalar(data, i, size, value); \
+
+#if defined(ARRAY_UTILS_X86)
+#define DISPATCH(avx2_kernel, sse2_kernel, scalar_kernel, ...) \
+    switch (implementation) { \
+        case AVX2: \
+            return avx2_kernel(__VA_ARGS__); \
+        case SSE2: \
+            return sse2_kernel(__VA_ARGS__); \
+        default: \
+            return scalar_kernel(__VA_ARGS__); \
+    } \
+
+#else
+#define DISPATCH(avx2_kernel, sse2_kernel, scalar_kernel, ...) \
+    return scalar_kernel(__VA_ARGS__); \
+
+#endif
+
+namespace arrayutils {
+// Integers are added and multiplied as unsigned ones, which wrap around.
+template <class T>
+using Unsigned = typename std::make_unsigned<T>::type;
+
+template <class T>
+void fill_scalar(T* data, size_t i, const size_t& size, const T& value) {
+    for (; i < size; i++) {
+        data[i] = value;
+    }
+}
+
+template <class T>
+int64_t sum_scalar(const T* data, size_t i, const size_t& size) {
+    uint64_t sum = 0;
+    for (; i < size; i++) {
+        sum += (uint64_t) data[i];
+    }
+    return sum;
+}
+
+template <class T>
+T min_scalar(const T* data, size_t i, const size_t& size, T best) {
+    for (; i < size; i++) {
+        best = std::min(best, data[i]);
+    }
+    return best;
+}
+
+template <class T>
+T max_scalar(const T* data, size_t i, const size_t& size, T best) {
+    for (; i < size; i++) {
+        best = std::max(best, data[i]);
+    }
+    return best;
+}
+
+template <class T>
+int64_t dot_scalar(const T* a, const T* b, size_t i, const size_t& size) {
+    uint64_t sum = 0;
+    for (; i < size; i++) {
+        sum += (uint64_t) a[i] * (uint64_t) b[i];
+    }
+    return sum;
+}
+
+template <class T>
+int64_t count_scalar(const T* data, size_t i, const size_t& size, const T& value) {
+    int64_t count = 0;
+    for (; i < size; i++) {
+        count += data[i] == value;
+    }
+    return count;
+}
+
+template <class T>
+void add_scalar(T* data, size_t i, const size_t& size, const T& value) {
+    for (; i < size; i++) {
+        data[i] = (T) ((Unsigned<T>) data[i] + (Unsigned<T>) value);
+    }
+}
+
+template <class T>
+void add_arrays_scalar(T* data, const T* other, size_t i, const size_t& size) {
+    for (; i < size; i++) {
+        data[i] = (T) ((Unsigned<T>) data[i] + (Unsigned<T>) other[i]);
+    }
+}
+
+template <class T>
+void mul_scalar(T* data, size_t i, const size_t& size, const T& value) {
+    for (; i < size; i++) {
+        data[i] = (T) ((Unsigned<T>) data[i] * (Unsigned<T>) value);
+    }
+}
+
+template <class T>
+void mul_arrays_scalar(T* data, const T* other, size_t i, const size_t& size) {
+    for (; i < size; i++) {
+        data[i] = (T) ((Unsigned<T>) data[i] * (Unsigned<T>) other[i]);
+    }
+}
+
+// Least significant digit radix sort on bytes, with the sign bit flipped so that negative
+// numbers come first. Bytes that are the same in every element are skipped.
+template <class T>
+void sort_scalar(T* data, const size_t& size) {
+    if (size < 64) {
+        std::sort(data, data + size);
+        return;
+    }
+    const Unsigned<T> sign = (Unsigned<T>) 1 << (8 * sizeof(T) - 1);
+    std::vector<T> buffer(size);
+    T* from = data;
+    T* to = buffer.data();
+    for (size_t shift = 0; shift < 8 * sizeof(T); shift += 8) {
+        size_t counts[256] = {0};
+        for (size_t i = 0; i < size; i++) {
+            counts[(((Unsigned<T>) from[i] ^ sign) >> shift) & 0xff]++;
+        }
+        if (counts[(((Unsigned<T>) from[0] ^ sign) >> shift) & 0xff] == size) {
+            continue;
+        }
+        size_t offset = 0;
+        for (size_t& count : counts) {
+            offset += count;
+            count = offset - count;
+        }
+        for (size_t i = 0; i < size; i++) {
+            to[counts[(((Unsigned<T>) from[i] ^ sign) >> shift) & 0xff]++] = from[i];
+        }
+        std::swap(from, to);
+    }
+    if (from != data) {
+        std::memcpy(data, from, size * sizeof(T));
+    }
+}
+
+// Branchless lower bound: the loop runs log2(size) times whatever the values are.
+template <class T>
+int64_t search_scalar(const T* data, const size_t& size, const T& value) {
+    if (size == 0) {
+        return -1;
+    }
+    const T* base = data;
+    for (size_t length = size; length > 1; length -= length / 2) {
+        base = base[length / 2] < value ? base + length / 2 : base;
+    }
+    size_t index = (base - data) + (*base < value);
+    return index < size && data[index] == value ? index : -1;
+}
+
+int64_t sum_lanes(const void* lanes, const size_t& bytes) {
+    uint64_t values[4];
+    std::memcpy(values, lanes, bytes);
+    uint64_t sum = 0;
+    for (size_t i = 0; i < bytes / sizeof(uint64_t); i++) {
+        sum += values[i];
+    }
+    return sum;
+}
+
+#if defined(ARRAY_UTILS_X86)
+// SSE2 has no signed byte minimum, no 32-bit signed minimum, no 64-bit comparison
+// and no multiplication of bytes or of 32-bit integers, they are built from other ones.
+
+__attribute__((target("sse2")))
+__m128i min_epi8_sse2(const __m128i& a, const __m128i& b) {
+    __m128i sign = _mm_set1_epi8((char) 0x80);
+    return _mm_xor_si128(_mm_min_epu8(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign)), sign);
+}
+
+__attribute__((target("sse2")))
+__m128i max_epi8_sse2(const __m128i& a, const __m128i& b) {
+    __m128i sign = _mm_set1_epi8((char) 0x80);
+    return _mm_xor_si128(_mm_max_epu8(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign)), sign);
+}
+
+__attribute__((target("sse2")))
+__m128i min_epi32_sse2(const __m128i& a, const __m128i& b) {
+    __m128i a_greater = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(a_greater, b), _mm_andnot_si128(a_greater, a));
+}
+
+__attribute__((target("sse2")))
+__m128i max_epi32_sse2(const __m128i& a, const __m128i& b) {
+    __m128i a_greater = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(a_greater, a), _mm_andnot_si128(a_greater, b));
+}
+
+__attribute__((target("sse2")))
+__m128i cmpeq_epi64_sse2(const __m128i& a, const __m128i& b) {
+    __m128i equal = _mm_cmpeq_epi32(a, b);
+    return _mm_and_si128(equal, _mm_shuffle_epi32(equal, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+__attribute__((target("sse2")))
+__m128i mullo_epi8_sse2(const __m128i& a, const __m128i& b) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i low_bytes = _mm_set1_epi16(0xff);
+    __m128i low = _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+    __m128i high = _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+    return _mm_packus_epi16(_mm_and_si128(low, low_bytes), _mm_and_si128(high, low_bytes));
+}
+
+__attribute__((target("sse2")))
+__m128i mullo_epi32_sse2(const __m128i& a, const __m128i& b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// Partial sums of 64 bits. Bytes are made unsigned by adding 128 to them.
+__attribute__((target("sse2")))
+__m128i sums_epi8_sse2(const __m128i& a) {
+    return _mm_sad_epu8(_mm_xor_si128(a, _mm_set1_epi8((char) 0x80)), _mm_setzero_si128());
+}
+
+__attribute__((target("sse2")))
+__m128i sums_epi32_sse2(const __m128i& a) {
+    __m128i sign = _mm_cmpgt_epi32(_mm_setzero_si128(), a);
+    return _mm_add_epi64(_mm_unpacklo_epi32(a, sign), _mm_unpackhi_epi32(a, sign));
+}
+
+__attribute__((target("sse2")))
+__m128i sums_epi64_sse2(const __m128i& a) {
+    return a;
+}
+
+// Bytes are widened to 16 bits and multiplied and added in pairs, which can't overflow 32 bits.
+__attribute__((target("sse2")))
+__m128i products_epi8_sse2(const __m128i& a, const __m128i& b) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i sign_a = _mm_cmpgt_epi8(zero, a);
+    __m128i sign_b = _mm_cmpgt_epi8(zero, b);
+    __m128i products = _mm_add_epi32(
+        _mm_madd_epi16(_mm_unpacklo_epi8(a, sign_a), _mm_unpacklo_epi8(b, sign_b)),
+        _mm_madd_epi16(_mm_unpackhi_epi8(a, sign_a), _mm_unpackhi_epi8(b, sign_b))
+    );
+    return sums_epi32_sse2(products);
+}
+
+__attribute__((target("sse2")))
+void fill_sse2(int8_t* data, size_t i, const size_t& size, const int8_t& value) {
+    FILL_BLOCKS(__m128i, 16, _mm_set1_epi8, _mm_storeu_si128);
+}
+
+__attribute__((target("sse2")))
+void fill_sse2(int32_t* data, size_t i, const size_t& size, const int32_t& value) {
+    FILL_BLOCKS(__m128i, 4, _mm_set1_epi32, _mm_storeu_si128);
+}
+
+__attribute__((target("sse2")))
+void fill_sse2(int64_t* data, size_t i, const size_t& size, const int64_t& value) {
+    FILL_BLOCKS(__m128i, 2, _mm_set1_epi64x, _mm_storeu_si128);
+}
+
+__attribute__((target("sse2")))
+int64_t sum_sse2(const int8_t* data, size_t i, const size_t& size) {
+    SUM_BLOCKS(__m128i, 16, _mm_setzero_si128, _mm_loadu_si128, _mm_add_epi64, sums_epi8_sse2, 128);
+}
+
+__attribute__((target("sse2")))
+int64_t sum_sse2(const int32_t* data, size_t i, const size_t& size) {
+    SUM_BLOCKS(__m128i, 4, _mm_setzero_si128, _mm_loadu_si128, _mm_add_epi64, sums_epi32_sse2, 0);
+}
+
+__attribute__((target("sse2")))
+int64_t sum_sse2(const int64_t* data, size_t i, const size_t& size) {
+    SUM_BLOCKS(__m128i, 2, _mm_setzero_si128, _mm_loadu_si128, _mm_add_epi64, sums_epi64_sse2, 0);
+}
+
+__attribute__((target("sse2")))
+int8_t min_sse2(const int8_t* data, size_t i, const size_t& size, int8_t best) {
+    REDUCE_BLOCKS(int8_t, __m128i, 16, _mm_set1_epi8, _mm_loadu_si128, min_epi8_sse2, min_scalar);
+}
+
+__attribute__((target("sse2")))
+int32_t min_sse2(const int32_t* data, size_t i, const size_t& size, int32_t best) {
+    REDUCE_BLOCKS(int32_t, __m128i, 4, _mm_set1_epi32, _mm_loadu_si128, min_epi32_sse2, min_scalar);
+}
+
+__attribute__((target("sse2")))
+int8_t max_sse2(const int8_t* data, size_t i, const size_t& size, int8_t best) {
+    REDUCE_BLOCKS(int8_t, __m128i, 16, _mm_set1_epi8, _mm_loadu_si128, max_epi8_sse2, max_scalar);
+}
+
+__attribute__((target("sse2")))
+int32_t max_sse2(const int32_t* data, size_t i, const size_t& size, int32_t best) {
+    REDUCE_BLOCKS(int32_t, __m128i, 4, _mm_set1_epi32, _mm_loadu_si128, max_epi32_sse2, max_scalar);
+}
+
+__attribute__((target("sse2")))
+int64_t dot_sse2(const int8_t* a, const int8_t* b, size_t i, const size_t& size) {
+    DOT_BLOCKS(__m128i, 16, _mm_setzero_si128, _mm_loadu_si128, _mm_add_epi64, products_epi8_sse2);
+}
+
+__attribute__((target("sse2")))
+int64_t count_sse2(const int8_t* data, size_t i, const size_t& size, const int8_t& value) {
+    COUNT_BLOCKS(__m128i, 16, _mm_set1_epi8, _mm_loadu_si128, _mm_cmpeq_epi8, _mm_movemask_epi8);
+}
+
+__attribute__((target("sse2")))
+int64_t count_sse2(const int32_t* data, size_t i, const size_t& size, const int32_t& value) {
+    COUNT_BLOCKS(__m128i, 4, _mm_set1_epi32, _mm_loadu_si128, _mm_cmpeq_epi32, _mm_movemask_epi8);
+}
+
+__attribute__((target("sse2")))
+int64_t count_sse2(const int64_t* data, size_t i, const size_t& size, const int64_t& value) {
+    COUNT_BLOCKS(__m128i, 2, _mm_set1_epi64x, _mm_loadu_si128, cmpeq_epi64_sse2, _mm_movemask_epi8);
+}
+
+__attribute__((target("sse2")))
+void add_sse2(int8_t* data, size_t i, const size_t& size, const int8_t& value) {
+    MAP_VALUE_BLOCKS(__m128i, 16, _mm_set1_epi8, _mm_loadu_si128, _mm_storeu_si128, _mm_add_epi8, add_scalar);
+}
+
+__attribute__((target("sse2")))
+void add_sse2(int32_t* data, size_t i, const size_t& size, const int32_t& value) {
+    MAP_VALUE_BLOCKS(__m128i, 4, _mm_set1_epi32, _mm_loadu_si128, _mm_storeu_si128, _mm_add_epi32, add_scalar);
+}
+
+__attribute__((target("sse2")))
+void add_sse2(int64_t* data, size_t i, const size_t& size, const int64_t& value) {
+    MAP_VALUE_BLOCKS(__m128i, 2, _mm_set1_epi64x, _mm_loadu_si128, _mm_storeu_si128, _mm_add_epi64, add_scalar);
+}
+
+__attribute__((target("sse2")))
+void add_arrays_sse2(int8_t* data, const int8_t* other, size_t i, const size_t& size) {
+    MAP_ARRAY_BLOCKS(__m128i, 16, _mm_loadu_si128, _mm_storeu_si128, _mm_add_epi8, add_arrays_scalar);
+}
+
+__attribute__((target("sse2")))
+void add_arrays_sse2(int32_t* data, const int32_t* other, size_t i, const size_t& size) {
+    MAP_ARRAY_BLOCKS(__m128i, 4, _mm_loadu_si128, _mm_storeu_si128, _mm_add_epi32, add_arrays_scalar);
+}
+
+__attribute__((target("sse2")))
+void add_arrays_sse2(int64_t* data, const int64_t* other, size_t i, const size_t& size) {
+    MAP_ARRAY_BLOCKS(__m128i, 2, _mm_loadu_si128, _mm_storeu_si128, _mm_add_epi64, add_arrays_scalar);
+}
+
+__attribute__((target("sse2")))
+void mul_sse2(int8_t* data, size_t i, const size_t& size, const int8_t& value) {
+    MAP_VALUE_BLOCKS(__m128i, 16, _mm_set1_epi8, _mm_loadu_si128, _mm_storeu_si128, mullo_epi8_sse2, mul_scalar);
+}
+
+__attribute__((target("sse2")))
+void mul_sse2(int32_t* data, size_t i, const size_t& size, const int32_t& value) {
+    MAP_VALUE_BLOCKS(__m128i, 4, _mm_set1_epi32, _mm_loadu_si128, _mm_storeu_si128, mullo_epi32_sse2, mul_scalar);
+}
+
+__attribute__((target("sse2")))
+void mul_arrays_sse2(int8_t* data, const int8_t* other, size_t i, const size_t& size) {
+    MAP_ARRAY_BLOCKS(__m128i, 16, _mm_loadu_si128, _mm_storeu_si128, mullo_epi8_sse2, mul_arrays_scalar);
+}
+
+__attribute__((target("sse2")))
+void mul_arrays_sse2(int32_t* data, const int32_t* other, size_t i, const size_t& size) {
+    MAP_ARRAY_BLOCKS(__m128i, 4, _mm_loadu_si128, _mm_storeu_si128, mullo_epi32_sse2, mul_arrays_scalar);
+}
+
+// AVX2 has no 64-bit minimum and no multiplication of bytes or of 64-bit integers.
+
+__attribute__((target("avx2")))
+__m256i min_epi64_avx2(const __m256i& a, const __m256i& b) {
+    return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b));
+}
+
+__attribute__((target("avx2")))
+__m256i max_epi64_avx2(const __m256i& a, const __m256i& b) {
+    return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(b, a));
+}
+
+__attribute__((target("avx2")))
+__m256i mullo_epi8_avx2(const __m256i& a, const __m256i& b) {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i low_bytes = _mm256_set1_epi16(0xff);
+    __m256i low = _mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero));
+    __m256i high = _mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero));
+    return _mm256_packus_epi16(_mm256_and_si256(low, low_bytes), _mm256_and_si256(high, low_bytes));
+}
+
+__attribute__((target("avx2")))
+__m256i sums_epi8_avx2(const __m256i& a) {
+    return _mm256_sad_epu8(_mm256_xor_si256(a, _mm256_set1_epi8((char) 0x80)), _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2")))
+__m256i sums_epi32_avx2(const __m256i& a) {
+    __m256i sign = _mm256_cmpgt_epi32(_mm256_setzero_si256(), a);
+    return _mm256_add_epi64(_mm256_unpacklo_epi32(a, sign), _mm256_unpackhi_epi32(a, sign));
+}
+
+__attribute__((target("avx2")))
+__m256i sums_epi64_avx2(const __m256i& a) {
+    return a;
+}
+
+__attribute__((target("avx2")))
+__m256i products_epi8_avx2(const __m256i& a, const __m256i& b) {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i sign_a = _mm256_cmpgt_epi8(zero, a);
+    __m256i sign_b = _mm256_cmpgt_epi8(zero, b);
+    __m256i products = _mm256_add_epi32(
+        _mm256_madd_epi16(_mm256_unpacklo_epi8(a, sign_a), _mm256_unpacklo_epi8(b, sign_b)),
+        _mm256_madd_epi16(_mm256_unpackhi_epi8(a, sign_a), _mm256_unpackhi_epi8(b, sign_b))
+    );
+    return sums_epi32_avx2(products);
+}
+
+// Products of the even and of the odd 32-bit integers, each on 64 bits.
+__attribute__((target("avx2")))
+__m256i products_epi32_avx2(const __m256i& a, const __m256i& b) {
+    return _mm256_add_epi64(
+        _mm256_mul_epi32(a, b),
+        _mm256_mul_epi32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32))
+    );
+}
+
+__attribute__((target("avx2")))
+void fill_avx2(int8_t* data, size_t i, const size_t& size, const int8_t& value) {
+    FILL_BLOCKS(__m256i, 32, _mm256_set1_epi8, _mm256_storeu_si256);
+}
+
+__attribute__((target("avx2")))
+void fill_avx2(int32_t* data, size_t i, const size_t& size, const int32_t& value) {
+    FILL_BLOCKS(__m256i, 8, _mm256_set1_epi32, _mm256_storeu_si256);
+}
+
+__attribute__((target("avx2")))
+void fill_avx2(int64_t* data, size_t i, const size_t& size, const int64_t& value) {
+    FILL_BLOCKS(__m256i, 4, _mm256_set1_epi64x, _mm256_storeu_si256);
+}
+
+__attribute__((target("avx2")))
+int64_t sum_avx2(const int8_t* data, size_t i, const size_t& size) {
+    SUM_BLOCKS(__m256i, 32, _mm256_setzero_si256, _mm256_loadu_si256, _mm256_add_epi64, sums_epi8_avx2, 128);
+}
+
+__attribute__((target("avx2")))
+int64_t sum_avx2(const int32_t* data, size_t i, const size_t& size) {
+    SUM_BLOCKS(__m256i, 8, _mm256_setzero_si256, _mm256_loadu_si256, _mm256_add_epi64, sums_epi32_avx2, 0);
+}
+
+__attribute__((target("avx2")))
+int64_t sum_avx2(const int64_t* data, size_t i, const size_t& size) {
+    SUM_BLOCKS(__m256i, 4, _mm256_setzero_si256, _mm256_loadu_si256, _mm256_add_epi64, sums_epi64_avx2, 0);
+}
+
+__attribute__((target("avx2")))
+int8_t min_avx2(const int8_t* data, size_t i, const size_t& size, int8_t best) {
+    REDUCE_BLOCKS(int8_t, __m256i, 32, _mm256_set1_epi8, _mm256_loadu_si256, _mm256_min_epi8, min_scalar);
+}
+
+__attribute__((target("avx2")))
+int32_t min_avx2(const int32_t* data, size_t i, const size_t& size, int32_t best) {
+    REDUCE_BLOCKS(int32_t, __m256i, 8, _mm256_set1_epi32, _mm256_loadu_si256, _mm256_min_epi32, min_scalar);
+}
+
+__attribute__((target("avx2")))
+int64_t min_avx2(const int64_t* data, size_t i, const size_t& size, int64_t best) {
+    REDUCE_BLOCKS(int64_t, __m256i, 4, _mm256_set1_epi64x, _mm256_loadu_si256, min_epi64_avx2, min_scalar);
+}
+
+__attribute__((target("avx2")))
+int8_t max_avx2(const int8_t* data, size_t i, const size_t& size, int8_t best) {
+    REDUCE_BLOCKS(int8_t, __m256i, 32, _mm256_set1_epi8, _mm256_loadu_si256, _mm256_max_epi8, max_scalar);
+}
+
+__attribute__((target("avx2")))
+int32_t max_avx2(const int32_t* data, size_t i, const size_t& size, int32_t best) {
+    REDUCE_BLOCKS(int32_t, __m256i, 8, _mm256_set1_epi32, _mm256_loadu_si256, _mm256_max_epi32, max_scalar);
+}
+
+__attribute__((target("avx2")))
+int64_t max_avx2(const int64_t* data, size_t i, const size_t& size, int64_t best) {
+    REDUCE_BLOCKS(int64_t, __m256i, 4, _mm256_set1_epi64x, _mm256_loadu_si256, max_epi64_avx2, max_scalar);
+}
+
+__attribute__((target("avx2")))
+int64_t dot_avx2(const int8_t* a, const int8_t* b, size_t i, const size_t& size) {
+    DOT_BLOCKS(__m256i, 32, _mm256_setzero_si256, _mm256_loadu_si256, _mm256_add_epi64, products_epi8_avx2);
+}
+
+__attribute__((target("avx2")))
+int64_t dot_avx2(const int32_t* a, const int32_t* b, size_t i, const size_t& size) {
+    DOT_BLOCKS(__m256i, 8, _mm256_setzero_si256, _mm256_loadu_si256, _mm256_add_epi64, products_epi32_avx2);
+}
+
+__attribute__((target("avx2")))
+int64_t count_avx2(const int8_t* data, size_t i, const size_t& size, const int8_t& value) {
+    COUNT_BLOCKS(__m256i, 32, _mm256_set1_epi8, _mm256_loadu_si256, _mm256_cmpeq_epi8, _mm256_movemask_epi8);
+}
+
+__attribute__((target("avx2")))
+int64_t count_avx2(const int32_t* data, size_t i, const size_t& size, const int32_t& value) {
+    COUNT_BLOCKS(__m256i, 8, _mm256_set1_epi32, _mm256_loadu_si256, _mm256_cmpeq_epi32, _mm256_movemask_epi8);
+}
+
+__attribute__((target("avx2")))
+int64_t count_avx2(const int64_t* data, size_t i, const size_t& size, const int64_t& value) {
+    COUNT_BLOCKS(__m256i, 4, _mm256_set1_epi64x, _mm256_loadu_si256, _mm256_cmpeq_epi64, _mm256_movemask_epi8);
+}
+
+__attribute__((target("avx2")))
+void add_avx2(int8_t* data, size_t i, const size_t& size, const int8_t& value) {
+    MAP_VALUE_BLOCKS(__m256i, 32, _mm256_set1_epi8, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_add_epi8, add_scalar);
+}
+
+__attribute__((target("avx2")))
+void add_avx2(int32_t* data, size_t i, const size_t& size, const int32_t& value) {
+    MAP_VALUE_BLOCKS(__m256i, 8, _mm256_set1_epi32, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_add_epi32, add_scalar);
+}
+
+__attribute__((target("avx2")))
+void add_avx2(int64_t* data, size_t i, const size_t& size, const int64_t& value) {
+    MAP_VALUE_BLOCKS(__m256i, 4, _mm256_set1_epi64x, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_add_epi64, add_scalar);
+}
+
+__attribute__((target("avx2")))
+void add_arrays_avx2(int8_t* data, const int8_t* other, size_t i, const size_t& size) {
+    MAP_ARRAY_BLOCKS(__m256i, 32, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_add_epi8, add_arrays_scalar);
+}
+
+__attribute__((target("avx2")))
+void add_arrays_avx2(int32_t* data, const int32_t* other, size_t i, const size_t& size) {
+    MAP_ARRAY_BLOCKS(__m256i, 8, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_add_epi32, add_arrays_scalar);
+}
+
+__attribute__((target("avx2")))
+void add_arrays_avx2(int64_t* data, const int64_t* other, size_t i, const size_t& size) {
+    MAP_ARRAY_BLOCKS(__m256i, 4, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_add_epi64, add_arrays_scalar);
+}
+
+__attribute__((target("avx2")))
+void mul_avx2(int8_t* data, size_t i, const size_t& size, const int8_t& value) {
+    MAP_VALUE_BLOCKS(__m256i, 32, _mm256_set1_epi8, _mm256_loadu_si256, _mm256_storeu_si256, mullo_epi8_avx2, mul_scalar);
+}
+
+__attribute__((target("avx2")))
+void mul_avx2(int32_t* data, size_t i, const size_t& size, const int32_t& value) {
+    MAP_VALUE_BLOCKS(__m256i, 8, _mm256_set1_epi32, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_mullo_epi32, mul_scalar);
+}
+
+__attribute__((target("avx2")))
+void mul_arrays_avx2(int8_t* data, const int8_t* other, size_t i, const size_t& size) {
+    MAP_ARRAY_BLOCKS(__m256i, 32, _mm256_loadu_si256, _mm256_storeu_si256, mullo_epi8_avx2, mul_arrays_scalar);
+}
+
+__attribute__((target("avx2")))
+void mul_arrays_avx2(int32_t* data, const int32_t* other, size_t i, const size_t& size) {
+    MAP_ARRAY_BLOCKS(__m256i, 8, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_mullo_epi32, mul_arrays_scalar);
+}
+#endif
+
+Implementation detect_implementation() {
+#if defined(ARRAY_UTILS_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SSE2;
+    }
+#endif
+    return SCALAR;
+}
+
+const Implementation BEST_IMPLEMENTATION = detect_implementation();
+Implementation implementation = BEST_IMPLEMENTATION;
+}
+
+void arrayutils::fill(int8_t* data, const size_t& size, const int8_t& value) {
+    DISPATCH(fill_avx2, fill_sse2, fill_scalar, data, 0, size, value);
+}
+
+void arrayutils::fill(int32_t* data, const size_t& size, const int32_t& value) {
+    DISPATCH(fill_avx2, fill_sse2, fill_scalar, data, 0, size, value);
+}
+
+void arrayutils::fill(int64_t* data, const size_t& size, const int64_t& value) {
+    DISPATCH(fill_avx2, fill_sse2, fill_scalar, data, 0, size, value);
+}
+
+int64_t arrayutils::sum(const int8_t* data, const size_t& size) {
+    DISPATCH(sum_avx2, sum_sse2, sum_scalar, data, 0, size);
+}
+
+int64_t arrayutils::sum(const int32_t* data, const size_t& size) {
+    DISPATCH(sum_avx2, sum_sse2, sum_scalar, data, 0, size);
+}
+
+int64_t arrayutils::sum(const int64_t* data, const size_t& size) {
+    DISPATCH(sum_avx2, sum_sse2, sum_scalar, data, 0, size);
+}
+
+int8_t arrayutils::min(const int8_t* data, const size_t& size) {
+    DISPATCH(min_avx2, min_sse2, min_scalar, data, 1, size, data[0]);
+}
+
+int32_t arrayutils::min(const int32_t* data, const size_t& size) {
+    DISPATCH(min_avx2, min_sse2, min_scalar, data, 1, size, data[0]);
+}
+
+int64_t arrayutils::min(const int64_t* data, const size_t& size) {
+    DISPATCH(min_avx2, min_scalar, min_scalar, data, 1, size, data[0]);
+}
+
+int8_t arrayutils::max(const int8_t* data, const size_t& size) {
+    DISPATCH(max_avx2, max_sse2, max_scalar, data, 1, size, data[0]);
+}
+
+int32_t arrayutils::max(const int32_t* data, const size_t& size) {
+    DISPATCH(max_avx2, max_sse2, max_scalar, data, 1, size, data[0]);
+}
+
+int64_t arrayutils::max(const int64_t* data, const size_t& size) {
+    DISPATCH(max_avx2, max_scalar, max_scalar, data, 1, size, data[0]);
+}
+
+int64_t arrayutils::dot(const int8_t* a, const int8_t* b, const size_t& size) {
+    DISPATCH(dot_avx2, dot_sse2, dot_scalar, a, b, 0, size);
+}
+
+int64_t arrayutils::dot(const int32_t* a, const int32_t* b, const size_t& size) {
+    DISPATCH(dot_avx2, dot_scalar, dot_scalar, a, b, 0, size);
+}
+
+int64_t arrayutils::dot(const int64_t* a, const int64_t* b, const size_t& size) {
+    return dot_scalar(a, b, 0, size);
+}
+
+int64_t arrayutils::count(const int8_t* data, const size_t& size, const int8_t& value) {
+    DISPATCH(count_avx2, count_sse2, count_scalar, data, 0, size, value);
+}
+
+int64_t arrayutils::count(const int32_t* data, const size_t& size, const int32_t& value) {
+    DISPATCH(count_avx2, count_sse2, count_scalar, data, 0, size, value);
+}
+
+int64_t arrayutils::count(const int64_t* data, const size_t& size, const int64_t& value) {
+    DISPATCH(count_avx2, count_sse2, count_scalar, data, 0, size, value);
+}
+
+void arrayutils::add(int8_t* data, const size_t& size, const int8_t& value) {
+    DISPATCH(add_avx2, add_sse2, add_scalar, data, 0, size, value);
+}
+
+void arrayutils::add(int32_t* data, const size_t& size, const int32_t& value) {
+    DISPATCH(add_avx2, add_sse2, add_scalar, data, 0, size, value);
+}
+
+void arrayutils::add(int64_t* data, const size_t& size, const int64_t& value) {
+    DISPATCH(add_avx2, add_sse2, add_scalar, data, 0, size, value);
+}
+
+void arrayutils::add(int8_t* data, const int8_t* other, const size_t& size) {
+    DISPATCH(add_arrays_avx2, add_arrays_sse2, add_arrays_scalar, data, other, 0, size);
+}
+
+void arrayutils::add(int32_t* data, const int32_t* other, const size_t& size) {
+    DISPATCH(add_arrays_avx2, add_arrays_sse2, add_arrays_scalar, data, other, 0, size);
+}
+
+void arrayutils::add(int64_t* data, const int64_t* other, const size_t& size) {
+    DISPATCH(add_arrays_avx2, add_arrays_sse2, add_arrays_scalar, data, other, 0, size);
+}
+
+void arrayutils::mul(int8_t* data, const size_t& size, const int8_t& value) {
+    DISPATCH(mul_avx2, mul_sse2, mul_scalar, data, 0, size, value);
+}
+
+void arrayutils::mul(int32_t* data, const size_t& size, const int32_t& value) {
+    DISPATCH(mul_avx2, mul_sse2, mul_scalar, data, 0, size, value);
+}
+
+void arrayutils::mul(int64_t* data, const size_t& size, const int64_t& value) {
+    mul_scalar(data, 0, size, value);
+}
+
+void arrayutils::mul(int8_t* data, const int8_t* other, const size_t& size) {
+    DISPATCH(mul_arrays_avx2, mul_arrays_sse2, mul_arrays_scalar, data, other, 0, size);
+}
+
+void arrayutils::mul(int32_t* data, const int32_t* other, const size_t& size) {
+    DISPATCH(mul_arrays_avx2, mul_arrays_sse2, mul_arrays_scalar, data, other, 0, size);
+}
+
+void arrayutils::mul(int64_t* data, const int64_t* other, const size_t& size) {
+    mul_arrays_scalar(data, other, 0, size);
+}
+
+void arrayutils::sort(int8_t* data, const size_t& size) {
+    sort_scalar(data, size);
+}
+
+void arrayutils::sort(int32_t* data, const size_t& size) {
+    sort_scalar(data, size);
+}
+
+void arrayutils::sort(int64_t* data, const size_t& size) {
+    sort_scalar(data, size);
+}
+
+int64_t arrayutils::search(const int8_t* data, const size_t& size, const int8_t& value) {
+    return search_scalar(data, size, value);
+}
+
+int64_t arrayutils::search(const int32_t* data, const size_t& size, const int32_t& value) {
+    return search_scalar(data, size, value);
+}
+
+int64_t arrayutils::search(const int64_t* data, const size_t& size, const int64_t& value) {
+    return search_scalar(data, size, value);
+}
+
+bool arrayutils::is_supported(const Implementation& implementation) {
+    return implementation <= BEST_IMPLEMENTATION;
+}
+
+arrayutils::Implementation arrayutils::get_implementation() {
+    return implementation;
+}
+
+void arrayutils::set_implementation(const Implementation& implementation) {
+    arrayutils::implementation = is_supported(implementation) ? implementation : BEST_IMPLEMENTATION;
+}
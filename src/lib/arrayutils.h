@@ -0,0 +1,68 @@
+#if !defined(ARRAY_UTILS)
+#define ARRAY_UTILS
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Operations on whole arrays of chars, ints or longs, vectorized when the CPU allows it.
+// Arithmetic wraps around like the one of the VM, sums and dot products are longs.
+namespace arrayutils {
+enum Implementation {
+    SCALAR, SSE2, AVX2
+};
+
+void fill(int8_t* data, const size_t& size, const int8_t& value);
+void fill(int32_t* data, const size_t& size, const int32_t& value);
+void fill(int64_t* data, const size_t& size, const int64_t& value);
+
+int64_t sum(const int8_t* data, const size_t& size);
+int64_t sum(const int32_t* data, const size_t& size);
+int64_t sum(const int64_t* data, const size_t& size);
+
+// The array must not be empty.
+int8_t min(const int8_t* data, const size_t& size);
+int32_t min(const int32_t* data, const size_t& size);
+int64_t min(const int64_t* data, const size_t& size);
+int8_t max(const int8_t* data, const size_t& size);
+int32_t max(const int32_t* data, const size_t& size);
+int64_t max(const int64_t* data, const size_t& size);
+
+int64_t dot(const int8_t* a, const int8_t* b, const size_t& size);
+int64_t dot(const int32_t* a, const int32_t* b, const size_t& size);
+int64_t dot(const int64_t* a, const int64_t* b, const size_t& size);
+
+// Number of elements equal to the value.
+int64_t count(const int8_t* data, const size_t& size, const int8_t& value);
+int64_t count(const int32_t* data, const size_t& size, const int32_t& value);
+int64_t count(const int64_t* data, const size_t& size, const int64_t& value);
+
+// Element-wise operations, in place: data[i] op= value, or data[i] op= other[i].
+void add(int8_t* data, const size_t& size, const int8_t& value);
+void add(int32_t* data, const size_t& size, const int32_t& value);
+void add(int64_t* data, const size_t& size, const int64_t& value);
+void add(int8_t* data, const int8_t* other, const size_t& size);
+void add(int32_t* data, const int32_t* other, const size_t& size);
+void add(int64_t* data, const int64_t* other, const size_t& size);
+void mul(int8_t* data, const size_t& size, const int8_t& value);
+void mul(int32_t* data, const size_t& size, const int32_t& value);
+void mul(int64_t* data, const size_t& size, const int64_t& value);
+void mul(int8_t* data, const int8_t* other, const size_t& size);
+void mul(int32_t* data, const int32_t* other, const size_t& size);
+void mul(int64_t* data, const int64_t* other, const size_t& size);
+
+// Ascending radix sort.
+void sort(int8_t* data, const size_t& size);
+void sort(int32_t* data, const size_t& size);
+void sort(int64_t* data, const size_t& size);
+
+// Index of the first element equal to the value in a sorted array, -1 if there is none.
+int64_t search(const int8_t* data, const size_t& size, const int8_t& value);
+int64_t search(const int32_t* data, const size_t& size, const int32_t& value);
+int64_t search(const int64_t* data, const size_t& size, const int64_t& value);
+
+bool is_supported(const Implementation& implementation);
+Implementation get_implementation();
+void set_implementation(const Implementation& implementation);
+}
+
+#endif // ARRAY_UTILS
@@ -0,0 +1,323 @@
+#include "assembler.h"
+#include "byteutils.h"
+#include "instructions.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <map>
+
+namespace assembler {
+struct Fixup {
+    Address offset;
+    std::string label;
+    uint64_t line;
+};
+
+void error(const uint64_t& line, const std::string& message) {
+    std::cout << "Line " << line << ": " << message << std::endl;
+    exit(1);
+}
+
+// Splits the line on spaces and tabs, up to the comment.
+void tokenize(const std::string& line, std::vector<std::string>& words) {
+    words.clear();
+    size_t i = 0;
+    while (i < line.size() && line[i] != ';') {
+        if (line[i] == ' ' || line[i] == '\t' || line[i] == '\r') {
+            i++;
+            continue;
+        }
+        size_t begin = i;
+        while (i < line.size() && line[i] != ' ' && line[i] != '\t' && line[i] != '\r' && line[i] != ';') {
+            i++;
+        }
+        words.emplace_back(line, begin, i - begin);
+    }
+}
+
+bool is_number(const std::string& word) {
+    return word.find_first_not_of("0123456789") == std::string::npos;
+}
+
+bool takes_address(const uint8_t& opcode) {
+    return opcode == OP_JUMP || opcode == OP_JUMP_IF || opcode == OP_JUMP_IF_FALSE || opcode == OP_CALL;
+}
+
+// Strings are quoted, with the characters that would end them or the line escaped.
+std::string quote(const std::string& str) {
+    std::stringstream ss;
+    ss << '"';
+    for (const char& c : str) {
+        if (c == '"' || c == '\\') {
+            ss << '\\' << c;
+        } else if (c == '\n') {
+            ss << "\\n";
+        } else if (c == '\t') {
+            ss << "\\t";
+        } else if ((uint8_t) c < 0x20 || (uint8_t) c == 0x7f) {
+            const char* digits = "0123456789abcdef";
+            ss << "\\x" << digits[(uint8_t) c >> 4] << digits[c & 0xf];
+        } else {
+            ss << c;
+        }
+    }
+    ss << '"';
+    return ss.str();
+}
+
+// Reads the quoted strings of the line, which may hold spaces and ';'.
+std::vector<std::string> unquote(const std::string& line, const size_t& begin, const uint64_t& line_number) {
+    std::vector<std::string> strings;
+    size_t i = begin;
+    while (true) {
+        while (i < line.size() && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r')) {
+            i++;
+        }
+        if (i == line.size() || line[i] == ';') {
+            return strings;
+        }
+        if (line[i] != '"') {
+            error(line_number, "Expected a quoted string.");
+        }
+        std::string str;
+        for (i++; i < line.size() && line[i] != '"'; i++) {
+            if (line[i] != '\\') {
+                str += line[i];
+                continue;
+            }
+            if (++i == line.size()) {
+                break;
+            }
+            if (line[i] == 'n') {
+                str += '\n';
+            } else if (line[i] == 't') {
+                str += '\t';
+            } else if (line[i] == 'x' && i + 2 < line.size()) {
+                str += (char) std::stoi(line.substr(i + 1, 2), nullptr, 16);
+                i += 2;
+            } else {
+                str += line[i];
+            }
+        }
+        if (i == line.size()) {
+            error(line_number, "Unterminated string.");
+        }
+        strings.push_back(str);
+        i++;
+    }
+}
+
+std::string type_names(const std::vector<var::DataType>& types) {
+    if (types.empty()) {
+        return "-";
+    }
+    std::string names;
+    for (const auto& type : types) {
+        names += (names.empty() ? "" : ",") + var::TYPE_NAME.at(type);
+    }
+    return names;
+}
+
+var::DataType type_of(const std::string& name, const uint64_t& line_number) {
+    const auto type = var::TYPE_NAME_REVERSED.find(name);
+    if (type == var::TYPE_NAME_REVERSED.end()) {
+        error(line_number, "Unknown type '" + name + "'.");
+    }
+    return type->second;
+}
+
+std::vector<var::DataType> types_of(const std::string& names, const uint64_t& line_number) {
+    std::vector<var::DataType> types;
+    if (names == "-") {
+        return types;
+    }
+    std::stringstream ss(names);
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+        types.push_back(type_of(name, line_number));
+    }
+    return types;
+}
+
+// Reads a line starting with '@', which describes a section of the executable instead of code.
+void read_directive(const std::string& line, const std::vector<std::string>& words, const uint64_t& line_number, Executable& executable, std::vector<Fixup>& entries) {
+    const std::string& directive = words[0];
+    if (directive == "@function") {
+        if (words.size() != 8) {
+            error(line_number, "Expected '@function entry params returns frame_size max_stack parameter_types return_types'.");
+        }
+        executable::Function function;
+        function.entry = 0;
+        if (words[1][0] == '.') {
+            entries.push_back({executable.functions.size(), words[1], line_number});
+        } else {
+            function.entry = stoul(words[1]);
+        }
+        function.params = stoul(words[2]);
+        function.returns = stoul(words[3]);
+        function.frame_size = stoul(words[4]);
+        function.max_stack = stoul(words[5]);
+        function.parameter_types = types_of(words[6], line_number);
+        function.return_types = types_of(words[7], line_number);
+        executable.functions.push_back(function);
+    } else if (directive == "@constant" || directive == "@global") {
+        if (directive == "@global" && words.size() == 2 && type_of(words[1], line_number) == var::STRING) {
+            // string globals start empty
+            executable.globals.push_back(var::create_string("", 0));
+            return;
+        }
+        if (words.size() != 3) {
+            error(line_number, "Expected '" + directive + " type value'.");
+        }
+        type_of(words[1], line_number);
+        Var value = var::from_string({words[1], words[2]});
+        (directive == "@constant" ? executable.constants : executable.globals).push_back(value);
+    } else if (directive == "@string") {
+        std::vector<std::string> strings = unquote(line, line.find(directive) + directive.size(), line_number);
+        if (strings.size() != 1) {
+            error(line_number, "Expected '@string \"string\"'.");
+        }
+        executable.strings.push_back(strings[0]);
+    } else if (directive == "@native") {
+        // the returned type comes first, the name and library may hold spaces
+        if (words.size() < 2) {
+            error(line_number, "Expected '@native type \"name\" \"library\"'.");
+        }
+        var::DataType type = type_of(words[1], line_number);
+        std::vector<std::string> strings = unquote(line, line.find(words[1], line.find(directive) + directive.size()) + words[1].size(), line_number);
+        if (strings.size() != 2) {
+            error(line_number, "Expected '@native type \"name\" \"library\"'.");
+        }
+        executable.natives.push_back({strings[0], strings[1], type});
+    } else if (directive == "@line") {
+        if (words.size() != 3) {
+            error(line_number, "Expected '@line address line'.");
+        }
+        executable.lines.push_back({stoul(words[1]), stoul(words[2])});
+    } else {
+        error(line_number, "Unknown directive '" + directive + "'.");
+    }
+}
+}
+
+std::vector<uint8_t> assembler::assemble(std::istream& input) {
+    std::vector<uint8_t> bytes;
+    std::map<std::string, Address> labels;
+    std::vector<Fixup> fixups;
+    // sections, from the directives
+    Executable executable;
+    bool has_sections = false;
+    // functions whose entry is a label, by index
+    std::vector<Fixup> entries;
+    std::vector<std::string> words;
+    std::vector<std::string> operands;
+    std::string line;
+    uint64_t line_number = 0;
+    while (std::getline(input, line)) {
+        line_number++;
+        tokenize(line, words);
+        size_t first = !words.empty() && is_number(words[0]) ? 1 : 0;
+        if (first == words.size()) {
+            continue;
+        }
+        if (first == 0 && words[0][0] == '@') {
+            read_directive(line, words, line_number, executable, entries);
+            has_sections = true;
+            continue;
+        }
+        if (words[first][0] == '.') {
+            if (!labels.emplace(words[first], bytes.size()).second) {
+                error(line_number, "Label '" + words[first] + "' is defined twice.");
+            }
+            continue;
+        }
+
+        if (!Instruction::is_opstring(words[first])) {
+            error(line_number, "Unknown instruction '" + words[first] + "'.");
+        }
+        const auto instruction = Instruction::from_opstring(words[first]);
+        operands.assign(words.begin() + first + 1, words.end());
+        for (size_t i = 0; i < operands.size(); i++) {
+            if (operands[i][0] != '.') {
+                continue;
+            }
+            if (i != 0 || !takes_address(instruction->get_opcode())) {
+                error(line_number, "Label '" + operands[i] + "' can only be the address of a jump or a call.");
+            }
+            // address operands are always right after the opcode
+            fixups.push_back({bytes.size() + SIZE_OF_BYTE, operands[i], line_number});
+            operands[i] = "0";
+        }
+        instruction->read_string(operands);
+        instruction->write(bytes);
+    }
+
+    for (const auto& fixup : fixups) {
+        const auto label = labels.find(fixup.label);
+        if (label == labels.end()) {
+            error(fixup.line, "Undefined label '" + fixup.label + "'.");
+        }
+        byteutils::write_ulong(bytes, fixup.offset, label->second);
+    }
+    if (!has_sections) {
+        return bytes;
+    }
+    for (const auto& entry : entries) {
+        const auto label = labels.find(entry.label);
+        if (label == labels.end()) {
+            error(entry.line, "Undefined label '" + entry.label + "'.");
+        }
+        executable.functions[entry.offset].entry = label->second;
+    }
+    executable.code = bytes.data();
+    executable.code_size = bytes.size();
+    return executable::to_bytes(executable);
+}
+
+void assembler::disassemble(const Executable& executable, std::ostream& output) {
+    for (const auto& function : executable.functions) {
+        output << "@function " << function.entry << ' ' << (int) function.params << ' ' << (int) function.returns << ' '
+            << function.frame_size << ' ' << function.max_stack << ' '
+            << type_names(function.parameter_types) << ' ' << type_names(function.return_types) << '\n';
+    }
+    for (const auto& constant : executable.constants) {
+        output << "@constant " << var::to_string(constant) << '\n';
+    }
+    for (const auto& str : executable.strings) {
+        output << "@string " << quote(str) << '\n';
+    }
+    for (const auto& native : executable.natives) {
+        output << "@native " << var::TYPE_NAME.at(native.return_type) << ' ' << quote(native.name) << ' ' << quote(native.library) << '\n';
+    }
+    for (const auto& value : executable.globals) {
+        output << "@global " << (value.type == var::STRING ? var::TYPE_NAME.at(var::STRING) : var::to_string(value)) << '\n';
+    }
+    for (const auto& line : executable.lines) {
+        output << "@line " << line.address << ' ' << line.line << '\n';
+    }
+    Address index = 0;
+    while (index < executable.code_size) {
+        if (!Instruction::is_valid(executable.code, executable.code_size, index)) {
+            std::cout << "Invalid instruction at address " << index << "." << std::endl;
+            exit(1);
+        }
+        Address address = index;
+        Instruction* instruction = Instruction::OP_INSTANCES_PTR[executable.code[index]];
+        index += SIZE_OF_BYTE;
+        instruction->read(executable.code, &index);
+        output << address << '\t' << instruction->to_string();
+        if (instruction->get_opcode() == OP_PUSH_CONST) {
+            uint32_t constant = ((const ConstInstruction*) instruction)->get_index();
+            if (constant < executable.constants.size()) {
+                output << "\t; " << var::to_string(executable.constants[constant]);
+            }
+        }
+        if (instruction->get_opcode() == OP_NATIVE) {
+            uint32_t name = ((const ConstInstruction*) instruction)->get_index();
+            if (name < executable.strings.size()) {
+                output << "\t; " << executable.strings[name];
+            }
+        }
+        output << '\n';
+    }
+}
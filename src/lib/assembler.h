@@ -0,0 +1,27 @@
+#if !defined(ASSEMBLER)
+#define ASSEMBLER
+
+#include <istream>
+#include <ostream>
+#include <vector>
+#include <stdint.h>
+#include "executable.h"
+
+namespace assembler {
+// Assembles a listing in a single pass over its lines. Labels are lines starting with '.',
+// they can be used as the address of jumps and calls before being defined: those operands
+// are patched once the whole listing is read. Comments start with ';', and a leading
+// address column, as printed by the disassembler, is ignored.
+//
+// Lines starting with '@' describe the sections of an executable: '@function entry params
+// returns frame_size max_stack types types' (types separated by ',', '-' when unknown),
+// '@constant type value', '@string "text"', '@native "name" "library"', '@global type value'
+// and '@line address line'. Listings with sections give an executable, the others a flat
+// instruction stream.
+std::vector<uint8_t> assemble(std::istream& input);
+// Prints the sections of the executable, then its code, one instruction per line along
+// with its address.
+void disassemble(const Executable& executable, std::ostream& output);
+}
+
+#endif // ASSEMBLER
@@ -8,15 +8,62 @@ std::map<AstVarType, var::DataType> AST_TO_VAR = {
     {ast::CHAR, var::CHAR},
     {ast::INT, var::INT},
     {ast::LONG, var::LONG},
+    {ast::DOUBLE, var::DOUBLE},
+    {ast::STRING, var::STRING},
+    {ast::CHAR_ARRAY, var::SLICE},
+    {ast::INT_ARRAY, var::SLICE},
+    {ast::LONG_ARRAY, var::SLICE},
 };
+
+const std::map<AstVarType, var::DataType> ELEMENT_TYPE = {
+    {ast::CHAR_ARRAY, var::CHAR},
+    {ast::INT_ARRAY, var::INT},
+    {ast::LONG_ARRAY, var::LONG},
+};
+}
+
+uint8_t ast::element_size(const AstVarType& type) {
+    switch (ELEMENT_TYPE.at(type)) {
+        case var::CHAR:
+            return sizeof(char);
+        case var::INT:
+            return sizeof(int);
+        default:
+            return sizeof(long);
+    }
+}
+
+var::DataType ast::element_type(const AstVarType& type) {
+    return ELEMENT_TYPE.at(type);
+}
+
+var::DataType ast::var_type(const AstVarType& type) {
+    return AST_TO_VAR.at(type);
+}
+
+Code::Code() {
+    size = 0;
+}
+
+void Code::push_back(const Instruction* instruction) {
+    instructions.push_back(instruction);
+    size += instruction->size();
+}
+
+Address Code::get_size() const {
+    return size;
+}
+
+const std::vector<const Instruction*>& Code::get_instructions() const {
+    return instructions;
 }
 
 AbstractSyntaxTree::AbstractSyntaxTree() {
     written = false;
 }
 
-void AbstractSyntaxTree::write(std::vector<const Instruction*>& instructions) {
-    program_address = ast::count_bytes(instructions);
+void AbstractSyntaxTree::write(Code& instructions) {
+    program_address = instructions.get_size();
     written = true;
 }
 
@@ -32,14 +79,38 @@ LiteralNode::LiteralNode(const Var& value) : AbstractSyntaxTree() {
     this->value = value;
 }
 
-void LiteralNode::write(std::vector<const Instruction*>& instructions) {
+void LiteralNode::write(Code& instructions) {
     AbstractSyntaxTree::write(instructions);
     instructions.push_back(new PushInstruction(value));
 }
 
-VariableNode::VariableNode(const std::shared_ptr<const AbstractSyntaxTree>& frame, const ast::AstVarType& type) {
+Var LiteralNode::get_value() const {
+    return value;
+}
+
+ConstantNode::ConstantNode(const uint32_t& index) : AbstractSyntaxTree() {
+    this->index = index;
+}
+
+void ConstantNode::write(Code& instructions) {
+    AbstractSyntaxTree::write(instructions);
+    instructions.push_back(new PushConstInstruction(index));
+}
+
+uint32_t ConstantNode::get_index() const {
+    return index;
+}
+
+VariableNode::VariableNode(
+    const std::shared_ptr<const AbstractSyntaxTree>& frame,
+    const ast::AstVarType& type,
+    const uint32_t& length,
+    const bool& has_elements
+) {
     this->frame = frame;
     this->type = type;
+    this->length = length;
+    this->global = false;
     if (frame == nullptr) {
         std::cout << "Trying to get address without a frame" << std::endl;
         exit(1);
@@ -49,10 +120,51 @@ VariableNode::VariableNode(const std::shared_ptr<const AbstractSyntaxTree>& fram
     }
     address = latest_address[frame];
     latest_address[frame]++;
+    if (has_elements) {
+        uint64_t bytes = (uint64_t) length * ast::element_size(type);
+        latest_address[frame] += (bytes + sizeof(Var) - 1) / sizeof(Var);
+    }
+}
+
+VariableNode::VariableNode(
+    const std::shared_ptr<const AbstractSyntaxTree>& frame,
+    const std::vector<ast::AstVarType>& fields
+) : VariableNode(frame, ast::STRUCT) {
+    this->fields = fields;
+    latest_address[frame] += fields.size() - 1;
 }
 
-void VariableNode::write(std::vector<const Instruction*>& instructions) {
+VariableNode::VariableNode(
+    const std::shared_ptr<const VariableNode>& parent,
+    const Address& offset,
+    const ast::AstVarType& type,
+    const std::vector<ast::AstVarType>& fields
+) {
+    this->frame = parent->frame;
+    this->address = parent->address + offset;
+    this->type = type;
+    this->length = 0;
+    this->global = false;
+    this->fields = fields;
+}
+
+VariableNode::VariableNode(const Address& global, const ast::AstVarType& type) {
+    this->address = global;
+    this->type = type;
+    this->length = 0;
+    this->global = true;
+}
+
+void VariableNode::write(Code& instructions) {
     AbstractSyntaxTree::write(instructions);
+    if (type == ast::STRUCT) {
+        instructions.push_back(new LoadBlockInstruction(address, fields.size()));
+        return;
+    }
+    if (global) {
+        instructions.push_back(new LoadGlobalInstruction(address));
+        return;
+    }
     instructions.push_back(new LoadInstruction(address));
 }
 
@@ -60,10 +172,27 @@ Address VariableNode::get_address() const {
     return address;
 }
 
+bool VariableNode::is_global() const {
+    return global;
+}
+
 ast::AstVarType VariableNode::get_type() const {
     return type;
 }
 
+uint32_t VariableNode::get_length() const {
+    return length;
+}
+
+std::vector<ast::AstVarType> VariableNode::get_fields() const {
+    return fields;
+}
+
+Address VariableNode::count(const std::shared_ptr<const AbstractSyntaxTree>& frame) {
+    const auto it = latest_address.find(frame);
+    return it == latest_address.end() ? 0 : it->second;
+}
+
 AssignNode::AssignNode(
     const std::shared_ptr<VariableNode>& node,
     const std::shared_ptr<AbstractSyntaxTree>& expression
@@ -72,15 +201,67 @@ AssignNode::AssignNode(
     this->expression = expression;
 }
 
-void AssignNode::write(std::vector<const Instruction*>& instructions) {
+void AssignNode::write(Code& instructions) {
     AbstractSyntaxTree::write(instructions);
     expression->write(instructions);
+    if (node->get_type() == ast::STRUCT) {
+        instructions.push_back(new StoreBlockInstruction(node->get_address(), node->get_fields().size()));
+        return;
+    }
+    if (node->is_global()) {
+        instructions.push_back(new StoreGlobalInstruction(node->get_address()));
+        return;
+    }
     instructions.push_back(new StoreInstruction(node->get_address()));
 }
 
+ArrayNode::ArrayNode(const std::shared_ptr<VariableNode>& node) : AbstractSyntaxTree() {
+    this->node = node;
+}
+
+void ArrayNode::write(Code& instructions) {
+    AbstractSyntaxTree::write(instructions);
+    instructions.push_back(new NewArrayInstruction(node->get_address(), node->get_length() * ast::element_size(node->get_type())));
+}
+
+IndexNode::IndexNode(
+    const std::shared_ptr<VariableNode>& node,
+    const std::shared_ptr<AbstractSyntaxTree>& index
+) : AbstractSyntaxTree() {
+    this->node = node;
+    this->index = index;
+}
+
+std::shared_ptr<VariableNode> IndexNode::get_node() const {
+    return node;
+}
+
+void IndexNode::write(Code& instructions) {
+    AbstractSyntaxTree::write(instructions);
+    index->write(instructions);
+    instructions.push_back(new LoadIndexInstruction(node->get_address(), ast::element_type(node->get_type())));
+}
+
+AssignIndexNode::AssignIndexNode(
+    const std::shared_ptr<VariableNode>& node,
+    const std::shared_ptr<AbstractSyntaxTree>& index,
+    const std::shared_ptr<AbstractSyntaxTree>& expression
+) : AbstractSyntaxTree() {
+    this->node = node;
+    this->index = index;
+    this->expression = expression;
+}
+
+void AssignIndexNode::write(Code& instructions) {
+    AbstractSyntaxTree::write(instructions);
+    index->write(instructions);
+    expression->write(instructions);
+    instructions.push_back(new StoreIndexInstruction(node->get_address(), ast::element_type(node->get_type())));
+}
+
 BlockNode::BlockNode() : AbstractSyntaxTree() {}
 
-void BlockNode::write(std::vector<const Instruction*>& instructions) {
+void BlockNode::write(Code& instructions) {
     AbstractSyntaxTree::write(instructions);
     for (auto node : nodes) {
         node->write(instructions);
@@ -101,7 +282,19 @@ BinaryOperationNode::BinaryOperationNode(
     this->operation = operation;
 }
 
-void BinaryOperationNode::write(std::vector<const Instruction*>& instructions) {
+std::shared_ptr<AbstractSyntaxTree> BinaryOperationNode::get_left() const {
+    return left;
+}
+
+std::shared_ptr<AbstractSyntaxTree> BinaryOperationNode::get_right() const {
+    return right;
+}
+
+ast::AstBinaryOperation BinaryOperationNode::get_operation() const {
+    return operation;
+}
+
+void BinaryOperationNode::write(Code& instructions) {
     AbstractSyntaxTree::write(instructions);
     left->write(instructions);
     right->write(instructions);
@@ -164,7 +357,11 @@ BooleanNotNode::BooleanNotNode(const std::shared_ptr<AbstractSyntaxTree>& expres
     this->expression = expression;
 }
 
-void BooleanNotNode::write(std::vector<const Instruction*>& instructions) {
+std::shared_ptr<AbstractSyntaxTree> BooleanNotNode::get_expression() const {
+    return expression;
+}
+
+void BooleanNotNode::write(Code& instructions) {
     AbstractSyntaxTree::write(instructions);
     expression->write(instructions);
     instructions.push_back(new BooleanNotInstruction());
@@ -174,7 +371,11 @@ BinaryNotNode::BinaryNotNode(const std::shared_ptr<AbstractSyntaxTree>& expressi
     this->expression = expression;
 }
 
-void BinaryNotNode::write(std::vector<const Instruction*>& instructions) {
+std::shared_ptr<AbstractSyntaxTree> BinaryNotNode::get_expression() const {
+    return expression;
+}
+
+void BinaryNotNode::write(Code& instructions) {
     AbstractSyntaxTree::write(instructions);
     expression->write(instructions);
     instructions.push_back(new BinaryNotInstruction());
@@ -190,7 +391,7 @@ IfNode::IfNode(
     this->else_block = else_block;
 }
 
-void IfNode::write(std::vector<const Instruction*>& instructions) {
+void IfNode::write(Code& instructions) {
     AbstractSyntaxTree::write(instructions);
     condition->write(instructions);
     JumpIfFalseInstruction* jump = new JumpIfFalseInstruction();
@@ -199,11 +400,11 @@ void IfNode::write(std::vector<const Instruction*>& instructions) {
     if (else_block != nullptr) {
         JumpInstruction* jump_to_end = new JumpInstruction();
         instructions.push_back(jump_to_end);
-        jump->set_address(ast::count_bytes(instructions));
+        jump->set_address(instructions.get_size());
         else_block->write(instructions);
-        jump_to_end->set_address(ast::count_bytes(instructions));
+        jump_to_end->set_address(instructions.get_size());
     } else {
-        jump->set_address(ast::count_bytes(instructions));
+        jump->set_address(instructions.get_size());
     }
 }
 
@@ -215,15 +416,15 @@ WhileNode::WhileNode(
     this->body = body;
 }
 
-void WhileNode::write(std::vector<const Instruction*>& instructions) {
+void WhileNode::write(Code& instructions) {
     AbstractSyntaxTree::write(instructions);
-    Address while_address = ast::count_bytes(instructions);
+    Address while_address = instructions.get_size();
     condition->write(instructions);
     JumpIfFalseInstruction* jump = new JumpIfFalseInstruction();
     instructions.push_back(jump);
     body->write(instructions);
     instructions.push_back(new JumpInstruction(while_address));
-    jump->set_address(ast::count_bytes(instructions));
+    jump->set_address(instructions.get_size());
 }
 
 ForNode::ForNode(
@@ -238,52 +439,65 @@ ForNode::ForNode(
     this->body = body;
 }
 
-void ForNode::write(std::vector<const Instruction*>& instructions) {
+void ForNode::write(Code& instructions) {
     AbstractSyntaxTree::write(instructions);
     init->write(instructions);
-    Address if_address = ast::count_bytes(instructions);
+    Address if_address = instructions.get_size();
     condition->write(instructions);
     JumpIfFalseInstruction* jump = new JumpIfFalseInstruction();
     instructions.push_back(jump);
     body->write(instructions);
     increment->write(instructions);
     instructions.push_back(new JumpInstruction(if_address));
-    jump->set_address(ast::count_bytes(instructions));
+    jump->set_address(instructions.get_size());
 }
 
-PrintNode::PrintNode(const std::shared_ptr<AbstractSyntaxTree>& expression, const std::string& end) : AbstractSyntaxTree() {
+PrintNode::PrintNode(const std::shared_ptr<AbstractSyntaxTree>& expression, const std::shared_ptr<AbstractSyntaxTree>& end) : AbstractSyntaxTree() {
     this->expression = expression;
     this->end = end;
 }
 
-void PrintNode::write(std::vector<const Instruction*>& instructions) {
+void PrintNode::write(Code& instructions) {
     AbstractSyntaxTree::write(instructions);
     expression->write(instructions);
     instructions.push_back(new PrintInstruction());
-    PrintStringNode(end).write(instructions);
+    end->write(instructions);
 }
 
-PrintStringNode::PrintStringNode(const std::string& str) : AbstractSyntaxTree() {
-    this->str = str;
+PrintStringNode::PrintStringNode(const uint32_t& index) : AbstractSyntaxTree() {
+    this->index = index;
 }
 
-void PrintStringNode::write(std::vector<const Instruction*>& instructions) {
+void PrintStringNode::write(Code& instructions) {
     AbstractSyntaxTree::write(instructions);
-    for (auto it = str.rbegin(); it < str.rend(); it++) {
-        instructions.push_back(new PushInstruction(var::create_char(*it)));
-        instructions.push_back(new PrintInstruction());
-    }
+    instructions.push_back(new PrintConstInstruction(index));
 }
 
-FunctionNode::FunctionNode(const bool& is_main) : AbstractSyntaxTree() {
+StringNode::StringNode(const uint32_t& index) : AbstractSyntaxTree() {
+    this->index = index;
+}
+
+void StringNode::write(Code& instructions) {
+    AbstractSyntaxTree::write(instructions);
+    instructions.push_back(new PushStringInstruction(index));
+}
+
+FunctionNode::FunctionNode(const std::string& name, const bool& is_main) : AbstractSyntaxTree() {
+    this->name = name;
     this->is_main = is_main;
+    this->external = false;
+    this->native = false;
+    this->native_index = 0;
 }
 
-void FunctionNode::write(std::vector<const Instruction*>& instructions) {
+void FunctionNode::write(Code& instructions) {
+    if (external) {
+        return;
+    }
     if (is_main) {
         AbstractSyntaxTree::write(instructions);
-        for (auto parameter : parameters) {
-            instructions.push_back(new StoreInstruction(parameter->get_address()));
+        for (auto it = parameters.rbegin(); it < parameters.rend(); it++) {
+            instructions.push_back(new StoreInstruction((*it)->get_address()));
         }
         body->write(instructions);
         return;
@@ -291,12 +505,19 @@ void FunctionNode::write(std::vector<const Instruction*>& instructions) {
     JumpInstruction* jump = jump = new JumpInstruction();
     instructions.push_back(jump);
     AbstractSyntaxTree::write(instructions);
-    for (auto parameter : parameters) {
-        instructions.push_back(new StoreInstruction(parameter->get_address()));
+    // the parameters are the first locals, in the order of the stack
+    if (get_parameters_count() == 1) {
+        instructions.push_back(new StoreInstruction(parameters.front()->get_address()));
+    } else if (get_parameters_count() > 1) {
+        instructions.push_back(new StoreBlockInstruction(parameters.front()->get_address(), get_parameters_count()));
     }
     body->write(instructions);
     instructions.push_back(new RetInstruction(0));
-    jump->set_address(ast::count_bytes(instructions));
+    jump->set_address(instructions.get_size());
+}
+
+std::string FunctionNode::get_name() const {
+    return name;
 }
 
 std::vector<std::shared_ptr<const VariableNode>> FunctionNode::get_parameters() const {
@@ -304,13 +525,48 @@ std::vector<std::shared_ptr<const VariableNode>> FunctionNode::get_parameters()
 }
 
 uint8_t FunctionNode::get_parameters_count() const {
-    return parameters.size();
+    return get_parameter_types().size();
+}
+
+std::vector<ast::AstVarType> FunctionNode::get_parameter_types() const {
+    std::vector<ast::AstVarType> types;
+    for (const auto& parameter : parameters) {
+        if (parameter->get_type() == ast::STRUCT) {
+            const auto fields = parameter->get_fields();
+            types.insert(types.end(), fields.begin(), fields.end());
+        } else {
+            types.push_back(parameter->get_type());
+        }
+    }
+    return types;
 }
 
 ast::AstVarType FunctionNode::get_return_type() const {
     return return_type;
 }
 
+std::vector<ast::AstVarType> FunctionNode::get_return_types() const {
+    if (return_type == ast::VOID) {
+        return {};
+    }
+    if (return_type == ast::STRUCT) {
+        return return_fields;
+    }
+    return {return_type};
+}
+
+bool FunctionNode::is_external() const {
+    return external;
+}
+
+bool FunctionNode::is_native() const {
+    return native;
+}
+
+uint32_t FunctionNode::get_native_index() const {
+    return native_index;
+}
+
 void FunctionNode::set_body(const std::shared_ptr<AbstractSyntaxTree>& body) {
     this->body = body;
 }
@@ -320,8 +576,81 @@ void FunctionNode::set_parameters(const std::vector<std::shared_ptr<VariableNode
     this->parameters.insert(this->parameters.end(), parameters.begin(), parameters.end());
 }
 
-void FunctionNode::set_return_type(const ast::AstVarType& return_type) {
+void FunctionNode::set_return_type(const ast::AstVarType& return_type, const std::vector<ast::AstVarType>& return_fields) {
     this->return_type = return_type;
+    this->return_fields = return_fields;
+}
+
+void FunctionNode::set_external(const bool& external) {
+    this->external = external;
+}
+
+void FunctionNode::set_native(const uint32_t& index) {
+    this->native = true;
+    this->native_index = index;
+}
+
+ModuleNode::ModuleNode() : BlockNode() {}
+
+void ModuleNode::add_import(const std::string& path) {
+    imports.push_back(path);
+}
+
+void ModuleNode::add_native(const executable::Native& native) {
+    natives[native.name] = native;
+}
+
+void ModuleNode::add_function(const std::shared_ptr<FunctionNode>& function) {
+    functions.push_back(function);
+}
+
+void ModuleNode::add_line(const std::shared_ptr<AbstractSyntaxTree>& statement, const uint64_t& line) {
+    lines.push_back(std::make_pair(statement, line));
+}
+
+void ModuleNode::set_main(const std::shared_ptr<FunctionNode>& main) {
+    this->main = main;
+}
+
+std::vector<std::string> ModuleNode::get_imports() const {
+    return imports;
+}
+
+std::map<std::string, executable::Native> ModuleNode::get_natives() const {
+    return natives;
+}
+
+std::vector<std::shared_ptr<FunctionNode>> ModuleNode::get_functions() const {
+    return functions;
+}
+
+std::vector<std::pair<std::shared_ptr<AbstractSyntaxTree>, uint64_t>> ModuleNode::get_lines() const {
+    return lines;
+}
+
+std::shared_ptr<FunctionNode> ModuleNode::get_main() const {
+    return main;
+}
+
+Address ModuleNode::add_global(const Var& value) {
+    globals.push_back(value);
+    return globals.size() - 1;
+}
+
+void ModuleNode::set_global(const Address& address, const Var& value) {
+    globals[address] = value;
+}
+
+std::vector<Var> ModuleNode::get_globals() const {
+    return globals;
+}
+
+ConstantPool& ModuleNode::get_constant_pool() {
+    return constant_pool;
+}
+
+const ConstantPool& ModuleNode::get_constant_pool() const {
+    return constant_pool;
 }
 
 CallNode::CallNode(
@@ -332,32 +661,73 @@ CallNode::CallNode(
     this->values.insert(this->values.end(), values.begin(), values.end());
 }
 
-void CallNode::write(std::vector<const Instruction*>& instructions) {
-    if (!function->is_written()) {
+std::shared_ptr<FunctionNode> CallNode::get_function() const {
+    return function;
+}
+
+void CallNode::write(Code& instructions) {
+    if (!function->is_written() && !function->is_external()) {
         std::cout << "Trying to call a function not yet written (declared)." << std::endl;
         exit(1);
     }
-    if (values.size() != function->get_parameters_count()) {
-        std::cout << "Function accepts " << function->get_parameters_count() << " parameters, but " << values.size() << " were passed." << std::endl;
+    if (values.size() != function->get_parameters().size()) {
+        std::cout << "Function accepts " << function->get_parameters().size() << " parameters, but " << values.size() << " were passed." << std::endl;
         exit(1);
     }
     AbstractSyntaxTree::write(instructions);
-    for (auto it = values.rbegin(); it < values.rend(); it++) {
-        (*it)->write(instructions);
+    // native functions read their arguments in place on the stack, without a frame of their own
+    if (function->is_native()) {
+        for (const auto& value : values) {
+            value->write(instructions);
+        }
+        instructions.push_back(new NativeInstruction(function->get_native_index(), function->get_parameters_count()));
+        return;
+    }
+    // the arguments are moved to the frame of the callee in the order they are pushed
+    for (const auto& value : values) {
+        value->write(instructions);
+    }
+    if (function->is_external()) {
+        instructions.push_back(new CallInstruction(function->get_name(), function->get_parameters_count()));
+    } else {
+        instructions.push_back(new CallInstruction(function->get_program_address(), function->get_parameters_count()));
     }
-    instructions.push_back(new CallInstruction(function->get_program_address(), function->get_parameters_count()));
+}
+
+ReturnedFieldNode::ReturnedFieldNode(
+    const std::shared_ptr<AssignNode>& returned,
+    const std::shared_ptr<VariableNode>& field
+) : AbstractSyntaxTree() {
+    this->returned = returned;
+    this->field = field;
+}
+
+void ReturnedFieldNode::write(Code& instructions) {
+    AbstractSyntaxTree::write(instructions);
+    returned->write(instructions);
+    field->write(instructions);
+}
+
+std::shared_ptr<VariableNode> ReturnedFieldNode::get_field() const {
+    return field;
 }
 
 ReturnNode::ReturnNode(const std::vector<std::shared_ptr<AbstractSyntaxTree>>& values) : AbstractSyntaxTree() {
     this->values = values;
+    this->count = values.size();
 }
 
-void ReturnNode::write(std::vector<const Instruction*>& instructions) {
+ReturnNode::ReturnNode(const std::shared_ptr<AbstractSyntaxTree>& value, const uint8_t& count) : AbstractSyntaxTree() {
+    this->values = {value};
+    this->count = count;
+}
+
+void ReturnNode::write(Code& instructions) {
     AbstractSyntaxTree::write(instructions);
     for (auto value : values) {
         value->write(instructions);
     }
-    instructions.push_back(new RetInstruction(values.size()));
+    instructions.push_back(new RetInstruction(count));
 }
 
 ConvertNode::ConvertNode(
@@ -368,49 +738,224 @@ ConvertNode::ConvertNode(
     this->type = type;
 }
 
-void ConvertNode::write(std::vector<const Instruction*>& instructions) {
+ast::AstVarType ConvertNode::get_type() const {
+    return type;
+}
+
+void ConvertNode::write(Code& instructions) {
     AbstractSyntaxTree::write(instructions);
     expression->write(instructions);
     instructions.push_back(new ConvertInstruction(ast::AST_TO_VAR.at(type)));
 }
 
 NativeNode::NativeNode(
-    const std::string& function_name,
+    const uint32_t& index,
     const std::vector<std::shared_ptr<VariableNode>>& values
 ) : AbstractSyntaxTree() {
-    this->function_name = function_name;
+    this->index = index;
     this->values.insert(this->values.begin(), values.begin(), values.end());
 }
 
-void NativeNode::write(std::vector<const Instruction*>& instructions) {
+void NativeNode::write(Code& instructions) {
+    // the arguments are pushed in order
     for (const auto& value : values) {
         value->write(instructions);
     }
-    instructions.push_back(new NativeInstruction(function_name));
+    instructions.push_back(new NativeInstruction(index, values.size()));
 }
 
-HaltNode::HaltNode() : AbstractSyntaxTree() {}
+PopNode::PopNode(const std::shared_ptr<AbstractSyntaxTree>& expression, const uint8_t& count) : AbstractSyntaxTree() {
+    this->expression = expression;
+    this->count = count;
+}
 
-void HaltNode::write(std::vector<const Instruction*>& instructions) {
+void PopNode::write(Code& instructions) {
     AbstractSyntaxTree::write(instructions);
-    instructions.push_back(new HaltInstruction());
+    expression->write(instructions);
+    for (uint8_t i = 0; i < count; i++) {
+        instructions.push_back(new PopInstruction());
+    }
+}
+
+BuiltinNode::BuiltinNode(
+    const ast::AstBuiltin& builtin,
+    const std::vector<std::shared_ptr<AbstractSyntaxTree>>& values,
+    const uint32_t& index
+) : AbstractSyntaxTree() {
+    this->builtin = builtin;
+    this->values = values;
+    this->index = index;
 }
 
-Address ast::count_bytes(const std::vector<const Instruction*>& instructions) {
-    Address size = 0;
-    for (const auto& instruction : instructions) {
-        size += instruction->size();
+ast::AstBuiltin BuiltinNode::get_builtin() const {
+    return builtin;
+}
+
+void BuiltinNode::write(Code& instructions) {
+    AbstractSyntaxTree::write(instructions);
+    for (const auto& value : values) {
+        value->write(instructions);
     }
-    return size;
+    switch (builtin) {
+        case ast::READ_LONG:
+            instructions.push_back(new ReadLongInstruction());
+            break;
+        case ast::READ_INT:
+            instructions.push_back(new ReadIntInstruction());
+            break;
+        case ast::READ_CHAR:
+            instructions.push_back(new ReadCharInstruction());
+            break;
+        case ast::END_OF_INPUT:
+            instructions.push_back(new EofInstruction());
+            break;
+        case ast::MAP_FILE:
+            instructions.push_back(new MapFileInstruction(index));
+            break;
+        case ast::MAPPED_SIZE:
+            instructions.push_back(new MappedSizeInstruction());
+            break;
+        case ast::MAPPED_BYTE:
+            instructions.push_back(new MappedByteInstruction());
+            break;
+        case ast::MAPPED_INT:
+            instructions.push_back(new MappedIntInstruction());
+            break;
+        case ast::MAPPED_LONG:
+            instructions.push_back(new MappedLongInstruction());
+            break;
+        case ast::MAPPED_SLICE:
+            instructions.push_back(new MappedSliceInstruction());
+            break;
+        case ast::STRING_LENGTH:
+            instructions.push_back(new StringLengthInstruction());
+            break;
+        case ast::STRING_INDEX:
+            instructions.push_back(new StringIndexInstruction());
+            break;
+        case ast::STRING_BUILDER:
+            instructions.push_back(new StringBuilderInstruction());
+            break;
+        case ast::STRING_APPEND:
+            instructions.push_back(new StringAppendInstruction());
+            break;
+        case ast::STRING_APPEND_CHAR:
+            instructions.push_back(new StringAppendCharInstruction());
+            break;
+        case ast::STRING_BUILD:
+            instructions.push_back(new StringBuildInstruction());
+            break;
+        case ast::MAP_NEW:
+            instructions.push_back(new MapNewInstruction());
+            break;
+        case ast::MAP_GET:
+            instructions.push_back(new MapGetInstruction());
+            break;
+        case ast::MAP_PUT:
+            instructions.push_back(new MapPutInstruction());
+            break;
+        case ast::MAP_CONTAINS:
+            instructions.push_back(new MapContainsInstruction());
+            break;
+        case ast::MAP_REMOVE:
+            instructions.push_back(new MapRemoveInstruction());
+            break;
+        case ast::MAP_SIZE:
+            instructions.push_back(new MapSizeInstruction());
+            break;
+        case ast::MAP_FREE:
+            instructions.push_back(new MapFreeInstruction());
+            break;
+    }
+}
+
+ArrayBuiltinNode::ArrayBuiltinNode(
+    const ast::AstArrayBuiltin& builtin,
+    const ast::AstVarType& type,
+    const std::vector<std::shared_ptr<AbstractSyntaxTree>>& values
+) : AbstractSyntaxTree() {
+    this->builtin = builtin;
+    this->type = type;
+    this->values = values;
+}
+
+void ArrayBuiltinNode::write(Code& instructions) {
+    AbstractSyntaxTree::write(instructions);
+    for (const auto& value : values) {
+        value->write(instructions);
+    }
+    var::DataType element = ast::element_type(type);
+    switch (builtin) {
+        case ast::ARRAY_FILL:
+            instructions.push_back(new ArrayFillInstruction(element));
+            break;
+        case ast::ARRAY_COPY:
+            instructions.push_back(new ArrayCopyInstruction(element));
+            break;
+        case ast::ARRAY_SUM:
+            instructions.push_back(new ArraySumInstruction(element));
+            break;
+        case ast::ARRAY_MIN:
+            instructions.push_back(new ArrayMinInstruction(element));
+            break;
+        case ast::ARRAY_MAX:
+            instructions.push_back(new ArrayMaxInstruction(element));
+            break;
+        case ast::ARRAY_DOT:
+            instructions.push_back(new ArrayDotInstruction(element));
+            break;
+        case ast::ARRAY_COUNT:
+            instructions.push_back(new ArrayCountInstruction(element));
+            break;
+        case ast::ARRAY_ADD:
+            instructions.push_back(new ArrayAddInstruction(element));
+            break;
+        case ast::ARRAY_MUL:
+            instructions.push_back(new ArrayMulInstruction(element));
+            break;
+        case ast::ARRAY_ADD_ARRAY:
+            instructions.push_back(new ArrayAddArrayInstruction(element));
+            break;
+        case ast::ARRAY_MUL_ARRAY:
+            instructions.push_back(new ArrayMulArrayInstruction(element));
+            break;
+        case ast::ARRAY_SORT:
+            instructions.push_back(new ArraySortInstruction(element));
+            break;
+        case ast::ARRAY_SEARCH:
+            instructions.push_back(new ArraySearchInstruction(element));
+            break;
+    }
+}
+
+FlushNode::FlushNode() : AbstractSyntaxTree() {}
+
+void FlushNode::write(Code& instructions) {
+    AbstractSyntaxTree::write(instructions);
+    instructions.push_back(new FlushInstruction());
+}
+
+SnapshotNode::SnapshotNode() : AbstractSyntaxTree() {}
+
+void SnapshotNode::write(Code& instructions) {
+    AbstractSyntaxTree::write(instructions);
+    instructions.push_back(new SnapshotInstruction());
+}
+
+HaltNode::HaltNode() : AbstractSyntaxTree() {}
+
+void HaltNode::write(Code& instructions) {
+    AbstractSyntaxTree::write(instructions);
+    instructions.push_back(new HaltInstruction());
 }
 
 std::vector<std::unique_ptr<const Instruction>> ast::to_instructions(const std::shared_ptr<AbstractSyntaxTree>& root) {
-    std::vector<const Instruction*> instructions;
+    Code instructions;
     root->write(instructions);
     instructions.push_back(new HaltInstruction());
 
     std::vector<std::unique_ptr<const Instruction>> instructions_ptr;
-    for (auto ptr : instructions) {
+    for (auto ptr : instructions.get_instructions()) {
         instructions_ptr.push_back(std::unique_ptr<const Instruction>(ptr));
     }
     return instructions_ptr;
@@ -7,11 +7,27 @@
 #include <memory>
 #include <stdint.h>
 #include "instructions.h"
+#include "constant_pool.h"
+#include "executable.h"
+
+// Instructions written by the nodes, with their size in bytes counted as they are added,
+// which is the address of the next one.
+class Code {
+    public:
+    Code();
+    void push_back(const Instruction* instruction);
+    Address get_size() const;
+    const std::vector<const Instruction*>& get_instructions() const;
+
+    private:
+    std::vector<const Instruction*> instructions;
+    Address size;
+};
 
 class AbstractSyntaxTree {
     public:
     AbstractSyntaxTree();
-    virtual void write(std::vector<const Instruction*>& instructions);
+    virtual void write(Code& instructions);
 
     Address get_program_address() const;
     bool is_written() const;
@@ -24,29 +40,79 @@ class AbstractSyntaxTree {
 class LiteralNode: public AbstractSyntaxTree {
     public:
     LiteralNode(const Var& value);
-    void write(std::vector<const Instruction*>& instructions);
+    void write(Code& instructions);
+    Var get_value() const;
 
     private:
     Var value;
 };
 
+// Literal stored in the constant pool of the module.
+class ConstantNode: public AbstractSyntaxTree {
+    public:
+    ConstantNode(const uint32_t& index);
+    void write(Code& instructions);
+    uint32_t get_index() const;
+
+    private:
+    uint32_t index;
+};
+
 namespace ast {
+// arrays are views of memory owned elsewhere, they are only passed to functions
+// structs are flat, their values are consecutive locals
 enum AstVarType {
-    BOOL, CHAR, INT, LONG, VOID
+    // types are stored by value in modules, new ones are added at the end
+    BOOL, CHAR, INT, LONG, VOID, CHAR_ARRAY, INT_ARRAY, LONG_ARRAY, DOUBLE, STRING, STRUCT
 };
 }
 
+namespace ast {
+// bytes of the elements of an array type
+uint8_t element_size(const AstVarType& type);
+var::DataType element_type(const AstVarType& type);
+// type of the values of a scalar type
+var::DataType var_type(const AstVarType& type);
+}
+
 class VariableNode: public AbstractSyntaxTree {
     public:
-    VariableNode(const std::shared_ptr<const AbstractSyntaxTree>& frame, const ast::AstVarType& type);
-    void write(std::vector<const Instruction*>& instructions);
+    // Arrays have a length when it is known, and the ones declared in the frame are
+    // followed by the locals holding their elements.
+    VariableNode(
+        const std::shared_ptr<const AbstractSyntaxTree>& frame,
+        const ast::AstVarType& type,
+        const uint32_t& length = 0,
+        const bool& has_elements = false
+    );
+    // Struct taking a local for each of its values, nested structs included.
+    VariableNode(const std::shared_ptr<const AbstractSyntaxTree>& frame, const std::vector<ast::AstVarType>& fields);
+    // Field of a struct, at an offset from its first local. Fields that are structs have fields.
+    VariableNode(
+        const std::shared_ptr<const VariableNode>& parent,
+        const Address& offset,
+        const ast::AstVarType& type,
+        const std::vector<ast::AstVarType>& fields = std::vector<ast::AstVarType>()
+    );
+    // Global at an address of the data section of the module, outside of every frame.
+    VariableNode(const Address& global, const ast::AstVarType& type);
+    void write(Code& instructions);
     Address get_address() const;
+    bool is_global() const;
     ast::AstVarType get_type() const;
+    uint32_t get_length() const;
+    std::vector<ast::AstVarType> get_fields() const;
+    // number of variables allocated in the frame
+    static Address count(const std::shared_ptr<const AbstractSyntaxTree>& frame);
     
     private:
     std::shared_ptr<const AbstractSyntaxTree> frame;
     Address address;
     ast::AstVarType type;
+    uint32_t length;
+    bool global;
+    // types of the values of a struct
+    std::vector<ast::AstVarType> fields;
 
     static inline std::map<std::shared_ptr<const AbstractSyntaxTree>, Address> latest_address;
 };
@@ -68,7 +134,10 @@ class BinaryOperationNode: public AbstractSyntaxTree {
         const std::shared_ptr<AbstractSyntaxTree>& right,
         const ast::AstBinaryOperation& operation
     );
-    void write(std::vector<const Instruction*>& instructions);
+    void write(Code& instructions);
+    std::shared_ptr<AbstractSyntaxTree> get_left() const;
+    std::shared_ptr<AbstractSyntaxTree> get_right() const;
+    ast::AstBinaryOperation get_operation() const;
 
     private:
     std::shared_ptr<AbstractSyntaxTree> left;
@@ -79,7 +148,8 @@ class BinaryOperationNode: public AbstractSyntaxTree {
 class BooleanNotNode: public AbstractSyntaxTree {
     public:
     BooleanNotNode(const std::shared_ptr<AbstractSyntaxTree>& expression);
-    void write(std::vector<const Instruction*>& instructions);
+    void write(Code& instructions);
+    std::shared_ptr<AbstractSyntaxTree> get_expression() const;
 
     private:
     std::shared_ptr<AbstractSyntaxTree> expression;
@@ -88,7 +158,8 @@ class BooleanNotNode: public AbstractSyntaxTree {
 class BinaryNotNode: public AbstractSyntaxTree {
     public:
     BinaryNotNode(const std::shared_ptr<AbstractSyntaxTree>& expression);
-    void write(std::vector<const Instruction*>& instructions);
+    void write(Code& instructions);
+    std::shared_ptr<AbstractSyntaxTree> get_expression() const;
 
     private:
     std::shared_ptr<AbstractSyntaxTree> expression;
@@ -97,7 +168,7 @@ class BinaryNotNode: public AbstractSyntaxTree {
 class BlockNode: public AbstractSyntaxTree {
     public:
     BlockNode();
-    void write(std::vector<const Instruction*>& instructions);
+    void write(Code& instructions);
     void add(const std::shared_ptr<AbstractSyntaxTree>& node);
 
     private:
@@ -107,13 +178,49 @@ class BlockNode: public AbstractSyntaxTree {
 class AssignNode: public AbstractSyntaxTree {
     public:
     AssignNode(const std::shared_ptr<VariableNode>& node, const std::shared_ptr<AbstractSyntaxTree>& expression);
-    void write(std::vector<const Instruction*>& instructions);
+    void write(Code& instructions);
 
     private:
     std::shared_ptr<VariableNode> node;
     std::shared_ptr<AbstractSyntaxTree> expression;
 };
 
+// Declaration of an array with its elements in the frame, all zero.
+class ArrayNode: public AbstractSyntaxTree {
+    public:
+    ArrayNode(const std::shared_ptr<VariableNode>& node);
+    void write(Code& instructions);
+
+    private:
+    std::shared_ptr<VariableNode> node;
+};
+
+class IndexNode: public AbstractSyntaxTree {
+    public:
+    IndexNode(const std::shared_ptr<VariableNode>& node, const std::shared_ptr<AbstractSyntaxTree>& index);
+    void write(Code& instructions);
+    std::shared_ptr<VariableNode> get_node() const;
+
+    private:
+    std::shared_ptr<VariableNode> node;
+    std::shared_ptr<AbstractSyntaxTree> index;
+};
+
+class AssignIndexNode: public AbstractSyntaxTree {
+    public:
+    AssignIndexNode(
+        const std::shared_ptr<VariableNode>& node,
+        const std::shared_ptr<AbstractSyntaxTree>& index,
+        const std::shared_ptr<AbstractSyntaxTree>& expression
+    );
+    void write(Code& instructions);
+
+    private:
+    std::shared_ptr<VariableNode> node;
+    std::shared_ptr<AbstractSyntaxTree> index;
+    std::shared_ptr<AbstractSyntaxTree> expression;
+};
+
 class IfNode: public AbstractSyntaxTree {
     public:
     IfNode(
@@ -121,7 +228,7 @@ class IfNode: public AbstractSyntaxTree {
         const std::shared_ptr<AbstractSyntaxTree>& if_block,
         const std::shared_ptr<AbstractSyntaxTree>& else_block = nullptr
     );
-    void write(std::vector<const Instruction*>& instructions);
+    void write(Code& instructions);
 
     private:
     std::shared_ptr<AbstractSyntaxTree> condition;
@@ -132,7 +239,7 @@ class IfNode: public AbstractSyntaxTree {
 class WhileNode: public AbstractSyntaxTree {
     public:
     WhileNode(const std::shared_ptr<AbstractSyntaxTree>& condition, const std::shared_ptr<AbstractSyntaxTree>& body);
-    void write(std::vector<const Instruction*>& instructions);
+    void write(Code& instructions);
 
     private:
     std::shared_ptr<AbstractSyntaxTree> condition;
@@ -147,7 +254,7 @@ class ForNode: public AbstractSyntaxTree {
         const std::shared_ptr<AbstractSyntaxTree>& increment,
         const std::shared_ptr<AbstractSyntaxTree>& body
     );
-    void write(std::vector<const Instruction*>& instructions);
+    void write(Code& instructions);
 
     private:
     std::shared_ptr<AbstractSyntaxTree> init;
@@ -158,65 +265,145 @@ class ForNode: public AbstractSyntaxTree {
 
 class PrintNode: public AbstractSyntaxTree {
     public:
-    PrintNode(const std::shared_ptr<AbstractSyntaxTree>& expression, const std::string& end = "\n");
-    void write(std::vector<const Instruction*>& instructions);
+    PrintNode(const std::shared_ptr<AbstractSyntaxTree>& expression, const std::shared_ptr<AbstractSyntaxTree>& end);
+    void write(Code& instructions);
     
     private:
     std::shared_ptr<AbstractSyntaxTree> expression;
-    std::string end;
+    std::shared_ptr<AbstractSyntaxTree> end;
 };
 
 class PrintStringNode: public AbstractSyntaxTree {
     public:
-    PrintStringNode(const std::string& str);
-    void write(std::vector<const Instruction*>& instructions);
+    // index of the string in the constant pool of the module
+    PrintStringNode(const uint32_t& index);
+    void write(Code& instructions);
     
     private:
-    std::string str;
+    uint32_t index;
+};
+
+// String value, interned by the VM when it loads the program.
+class StringNode: public AbstractSyntaxTree {
+    public:
+    // index of the string in the constant pool of the module
+    StringNode(const uint32_t& index);
+    void write(Code& instructions);
+
+    private:
+    uint32_t index;
 };
 
 class FunctionNode: public AbstractSyntaxTree {
     public:
-    FunctionNode(const bool& is_main = false);
-    void write(std::vector<const Instruction*>& instructions);
+    FunctionNode(const std::string& name, const bool& is_main = false);
+    void write(Code& instructions);
+    std::string get_name() const;
     std::vector<std::shared_ptr<const VariableNode>> get_parameters() const;
+    // number and types of the values passed, the fields of structs are passed one by one
     uint8_t get_parameters_count() const;
+    std::vector<ast::AstVarType> get_parameter_types() const;
     ast::AstVarType get_return_type() const;
+    std::vector<ast::AstVarType> get_return_types() const;
+    bool is_external() const;
+    bool is_native() const;
+    uint32_t get_native_index() const;
 
     void set_body(const std::shared_ptr<AbstractSyntaxTree>& body);
     void set_parameters(const std::vector<std::shared_ptr<VariableNode>>& parameters);
-    void set_return_type(const ast::AstVarType& return_type);
+    void set_return_type(const ast::AstVarType& return_type, const std::vector<ast::AstVarType>& return_fields = std::vector<ast::AstVarType>());
+    void set_external(const bool& external);
+    void set_native(const uint32_t& index);
 
     private:
+    std::string name;
     std::shared_ptr<AbstractSyntaxTree> body;
     std::vector<std::shared_ptr<const VariableNode>> parameters;
     ast::AstVarType return_type;
+    std::vector<ast::AstVarType> return_fields;
     bool is_main;
+    // declared by an imported module, the address is resolved by the linker
+    bool external;
+    // bound to a native function, whose name is at the index of the constant pool.
+    // Calls in the module are native calls, the body only serves other modules.
+    bool native;
+    uint32_t native_index;
+};
+
+class ModuleNode: public BlockNode {
+    public:
+    ModuleNode();
+    void add_import(const std::string& path);
+    void add_native(const executable::Native& native);
+    void add_function(const std::shared_ptr<FunctionNode>& function);
+    void add_line(const std::shared_ptr<AbstractSyntaxTree>& statement, const uint64_t& line);
+    void set_main(const std::shared_ptr<FunctionNode>& main);
+    std::vector<std::string> get_imports() const;
+    std::map<std::string, executable::Native> get_natives() const;
+    std::vector<std::shared_ptr<FunctionNode>> get_functions() const;
+    std::vector<std::pair<std::shared_ptr<AbstractSyntaxTree>, uint64_t>> get_lines() const;
+    std::shared_ptr<FunctionNode> get_main() const;
+    // Adds a global starting with the value, and gives its address.
+    Address add_global(const Var& value);
+    void set_global(const Address& address, const Var& value);
+    std::vector<Var> get_globals() const;
+    ConstantPool& get_constant_pool();
+    const ConstantPool& get_constant_pool() const;
+
+    private:
+    std::vector<std::string> imports;
+    // native functions by name
+    std::map<std::string, executable::Native> natives;
+    std::vector<std::shared_ptr<FunctionNode>> functions;
+    // source line of each statement, for the debug line table
+    std::vector<std::pair<std::shared_ptr<AbstractSyntaxTree>, uint64_t>> lines;
+    // written inline in the top-level frame
+    std::shared_ptr<FunctionNode> main;
+    // initial values of the globals, written to the data section
+    std::vector<Var> globals;
+    ConstantPool constant_pool;
 };
 
 class CallNode: public AbstractSyntaxTree {
     public:
     CallNode(const std::shared_ptr<FunctionNode>& function, const std::vector<std::shared_ptr<AbstractSyntaxTree>>& values);
-    void write(std::vector<const Instruction*>& instructions);
+    void write(Code& instructions);
+    std::shared_ptr<FunctionNode> get_function() const;
 
     private:
     std::shared_ptr<FunctionNode> function;
     std::vector<std::shared_ptr<AbstractSyntaxTree>> values;
 };
 
+// Field of the struct returned by a call, read once the struct is stored into the frame.
+class ReturnedFieldNode: public AbstractSyntaxTree {
+    public:
+    ReturnedFieldNode(const std::shared_ptr<AssignNode>& returned, const std::shared_ptr<VariableNode>& field);
+    void write(Code& instructions);
+    std::shared_ptr<VariableNode> get_field() const;
+
+    private:
+    std::shared_ptr<AssignNode> returned;
+    std::shared_ptr<VariableNode> field;
+};
+
 class ReturnNode: public AbstractSyntaxTree {
     public:
     ReturnNode(const std::vector<std::shared_ptr<AbstractSyntaxTree>>& values = std::vector<std::shared_ptr<AbstractSyntaxTree>>());
-    void write(std::vector<const Instruction*>& instructions);
+    // Value made of several values, such as a struct.
+    ReturnNode(const std::shared_ptr<AbstractSyntaxTree>& value, const uint8_t& count);
+    void write(Code& instructions);
 
     private:
     std::vector<std::shared_ptr<AbstractSyntaxTree>> values;
+    uint8_t count;
 };
 
 class ConvertNode: public AbstractSyntaxTree {
     public:
     ConvertNode(const std::shared_ptr<AbstractSyntaxTree>& expression, const ast::AstVarType& type);
-    void write(std::vector<const Instruction*>& instructions);
+    void write(Code& instructions);
+    ast::AstVarType get_type() const;
 
     private:
     std::shared_ptr<AbstractSyntaxTree> expression;
@@ -225,25 +412,97 @@ class ConvertNode: public AbstractSyntaxTree {
 
 class NativeNode: public AbstractSyntaxTree {
     public:
+    // The index is the name of the function in the constant pool.
     NativeNode(
-        const std::string& function_name,
+        const uint32_t& index,
         const std::vector<std::shared_ptr<VariableNode>>& values
     );
-    void write(std::vector<const Instruction*>& instructions);
+    void write(Code& instructions);
 
     private:
-    std::string function_name;
+    uint32_t index;
     std::vector<std::shared_ptr<VariableNode>> values;
 };
 
+class PopNode: public AbstractSyntaxTree {
+    public:
+    PopNode(const std::shared_ptr<AbstractSyntaxTree>& expression, const uint8_t& count = 1);
+    void write(Code& instructions);
+
+    private:
+    std::shared_ptr<AbstractSyntaxTree> expression;
+    uint8_t count;
+};
+
+namespace ast {
+enum AstBuiltin {
+    READ_LONG, READ_INT, READ_CHAR, END_OF_INPUT,
+    MAP_FILE, MAPPED_SIZE, MAPPED_BYTE, MAPPED_INT, MAPPED_LONG, MAPPED_SLICE,
+    STRING_LENGTH, STRING_INDEX, STRING_BUILDER, STRING_APPEND, STRING_APPEND_CHAR, STRING_BUILD,
+    MAP_NEW, MAP_GET, MAP_PUT, MAP_CONTAINS, MAP_REMOVE, MAP_SIZE, MAP_FREE
+};
+}
+
+// Function of the language compiled to an instruction, after its parameters.
+// The index is the path of map_file in the constant pool.
+class BuiltinNode: public AbstractSyntaxTree {
+    public:
+    BuiltinNode(
+        const ast::AstBuiltin& builtin,
+        const std::vector<std::shared_ptr<AbstractSyntaxTree>>& values = {},
+        const uint32_t& index = 0
+    );
+    void write(Code& instructions);
+    ast::AstBuiltin get_builtin() const;
+
+    private:
+    ast::AstBuiltin builtin;
+    std::vector<std::shared_ptr<AbstractSyntaxTree>> values;
+    uint32_t index;
+};
+
+namespace ast {
+enum AstArrayBuiltin {
+    ARRAY_FILL, ARRAY_COPY, ARRAY_SUM, ARRAY_MIN, ARRAY_MAX, ARRAY_DOT, ARRAY_COUNT,
+    ARRAY_ADD, ARRAY_MUL, ARRAY_ADD_ARRAY, ARRAY_MUL_ARRAY, ARRAY_SORT, ARRAY_SEARCH
+};
+}
+
+// Builtin working on whole arrays, compiled to a single instruction for the type of their elements.
+class ArrayBuiltinNode: public AbstractSyntaxTree {
+    public:
+    ArrayBuiltinNode(
+        const ast::AstArrayBuiltin& builtin,
+        const ast::AstVarType& type,
+        const std::vector<std::shared_ptr<AbstractSyntaxTree>>& values
+    );
+    void write(Code& instructions);
+
+    private:
+    ast::AstArrayBuiltin builtin;
+    ast::AstVarType type;
+    std::vector<std::shared_ptr<AbstractSyntaxTree>> values;
+};
+
+class FlushNode: public AbstractSyntaxTree {
+    public:
+    FlushNode();
+    void write(Code& instructions);
+};
+
+class SnapshotNode: public AbstractSyntaxTree {
+    public:
+    SnapshotNode();
+    void write(Code& instructions);
+};
+
 class HaltNode: public AbstractSyntaxTree {
     public:
     HaltNode();
-    void write(std::vector<const Instruction*>& instructions);
+    void write(Code& instructions);
 };
 
 namespace ast {
-    Address count_bytes(const std::vector<const Instruction*>& instructions);
     std::vector<std::unique_ptr<const Instruction>> to_instructions(const std::shared_ptr<AbstractSyntaxTree>& root);
 };
 
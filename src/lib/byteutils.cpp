@@ -34,38 +34,83 @@ void byteutils::push_ulong(std::vector<uint8_t>& stack, const uint64_t& value) {
     stack.push_back(BYTE_7(value));
 }
 
+void byteutils::push_string(std::vector<uint8_t>& stack, const std::string& value) {
+    push_ulong(stack, value.size());
+    stack.insert(stack.end(), value.begin(), value.end());
+}
+
+void byteutils::write_int(std::vector<uint8_t>& stack, const uint64_t& index, const int32_t& value) {
+    stack[index + 0] = BYTE_0(value);
+    stack[index + 1] = BYTE_1(value);
+    stack[index + 2] = BYTE_2(value);
+    stack[index + 3] = BYTE_3(value);
+}
+
+void byteutils::write_ulong(std::vector<uint8_t>& stack, const uint64_t& index, const uint64_t& value) {
+    stack[index + 0] = BYTE_0(value);
+    stack[index + 1] = BYTE_1(value);
+    stack[index + 2] = BYTE_2(value);
+    stack[index + 3] = BYTE_3(value);
+    stack[index + 4] = BYTE_4(value);
+    stack[index + 5] = BYTE_5(value);
+    stack[index + 6] = BYTE_6(value);
+    stack[index + 7] = BYTE_7(value);
+}
+
+int16_t byteutils::read_short(const uint8_t* bytes, const uint64_t& index) {
+    return ((int16_t) bytes[index + 1] << 8) | bytes[index + 0];
+}
+
+int32_t byteutils::read_int(const uint8_t* bytes, const uint64_t& index) {
+    return
+        ((int32_t) bytes[index + 3] << 24) |
+        ((int32_t) bytes[index + 2] << 16) |
+        ((int32_t) bytes[index + 1] << 8) |
+        bytes[index + 0];
+}
+
+int64_t byteutils::read_long(const uint8_t* bytes, const uint64_t& index) {
+    return
+        ((int64_t) bytes[index + 7] << 56) |
+        ((int64_t) bytes[index + 6] << 48) |
+        ((int64_t) bytes[index + 5] << 40) |
+        ((int64_t) bytes[index + 4] << 32) |
+        ((int64_t) bytes[index + 3] << 24) |
+        ((int64_t) bytes[index + 2] << 16) |
+        ((int64_t) bytes[index + 1] << 8) |
+        bytes[index + 0];
+}
+
+uint64_t byteutils::read_ulong(const uint8_t* bytes, const uint64_t& index) {
+    return
+        ((uint64_t) bytes[index + 7] << 56) |
+        ((uint64_t) bytes[index + 6] << 48) |
+        ((uint64_t) bytes[index + 5] << 40) |
+        ((uint64_t) bytes[index + 4] << 32) |
+        ((uint64_t) bytes[index + 3] << 24) |
+        ((uint64_t) bytes[index + 2] << 16) |
+        ((uint64_t) bytes[index + 1] << 8) |
+        bytes[index + 0];
+}
+
 int16_t byteutils::read_short(const std::vector<uint8_t>& stack, const uint64_t& index) {
-    return ((int16_t) stack[index + 1] << 8) | stack[index + 0];
+    return read_short(stack.data(), index);
 }
 
 int32_t byteutils::read_int(const std::vector<uint8_t>& stack, const uint64_t& index) {
-    return
-        ((int32_t) stack[index + 3] << 24) |
-        ((int32_t) stack[index + 2] << 16) |
-        ((int32_t) stack[index + 1] << 8) |
-        stack[index + 0];
+    return read_int(stack.data(), index);
 }
 
 int64_t byteutils::read_long(const std::vector<uint8_t>& stack, const uint64_t& index) {
-    return
-        ((int64_t) stack[index + 7] << 56) |
-        ((int64_t) stack[index + 6] << 48) |
-        ((int64_t) stack[index + 5] << 40) |
-        ((int64_t) stack[index + 4] << 32) |
-        ((int64_t) stack[index + 3] << 24) |
-        ((int64_t) stack[index + 2] << 16) |
-        ((int64_t) stack[index + 1] << 8) |
-        stack[index + 0];
+    return read_long(stack.data(), index);
 }
 
 uint64_t byteutils::read_ulong(const std::vector<uint8_t>& stack, const uint64_t& index) {
-    return
-        ((uint64_t) stack[index + 7] << 56) |
-        ((uint64_t) stack[index + 6] << 48) |
-        ((uint64_t) stack[index + 5] << 40) |
-        ((uint64_t) stack[index + 4] << 32) |
-        ((uint64_t) stack[index + 3] << 24) |
-        ((uint64_t) stack[index + 2] << 16) |
-        ((uint64_t) stack[index + 1] << 8) |
-        stack[index + 0];
+    return read_ulong(stack.data(), index);
+}
+
+std::string byteutils::read_string(const std::vector<uint8_t>& stack, const uint64_t& index) {
+    uint64_t size = read_ulong(stack, index);
+    auto begin = stack.begin() + index + SIZE_OF_LONG;
+    return std::string(begin, begin + size);
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define BYTE_UTILS
 
 #include <vector>
+#include <string>
 #include <stdint.h>
 
 #define BYTE_0(x) (x & 0xff)
@@ -23,11 +24,20 @@ void push_short(std::vector<uint8_t>& stack, const int16_t& value);
 void push_int(std::vector<uint8_t>& stack, const int32_t& value);
 void push_long(std::vector<uint8_t>& stack, const int64_t& value);
 void push_ulong(std::vector<uint8_t>& stack, const uint64_t& value);
+void push_string(std::vector<uint8_t>& stack, const std::string& value);
+void write_int(std::vector<uint8_t>& stack, const uint64_t& index, const int32_t& value);
+void write_ulong(std::vector<uint8_t>& stack, const uint64_t& index, const uint64_t& value);
+
+int16_t read_short(const uint8_t* bytes, const uint64_t& index);
+int32_t read_int(const uint8_t* bytes, const uint64_t& index);
+int64_t read_long(const uint8_t* bytes, const uint64_t& index);
+uint64_t read_ulong(const uint8_t* bytes, const uint64_t& index);
 
 int16_t read_short(const std::vector<uint8_t>& stack, const uint64_t& index);
 int32_t read_int(const std::vector<uint8_t>& stack, const uint64_t& index);
 int64_t read_long(const std::vector<uint8_t>& stack, const uint64_t& index);
 uint64_t read_ulong(const std::vector<uint8_t>& stack, const uint64_t& index);
+std::string read_string(const std::vector<uint8_t>& stack, const uint64_t& index);
 }
 
 #endif // BYTE_UTILS
\ No newline at end of file
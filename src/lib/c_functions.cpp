@@ -2,59 +2,21 @@
 #include <iostream>
 #include <functional>
 #include <dlfcn.h>
+#include <mutex>
 #include <ffi.h>
 
-CFunctions::~CFunctions() {
-    functions_by_hash.clear();
-    for (auto& handle : handles) {
-        dlclose(handle);
-    }
-}
-
-void CFunctions::load(const std::vector<std::string>& shared_libraries) {
-    for (auto path : shared_libraries) {
-        void* handle = dlopen(path.c_str(), RTLD_NOW);
-        if (handle == nullptr) {
-            std::cout << dlerror() << std::endl;
-            exit(1);
-        }
-        void* ptr = dlsym(handle, "get_classes");
-        if (ptr == nullptr) {
-            std::cout << dlerror() << std::endl;
-            exit(1);
-        }
-        std::function<std::vector<CInterface*>()> get_classes = reinterpret_cast<std::vector<CInterface*>(*)()>(ptr);
-        for (auto c_function_ptr : get_classes()) {
-            const auto& fun = std::shared_ptr<CInterface>(c_function_ptr);
-            functions_by_hash[CFunctions::hasher(fun->get_name())] = fun;
-        }
-    }
-}
-
-std::shared_ptr<CInterface> CFunctions::get_function(const std::string& name) const {
-    size_t hash = CFunctions::hasher(name);
-    if (functions_by_hash.find(hash) == functions_by_hash.end()) {
-        std::cout << "Could not find function " << name << std::endl;
-        exit(1);
-    }
-    return functions_by_hash.at(hash);
-}
-
-std::shared_ptr<CInterface> CFunctions::get_function(const size_t& hash) const {
-    if (functions_by_hash.find(hash) == functions_by_hash.end()) {
-        std::cout << "Could not find function " << hash << std::endl;
-        exit(1);
-    }
-    return functions_by_hash.at(hash);
-}
-
-
 namespace cfunctions {
-std::map<var::DataType, ffi_type*> DATA_TYPE_TO_FFI_TYPE = {
+// layout of cinterface::Array, which is passed by value
+ffi_type* ARRAY_ELEMENTS[] = {&ffi_type_pointer, &ffi_type_slong, nullptr};
+ffi_type ffi_type_array = {0, 0, FFI_TYPE_STRUCT, ARRAY_ELEMENTS};
+
+const std::map<var::DataType, ffi_type*> DATA_TYPE_TO_FFI_TYPE = {
     {var::BOOL, &ffi_type_schar},
     {var::CHAR, &ffi_type_schar},
     {var::INT, &ffi_type_sint},
     {var::LONG, &ffi_type_slong},
+    {var::SLICE, &ffi_type_array},
+    {var::DOUBLE, &ffi_type_double},
 };
 
 const std::map<cinterface::ArgType, var::DataType> C_TYPE_TO_DATA_TYPE {
@@ -62,59 +24,186 @@ const std::map<cinterface::ArgType, var::DataType> C_TYPE_TO_DATA_TYPE {
     {cinterface::CHAR, var::CHAR},
     {cinterface::INT, var::INT},
     {cinterface::LONG, var::LONG},
+    {cinterface::CHAR_ARRAY, var::SLICE},
+    {cinterface::INT_ARRAY, var::SLICE},
+    {cinterface::LONG_ARRAY, var::SLICE},
+    {cinterface::DOUBLE, var::DOUBLE},
+    {cinterface::CONST_CHAR_ARRAY, var::SLICE},
+    {cinterface::CONST_INT_ARRAY, var::SLICE},
+    {cinterface::CONST_LONG_ARRAY, var::SLICE},
 };
+
+const std::map<cinterface::ArgType, uint8_t> ELEMENT_SIZE {
+    {cinterface::CHAR_ARRAY, sizeof(char)},
+    {cinterface::INT_ARRAY, sizeof(int)},
+    {cinterface::LONG_ARRAY, sizeof(long)},
+    {cinterface::CONST_CHAR_ARRAY, sizeof(char)},
+    {cinterface::CONST_INT_ARRAY, sizeof(int)},
+    {cinterface::CONST_LONG_ARRAY, sizeof(long)},
+};
+
+bool is_mutable_array(const cinterface::ArgType& type) {
+    return type == cinterface::CHAR_ARRAY || type == cinterface::INT_ARRAY || type == cinterface::LONG_ARRAY;
 }
 
-Var CFunctions::call(const std::shared_ptr<CInterface>& function, const std::vector<Var>& args) {
-    const int args_num = args.size();
+std::unique_ptr<NativeFunction> prepare(const std::shared_ptr<CInterface>& function, const std::string& library) {
+    std::unique_ptr<NativeFunction> native(new NativeFunction());
+    native->function = function;
+    native->library = library;
+    native->pointer = reinterpret_cast<void (*)()>(function->get_function());
+    native->stack_function = function->get_stack_function();
+    for (const auto& type : function->get_arg_types()) {
+        if (is_mutable_array(type)) {
+            native->mutable_arrays.push_back(native->arg_types.size());
+        }
+        native->arg_types.push_back(C_TYPE_TO_DATA_TYPE.at(type));
+        native->element_sizes.push_back(ELEMENT_SIZE.find(type) == ELEMENT_SIZE.end() ? 0 : ELEMENT_SIZE.at(type));
+        native->ffi_arg_types.push_back(DATA_TYPE_TO_FFI_TYPE.at(native->arg_types.back()));
+    }
+    if (ELEMENT_SIZE.find(function->get_return_type()) != ELEMENT_SIZE.end()) {
+        std::cout << "Native function " << function->get_name() << " can't return an array." << std::endl;
+        exit(1);
+    }
+    native->return_type = C_TYPE_TO_DATA_TYPE.at(function->get_return_type());
+    ffi_type* ffi_return_type = DATA_TYPE_TO_FFI_TYPE.at(native->return_type);
+    if (ffi_prep_cif(&native->cif, FFI_DEFAULT_ABI, native->ffi_arg_types.size(), ffi_return_type, native->ffi_arg_types.data()) != FFI_OK) {
+        std::cout << "Could not prepare call to function " << function->get_name() << std::endl;
+        exit(1);
+    }
+    return native;
+}
+
+typedef std::map<std::string, std::unique_ptr<NativeFunction>> Library;
 
-    // argument types
-    ffi_type *ffi_args[args_num];
-    for (int i = 0; i < args_num; i++) {
-        ffi_args[i] = cfunctions::DATA_TYPE_TO_FFI_TYPE.at(args.at(i).type);
+// Libraries opened by the process, by path. They stay open until it exits.
+std::mutex libraries_mutex;
+std::map<std::string, Library> libraries;
+
+const Library& open(const std::string& path) {
+    std::lock_guard<std::mutex> lock(libraries_mutex);
+    if (libraries.find(path) != libraries.end()) {
+        return libraries.at(path);
     }
-    
-    // argument values
-    void *values[args_num];
-    for (int i = 0; i < args_num; i++) {
-        values[i] = var::to_ptr(args.at(i));
+    void* handle = dlopen(path.c_str(), RTLD_NOW);
+    if (handle == nullptr) {
+        std::cout << dlerror() << std::endl;
+        exit(1);
     }
+    void* ptr = dlsym(handle, "get_classes");
+    if (ptr == nullptr) {
+        std::cout << dlerror() << std::endl;
+        exit(1);
+    }
+    std::function<std::vector<CInterface*>()> get_classes = reinterpret_cast<std::vector<CInterface*>(*)()>(ptr);
+    Library& library = libraries[path];
+    for (auto c_function_ptr : get_classes()) {
+        std::shared_ptr<CInterface> function(c_function_ptr);
+        library[function->get_name()] = prepare(function, path);
+    }
+    return library;
+}
+}
 
-    // function return type
-    var::DataType return_type = cfunctions::C_TYPE_TO_DATA_TYPE.at(function->get_return_type());
-    auto ffi_return_type = cfunctions::DATA_TYPE_TO_FFI_TYPE.at(return_type);
-
-    // function to call
-    void (*f)() = reinterpret_cast<void (*)()>(function->get_function());
-    
-    ffi_cif cif;
-    if (ffi_prep_cif(&cif, FFI_DEFAULT_ABI, args_num, ffi_return_type, ffi_args) == FFI_OK) {
-        switch (return_type) {
-            case var::BOOL: {
-                char result;
-                ffi_call(&cif, f, &result, values);
-                return var::create_bool(result);
-            }
-            case var::CHAR: {
-                char result;
-                ffi_call(&cif, f, &result, values);
-                return var::create_char(result);
-            }
-            case var::INT: {
-                int result;
-                ffi_call(&cif, f, &result, values);
-                return var::create_int(result);
-            }
-            case var::LONG: {
-                long result;
-                ffi_call(&cif, f, &result, values);
-                return var::create_long(result);
-            }
+void CFunctions::set_libraries(const std::vector<std::string>& shared_libraries) {
+    libraries = shared_libraries;
+}
+
+const NativeFunction* CFunctions::find(const std::string& name) {
+    if (has_function(name)) {
+        return bound.at(name);
+    }
+    for (const auto& library : libraries) {
+        const auto& natives = cfunctions::open(library);
+        if (natives.find(name) != natives.end()) {
+            bound[name] = natives.at(name).get();
+            return bound.at(name);
         }
-        std::cout << "Could not find type" << return_type << std::endl;
+    }
+    return nullptr;
+}
+
+void CFunctions::bind(const std::string& name, const std::string& library) {
+    const auto& natives = cfunctions::open(library);
+    if (natives.find(name) == natives.end()) {
+        std::cout << "Could not find function " << name << " in " << library << std::endl;
         exit(1);
     }
+    bound[name] = natives.at(name).get();
+}
+
+bool CFunctions::has_function(const std::string& name) const {
+    return bound.find(name) != bound.end();
+}
 
-    std::cout << "Could not call function" << std::endl;
+const NativeFunction& CFunctions::get_native(const std::string& name) const {
+    if (!has_function(name)) {
+        std::cout << "Could not find function " << name << std::endl;
+        exit(1);
+    }
+    return *bound.at(name);
+}
+
+std::shared_ptr<CInterface> CFunctions::get_function(const std::string& name) const {
+    return get_native(name).function;
+}
+
+void CFunctions::call(const NativeFunction& native, Var* args) {
+    if (native.stack_function != nullptr) {
+        native.stack_function(args);
+        return;
+    }
+
+    const size_t args_num = native.arg_types.size();
+    void* values[args_num];
+    cinterface::Array<uint8_t> arrays[args_num];
+    for (size_t i = 0; i < args_num; i++) {
+        const Var& arg = args[i];
+        if (native.element_sizes[i] == 0) {
+            values[i] = (void*) &arg.data;
+            continue;
+        }
+        // a view of the VM memory, the elements are not copied
+        arrays[i] = {arg.data._pointer, (long) (arg.length / native.element_sizes[i])};
+        values[i] = (void*) &arrays[i];
+    }
+
+    // integers smaller than a register are returned widened to ffi_arg
+    switch (native.return_type) {
+        case var::BOOL: {
+            ffi_arg result;
+            ffi_call((ffi_cif*) &native.cif, native.pointer, &result, values);
+            args[0] = var::create_bool((char) result);
+            return;
+        }
+        case var::CHAR: {
+            ffi_arg result;
+            ffi_call((ffi_cif*) &native.cif, native.pointer, &result, values);
+            args[0] = var::create_char((char) result);
+            return;
+        }
+        case var::INT: {
+            ffi_arg result;
+            ffi_call((ffi_cif*) &native.cif, native.pointer, &result, values);
+            args[0] = var::create_int((int) result);
+            return;
+        }
+        case var::LONG: {
+            long result;
+            ffi_call((ffi_cif*) &native.cif, native.pointer, &result, values);
+            args[0] = var::create_long(result);
+            return;
+        }
+        case var::DOUBLE: {
+            double result;
+            ffi_call((ffi_cif*) &native.cif, native.pointer, &result, values);
+            args[0] = var::create_double(result);
+            return;
+        }
+        case var::SLICE:
+        case var::STRING:
+            // arrays are rejected when the function is prepared, and natives have no string type
+            break;
+    }
+    std::cout << "Native function " << native.function->get_name() << " can't return type " << (int) native.return_type << std::endl;
     exit(1);
 }
@@ -7,22 +7,49 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <ffi.h>
+
+// Native function resolved once when its library is opened, with its libffi call interface prepared.
+struct NativeFunction {
+    std::shared_ptr<CInterface> function;
+    // path of the library the function comes from
+    std::string library;
+    void (*pointer)();
+    // when set, called on the operand stack instead of through libffi
+    cinterface::StackFunction stack_function;
+    std::vector<var::DataType> arg_types;
+    // bytes of the elements of the array arguments, 0 for the others
+    std::vector<uint8_t> element_sizes;
+    // arguments that are arrays the function may write to, which can't be read-only
+    std::vector<uint8_t> mutable_arrays;
+    var::DataType return_type;
+    std::vector<ffi_type*> ffi_arg_types;
+    ffi_cif cif;
+};
 
+// Native functions bound by a parser or a VM. Libraries are opened once per process,
+// shared by every parser and VM, and only when one of their functions is bound.
 class CFunctions {
     public:
-    ~CFunctions();
-
-    void load(const std::vector<std::string>& shared_libraries);
+    // Libraries searched, in order, for the functions bound by name only. None is opened here.
+    void set_libraries(const std::vector<std::string>& shared_libraries);
+    // Binds the function, opening the libraries one at a time until one has it. Null if none has.
+    const NativeFunction* find(const std::string& name);
+    // Binds the function from the given library only.
+    void bind(const std::string& name, const std::string& library);
+
+    bool has_function(const std::string& name) const;
+    const NativeFunction& get_native(const std::string& name) const;
     std::shared_ptr<CInterface> get_function(const std::string& name) const;
-    std::shared_ptr<CInterface> get_function(const size_t& hash) const;
 
-    static Var call(const std::shared_ptr<CInterface>& function, const std::vector<Var>& args);
+    // Arguments are the last values of an operand stack, in order.
+    // The result replaces the first argument.
+    static void call(const NativeFunction& native, Var* args);
 
     private:
-    std::vector<void*> handles;
-    std::map<size_t, std::shared_ptr<CInterface>> functions_by_hash;
-
-    inline static std::hash<std::string> hasher;
+    std::vector<std::string> libraries;
+    // functions never move once their library is opened
+    std::map<std::string, const NativeFunction*> bound;
 };
 
 
@@ -3,11 +3,28 @@
 
 #include <vector>
 #include <string>
+#include <utility>
+#include "var.h"
 
 namespace cinterface {
 enum ArgType {
-    BOOL, CHAR, INT, LONG
+    BOOL, CHAR, INT, LONG, CHAR_ARRAY, INT_ARRAY, LONG_ARRAY, DOUBLE,
+    // arrays the function only reads
+    CONST_CHAR_ARRAY, CONST_INT_ARRAY, CONST_LONG_ARRAY
 };
+
+// Values in the memory of the VM, passed to native functions without copying:
+// size is their number. Arrays can be parameters, not results. The ones from
+// mapped files are read-only, they can only be passed as Array<const T>.
+template <class T>
+struct Array {
+    T* data;
+    long size;
+};
+
+// Function working on the operand stack of the VM: the arguments are the last values,
+// in order, and the result replaces the first argument.
+typedef void (*StackFunction)(Var* args);
 }
 
 class CInterface {
@@ -18,6 +35,107 @@ class CInterface {
     virtual std::vector<cinterface::ArgType> get_arg_types() const = 0;
     virtual std::string get_name() const = 0;
     virtual void* get_function() const = 0;
+    // Called instead of get_function when not null, without going through libffi.
+    virtual cinterface::StackFunction get_stack_function() const { return nullptr; }
+};
+
+namespace cinterface {
+template <class T>
+struct Type;
+
+template <>
+struct Type<bool> {
+    static constexpr ArgType ARG_TYPE = BOOL;
+    static bool get(const Var& value) { return value.data._bool; }
+    static void set(Var& value, const bool& result) { value.data._bool = result; value.type = var::BOOL; }
+};
+
+template <>
+struct Type<char> {
+    static constexpr ArgType ARG_TYPE = CHAR;
+    static char get(const Var& value) { return value.data._char; }
+    static void set(Var& value, const char& result) { value.data._char = result; value.type = var::CHAR; }
+};
+
+template <>
+struct Type<int> {
+    static constexpr ArgType ARG_TYPE = INT;
+    static int get(const Var& value) { return value.data._int; }
+    static void set(Var& value, const int& result) { value.data._int = result; value.type = var::INT; }
+};
+
+template <>
+struct Type<long> {
+    static constexpr ArgType ARG_TYPE = LONG;
+    static long get(const Var& value) { return value.data._long; }
+    static void set(Var& value, const long& result) { value.data._long = result; value.type = var::LONG; }
+};
+
+template <>
+struct Type<double> {
+    static constexpr ArgType ARG_TYPE = DOUBLE;
+    static double get(const Var& value) { return value.data._double; }
+    static void set(Var& value, const double& result) { value.data._double = result; value.type = var::DOUBLE; }
+};
+
+template <class T, ArgType A>
+struct ArrayType {
+    static constexpr ArgType ARG_TYPE = A;
+    static Array<T> get(const Var& value) { return {(T*) value.data._pointer, (long) (value.length / sizeof(T))}; }
+};
+
+template <>
+struct Type<Array<char>> : ArrayType<char, CHAR_ARRAY> {};
+
+template <>
+struct Type<Array<int>> : ArrayType<int, INT_ARRAY> {};
+
+template <>
+struct Type<Array<long>> : ArrayType<long, LONG_ARRAY> {};
+
+template <>
+struct Type<Array<const char>> : ArrayType<const char, CONST_CHAR_ARRAY> {};
+
+template <>
+struct Type<Array<const int>> : ArrayType<const int, CONST_INT_ARRAY> {};
+
+template <>
+struct Type<Array<const long>> : ArrayType<const long, CONST_LONG_ARRAY> {};
+}
+
+// Native function whose signature is read from the C++ function at compile time.
+// It is called directly on the operand stack, so its parameters and result must be
+// bool, char, int, long or double, or arrays of char, int or long for the parameters
+// (Array<const T> when the function doesn't write to them):
+//
+//   long twice(long n) { return 2 * n; }
+//   std::vector<CInterface*> get_classes() { return {new CFunction<twice>("math::twice")}; }
+template <auto F, class Signature = decltype(F)>
+class CFunction;
+
+template <auto F, class R, class... Args>
+class CFunction<F, R (*)(Args...)> : public CInterface {
+    public:
+    CFunction(const std::string& name) : name(name) {}
+
+    cinterface::ArgType get_return_type() const { return cinterface::Type<R>::ARG_TYPE; }
+    std::vector<cinterface::ArgType> get_arg_types() const { return {cinterface::Type<Args>::ARG_TYPE...}; }
+    std::string get_name() const { return name; }
+    void* get_function() const { return (void*) F; }
+    cinterface::StackFunction get_stack_function() const { return call; }
+
+    private:
+    static void call(Var* args) {
+        call(args, std::index_sequence_for<Args...>());
+    }
+
+    template <size_t... I>
+    static void call(Var* args, std::index_sequence<I...>) {
+        R result = F(cinterface::Type<Args>::get(args[I])...);
+        cinterface::Type<R>::set(args[0], result);
+    }
+
+    std::string name;
 };
 
 extern "C" std::vector<CInterface*> get_classes();
@@ -0,0 +1,37 @@
+#include "constant_pool.h"
+#include <cstring>
+
+uint32_t ConstantPool::add(const Var& value) {
+    int64_t bits = var::convert(value, var::LONG).data._long;
+    if (value.type == var::DOUBLE) {
+        memcpy(&bits, &value.data._double, sizeof(bits));
+    }
+    auto key = std::make_pair((uint8_t) value.type, bits);
+    auto it = constant_indexes.find(key);
+    if (it != constant_indexes.end()) {
+        return it->second;
+    }
+    uint32_t index = constants.size();
+    constants.push_back(value);
+    constant_indexes[key] = index;
+    return index;
+}
+
+uint32_t ConstantPool::add(const std::string& str) {
+    auto it = string_indexes.find(str);
+    if (it != string_indexes.end()) {
+        return it->second;
+    }
+    uint32_t index = strings.size();
+    strings.push_back(str);
+    string_indexes[str] = index;
+    return index;
+}
+
+const std::vector<Var>& ConstantPool::get_constants() const {
+    return constants;
+}
+
+const std::vector<std::string>& ConstantPool::get_strings() const {
+    return strings;
+}
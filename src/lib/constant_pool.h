@@ -0,0 +1,26 @@
+#if !defined(CONSTANT_POOL)
+#define CONSTANT_POOL
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "var.h"
+
+// Deduplicated constants and strings of a program, referred to by index.
+class ConstantPool {
+    public:
+    uint32_t add(const Var& value);
+    uint32_t add(const std::string& str);
+    const std::vector<Var>& get_constants() const;
+    const std::vector<std::string>& get_strings() const;
+
+    private:
+    std::vector<Var> constants;
+    std::vector<std::string> strings;
+    // values of the same type are equal when they are equal as longs, doubles when their bits are
+    std::map<std::pair<uint8_t, int64_t>, uint32_t> constant_indexes;
+    std::map<std::string, uint32_t> string_indexes;
+};
+
+#endif // CONSTANT_POOL
@@ -0,0 +1,333 @@
+#include "executable.h"
+#include "byteutils.h"
+#include <algorithm>
+#include <iostream>
+
+namespace executable {
+const uint64_t SECTION_HEADER_SIZE = SIZE_OF_BYTE + SIZE_OF_LONG;
+// size of a function without types
+const uint64_t FUNCTION_SIZE = 3 * SIZE_OF_LONG + 4 * SIZE_OF_BYTE;
+const uint64_t LINE_SIZE = 2 * SIZE_OF_LONG;
+// size of a native function with empty names
+const uint64_t NATIVE_SIZE = 2 * SIZE_OF_LONG + SIZE_OF_BYTE;
+
+void malformed(const std::string& message) {
+    std::cout << "Malformed executable: " << message << std::endl;
+    exit(1);
+}
+
+void push_section(std::vector<uint8_t>& bytes, const SectionId& id, const std::vector<uint8_t>& payload) {
+    bytes.push_back(id);
+    byteutils::push_ulong(bytes, payload.size());
+    bytes.insert(bytes.end(), payload.begin(), payload.end());
+}
+
+uint64_t read_count(const uint8_t* section, const uint64_t& size, const uint64_t& record_size) {
+    if (size < SIZE_OF_LONG) {
+        malformed("section too small.");
+    }
+    uint64_t count = byteutils::read_ulong(section, 0);
+    if (count > (size - SIZE_OF_LONG) / record_size) {
+        malformed("section too small.");
+    }
+    return count;
+}
+
+std::vector<var::DataType> read_types(const uint8_t* section, const uint64_t& size, uint64_t* index) {
+    std::vector<var::DataType> types;
+    uint8_t count = section[*index];
+    *index += SIZE_OF_BYTE;
+    if (count > size - *index) {
+        malformed("truncated function types.");
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        var::DataType type = (var::DataType) section[*index];
+        if (var::TYPE_NAME.find(type) == var::TYPE_NAME.end()) {
+            malformed("invalid function type.");
+        }
+        types.push_back(type);
+        *index += SIZE_OF_BYTE;
+    }
+    return types;
+}
+
+void push_types(std::vector<uint8_t>& bytes, const std::vector<var::DataType>& types) {
+    bytes.push_back(types.size());
+    for (const auto& type : types) {
+        bytes.push_back(type);
+    }
+}
+
+void read_functions(const uint8_t* section, const uint64_t& size, Executable& executable) {
+    uint64_t count = read_count(section, size, FUNCTION_SIZE);
+    uint64_t index = SIZE_OF_LONG;
+    for (uint64_t i = 0; i < count; i++) {
+        if (size - index < FUNCTION_SIZE) {
+            malformed("truncated function.");
+        }
+        Function function;
+        function.entry = byteutils::read_ulong(section, index);
+        index += SIZE_OF_LONG;
+        function.params = section[index];
+        index += SIZE_OF_BYTE;
+        function.returns = section[index];
+        index += SIZE_OF_BYTE;
+        function.frame_size = byteutils::read_ulong(section, index);
+        index += SIZE_OF_LONG;
+        function.max_stack = byteutils::read_ulong(section, index);
+        index += SIZE_OF_LONG;
+        function.parameter_types = read_types(section, size, &index);
+        if (size - index < SIZE_OF_BYTE) {
+            malformed("truncated function.");
+        }
+        function.return_types = read_types(section, size, &index);
+        if ((!function.parameter_types.empty() && function.parameter_types.size() != function.params) ||
+            (!function.return_types.empty() && function.return_types.size() != function.returns)) {
+            malformed("function types don't match its signature.");
+        }
+        executable.functions.push_back(function);
+    }
+}
+
+void read_constants(const uint8_t* section, const uint64_t& size, Executable& executable) {
+    uint64_t count = read_count(section, size, SIZE_OF_BYTE);
+    uint64_t index = SIZE_OF_LONG;
+    for (uint64_t i = 0; i < count; i++) {
+        if (index >= size) {
+            malformed("invalid constant.");
+        }
+        Var value;
+        value.type = (var::DataType) section[index];
+        if (var::TYPE_NAME.find(value.type) == var::TYPE_NAME.end() || index + var::size(value) > size) {
+            malformed("invalid constant.");
+        }
+        executable.constants.push_back(var::read(section, &index));
+    }
+}
+
+std::string read_string(const uint8_t* section, const uint64_t& size, uint64_t* index) {
+    if (size - *index < SIZE_OF_LONG) {
+        malformed("truncated string.");
+    }
+    uint64_t length = byteutils::read_ulong(section, *index);
+    *index += SIZE_OF_LONG;
+    if (length > size - *index) {
+        malformed("truncated string.");
+    }
+    *index += length;
+    return std::string(section + *index - length, section + *index);
+}
+
+void read_strings(const uint8_t* section, const uint64_t& size, std::vector<std::string>& strings) {
+    uint64_t count = read_count(section, size, SIZE_OF_LONG);
+    uint64_t index = SIZE_OF_LONG;
+    for (uint64_t i = 0; i < count; i++) {
+        strings.push_back(read_string(section, size, &index));
+    }
+}
+
+void read_natives(const uint8_t* section, const uint64_t& size, Executable& executable) {
+    uint64_t count = read_count(section, size, NATIVE_SIZE);
+    uint64_t index = SIZE_OF_LONG;
+    for (uint64_t i = 0; i < count; i++) {
+        Native native;
+        native.name = read_string(section, size, &index);
+        native.library = read_string(section, size, &index);
+        if (size - index < SIZE_OF_BYTE) {
+            malformed("truncated native function.");
+        }
+        native.return_type = (var::DataType) section[index];
+        if (var::TYPE_NAME.find(native.return_type) == var::TYPE_NAME.end()) {
+            malformed("invalid native function type.");
+        }
+        index += SIZE_OF_BYTE;
+        executable.natives.push_back(native);
+    }
+}
+
+void read_globals(const uint8_t* section, const uint64_t& size, Executable& executable) {
+    uint64_t count = read_count(section, size, SIZE_OF_BYTE);
+    uint64_t index = SIZE_OF_LONG;
+    for (uint64_t i = 0; i < count; i++) {
+        executable.globals.push_back(read_global(section, size, &index));
+    }
+}
+
+void read_lines(const uint8_t* section, const uint64_t& size, Executable& executable) {
+    uint64_t count = read_count(section, size, LINE_SIZE);
+    uint64_t index = SIZE_OF_LONG;
+    for (uint64_t i = 0; i < count; i++) {
+        Line line;
+        line.address = byteutils::read_ulong(section, index);
+        index += SIZE_OF_LONG;
+        line.line = byteutils::read_ulong(section, index);
+        index += SIZE_OF_LONG;
+        executable.lines.push_back(line);
+    }
+}
+}
+
+void executable::push_global(const Var& value, std::vector<uint8_t>& bytes) {
+    if (value.type == var::STRING) {
+        bytes.push_back(var::STRING);
+        return;
+    }
+    var::push(value, bytes);
+}
+
+Var executable::read_global(const uint8_t* bytes, const uint64_t& size, uint64_t* index) {
+    if (*index >= size) {
+        malformed("invalid global.");
+    }
+    Var value;
+    value.type = (var::DataType) bytes[*index];
+    if (value.type == var::STRING) {
+        *index += SIZE_OF_BYTE;
+        return var::create_string("", 0);
+    }
+    // slices point into frames, which globals outlive
+    if (var::TYPE_NAME.find(value.type) == var::TYPE_NAME.end() || value.type == var::SLICE || *index + var::size(value) > size) {
+        malformed("invalid global.");
+    }
+    return var::read(bytes, index);
+}
+
+bool executable::is_container(const uint8_t* bytes, const uint64_t& size) {
+    // Flat programs have no header, and opcodes go past the first character of the magic,
+    // so a container is recognized by the whole magic followed by a version of the format.
+    return size > MAGIC.size() &&
+        std::equal(MAGIC.begin(), MAGIC.end(), bytes) &&
+        bytes[MAGIC.size()] >= FIRST_VERSION &&
+        bytes[MAGIC.size()] <= VERSION;
+}
+
+std::vector<uint8_t> executable::to_bytes(const Executable& executable) {
+    std::vector<uint8_t> bytes(MAGIC.begin(), MAGIC.end());
+    bytes.push_back(VERSION);
+
+    push_section(bytes, CODE, std::vector<uint8_t>(executable.code, executable.code + executable.code_size));
+
+    std::vector<uint8_t> functions;
+    byteutils::push_ulong(functions, executable.functions.size());
+    for (const auto& function : executable.functions) {
+        byteutils::push_ulong(functions, function.entry);
+        functions.push_back(function.params);
+        functions.push_back(function.returns);
+        byteutils::push_ulong(functions, function.frame_size);
+        byteutils::push_ulong(functions, function.max_stack);
+        push_types(functions, function.parameter_types);
+        push_types(functions, function.return_types);
+    }
+    push_section(bytes, FUNCTIONS, functions);
+
+    std::vector<uint8_t> constants;
+    byteutils::push_ulong(constants, executable.constants.size());
+    for (const auto& constant : executable.constants) {
+        var::push(constant, constants);
+    }
+    push_section(bytes, CONSTANTS, constants);
+
+    if (!executable.strings.empty()) {
+        std::vector<uint8_t> strings;
+        byteutils::push_ulong(strings, executable.strings.size());
+        for (const auto& str : executable.strings) {
+            byteutils::push_string(strings, str);
+        }
+        push_section(bytes, STRINGS, strings);
+    }
+
+    if (!executable.globals.empty()) {
+        std::vector<uint8_t> globals;
+        byteutils::push_ulong(globals, executable.globals.size());
+        for (const auto& value : executable.globals) {
+            push_global(value, globals);
+        }
+        push_section(bytes, DATA, globals);
+    }
+
+    if (!executable.natives.empty()) {
+        std::vector<uint8_t> natives;
+        byteutils::push_ulong(natives, executable.natives.size());
+        for (const auto& native : executable.natives) {
+            byteutils::push_string(natives, native.name);
+            byteutils::push_string(natives, native.library);
+            natives.push_back(native.return_type);
+        }
+        push_section(bytes, NATIVES, natives);
+    }
+
+    // debug information is optional
+    if (!executable.lines.empty()) {
+        std::vector<uint8_t> lines;
+        byteutils::push_ulong(lines, executable.lines.size());
+        for (const auto& line : executable.lines) {
+            byteutils::push_ulong(lines, line.address);
+            byteutils::push_ulong(lines, line.line);
+        }
+        push_section(bytes, LINES, lines);
+    }
+    return bytes;
+}
+
+Executable executable::from_bytes(const uint8_t* bytes, const uint64_t& size) {
+    Executable executable;
+    if (!is_container(bytes, size)) {
+        executable.code = bytes;
+        executable.code_size = size;
+        return executable;
+    }
+
+    uint64_t index = MAGIC.size();
+    if (bytes[index] != VERSION) {
+        std::cout << "Unsupported executable version." << std::endl;
+        exit(1);
+    }
+    index += SIZE_OF_BYTE;
+
+    bool has_code = false;
+    while (index < size) {
+        if (size - index < SECTION_HEADER_SIZE) {
+            malformed("truncated section header.");
+        }
+        SectionId id = (SectionId) bytes[index];
+        uint64_t section_size = byteutils::read_ulong(bytes, index + SIZE_OF_BYTE);
+        index += SECTION_HEADER_SIZE;
+        if (section_size > size - index) {
+            malformed("truncated section.");
+        }
+        const uint8_t* section = bytes + index;
+        switch (id) {
+            case CODE:
+                executable.code = section;
+                executable.code_size = section_size;
+                has_code = true;
+                break;
+            case FUNCTIONS:
+                read_functions(section, section_size, executable);
+                break;
+            case CONSTANTS:
+                read_constants(section, section_size, executable);
+                break;
+            case LINES:
+                read_lines(section, section_size, executable);
+                break;
+            case STRINGS:
+                read_strings(section, section_size, executable.strings);
+                break;
+            case NATIVES:
+                read_natives(section, section_size, executable);
+                break;
+            case DATA:
+                read_globals(section, section_size, executable);
+                break;
+            default:
+                // sections unknown to this version are skipped
+                break;
+        }
+        index += section_size;
+    }
+    if (!has_code) {
+        malformed("missing code section.");
+    }
+    return executable;
+}
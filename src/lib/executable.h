@@ -0,0 +1,93 @@
+#if !defined(EXECUTABLE)
+#define EXECUTABLE
+
+#include <map>
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include "var.h"
+
+namespace executable {
+enum SectionId {
+    CODE,
+    FUNCTIONS,
+    CONSTANTS,
+    LINES,
+    STRINGS,
+    NATIVES,
+    DATA
+};
+
+// Point where a frame continues when it is resumed from a snapshot: after a snapshot
+// instruction, or after a call for the frames below the last one.
+struct Resumption {
+    bool call;
+    // entry of the called function, for calls
+    uint64_t callee;
+    // types of the operand stack and of the locals there, as found by the verifier
+    std::vector<uint8_t> stack;
+    std::vector<uint8_t> locals;
+};
+
+struct Function {
+    uint64_t entry;
+    uint8_t params;
+    uint8_t returns;
+    // number of variables in the frame of the function
+    uint64_t frame_size;
+    // maximum number of values on the operand stack of the frame
+    uint64_t max_stack;
+    // types of the parameters and returned values, empty when unknown
+    std::vector<var::DataType> parameter_types;
+    std::vector<var::DataType> return_types;
+    // locals holding elements of arrays instead of values, found by the verifier
+    std::vector<bool> elements;
+    // points where frames of the function can be resumed, by address, found by the verifier
+    std::map<uint64_t, Resumption> resumptions;
+};
+
+struct Line {
+    uint64_t address;
+    uint64_t line;
+};
+
+// Native function called by the program, with the library it was bound from
+// and the type it returns, known before the library is opened.
+struct Native {
+    std::string name;
+    std::string library;
+    var::DataType return_type;
+};
+}
+
+// Program made of sections. The code is not owned, it points into the buffer
+// the executable was read from, so that it can be executed in place.
+struct Executable {
+    const uint8_t* code;
+    uint64_t code_size;
+    std::vector<executable::Function> functions;
+    std::vector<Var> constants;
+    std::vector<executable::Line> lines;
+    std::vector<std::string> strings;
+    std::vector<executable::Native> natives;
+    // initial values of the globals, their types don't change
+    std::vector<Var> globals;
+};
+
+namespace executable {
+const std::string MAGIC = "BNNA";
+const uint8_t VERSION = 7;
+// version of the first containers
+const uint8_t FIRST_VERSION = 1;
+
+// Globals are numbers, booleans, chars or strings, which start empty and are set by the code.
+void push_global(const Var& value, std::vector<uint8_t>& bytes);
+Var read_global(const uint8_t* bytes, const uint64_t& size, uint64_t* index);
+
+bool is_container(const uint8_t* bytes, const uint64_t& size);
+std::vector<uint8_t> to_bytes(const Executable& executable);
+// Programs without the magic are flat instruction streams, made of a code section only.
+Executable from_bytes(const uint8_t* bytes, const uint64_t& size);
+}
+
+#endif // EXECUTABLE
@@ -4,6 +4,48 @@
 #include <sstream>
 #include <iterator>
 #include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+MappedFile::MappedFile(const std::string& filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+        std::cout << "Could not open file: " << filename << std::endl;
+        exit(1);
+    }
+    struct stat status;
+    if (fstat(fd, &status) == -1) {
+        std::cout << "Could not read file size: " << filename << std::endl;
+        exit(1);
+    }
+    length = status.st_size;
+    address = nullptr;
+    if (length > 0) {
+        void* mapping = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            std::cout << "Could not map file: " << filename << std::endl;
+            exit(1);
+        }
+        address = (uint8_t*) mapping;
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (address != nullptr) {
+        munmap(address, length);
+    }
+}
+
+const uint8_t* MappedFile::data() const {
+    return address;
+}
+
+uint64_t MappedFile::size() const {
+    return length;
+}
 
 std::vector<uint8_t> fileutils::read_bytes(const std::string& filename) {
     std::ifstream is(filename.c_str(), std::ios::binary);
@@ -11,11 +53,18 @@ std::vector<uint8_t> fileutils::read_bytes(const std::string& filename) {
         std::cout << "Could not open file: " << filename << std::endl;
         exit(1);
     }
-    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+    is.seekg(0, std::ios::end);
+    std::vector<uint8_t> bytes(is.tellg());
+    is.seekg(0, std::ios::beg);
+    is.read((char*) bytes.data(), bytes.size());
     is.close();
     return bytes;
 }
 
+std::shared_ptr<const MappedFile> fileutils::map_file(const std::string& filename) {
+    return std::make_shared<const MappedFile>(filename);
+}
+
 std::vector<std::string> fileutils::read_lines(const std::string& filename) {
     std::ifstream is(filename.c_str());
     if (!is.is_open()) {
@@ -45,8 +94,7 @@ std::string fileutils::read_string(const std::string& filename) {
 
 void fileutils::write_bytes(const std::vector<uint8_t>& bytes, const std::string& filename) {
     std::ofstream os(filename.c_str(), std::ios::binary);
-    std::ostream_iterator<uint8_t> output_iterator(os);
-    std::copy(bytes.begin(), bytes.end(), output_iterator);
+    os.write((const char*) bytes.data(), bytes.size());
     os.close();
 }
 
@@ -66,3 +114,7 @@ std::vector<std::string> fileutils::list_files(const std::string& directory, con
     }
     return files;
 }
+
+std::string fileutils::directory(const std::string& filename) {
+    return std::filesystem::path(filename).parent_path().string();
+}
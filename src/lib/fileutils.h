@@ -1,17 +1,37 @@
 #if !defined(FILE_UTILS)
 #define FILE_UTILS
 
+#include <memory>
 #include <vector>
 #include <string>
 #include <stdint.h>
 
+// Read-only memory mapping of a whole file. Processes mapping the same file share its pages.
+class MappedFile {
+    public:
+    MappedFile(const std::string& filename);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    const uint8_t* data() const;
+    uint64_t size() const;
+
+    private:
+    uint8_t* address;
+    uint64_t length;
+};
+
 namespace fileutils {
 std::vector<uint8_t> read_bytes(const std::string& filename);
+std::shared_ptr<const MappedFile> map_file(const std::string& filename);
 std::vector<std::string> read_lines(const std::string& filename);
 std::string read_string(const std::string& filename);
 void write_bytes(const std::vector<uint8_t>& bytes, const std::string& filename);
 void write_lines(const std::vector<std::string>& lines, const std::string& filename);
 std::vector<std::string> list_files(const std::string& directory, const std::string& extension);
+// Directory of the file, empty for the files of the working directory.
+std::string directory(const std::string& filename);
 }
 
 #endif // FILE_UTILS
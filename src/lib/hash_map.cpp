@@ -0,0 +1,117 @@
+#include "hash_map.h"
+#include <limits>
+
+namespace hash_map {
+const int64_t EMPTY = std::numeric_limits<int64_t>::min();
+const uint8_t INITIAL_BITS = 4;
+// golden ratio, which spreads consecutive keys over the whole table
+const uint64_t MULTIPLIER = 0x9E3779B97F4A7C15;
+}
+
+HashMap::HashMap() {
+    slots.assign(1 << hash_map::INITIAL_BITS, {hash_map::EMPTY, 0});
+    count = 0;
+    shift = 64 - hash_map::INITIAL_BITS;
+    has_empty_key = false;
+    empty_key_value = 0;
+}
+
+int64_t HashMap::get(const int64_t& key) const {
+    if (key == hash_map::EMPTY) {
+        return has_empty_key ? empty_key_value : 0;
+    }
+    const Slot& slot = slots[find(key)];
+    return slot.key == key ? slot.value : 0;
+}
+
+bool HashMap::contains(const int64_t& key) const {
+    if (key == hash_map::EMPTY) {
+        return has_empty_key;
+    }
+    return slots[find(key)].key == key;
+}
+
+void HashMap::put(const int64_t& key, const int64_t& value) {
+    if (key == hash_map::EMPTY) {
+        has_empty_key = true;
+        empty_key_value = value;
+        return;
+    }
+    uint64_t index = find(key);
+    if (slots[index].key == key) {
+        slots[index].value = value;
+        return;
+    }
+    // probe sequences stay short while at most three quarters of the slots are used
+    if ((count + 1) * 4 > slots.size() * 3) {
+        grow();
+        index = find(key);
+    }
+    slots[index] = {key, value};
+    count++;
+}
+
+bool HashMap::remove(const int64_t& key) {
+    if (key == hash_map::EMPTY) {
+        bool had = has_empty_key;
+        has_empty_key = false;
+        return had;
+    }
+    uint64_t mask = slots.size() - 1;
+    uint64_t hole = find(key);
+    if (slots[hole].key != key) {
+        return false;
+    }
+    // entries after the hole move into it when it is on their probe sequence
+    for (uint64_t index = (hole + 1) & mask; slots[index].key != hash_map::EMPTY; index = (index + 1) & mask) {
+        uint64_t distance = (index - home(slots[index].key)) & mask;
+        if (distance >= ((index - hole) & mask)) {
+            slots[hole] = slots[index];
+            hole = index;
+        }
+    }
+    slots[hole].key = hash_map::EMPTY;
+    count--;
+    return true;
+}
+
+uint64_t HashMap::size() const {
+    return count + has_empty_key;
+}
+
+std::vector<std::pair<int64_t, int64_t>> HashMap::entries() const {
+    std::vector<std::pair<int64_t, int64_t>> entries;
+    for (const auto& slot : slots) {
+        if (slot.key != hash_map::EMPTY) {
+            entries.push_back({slot.key, slot.value});
+        }
+    }
+    if (has_empty_key) {
+        entries.push_back({hash_map::EMPTY, empty_key_value});
+    }
+    return entries;
+}
+
+uint64_t HashMap::home(const int64_t& key) const {
+    return ((uint64_t) key * hash_map::MULTIPLIER) >> shift;
+}
+
+uint64_t HashMap::find(const int64_t& key) const {
+    uint64_t mask = slots.size() - 1;
+    uint64_t index = home(key);
+    while (slots[index].key != key && slots[index].key != hash_map::EMPTY) {
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+void HashMap::grow() {
+    std::vector<Slot> old = std::move(slots);
+    slots.assign(old.size() * 2, {hash_map::EMPTY, 0});
+    shift--;
+    for (const auto& slot : old) {
+        if (slot.key != hash_map::EMPTY) {
+            slots[find(slot.key)] = slot;
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#if !defined(HASH_MAP)
+#define HASH_MAP
+
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+// Map of longs to longs made by a program. Entries are stored in a single array, a key is
+// looked for from the slot of its hash to the next empty slot (linear probing), and removals
+// move the following entries back instead of leaving tombstones.
+class HashMap {
+    public:
+    HashMap();
+
+    // Value of the key, zero when the map doesn't have it.
+    int64_t get(const int64_t& key) const;
+    bool contains(const int64_t& key) const;
+    void put(const int64_t& key, const int64_t& value);
+    // Gives true when the key was in the map.
+    bool remove(const int64_t& key);
+    uint64_t size() const;
+    // entries in no particular order
+    std::vector<std::pair<int64_t, int64_t>> entries() const;
+
+    private:
+    struct Slot {
+        int64_t key;
+        int64_t value;
+    };
+
+    uint64_t home(const int64_t& key) const;
+    // slot holding the key, or the empty slot ending its probe sequence
+    uint64_t find(const int64_t& key) const;
+    void grow();
+
+    // empty slots hold the smallest long, which is stored apart when it is a key
+    std::vector<Slot> slots;
+    uint64_t count;
+    uint8_t shift;
+    bool has_empty_key;
+    int64_t empty_key_value;
+};
+
+#endif // HASH_MAP
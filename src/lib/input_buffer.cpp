@@ -0,0 +1,93 @@
+#include "input_buffer.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+
+namespace input {
+bool is_whitespace(const char& c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+}
+
+InputBuffer::InputBuffer(const int& fd) : fd(fd), buffer(nullptr), position(0), size(0) {}
+
+bool InputBuffer::read_long(int64_t* value) {
+    *value = 0;
+    skip_whitespace();
+    if (position == size) {
+        return true;
+    }
+    bool negative = buffer[position] == '-';
+    if (negative || buffer[position] == '+') {
+        position++;
+    }
+    // accumulated as unsigned, so that the smallest long doesn't overflow
+    uint64_t digits = 0;
+    uint64_t result = 0;
+    while (position < size || fill()) {
+        char c = buffer[position];
+        if (c < '0' || c > '9') {
+            break;
+        }
+        result = result * 10 + (c - '0');
+        position++;
+        digits++;
+    }
+    *value = negative ? -result : result;
+    return digits > 0;
+}
+
+bool InputBuffer::read_int(int32_t* value) {
+    int64_t result;
+    bool read = read_long(&result);
+    *value = result;
+    return read;
+}
+
+char InputBuffer::read_char() {
+    if (position == size && !fill()) {
+        return 0;
+    }
+    return buffer[position++];
+}
+
+bool InputBuffer::eof() {
+    skip_whitespace();
+    return position == size;
+}
+
+void InputBuffer::set_fd(const int& fd) {
+    this->fd = fd;
+    position = 0;
+    size = 0;
+}
+
+bool InputBuffer::fill() {
+    position = 0;
+    size = 0;
+    if (buffer == nullptr) {
+        buffer.reset(new char[CAPACITY]);
+    }
+    for (;;) {
+        ssize_t count = ::read(fd, buffer.get(), CAPACITY);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cout << "Could not read input: " << strerror(errno) << std::endl;
+            exit(1);
+        }
+        size = count;
+        return count > 0;
+    }
+}
+
+void InputBuffer::skip_whitespace() {
+    while (position < size || fill()) {
+        if (!input::is_whitespace(buffer[position])) {
+            return;
+        }
+        position++;
+    }
+}
@@ -0,0 +1,40 @@
+#if !defined(INPUT_BUFFER)
+#define INPUT_BUFFER
+
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+// Input of the programs, read from a file descriptor in large blocks.
+// The buffer is allocated by the first read, programs that don't read don't have one.
+class InputBuffer {
+    public:
+    InputBuffer(const int& fd);
+    InputBuffer(const InputBuffer&) = delete;
+    InputBuffer& operator=(const InputBuffer&) = delete;
+
+    // Integers skip the whitespace before them, and are 0 at the end of the input.
+    // False when the input goes on with something else than an integer.
+    bool read_long(int64_t* value);
+    bool read_int(int32_t* value);
+    // Next character, whitespace included, 0 at the end of the input.
+    char read_char();
+    // True when only whitespace is left, which is skipped.
+    bool eof();
+    // Reads from another file descriptor, dropping what is left in the buffer.
+    void set_fd(const int& fd);
+
+    static constexpr size_t CAPACITY = 1 << 20;
+
+    private:
+    // Reads the next block, returns false at the end of the input.
+    bool fill();
+    void skip_whitespace();
+
+    int fd;
+    std::unique_ptr<char[]> buffer;
+    size_t position;
+    size_t size;
+};
+
+#endif // INPUT_BUFFER
@@ -3,11 +3,14 @@
 #include "byteutils.h"
 #include "c_interface.h"
 #include "c_functions.h"
+#include "arrayutils.h"
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <cassert>
 #include <ffi.h>
 #include <cmath>
+#include <cstring>
 #include <map>
 
 namespace instructions {
@@ -21,18 +24,145 @@ std::vector<std::string> split_string(const std::string& str, const char& separa
     return result;
 }
 
-Var pop_var(std::vector<Var>* vars) {
-    Var var = vars->back();
-    vars->pop_back();
-    return var;
+Var pop_var(OperandStack* stack) {
+    return stack->pop();
 }
 
-const std::map<cinterface::ArgType, var::DataType> C_TYPE_TO_DATA_TYPE {
-    {cinterface::BOOL, var::BOOL},
-    {cinterface::CHAR, var::CHAR},
-    {cinterface::INT, var::INT},
-    {cinterface::LONG, var::LONG},
-};
+const MappedRegion& mapped_region(Vm& vm, const Var& handle) {
+    if (handle.data._int < 0 || (size_t) handle.data._int >= vm.mapped_files.size()) {
+        vm.output.flush();
+        std::cout << "Invalid mapped file handle: " << handle.data._int << std::endl;
+        exit(1);
+    }
+    return vm.mapped_files[handle.data._int];
+}
+
+std::string& builder(Vm& vm, const Var& handle) {
+    if (handle.data._int < 0 || (size_t) handle.data._int >= vm.builders.size()) {
+        vm.output.flush();
+        std::cout << "Invalid string builder handle: " << handle.data._int << std::endl;
+        exit(1);
+    }
+    return vm.builders[handle.data._int];
+}
+
+int map_slot(const Var& handle) {
+    return handle.data._int & ((1 << MAP_SLOT_BITS) - 1);
+}
+
+HashMap& hash_map(Vm& vm, const Var& handle) {
+    int slot = map_slot(handle);
+    if (handle.data._int < 0 || (size_t) slot >= vm.maps.size() || !vm.maps[slot] ||
+        vm.map_generations[slot] != handle.data._int >> MAP_SLOT_BITS) {
+        vm.output.flush();
+        std::cout << "Invalid map handle: " << handle.data._int << std::endl;
+        exit(1);
+    }
+    return *vm.maps[slot];
+}
+
+void invalid_input(Vm& vm) {
+    vm.output.flush();
+    std::cout << "Expected an integer in the input." << std::endl;
+    exit(1);
+}
+
+// Address of the bytes read at the offset of a mapped file, which must all be inside the file.
+const uint8_t* mapped_bytes(Vm& vm, const Var& handle, const Var& offset, const uint64_t& width) {
+    const MappedRegion& region = mapped_region(vm, handle);
+    if (offset.data._long < 0 || (uint64_t) offset.data._long > region.size || width > region.size - offset.data._long) {
+        vm.output.flush();
+        std::cout << "Read at offset " << offset.data._long << " outside of mapped file: " << region.path << std::endl;
+        exit(1);
+    }
+    return region.data + offset.data._long;
+}
+
+// Address of the element of the slice, after the only bounds check of the access.
+template <class T>
+uint8_t* element(Vm& vm, const Var& array, const Var& index) {
+    if ((uint64_t) index.data._long >= array.length / sizeof(T)) {
+        vm.output.flush();
+        std::cout << "Index " << index.data._long << " outside of array of " << array.length / sizeof(T) << " elements." << std::endl;
+        exit(1);
+    }
+    return array.data._pointer + index.data._long * sizeof(T);
+}
+
+template <class T>
+T load(Vm& vm, const Var& array, const Var& index) {
+    T value;
+    std::memcpy(&value, element<T>(vm, array, index), sizeof(T));
+    return value;
+}
+
+void check_writable(Vm& vm, const Var& array) {
+    if (array.read_only) {
+        vm.output.flush();
+        std::cout << "Write to an array of a mapped file." << std::endl;
+        exit(1);
+    }
+}
+
+// Natives write through their array parameters unless they are const.
+void check_native_arrays(const NativeFunction& native, const Var* args) {
+    for (const auto& i : native.mutable_arrays) {
+        if (args[i].read_only) {
+            std::cout << "Array of a mapped file passed to native function " << native.function->get_name() << ", which may write to it." << std::endl;
+            exit(1);
+        }
+    }
+}
+
+template <class T>
+void store(Vm& vm, const Var& array, const Var& index, const T& value) {
+    check_writable(vm, array);
+    std::memcpy(element<T>(vm, array, index), &value, sizeof(T));
+}
+
+// Calls f with the elements of the slice and their number, typed by the element type of an instruction.
+template <class F>
+auto with_elements(const Var& array, const var::DataType& type, F f) {
+    switch (type) {
+        case var::CHAR:
+            return f((int8_t*) array.data._pointer, (size_t) array.length);
+        case var::INT:
+            return f((int32_t*) array.data._pointer, (size_t) array.length / sizeof(int32_t));
+        default:
+            return f((int64_t*) array.data._pointer, (size_t) array.length / sizeof(int64_t));
+    }
+}
+
+// Value of the element type of the array.
+template <class T>
+T element_value(const T* data, const Var& value) {
+    if constexpr (sizeof(T) == sizeof(char)) {
+        return value.data._char;
+    } else if constexpr (sizeof(T) == sizeof(int)) {
+        return value.data._int;
+    } else {
+        return value.data._long;
+    }
+}
+
+// Elements of the other array, which must have as many elements as the first one.
+template <class T>
+T* same_size(Vm& vm, const T* data, const size_t& size, const Var& other) {
+    if (other.length / sizeof(T) != size) {
+        vm.output.flush();
+        std::cout << "Arrays of " << size << " and " << other.length / sizeof(T) << " elements." << std::endl;
+        exit(1);
+    }
+    return (T*) other.data._pointer;
+}
+
+void check_not_empty(Vm& vm, const size_t& size) {
+    if (size == 0) {
+        vm.output.flush();
+        std::cout << "No minimum or maximum of an empty array." << std::endl;
+        exit(1);
+    }
+}
 
 const std::map<uint8_t, std::string> OP_STRINGS = {
     {OP_ADD, "add"},
@@ -65,12 +195,144 @@ const std::map<uint8_t, std::string> OP_STRINGS = {
     {OP_CONVERT, "convert"},
     {OP_NATIVE, "native"},
     {OP_HALT, "halt"},
+    {OP_POP, "pop"},
+    {OP_PUSH_CONST, "push_const"},
+    {OP_PRINT_CONST, "print_const"},
+    {OP_FLUSH, "flush"},
+    {OP_READ_LONG, "read_long"},
+    {OP_READ_INT, "read_int"},
+    {OP_READ_CHAR, "read_char"},
+    {OP_EOF, "eof"},
+    {OP_MAP_FILE, "map_file"},
+    {OP_MAPPED_SIZE, "mapped_size"},
+    {OP_MAPPED_BYTE, "mapped_byte"},
+    {OP_MAPPED_INT, "mapped_int"},
+    {OP_MAPPED_LONG, "mapped_long"},
+    {OP_MAPPED_SLICE, "mapped_slice"},
+    {OP_NEW_ARRAY, "new_array"},
+    {OP_LOAD_INDEX, "load_index"},
+    {OP_STORE_INDEX, "store_index"},
+    {OP_ARRAY_FILL, "array_fill"},
+    {OP_ARRAY_COPY, "array_copy"},
+    {OP_ARRAY_SUM, "array_sum"},
+    {OP_ARRAY_MIN, "array_min"},
+    {OP_ARRAY_MAX, "array_max"},
+    {OP_ARRAY_DOT, "array_dot"},
+    {OP_ARRAY_COUNT, "array_count"},
+    {OP_ARRAY_ADD, "array_add"},
+    {OP_ARRAY_MUL, "array_mul"},
+    {OP_ARRAY_ADD_ARRAY, "array_add_array"},
+    {OP_ARRAY_MUL_ARRAY, "array_mul_array"},
+    {OP_ARRAY_SORT, "array_sort"},
+    {OP_ARRAY_SEARCH, "array_search"},
+    {OP_PUSH_STRING, "push_string"},
+    {OP_STRING_LENGTH, "string_length"},
+    {OP_STRING_INDEX, "string_index"},
+    {OP_STRING_BUILDER, "string_builder"},
+    {OP_STRING_APPEND, "string_append"},
+    {OP_STRING_APPEND_CHAR, "string_append_char"},
+    {OP_STRING_BUILD, "string_build"},
+    {OP_LOAD_BLOCK, "load_block"},
+    {OP_STORE_BLOCK, "store_block"},
+    {OP_LOAD_GLOBAL, "load_global"},
+    {OP_STORE_GLOBAL, "store_global"},
+    {OP_MAP_NEW, "map_new"},
+    {OP_MAP_GET, "map_get"},
+    {OP_MAP_PUT, "map_put"},
+    {OP_MAP_CONTAINS, "map_contains"},
+    {OP_MAP_REMOVE, "map_remove"},
+    {OP_MAP_SIZE, "map_size"},
+    {OP_SNAPSHOT, "snapshot"},
+    {OP_MAP_FREE, "map_free"},
+};
+
+// values popped and pushed, for instructions whose stack effect doesn't depend on their operands
+const std::map<uint8_t, std::pair<uint8_t, uint8_t>> STACK_EFFECTS = {
+    {OP_ADD, {2, 1}},
+    {OP_SUB, {2, 1}},
+    {OP_MUL, {2, 1}},
+    {OP_DIV, {2, 1}},
+    {OP_MOD, {2, 1}},
+    {OP_XOR, {2, 1}},
+    {OP_BINARY_AND, {2, 1}},
+    {OP_BINARY_OR, {2, 1}},
+    {OP_BINARY_NOT, {1, 1}},
+    {OP_PUSH, {0, 1}},
+    {OP_JUMP, {0, 0}},
+    {OP_JUMP_IF, {1, 0}},
+    {OP_JUMP_IF_FALSE, {1, 0}},
+    {OP_CALL, {0, 0}},
+    {OP_RET, {0, 0}},
+    {OP_LT, {2, 1}},
+    {OP_LTE, {2, 1}},
+    {OP_GT, {2, 1}},
+    {OP_GTE, {2, 1}},
+    {OP_EQ, {2, 1}},
+    {OP_NOT_EQ, {2, 1}},
+    {OP_BOOLEAN_AND, {2, 1}},
+    {OP_BOOLEAN_OR, {2, 1}},
+    {OP_BOOLEAN_NOT, {1, 1}},
+    {OP_PRINT, {1, 0}},
+    {OP_STORE, {1, 0}},
+    {OP_LOAD, {0, 1}},
+    {OP_CONVERT, {1, 1}},
+    {OP_NATIVE, {0, 1}},
+    {OP_HALT, {0, 0}},
+    {OP_POP, {1, 0}},
+    {OP_PUSH_CONST, {0, 1}},
+    {OP_PRINT_CONST, {0, 0}},
+    {OP_FLUSH, {0, 0}},
+    {OP_READ_LONG, {0, 1}},
+    {OP_READ_INT, {0, 1}},
+    {OP_READ_CHAR, {0, 1}},
+    {OP_EOF, {0, 1}},
+    {OP_MAP_FILE, {0, 1}},
+    {OP_MAPPED_SIZE, {1, 1}},
+    {OP_MAPPED_BYTE, {2, 1}},
+    {OP_MAPPED_INT, {2, 1}},
+    {OP_MAPPED_LONG, {2, 1}},
+    {OP_MAPPED_SLICE, {3, 1}},
+    {OP_NEW_ARRAY, {0, 0}},
+    {OP_LOAD_INDEX, {1, 1}},
+    {OP_STORE_INDEX, {2, 0}},
+    {OP_ARRAY_FILL, {2, 0}},
+    {OP_ARRAY_COPY, {2, 0}},
+    {OP_ARRAY_SUM, {1, 1}},
+    {OP_ARRAY_MIN, {1, 1}},
+    {OP_ARRAY_MAX, {1, 1}},
+    {OP_ARRAY_DOT, {2, 1}},
+    {OP_ARRAY_COUNT, {2, 1}},
+    {OP_ARRAY_ADD, {2, 0}},
+    {OP_ARRAY_MUL, {2, 0}},
+    {OP_ARRAY_ADD_ARRAY, {2, 0}},
+    {OP_ARRAY_MUL_ARRAY, {2, 0}},
+    {OP_ARRAY_SORT, {1, 0}},
+    {OP_ARRAY_SEARCH, {2, 1}},
+    {OP_PUSH_STRING, {0, 1}},
+    {OP_STRING_LENGTH, {1, 1}},
+    {OP_STRING_INDEX, {2, 1}},
+    {OP_STRING_BUILDER, {0, 1}},
+    {OP_STRING_APPEND, {2, 0}},
+    {OP_STRING_APPEND_CHAR, {2, 0}},
+    {OP_STRING_BUILD, {1, 1}},
+    {OP_LOAD_BLOCK, {0, 0}},
+    {OP_STORE_BLOCK, {0, 0}},
+    {OP_LOAD_GLOBAL, {0, 1}},
+    {OP_STORE_GLOBAL, {1, 0}},
+    {OP_MAP_NEW, {0, 1}},
+    {OP_MAP_GET, {2, 1}},
+    {OP_MAP_PUT, {3, 0}},
+    {OP_MAP_CONTAINS, {2, 1}},
+    {OP_MAP_REMOVE, {2, 1}},
+    {OP_MAP_SIZE, {1, 1}},
+    {OP_SNAPSHOT, {0, 0}},
+    {OP_MAP_FREE, {1, 0}},
 };
 
 const std::map<std::string, uint8_t> OP_STRINGS_REV = maputils::reverse(OP_STRINGS);
 }
 
-std::shared_ptr<Instruction> const Instruction::OP_INSTANCES[OP_OPERATIONS_COUNT] = {
+thread_local std::shared_ptr<Instruction> const Instruction::OP_INSTANCES[OP_OPERATIONS_COUNT] = {
     std::shared_ptr<Instruction>(new AddInstruction()),
     std::shared_ptr<Instruction>(new SubInstruction()),
     std::shared_ptr<Instruction>(new MulInstruction()),
@@ -101,9 +363,58 @@ std::shared_ptr<Instruction> const Instruction::OP_INSTANCES[OP_OPERATIONS_COUNT
     std::shared_ptr<Instruction>(new ConvertInstruction()),
     std::shared_ptr<Instruction>(new NativeInstruction()),
     std::shared_ptr<Instruction>(new HaltInstruction()),
+    std::shared_ptr<Instruction>(new PopInstruction()),
+    std::shared_ptr<Instruction>(new PushConstInstruction()),
+    std::shared_ptr<Instruction>(new PrintConstInstruction()),
+    std::shared_ptr<Instruction>(new FlushInstruction()),
+    std::shared_ptr<Instruction>(new ReadLongInstruction()),
+    std::shared_ptr<Instruction>(new ReadIntInstruction()),
+    std::shared_ptr<Instruction>(new ReadCharInstruction()),
+    std::shared_ptr<Instruction>(new EofInstruction()),
+    std::shared_ptr<Instruction>(new MapFileInstruction()),
+    std::shared_ptr<Instruction>(new MappedSizeInstruction()),
+    std::shared_ptr<Instruction>(new MappedByteInstruction()),
+    std::shared_ptr<Instruction>(new MappedIntInstruction()),
+    std::shared_ptr<Instruction>(new MappedLongInstruction()),
+    std::shared_ptr<Instruction>(new MappedSliceInstruction()),
+    std::shared_ptr<Instruction>(new NewArrayInstruction()),
+    std::shared_ptr<Instruction>(new LoadIndexInstruction()),
+    std::shared_ptr<Instruction>(new StoreIndexInstruction()),
+    std::shared_ptr<Instruction>(new ArrayFillInstruction()),
+    std::shared_ptr<Instruction>(new ArrayCopyInstruction()),
+    std::shared_ptr<Instruction>(new ArraySumInstruction()),
+    std::shared_ptr<Instruction>(new ArrayMinInstruction()),
+    std::shared_ptr<Instruction>(new ArrayMaxInstruction()),
+    std::shared_ptr<Instruction>(new ArrayDotInstruction()),
+    std::shared_ptr<Instruction>(new ArrayCountInstruction()),
+    std::shared_ptr<Instruction>(new ArrayAddInstruction()),
+    std::shared_ptr<Instruction>(new ArrayMulInstruction()),
+    std::shared_ptr<Instruction>(new ArrayAddArrayInstruction()),
+    std::shared_ptr<Instruction>(new ArrayMulArrayInstruction()),
+    std::shared_ptr<Instruction>(new ArraySortInstruction()),
+    std::shared_ptr<Instruction>(new ArraySearchInstruction()),
+    std::shared_ptr<Instruction>(new PushStringInstruction()),
+    std::shared_ptr<Instruction>(new StringLengthInstruction()),
+    std::shared_ptr<Instruction>(new StringIndexInstruction()),
+    std::shared_ptr<Instruction>(new StringBuilderInstruction()),
+    std::shared_ptr<Instruction>(new StringAppendInstruction()),
+    std::shared_ptr<Instruction>(new StringAppendCharInstruction()),
+    std::shared_ptr<Instruction>(new StringBuildInstruction()),
+    std::shared_ptr<Instruction>(new LoadBlockInstruction()),
+    std::shared_ptr<Instruction>(new StoreBlockInstruction()),
+    std::shared_ptr<Instruction>(new LoadGlobalInstruction()),
+    std::shared_ptr<Instruction>(new StoreGlobalInstruction()),
+    std::shared_ptr<Instruction>(new MapNewInstruction()),
+    std::shared_ptr<Instruction>(new MapGetInstruction()),
+    std::shared_ptr<Instruction>(new MapPutInstruction()),
+    std::shared_ptr<Instruction>(new MapContainsInstruction()),
+    std::shared_ptr<Instruction>(new MapRemoveInstruction()),
+    std::shared_ptr<Instruction>(new MapSizeInstruction()),
+    std::shared_ptr<Instruction>(new SnapshotInstruction()),
+    std::shared_ptr<Instruction>(new MapFreeInstruction()),
 };
 
-Instruction* const Instruction::OP_INSTANCES_PTR[OP_OPERATIONS_COUNT] = {
+thread_local Instruction* const Instruction::OP_INSTANCES_PTR[OP_OPERATIONS_COUNT] = {
     OP_INSTANCES[OP_ADD].get(),
     OP_INSTANCES[OP_SUB].get(),
     OP_INSTANCES[OP_MUL].get(),
@@ -134,6 +445,55 @@ Instruction* const Instruction::OP_INSTANCES_PTR[OP_OPERATIONS_COUNT] = {
     OP_INSTANCES[OP_CONVERT].get(),
     OP_INSTANCES[OP_NATIVE].get(),
     OP_INSTANCES[OP_HALT].get(),
+    OP_INSTANCES[OP_POP].get(),
+    OP_INSTANCES[OP_PUSH_CONST].get(),
+    OP_INSTANCES[OP_PRINT_CONST].get(),
+    OP_INSTANCES[OP_FLUSH].get(),
+    OP_INSTANCES[OP_READ_LONG].get(),
+    OP_INSTANCES[OP_READ_INT].get(),
+    OP_INSTANCES[OP_READ_CHAR].get(),
+    OP_INSTANCES[OP_EOF].get(),
+    OP_INSTANCES[OP_MAP_FILE].get(),
+    OP_INSTANCES[OP_MAPPED_SIZE].get(),
+    OP_INSTANCES[OP_MAPPED_BYTE].get(),
+    OP_INSTANCES[OP_MAPPED_INT].get(),
+    OP_INSTANCES[OP_MAPPED_LONG].get(),
+    OP_INSTANCES[OP_MAPPED_SLICE].get(),
+    OP_INSTANCES[OP_NEW_ARRAY].get(),
+    OP_INSTANCES[OP_LOAD_INDEX].get(),
+    OP_INSTANCES[OP_STORE_INDEX].get(),
+    OP_INSTANCES[OP_ARRAY_FILL].get(),
+    OP_INSTANCES[OP_ARRAY_COPY].get(),
+    OP_INSTANCES[OP_ARRAY_SUM].get(),
+    OP_INSTANCES[OP_ARRAY_MIN].get(),
+    OP_INSTANCES[OP_ARRAY_MAX].get(),
+    OP_INSTANCES[OP_ARRAY_DOT].get(),
+    OP_INSTANCES[OP_ARRAY_COUNT].get(),
+    OP_INSTANCES[OP_ARRAY_ADD].get(),
+    OP_INSTANCES[OP_ARRAY_MUL].get(),
+    OP_INSTANCES[OP_ARRAY_ADD_ARRAY].get(),
+    OP_INSTANCES[OP_ARRAY_MUL_ARRAY].get(),
+    OP_INSTANCES[OP_ARRAY_SORT].get(),
+    OP_INSTANCES[OP_ARRAY_SEARCH].get(),
+    OP_INSTANCES[OP_PUSH_STRING].get(),
+    OP_INSTANCES[OP_STRING_LENGTH].get(),
+    OP_INSTANCES[OP_STRING_INDEX].get(),
+    OP_INSTANCES[OP_STRING_BUILDER].get(),
+    OP_INSTANCES[OP_STRING_APPEND].get(),
+    OP_INSTANCES[OP_STRING_APPEND_CHAR].get(),
+    OP_INSTANCES[OP_STRING_BUILD].get(),
+    OP_INSTANCES[OP_LOAD_BLOCK].get(),
+    OP_INSTANCES[OP_STORE_BLOCK].get(),
+    OP_INSTANCES[OP_LOAD_GLOBAL].get(),
+    OP_INSTANCES[OP_STORE_GLOBAL].get(),
+    OP_INSTANCES[OP_MAP_NEW].get(),
+    OP_INSTANCES[OP_MAP_GET].get(),
+    OP_INSTANCES[OP_MAP_PUT].get(),
+    OP_INSTANCES[OP_MAP_CONTAINS].get(),
+    OP_INSTANCES[OP_MAP_REMOVE].get(),
+    OP_INSTANCES[OP_MAP_SIZE].get(),
+    OP_INSTANCES[OP_SNAPSHOT].get(),
+    OP_INSTANCES[OP_MAP_FREE].get(),
 };
 
 Instruction::Instruction(const uint8_t& opcode) {
@@ -142,7 +502,7 @@ Instruction::Instruction(const uint8_t& opcode) {
 
 Instruction::~Instruction() {}
 
-void Instruction::read(const std::vector<uint8_t>& buffer, Address* index) {}
+void Instruction::read(const uint8_t* buffer, Address* index) {}
 
 void Instruction::write(std::vector<uint8_t>& buffer) const {
     buffer.push_back(opcode);
@@ -160,6 +520,18 @@ uint8_t Instruction::size() const {
     return SIZE_OF_BYTE;
 }
 
+uint8_t Instruction::pops() const {
+    return instructions::STACK_EFFECTS.at(opcode).first;
+}
+
+uint8_t Instruction::pushes() const {
+    return instructions::STACK_EFFECTS.at(opcode).second;
+}
+
+uint8_t Instruction::get_opcode() const {
+    return opcode;
+}
+
 std::shared_ptr<Instruction> Instruction::from_opcode(const uint8_t& opcode) {
     if (opcode < OP_OPERATIONS_COUNT) {
         return OP_INSTANCES[opcode];
@@ -172,6 +544,10 @@ std::shared_ptr<Instruction> Instruction::from_opstring(const std::string& opstr
     return Instruction::from_opcode(instructions::OP_STRINGS_REV.at(opstring));
 }
 
+bool Instruction::is_opstring(const std::string& opstring) {
+    return instructions::OP_STRINGS_REV.find(opstring) != instructions::OP_STRINGS_REV.end();
+}
+
 std::shared_ptr<Instruction> Instruction::from_string(const std::string& str) {
     std::vector<std::string> parts = instructions::split_string(str, ' ');
     auto instruction = Instruction::from_opcode(instructions::OP_STRINGS_REV.at(parts[0]));
@@ -179,6 +555,50 @@ std::shared_ptr<Instruction> Instruction::from_string(const std::string& str) {
     return instruction;
 }
 
+bool Instruction::is_valid(const uint8_t* program, const uint64_t& size, const Address& index) {
+    if (index >= size || program[index] >= OP_OPERATIONS_COUNT) {
+        return false;
+    }
+    Address operands = index + SIZE_OF_BYTE;
+    switch (program[index]) {
+        case OP_PUSH: {
+            // slices and strings are made by the VM, not read from the code
+            uint8_t type = operands < size ? program[operands] : var::SLICE;
+            if (var::TYPE_NAME.find((var::DataType) type) == var::TYPE_NAME.end() || type == var::SLICE || type == var::STRING) {
+                return false;
+            }
+            Var value;
+            value.type = (var::DataType) program[operands];
+            return operands + var::size(value) <= size;
+        }
+        case OP_CONVERT:
+            return operands < size && var::TYPE_NAME.find((var::DataType) program[operands]) != var::TYPE_NAME.end();
+        case OP_LOAD_INDEX:
+        case OP_STORE_INDEX: {
+            // elements are chars, ints or longs
+            Address type = operands + SIZE_OF_LONG;
+            return type < size && (program[type] == var::CHAR || program[type] == var::INT || program[type] == var::LONG);
+        }
+        case OP_ARRAY_FILL:
+        case OP_ARRAY_COPY:
+        case OP_ARRAY_SUM:
+        case OP_ARRAY_MIN:
+        case OP_ARRAY_MAX:
+        case OP_ARRAY_DOT:
+        case OP_ARRAY_COUNT:
+        case OP_ARRAY_ADD:
+        case OP_ARRAY_MUL:
+        case OP_ARRAY_ADD_ARRAY:
+        case OP_ARRAY_MUL_ARRAY:
+        case OP_ARRAY_SORT:
+        case OP_ARRAY_SEARCH:
+            return operands < size && (program[operands] == var::CHAR || program[operands] == var::INT || program[operands] == var::LONG);
+        default:
+            // every other instruction has a fixed size
+            return index + OP_INSTANCES[program[index]]->size() <= size;
+    }
+}
+
 std::vector<uint8_t> Instruction::to_bytes(const std::vector<std::unique_ptr<const Instruction>>& instructions) {
     std::vector<uint8_t> bytes;
     for (const auto& instruction : instructions) {
@@ -273,7 +693,7 @@ PushInstruction::PushInstruction(const Var& value) : Instruction(OP_PUSH) {
     this->value = value;
 }
 
-void PushInstruction::read(const std::vector<uint8_t>& buffer, Address* index) {
+void PushInstruction::read(const uint8_t* buffer, Address* index) {
     value = var::read(buffer, index);
 }
 
@@ -312,7 +732,7 @@ JumpInstruction::JumpInstruction(const uint8_t& opcode, const Address& address)
     this->address = address;
 }
 
-void JumpInstruction::read(const std::vector<uint8_t>& buffer, Address* index) {
+void JumpInstruction::read(const uint8_t* buffer, Address* index) {
     address = byteutils::read_ulong(buffer, *index);
     *index += SIZE_OF_LONG;
 }
@@ -344,6 +764,10 @@ void JumpInstruction::set_address(const Address& address) {
     this->address = address;
 }
 
+Address JumpInstruction::get_address() const {
+    return address;
+}
+
 JumpIfInstruction::JumpIfInstruction() : JumpInstruction((uint8_t) OP_JUMP_IF) {}
 
 JumpIfInstruction::JumpIfInstruction(const Address& address) : JumpInstruction(OP_JUMP_IF, address) {}
@@ -371,7 +795,13 @@ CallInstruction::CallInstruction(const Address& address, const uint8_t& param_co
     this->param_count = param_count;
 }
 
-void CallInstruction::read(const std::vector<uint8_t>& buffer, Address* index) {
+CallInstruction::CallInstruction(const std::string& symbol, const uint8_t& param_count) : Instruction(OP_CALL) {
+    this->address = 0;
+    this->param_count = param_count;
+    this->symbol = symbol;
+}
+
+void CallInstruction::read(const uint8_t* buffer, Address* index) {
     address = byteutils::read_ulong(buffer, *index);
     *index += SIZE_OF_LONG;
     param_count = buffer[*index];
@@ -384,14 +814,13 @@ void CallInstruction::write(std::vector<uint8_t>& buffer) const {
     buffer.push_back(param_count);
 }
 
+// The arguments are moved to the stack of the callee at once, in the order they were pushed.
 void CallInstruction::execute(Vm& vm) const {
     vm.call_stack.push(vm.ip);
     vm.ip = address;
-    std::vector<Var>* old_stack = vm.stack;
-    vm.push_frame();
-    for (int i = 0; i < param_count; i++) {
-        vm.stack->push_back(instructions::pop_var(old_stack));
-    }
+    const Var* values = vm.stack->pop(param_count);
+    vm.push_frame(address);
+    vm.stack->push_back(values, param_count);
 }
 
 void CallInstruction::read_string(const std::vector<std::string>& strings) {
@@ -401,7 +830,11 @@ void CallInstruction::read_string(const std::vector<std::string>& strings) {
 
 std::string CallInstruction::to_string() const {
     std::stringstream ss;
-    ss << Instruction::to_string() << " " << address << " " << (int) param_count;
+    if (symbol.empty()) {
+        ss << Instruction::to_string() << " " << address << " " << (int) param_count;
+    } else {
+        ss << Instruction::to_string() << " " << symbol << " " << (int) param_count;
+    }
     return ss.str();
 }
 
@@ -409,13 +842,26 @@ uint8_t CallInstruction::size() const {
     return Instruction::size() + SIZE_OF_LONG + SIZE_OF_BYTE;
 }
 
+// the values returned by the callee depend on its declaration, not on this instruction
+uint8_t CallInstruction::pops() const {
+    return param_count;
+}
+
+Address CallInstruction::get_address() const {
+    return address;
+}
+
+std::string CallInstruction::get_symbol() const {
+    return symbol;
+}
+
 RetInstruction::RetInstruction() : Instruction(OP_RET) {}
 
 RetInstruction::RetInstruction(const uint8_t& values_count) : Instruction(OP_RET) {
     this->values_count = values_count;
 }
 
-void RetInstruction::read(const std::vector<uint8_t>& buffer, Address* index) {
+void RetInstruction::read(const uint8_t* buffer, Address* index) {
     values_count = buffer[*index];
     *index += SIZE_OF_BYTE;
 }
@@ -428,14 +874,13 @@ void RetInstruction::write(std::vector<uint8_t>& buffer) const {
 void RetInstruction::execute(Vm& vm) const {
     vm.ip = vm.call_stack.top();
     vm.call_stack.pop();
+    // the frame of the callee is freed before the values are pushed
     Var values[values_count];
-    for (int i = 0; i < values_count; i++) {
+    for (int i = values_count - 1; i >= 0; i--) {
         values[i] = instructions::pop_var(vm.stack);
     }
     vm.pop_frame();
-    for (int i = 0; i < values_count; i++) {
-        vm.stack->push_back(values[i]);
-    }
+    vm.stack->push_back(values, values_count);
 }
 
 void RetInstruction::read_string(const std::vector<std::string>& strings) {
@@ -452,6 +897,10 @@ uint8_t RetInstruction::size() const {
     return Instruction::size() + SIZE_OF_BYTE;
 }
 
+uint8_t RetInstruction::pops() const {
+    return values_count;
+}
+
 LtInstruction::LtInstruction() : Instruction(OP_LT) {}
 
 void LtInstruction::execute(Vm& vm) const {
@@ -525,7 +974,7 @@ void BooleanNotInstruction::execute(Vm& vm) const {
 PrintInstruction::PrintInstruction() : Instruction(OP_PRINT) {}
 
 void PrintInstruction::execute(Vm& vm) const {
-    var::print(instructions::pop_var(vm.stack));
+    vm.output.write(instructions::pop_var(vm.stack));
 }
 
 StoreInstruction::StoreInstruction() : Instruction(OP_STORE) {}
@@ -534,7 +983,7 @@ StoreInstruction::StoreInstruction(const Address& address) : Instruction(OP_STOR
     this->address = address;
 }
 
-void StoreInstruction::read(const std::vector<uint8_t>& buffer, Address* index) {
+void StoreInstruction::read(const uint8_t* buffer, Address* index) {
     address = byteutils::read_ulong(buffer, *index);
     *index += SIZE_OF_LONG;
 }
@@ -568,7 +1017,7 @@ LoadInstruction::LoadInstruction(const Address& address) : Instruction(OP_LOAD)
     this->address = address;
 }
 
-void LoadInstruction::read(const std::vector<uint8_t>& buffer, Address* index) {
+void LoadInstruction::read(const uint8_t* buffer, Address* index) {
     address = byteutils::read_ulong(buffer, *index);
     *index += SIZE_OF_LONG;
 }
@@ -602,7 +1051,7 @@ ConvertInstruction::ConvertInstruction(const var::DataType& type) : Instruction(
     this->type = type;
 }
 
-void ConvertInstruction::read(const std::vector<uint8_t>& buffer, Address* index) {
+void ConvertInstruction::read(const uint8_t* buffer, Address* index) {
     type = (var::DataType) buffer[*index];
     *index += SIZE_OF_BYTE;
 }
@@ -618,7 +1067,9 @@ void ConvertInstruction::execute(Vm& vm) const {
 }
 
 void ConvertInstruction::read_string(const std::vector<std::string>& strings) {
-    type = (var::DataType) stoi(strings[0]);
+    // types are written by name, and were written by number before
+    const auto it = var::TYPE_NAME_REVERSED.find(strings[0]);
+    type = it != var::TYPE_NAME_REVERSED.end() ? it->second : (var::DataType) stoi(strings[0]);
 }
 
 std::string ConvertInstruction::to_string() const {
@@ -631,56 +1082,797 @@ uint8_t ConvertInstruction::size() const {
     return Instruction::size() + SIZE_OF_BYTE;
 }
 
-NativeInstruction::NativeInstruction() : Instruction(OP_NATIVE) {}
+NativeInstruction::NativeInstruction() : ConstInstruction(OP_NATIVE) {}
 
-NativeInstruction::NativeInstruction(const std::string& function_name) : Instruction(OP_NATIVE) {
-    this->function_name = function_name;
-    this->function_hash = NativeInstruction::hasher(function_name);
+NativeInstruction::NativeInstruction(const uint32_t& index, const uint8_t& args_count) : ConstInstruction(OP_NATIVE, index) {
+    this->args_count = args_count;
 }
 
-void NativeInstruction::read(const std::vector<uint8_t>& buffer, Address* index) {
-    function_hash = byteutils::read_ulong(buffer, *index);
-    *index += SIZE_OF_LONG;
+void NativeInstruction::read(const uint8_t* buffer, Address* index) {
+    ConstInstruction::read(buffer, index);
+    args_count = buffer[*index];
+    *index += SIZE_OF_BYTE;
 }
 
 void NativeInstruction::write(std::vector<uint8_t>& buffer) const {
-    Instruction::write(buffer);
-    byteutils::push_ulong(buffer, function_hash);
+    ConstInstruction::write(buffer);
+    buffer.push_back(args_count);
 }
 
 void NativeInstruction::execute(Vm& vm) const {
-    const auto& fun = vm.c_functions.get_function(function_hash);
-    std::vector<Var> args;
-    for (const auto& c_type : fun->get_arg_types()) {
-        var::DataType data_type = instructions::C_TYPE_TO_DATA_TYPE.at(c_type);
-        Var arg = instructions::pop_var(vm.stack);
-        if (arg.type != data_type) {
-            std::cout << "Expected arg '" << var::TYPE_NAME.at(data_type) << "', but got '" << var::TYPE_NAME.at(arg.type) << "' instead. "<< std::endl;
+    // native functions may write to the output too
+    vm.output.flush();
+    // the arguments were checked by the verifier, they are passed from the stack in place
+    Var* args = vm.stack->pop(args_count);
+    const NativeFunction& native = *vm.natives[index];
+    instructions::check_native_arrays(native, args);
+    CFunctions::call(native, args);
+    // the result is in the slot of the first argument
+    vm.stack->push_back(*args);
+}
+
+void NativeInstruction::read_string(const std::vector<std::string>& strings) {
+    ConstInstruction::read_string(strings);
+    args_count = stol(strings[1]);
+}
+
+std::string NativeInstruction::to_string() const {
+    return ConstInstruction::to_string() + " " + std::to_string(args_count);
+}
+
+uint8_t NativeInstruction::size() const {
+    return ConstInstruction::size() + SIZE_OF_BYTE;
+}
+
+uint8_t NativeInstruction::pops() const {
+    return args_count;
+}
+
+PopInstruction::PopInstruction() : Instruction(OP_POP) {}
+
+void PopInstruction::execute(Vm& vm) const {
+    vm.stack->pop_back();
+}
+
+ConstInstruction::ConstInstruction(const uint8_t& opcode) : Instruction(opcode) {}
+
+ConstInstruction::ConstInstruction(const uint8_t& opcode, const uint32_t& index) : Instruction(opcode) {
+    this->index = index;
+}
+
+void ConstInstruction::read(const uint8_t* buffer, Address* index) {
+    this->index = byteutils::read_int(buffer, *index);
+    *index += SIZE_OF_INT;
+}
+
+void ConstInstruction::write(std::vector<uint8_t>& buffer) const {
+    Instruction::write(buffer);
+    byteutils::push_int(buffer, index);
+}
+
+void ConstInstruction::read_string(const std::vector<std::string>& strings) {
+    index = stoul(strings[0]);
+}
+
+std::string ConstInstruction::to_string() const {
+    std::stringstream ss;
+    ss << Instruction::to_string() << " " << index;
+    return ss.str();
+}
+
+uint8_t ConstInstruction::size() const {
+    return Instruction::size() + SIZE_OF_INT;
+}
+
+uint32_t ConstInstruction::get_index() const {
+    return index;
+}
+
+PushConstInstruction::PushConstInstruction() : ConstInstruction(OP_PUSH_CONST) {}
+
+PushConstInstruction::PushConstInstruction(const uint32_t& index) : ConstInstruction(OP_PUSH_CONST, index) {}
+
+void PushConstInstruction::execute(Vm& vm) const {
+    vm.stack->push_back(vm.constants[index]);
+}
+
+PrintConstInstruction::PrintConstInstruction() : ConstInstruction(OP_PRINT_CONST) {}
+
+PrintConstInstruction::PrintConstInstruction(const uint32_t& index) : ConstInstruction(OP_PRINT_CONST, index) {}
+
+void PrintConstInstruction::execute(Vm& vm) const {
+    const std::string& str = vm.strings[index];
+    vm.output.write(str.data(), str.size());
+}
+
+FlushInstruction::FlushInstruction() : Instruction(OP_FLUSH) {}
+
+void FlushInstruction::execute(Vm& vm) const {
+    vm.output.flush();
+}
+
+ReadLongInstruction::ReadLongInstruction() : Instruction(OP_READ_LONG) {}
+
+void ReadLongInstruction::execute(Vm& vm) const {
+    int64_t value;
+    if (!vm.input.read_long(&value)) {
+        instructions::invalid_input(vm);
+    }
+    vm.stack->push_back(var::create_long(value));
+}
+
+ReadIntInstruction::ReadIntInstruction() : Instruction(OP_READ_INT) {}
+
+void ReadIntInstruction::execute(Vm& vm) const {
+    int32_t value;
+    if (!vm.input.read_int(&value)) {
+        instructions::invalid_input(vm);
+    }
+    vm.stack->push_back(var::create_int(value));
+}
+
+ReadCharInstruction::ReadCharInstruction() : Instruction(OP_READ_CHAR) {}
+
+void ReadCharInstruction::execute(Vm& vm) const {
+    vm.stack->push_back(var::create_char(vm.input.read_char()));
+}
+
+EofInstruction::EofInstruction() : Instruction(OP_EOF) {}
+
+void EofInstruction::execute(Vm& vm) const {
+    vm.stack->push_back(var::create_bool(vm.input.eof()));
+}
+
+MapFileInstruction::MapFileInstruction() : ConstInstruction(OP_MAP_FILE) {}
+
+MapFileInstruction::MapFileInstruction(const uint32_t& index) : ConstInstruction(OP_MAP_FILE, index) {}
+
+void MapFileInstruction::execute(Vm& vm) const {
+    vm.stack->push_back(var::create_int(vm.map_file(vm.strings[index])));
+}
+
+MappedSizeInstruction::MappedSizeInstruction() : Instruction(OP_MAPPED_SIZE) {}
+
+void MappedSizeInstruction::execute(Vm& vm) const {
+    Var handle = vm.stack->pop();
+    vm.stack->push_back(var::create_long(instructions::mapped_region(vm, handle).size));
+}
+
+MappedByteInstruction::MappedByteInstruction() : Instruction(OP_MAPPED_BYTE) {}
+
+void MappedByteInstruction::execute(Vm& vm) const {
+    Var offset = vm.stack->pop();
+    Var handle = vm.stack->pop();
+    vm.stack->push_back(var::create_int(*instructions::mapped_bytes(vm, handle, offset, SIZE_OF_BYTE)));
+}
+
+MappedIntInstruction::MappedIntInstruction() : Instruction(OP_MAPPED_INT) {}
+
+void MappedIntInstruction::execute(Vm& vm) const {
+    Var offset = vm.stack->pop();
+    Var handle = vm.stack->pop();
+    vm.stack->push_back(var::create_int(byteutils::read_int(instructions::mapped_bytes(vm, handle, offset, SIZE_OF_INT), 0)));
+}
+
+MappedLongInstruction::MappedLongInstruction() : Instruction(OP_MAPPED_LONG) {}
+
+void MappedLongInstruction::execute(Vm& vm) const {
+    Var offset = vm.stack->pop();
+    Var handle = vm.stack->pop();
+    vm.stack->push_back(var::create_long(byteutils::read_long(instructions::mapped_bytes(vm, handle, offset, SIZE_OF_LONG), 0)));
+}
+
+MappedSliceInstruction::MappedSliceInstruction() : Instruction(OP_MAPPED_SLICE) {}
+
+void MappedSliceInstruction::execute(Vm& vm) const {
+    Var length = vm.stack->pop();
+    Var offset = vm.stack->pop();
+    Var handle = vm.stack->pop();
+    if (length.data._long < 0 || length.data._long > UINT32_MAX) {
+        vm.output.flush();
+        std::cout << "Invalid slice length: " << length.data._long << std::endl;
+        exit(1);
+    }
+    const uint8_t* bytes = instructions::mapped_bytes(vm, handle, offset, length.data._long);
+    vm.stack->push_back(var::create_slice((uint8_t*) bytes, length.data._long, true));
+}
+
+NewArrayInstruction::NewArrayInstruction() : Instruction(OP_NEW_ARRAY) {}
+
+NewArrayInstruction::NewArrayInstruction(const Address& address, const uint32_t& length) : Instruction(OP_NEW_ARRAY) {
+    this->address = address;
+    this->length = length;
+}
+
+void NewArrayInstruction::read(const uint8_t* buffer, Address* index) {
+    address = byteutils::read_ulong(buffer, *index);
+    *index += SIZE_OF_LONG;
+    length = byteutils::read_int(buffer, *index);
+    *index += SIZE_OF_INT;
+}
+
+void NewArrayInstruction::write(std::vector<uint8_t>& buffer) const {
+    Instruction::write(buffer);
+    byteutils::push_ulong(buffer, address);
+    byteutils::push_int(buffer, length);
+}
+
+void NewArrayInstruction::execute(Vm& vm) const {
+    uint8_t* elements = (uint8_t*) (vm.heap + address + 1);
+    std::memset(elements, 0, length);
+    vm.heap[address] = var::create_slice(elements, length, false);
+}
+
+void NewArrayInstruction::read_string(const std::vector<std::string>& strings) {
+    address = stoul(strings[0]);
+    length = stoul(strings[1]);
+}
+
+std::string NewArrayInstruction::to_string() const {
+    std::stringstream ss;
+    ss << Instruction::to_string() << " " << address << " " << length;
+    return ss.str();
+}
+
+uint8_t NewArrayInstruction::size() const {
+    return Instruction::size() + SIZE_OF_LONG + SIZE_OF_INT;
+}
+
+IndexInstruction::IndexInstruction(const uint8_t& opcode) : Instruction(opcode) {}
+
+IndexInstruction::IndexInstruction(const uint8_t& opcode, const Address& address, const var::DataType& type) : Instruction(opcode) {
+    this->address = address;
+    this->type = type;
+}
+
+void IndexInstruction::read(const uint8_t* buffer, Address* index) {
+    address = byteutils::read_ulong(buffer, *index);
+    *index += SIZE_OF_LONG;
+    type = (var::DataType) buffer[*index];
+    *index += SIZE_OF_BYTE;
+}
+
+void IndexInstruction::write(std::vector<uint8_t>& buffer) const {
+    Instruction::write(buffer);
+    byteutils::push_ulong(buffer, address);
+    buffer.push_back(type);
+}
+
+void IndexInstruction::read_string(const std::vector<std::string>& strings) {
+    address = stoul(strings[0]);
+    type = var::TYPE_NAME_REVERSED.at(strings[1]);
+}
+
+std::string IndexInstruction::to_string() const {
+    std::stringstream ss;
+    ss << Instruction::to_string() << " " << address << " " << var::TYPE_NAME.at(type);
+    return ss.str();
+}
+
+uint8_t IndexInstruction::size() const {
+    return Instruction::size() + SIZE_OF_LONG + SIZE_OF_BYTE;
+}
+
+LoadIndexInstruction::LoadIndexInstruction() : IndexInstruction(OP_LOAD_INDEX) {}
+
+LoadIndexInstruction::LoadIndexInstruction(const Address& address, const var::DataType& type) : IndexInstruction(OP_LOAD_INDEX, address, type) {}
+
+void LoadIndexInstruction::execute(Vm& vm) const {
+    const Var& array = vm.heap[address];
+    Var& index = vm.stack->back();
+    switch (type) {
+        case var::CHAR:
+            index = var::create_char(instructions::load<char>(vm, array, index));
+            break;
+        case var::INT:
+            index = var::create_int(instructions::load<int>(vm, array, index));
+            break;
+        default:
+            index = var::create_long(instructions::load<long>(vm, array, index));
+            break;
+    }
+}
+
+StoreIndexInstruction::StoreIndexInstruction() : IndexInstruction(OP_STORE_INDEX) {}
+
+StoreIndexInstruction::StoreIndexInstruction(const Address& address, const var::DataType& type) : IndexInstruction(OP_STORE_INDEX, address, type) {}
+
+void StoreIndexInstruction::execute(Vm& vm) const {
+    const Var& array = vm.heap[address];
+    Var value = vm.stack->pop();
+    Var index = vm.stack->pop();
+    switch (type) {
+        case var::CHAR:
+            instructions::store<char>(vm, array, index, value.data._char);
+            break;
+        case var::INT:
+            instructions::store<int>(vm, array, index, value.data._int);
+            break;
+        default:
+            instructions::store<long>(vm, array, index, value.data._long);
+            break;
+    }
+}
+
+ArrayInstruction::ArrayInstruction(const uint8_t& opcode) : Instruction(opcode) {}
+
+ArrayInstruction::ArrayInstruction(const uint8_t& opcode, const var::DataType& type) : Instruction(opcode) {
+    this->type = type;
+}
+
+void ArrayInstruction::read(const uint8_t* buffer, Address* index) {
+    type = (var::DataType) buffer[*index];
+    *index += SIZE_OF_BYTE;
+}
+
+void ArrayInstruction::write(std::vector<uint8_t>& buffer) const {
+    Instruction::write(buffer);
+    buffer.push_back(type);
+}
+
+void ArrayInstruction::read_string(const std::vector<std::string>& strings) {
+    type = var::TYPE_NAME_REVERSED.at(strings[0]);
+}
+
+std::string ArrayInstruction::to_string() const {
+    std::stringstream ss;
+    ss << Instruction::to_string() << " " << var::TYPE_NAME.at(type);
+    return ss.str();
+}
+
+uint8_t ArrayInstruction::size() const {
+    return Instruction::size() + SIZE_OF_BYTE;
+}
+
+ArrayFillInstruction::ArrayFillInstruction() : ArrayInstruction(OP_ARRAY_FILL) {}
+
+ArrayFillInstruction::ArrayFillInstruction(const var::DataType& type) : ArrayInstruction(OP_ARRAY_FILL, type) {}
+
+void ArrayFillInstruction::execute(Vm& vm) const {
+    Var value = vm.stack->pop();
+    Var array = vm.stack->pop();
+    instructions::check_writable(vm, array);
+    instructions::with_elements(array, type, [&](auto* data, const size_t& size) {
+        arrayutils::fill(data, size, instructions::element_value(data, value));
+    });
+}
+
+ArrayCopyInstruction::ArrayCopyInstruction() : ArrayInstruction(OP_ARRAY_COPY) {}
+
+ArrayCopyInstruction::ArrayCopyInstruction(const var::DataType& type) : ArrayInstruction(OP_ARRAY_COPY, type) {}
+
+void ArrayCopyInstruction::execute(Vm& vm) const {
+    Var source = vm.stack->pop();
+    Var destination = vm.stack->pop();
+    instructions::check_writable(vm, destination);
+    instructions::with_elements(source, type, [&](auto* data, const size_t& size) {
+        if (size > destination.length / sizeof(*data)) {
+            vm.output.flush();
+            std::cout << "Copy of " << size << " elements to an array of " << destination.length / sizeof(*data) << " elements." << std::endl;
             exit(1);
         }
-        args.push_back(arg);
+        std::memmove(destination.data._pointer, data, size * sizeof(*data));
+    });
+}
+
+ArraySumInstruction::ArraySumInstruction() : ArrayInstruction(OP_ARRAY_SUM) {}
+
+ArraySumInstruction::ArraySumInstruction(const var::DataType& type) : ArrayInstruction(OP_ARRAY_SUM, type) {}
+
+void ArraySumInstruction::execute(Vm& vm) const {
+    Var& array = vm.stack->back();
+    array = var::create_long(instructions::with_elements(array, type, [](auto* data, const size_t& size) -> long {
+        return arrayutils::sum(data, size);
+    }));
+}
+
+ArrayMinInstruction::ArrayMinInstruction() : ArrayInstruction(OP_ARRAY_MIN) {}
+
+ArrayMinInstruction::ArrayMinInstruction(const var::DataType& type) : ArrayInstruction(OP_ARRAY_MIN, type) {}
+
+void ArrayMinInstruction::execute(Vm& vm) const {
+    Var& array = vm.stack->back();
+    array = var::create_long(instructions::with_elements(array, type, [&](auto* data, const size_t& size) -> long {
+        instructions::check_not_empty(vm, size);
+        return arrayutils::min(data, size);
+    }));
+}
+
+ArrayMaxInstruction::ArrayMaxInstruction() : ArrayInstruction(OP_ARRAY_MAX) {}
+
+ArrayMaxInstruction::ArrayMaxInstruction(const var::DataType& type) : ArrayInstruction(OP_ARRAY_MAX, type) {}
+
+void ArrayMaxInstruction::execute(Vm& vm) const {
+    Var& array = vm.stack->back();
+    array = var::create_long(instructions::with_elements(array, type, [&](auto* data, const size_t& size) -> long {
+        instructions::check_not_empty(vm, size);
+        return arrayutils::max(data, size);
+    }));
+}
+
+ArrayDotInstruction::ArrayDotInstruction() : ArrayInstruction(OP_ARRAY_DOT) {}
+
+ArrayDotInstruction::ArrayDotInstruction(const var::DataType& type) : ArrayInstruction(OP_ARRAY_DOT, type) {}
+
+void ArrayDotInstruction::execute(Vm& vm) const {
+    Var other = vm.stack->pop();
+    Var& array = vm.stack->back();
+    array = var::create_long(instructions::with_elements(array, type, [&](auto* data, const size_t& size) -> long {
+        return arrayutils::dot(data, instructions::same_size(vm, data, size, other), size);
+    }));
+}
+
+ArrayCountInstruction::ArrayCountInstruction() : ArrayInstruction(OP_ARRAY_COUNT) {}
+
+ArrayCountInstruction::ArrayCountInstruction(const var::DataType& type) : ArrayInstruction(OP_ARRAY_COUNT, type) {}
+
+void ArrayCountInstruction::execute(Vm& vm) const {
+    Var value = vm.stack->pop();
+    Var& array = vm.stack->back();
+    array = var::create_long(instructions::with_elements(array, type, [&](auto* data, const size_t& size) -> long {
+        return arrayutils::count(data, size, instructions::element_value(data, value));
+    }));
+}
+
+ArrayAddInstruction::ArrayAddInstruction() : ArrayInstruction(OP_ARRAY_ADD) {}
+
+ArrayAddInstruction::ArrayAddInstruction(const var::DataType& type) : ArrayInstruction(OP_ARRAY_ADD, type) {}
+
+void ArrayAddInstruction::execute(Vm& vm) const {
+    Var value = vm.stack->pop();
+    Var array = vm.stack->pop();
+    instructions::check_writable(vm, array);
+    instructions::with_elements(array, type, [&](auto* data, const size_t& size) {
+        arrayutils::add(data, size, instructions::element_value(data, value));
+    });
+}
+
+ArrayMulInstruction::ArrayMulInstruction() : ArrayInstruction(OP_ARRAY_MUL) {}
+
+ArrayMulInstruction::ArrayMulInstruction(const var::DataType& type) : ArrayInstruction(OP_ARRAY_MUL, type) {}
+
+void ArrayMulInstruction::execute(Vm& vm) const {
+    Var value = vm.stack->pop();
+    Var array = vm.stack->pop();
+    instructions::check_writable(vm, array);
+    instructions::with_elements(array, type, [&](auto* data, const size_t& size) {
+        arrayutils::mul(data, size, instructions::element_value(data, value));
+    });
+}
+
+ArrayAddArrayInstruction::ArrayAddArrayInstruction() : ArrayInstruction(OP_ARRAY_ADD_ARRAY) {}
+
+ArrayAddArrayInstruction::ArrayAddArrayInstruction(const var::DataType& type) : ArrayInstruction(OP_ARRAY_ADD_ARRAY, type) {}
+
+void ArrayAddArrayInstruction::execute(Vm& vm) const {
+    Var other = vm.stack->pop();
+    Var array = vm.stack->pop();
+    instructions::check_writable(vm, array);
+    instructions::with_elements(array, type, [&](auto* data, const size_t& size) {
+        arrayutils::add(data, instructions::same_size(vm, data, size, other), size);
+    });
+}
+
+ArrayMulArrayInstruction::ArrayMulArrayInstruction() : ArrayInstruction(OP_ARRAY_MUL_ARRAY) {}
+
+ArrayMulArrayInstruction::ArrayMulArrayInstruction(const var::DataType& type) : ArrayInstruction(OP_ARRAY_MUL_ARRAY, type) {}
+
+void ArrayMulArrayInstruction::execute(Vm& vm) const {
+    Var other = vm.stack->pop();
+    Var array = vm.stack->pop();
+    instructions::check_writable(vm, array);
+    instructions::with_elements(array, type, [&](auto* data, const size_t& size) {
+        arrayutils::mul(data, instructions::same_size(vm, data, size, other), size);
+    });
+}
+
+ArraySortInstruction::ArraySortInstruction() : ArrayInstruction(OP_ARRAY_SORT) {}
+
+ArraySortInstruction::ArraySortInstruction(const var::DataType& type) : ArrayInstruction(OP_ARRAY_SORT, type) {}
+
+void ArraySortInstruction::execute(Vm& vm) const {
+    Var array = vm.stack->pop();
+    instructions::check_writable(vm, array);
+    instructions::with_elements(array, type, [](auto* data, const size_t& size) {
+        arrayutils::sort(data, size);
+    });
+}
+
+ArraySearchInstruction::ArraySearchInstruction() : ArrayInstruction(OP_ARRAY_SEARCH) {}
+
+ArraySearchInstruction::ArraySearchInstruction(const var::DataType& type) : ArrayInstruction(OP_ARRAY_SEARCH, type) {}
+
+void ArraySearchInstruction::execute(Vm& vm) const {
+    Var value = vm.stack->pop();
+    Var& array = vm.stack->back();
+    array = var::create_long(instructions::with_elements(array, type, [&](auto* data, const size_t& size) -> long {
+        return arrayutils::search(data, size, instructions::element_value(data, value));
+    }));
+}
+
+PushStringInstruction::PushStringInstruction() : ConstInstruction(OP_PUSH_STRING) {}
+
+PushStringInstruction::PushStringInstruction(const uint32_t& index) : ConstInstruction(OP_PUSH_STRING, index) {}
+
+void PushStringInstruction::execute(Vm& vm) const {
+    vm.stack->push_back(vm.string_values[index]);
+}
+
+StringLengthInstruction::StringLengthInstruction() : Instruction(OP_STRING_LENGTH) {}
+
+void StringLengthInstruction::execute(Vm& vm) const {
+    Var& str = vm.stack->back();
+    str = var::create_long(str.length);
+}
+
+StringIndexInstruction::StringIndexInstruction() : Instruction(OP_STRING_INDEX) {}
+
+void StringIndexInstruction::execute(Vm& vm) const {
+    Var index = vm.stack->pop();
+    Var& str = vm.stack->back();
+    if ((uint64_t) index.data._long >= str.length) {
+        vm.output.flush();
+        std::cout << "Index " << index.data._long << " outside of string of " << str.length << " characters." << std::endl;
+        exit(1);
     }
-    Var result = CFunctions::call(fun, args);
-    vm.stack->push_back(result);
+    str = var::create_char(var::string_data(str)[index.data._long]);
 }
 
-void NativeInstruction::read_string(const std::vector<std::string>& strings) {
-    function_name = strings[0];
-    function_hash = NativeInstruction::hasher(function_name);
+StringBuilderInstruction::StringBuilderInstruction() : Instruction(OP_STRING_BUILDER) {}
+
+void StringBuilderInstruction::execute(Vm& vm) const {
+    vm.builders.emplace_back();
+    vm.stack->push_back(var::create_int(vm.builders.size() - 1));
 }
 
-std::string NativeInstruction::to_string() const {
+StringAppendInstruction::StringAppendInstruction() : Instruction(OP_STRING_APPEND) {}
+
+void StringAppendInstruction::execute(Vm& vm) const {
+    Var str = vm.stack->pop();
+    Var handle = vm.stack->pop();
+    instructions::builder(vm, handle).append(var::string_data(str), str.length);
+}
+
+StringAppendCharInstruction::StringAppendCharInstruction() : Instruction(OP_STRING_APPEND_CHAR) {}
+
+void StringAppendCharInstruction::execute(Vm& vm) const {
+    Var c = vm.stack->pop();
+    Var handle = vm.stack->pop();
+    instructions::builder(vm, handle).push_back(c.data._char);
+}
+
+StringBuildInstruction::StringBuildInstruction() : Instruction(OP_STRING_BUILD) {}
+
+void StringBuildInstruction::execute(Vm& vm) const {
+    Var& handle = vm.stack->back();
+    std::string& builder = instructions::builder(vm, handle);
+    if (builder.size() > UINT32_MAX) {
+        vm.output.flush();
+        std::cout << "String of " << builder.size() << " characters is too long." << std::endl;
+        exit(1);
+    }
+    handle = vm.interned.intern(builder);
+    builder.clear();
+}
+
+BlockInstruction::BlockInstruction(const uint8_t& opcode) : Instruction(opcode) {}
+
+BlockInstruction::BlockInstruction(const uint8_t& opcode, const Address& address, const uint8_t& count) : Instruction(opcode) {
+    this->address = address;
+    this->count = count;
+}
+
+void BlockInstruction::read(const uint8_t* buffer, Address* index) {
+    address = byteutils::read_ulong(buffer, *index);
+    *index += SIZE_OF_LONG;
+    count = buffer[*index];
+    *index += SIZE_OF_BYTE;
+}
+
+void BlockInstruction::write(std::vector<uint8_t>& buffer) const {
+    Instruction::write(buffer);
+    byteutils::push_ulong(buffer, address);
+    buffer.push_back(count);
+}
+
+void BlockInstruction::read_string(const std::vector<std::string>& strings) {
+    address = stoul(strings[0]);
+    count = stol(strings[1]);
+}
+
+std::string BlockInstruction::to_string() const {
     std::stringstream ss;
-    ss << Instruction::to_string() << " " << function_name;
+    ss << Instruction::to_string() << " " << address << " " << (int) count;
     return ss.str();
 }
 
-uint8_t NativeInstruction::size() const {
+uint8_t BlockInstruction::size() const {
+    return Instruction::size() + SIZE_OF_LONG + SIZE_OF_BYTE;
+}
+
+uint8_t BlockInstruction::pops() const {
+    return get_opcode() == OP_STORE_BLOCK ? count : 0;
+}
+
+uint8_t BlockInstruction::pushes() const {
+    return get_opcode() == OP_LOAD_BLOCK ? count : 0;
+}
+
+LoadBlockInstruction::LoadBlockInstruction() : BlockInstruction(OP_LOAD_BLOCK) {}
+
+LoadBlockInstruction::LoadBlockInstruction(const Address& address, const uint8_t& count) : BlockInstruction(OP_LOAD_BLOCK, address, count) {}
+
+void LoadBlockInstruction::execute(Vm& vm) const {
+    vm.stack->push_back(vm.heap + address, count);
+}
+
+StoreBlockInstruction::StoreBlockInstruction() : BlockInstruction(OP_STORE_BLOCK) {}
+
+StoreBlockInstruction::StoreBlockInstruction(const Address& address, const uint8_t& count) : BlockInstruction(OP_STORE_BLOCK, address, count) {}
+
+void StoreBlockInstruction::execute(Vm& vm) const {
+    const Var* values = vm.stack->pop(count);
+    std::copy(values, values + count, vm.heap + address);
+}
+
+StoreGlobalInstruction::StoreGlobalInstruction() : Instruction(OP_STORE_GLOBAL) {}
+
+StoreGlobalInstruction::StoreGlobalInstruction(const Address& address) : Instruction(OP_STORE_GLOBAL) {
+    this->address = address;
+}
+
+void StoreGlobalInstruction::read(const uint8_t* buffer, Address* index) {
+    address = byteutils::read_ulong(buffer, *index);
+    *index += SIZE_OF_LONG;
+}
+
+void StoreGlobalInstruction::write(std::vector<uint8_t>& buffer) const {
+    Instruction::write(buffer);
+    byteutils::push_ulong(buffer, address);
+}
+
+void StoreGlobalInstruction::execute(Vm& vm) const {
+    vm.globals[address] = instructions::pop_var(vm.stack);
+}
+
+void StoreGlobalInstruction::read_string(const std::vector<std::string>& strings) {
+    address = stoul(strings[0]);
+}
+
+std::string StoreGlobalInstruction::to_string() const {
+    std::stringstream ss;
+    ss << Instruction::to_string() << " " << address;
+    return ss.str();
+}
+
+uint8_t StoreGlobalInstruction::size() const {
+    return Instruction::size() + SIZE_OF_LONG;
+}
+
+LoadGlobalInstruction::LoadGlobalInstruction() : Instruction(OP_LOAD_GLOBAL) {}
+
+LoadGlobalInstruction::LoadGlobalInstruction(const Address& address) : Instruction(OP_LOAD_GLOBAL) {
+    this->address = address;
+}
+
+void LoadGlobalInstruction::read(const uint8_t* buffer, Address* index) {
+    address = byteutils::read_ulong(buffer, *index);
+    *index += SIZE_OF_LONG;
+}
+
+void LoadGlobalInstruction::write(std::vector<uint8_t>& buffer) const {
+    Instruction::write(buffer);
+    byteutils::push_ulong(buffer, address);
+}
+
+void LoadGlobalInstruction::execute(Vm& vm) const {
+    vm.stack->push_back(vm.globals[address]);
+}
+
+void LoadGlobalInstruction::read_string(const std::vector<std::string>& strings) {
+    address = stoul(strings[0]);
+}
+
+std::string LoadGlobalInstruction::to_string() const {
+    std::stringstream ss;
+    ss << Instruction::to_string() << " " << address;
+    return ss.str();
+}
+
+uint8_t LoadGlobalInstruction::size() const {
     return Instruction::size() + SIZE_OF_LONG;
 }
 
+MapNewInstruction::MapNewInstruction() : Instruction(OP_MAP_NEW) {}
+
+void MapNewInstruction::execute(Vm& vm) const {
+    // slots of freed maps are used again, so that the table doesn't grow
+    int slot;
+    if (!vm.free_maps.empty()) {
+        slot = vm.free_maps.back();
+        vm.free_maps.pop_back();
+        vm.maps[slot].emplace();
+    } else {
+        if (vm.maps.size() == 1 << MAP_SLOT_BITS) {
+            vm.output.flush();
+            std::cout << "Too many maps." << std::endl;
+            exit(1);
+        }
+        slot = vm.maps.size();
+        vm.maps.emplace_back(std::in_place);
+        vm.map_generations.push_back(0);
+    }
+    vm.stack->push_back(var::create_int(vm.map_generations[slot] << MAP_SLOT_BITS | slot));
+}
+
+MapGetInstruction::MapGetInstruction() : Instruction(OP_MAP_GET) {}
+
+void MapGetInstruction::execute(Vm& vm) const {
+    Var key = vm.stack->pop();
+    Var& handle = vm.stack->back();
+    handle = var::create_long(instructions::hash_map(vm, handle).get(key.data._long));
+}
+
+MapPutInstruction::MapPutInstruction() : Instruction(OP_MAP_PUT) {}
+
+void MapPutInstruction::execute(Vm& vm) const {
+    Var value = vm.stack->pop();
+    Var key = vm.stack->pop();
+    Var handle = vm.stack->pop();
+    instructions::hash_map(vm, handle).put(key.data._long, value.data._long);
+}
+
+MapContainsInstruction::MapContainsInstruction() : Instruction(OP_MAP_CONTAINS) {}
+
+void MapContainsInstruction::execute(Vm& vm) const {
+    Var key = vm.stack->pop();
+    Var& handle = vm.stack->back();
+    handle = var::create_bool(instructions::hash_map(vm, handle).contains(key.data._long));
+}
+
+MapRemoveInstruction::MapRemoveInstruction() : Instruction(OP_MAP_REMOVE) {}
+
+void MapRemoveInstruction::execute(Vm& vm) const {
+    Var key = vm.stack->pop();
+    Var& handle = vm.stack->back();
+    handle = var::create_bool(instructions::hash_map(vm, handle).remove(key.data._long));
+}
+
+MapSizeInstruction::MapSizeInstruction() : Instruction(OP_MAP_SIZE) {}
+
+void MapSizeInstruction::execute(Vm& vm) const {
+    Var& handle = vm.stack->back();
+    handle = var::create_long(instructions::hash_map(vm, handle).size());
+}
+
+MapFreeInstruction::MapFreeInstruction() : Instruction(OP_MAP_FREE) {}
+
+void MapFreeInstruction::execute(Vm& vm) const {
+    Var handle = vm.stack->pop();
+    // freeing a map twice is an invalid handle
+    instructions::hash_map(vm, handle);
+    int slot = instructions::map_slot(handle);
+    vm.maps[slot].reset();
+    vm.map_generations[slot] = (vm.map_generations[slot] + 1) % MAP_GENERATIONS;
+    vm.free_maps.push_back(slot);
+}
+
+SnapshotInstruction::SnapshotInstruction() : Instruction(OP_SNAPSHOT) {}
+
+void SnapshotInstruction::execute(Vm& vm) const {
+    // programs run through snapshot points unless a snapshot was requested
+    if (vm.snapshot_path.empty()) {
+        return;
+    }
+    vm.output.flush();
+    vm.save_snapshot(vm.snapshot_path);
+    vm.snapshot_path.clear();
+    vm.running = false;
+}
+
 HaltInstruction::HaltInstruction() : Instruction(OP_HALT) {}
 
 void HaltInstruction::execute(Vm& vm) const {
+    vm.output.flush();
     vm.running = false;
 }
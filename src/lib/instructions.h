@@ -12,6 +12,7 @@
 typedef uint64_t Address;
 
 enum {
+    // opcodes are stored in programs, new ones are added at the end
     OP_ADD,
     OP_SUB,
     OP_MUL,
@@ -42,6 +43,55 @@ enum {
     OP_CONVERT,
     OP_NATIVE,
     OP_HALT,
+    OP_POP,
+    OP_PUSH_CONST,
+    OP_PRINT_CONST,
+    OP_FLUSH,
+    OP_READ_LONG,
+    OP_READ_INT,
+    OP_READ_CHAR,
+    OP_EOF,
+    OP_MAP_FILE,
+    OP_MAPPED_SIZE,
+    OP_MAPPED_BYTE,
+    OP_MAPPED_INT,
+    OP_MAPPED_LONG,
+    OP_MAPPED_SLICE,
+    OP_NEW_ARRAY,
+    OP_LOAD_INDEX,
+    OP_STORE_INDEX,
+    OP_ARRAY_FILL,
+    OP_ARRAY_COPY,
+    OP_ARRAY_SUM,
+    OP_ARRAY_MIN,
+    OP_ARRAY_MAX,
+    OP_ARRAY_DOT,
+    OP_ARRAY_COUNT,
+    OP_ARRAY_ADD,
+    OP_ARRAY_MUL,
+    OP_ARRAY_ADD_ARRAY,
+    OP_ARRAY_MUL_ARRAY,
+    OP_ARRAY_SORT,
+    OP_ARRAY_SEARCH,
+    OP_PUSH_STRING,
+    OP_STRING_LENGTH,
+    OP_STRING_INDEX,
+    OP_STRING_BUILDER,
+    OP_STRING_APPEND,
+    OP_STRING_APPEND_CHAR,
+    OP_STRING_BUILD,
+    OP_LOAD_BLOCK,
+    OP_STORE_BLOCK,
+    OP_LOAD_GLOBAL,
+    OP_STORE_GLOBAL,
+    OP_MAP_NEW,
+    OP_MAP_GET,
+    OP_MAP_PUT,
+    OP_MAP_CONTAINS,
+    OP_MAP_REMOVE,
+    OP_MAP_SIZE,
+    OP_SNAPSHOT,
+    OP_MAP_FREE,
     OP_OPERATIONS_COUNT
 };
 
@@ -49,20 +99,28 @@ class Instruction {
     public:
     Instruction(const uint8_t& opcode);
     virtual ~Instruction();
-    virtual void read(const std::vector<uint8_t>& buffer, Address* index);
+    virtual void read(const uint8_t* buffer, Address* index);
     virtual void write(std::vector<uint8_t>& buffer) const;
     virtual void execute(Vm& vm) const;
     virtual void read_string(const std::vector<std::string>& strings);
     virtual std::string to_string() const;
     virtual uint8_t size() const;
+    // number of values taken from and put on the operand stack
+    virtual uint8_t pops() const;
+    virtual uint8_t pushes() const;
+    uint8_t get_opcode() const;
 
     static std::shared_ptr<Instruction> from_opcode(const uint8_t& opcode);
     static std::shared_ptr<Instruction> from_opstring(const std::string& opstring);
+    static bool is_opstring(const std::string& opstring);
     static std::shared_ptr<Instruction> from_string(const std::string& str);
+    static bool is_valid(const uint8_t* program, const uint64_t& size, const Address& index);
     static std::vector<uint8_t> to_bytes(const std::vector<std::unique_ptr<const Instruction>>& instructions);
     static std::vector<std::pair<Address, std::string>> to_asm(const std::vector<std::unique_ptr<const Instruction>>& instructions);
-    static std::shared_ptr<Instruction> const OP_INSTANCES[OP_OPERATIONS_COUNT];
-    static Instruction* const OP_INSTANCES_PTR[OP_OPERATIONS_COUNT];
+    // Instances decoding the instructions, read() overwrites their operands.
+    // Each thread has its own, so that VMs can run in parallel threads.
+    static thread_local std::shared_ptr<Instruction> const OP_INSTANCES[OP_OPERATIONS_COUNT];
+    static thread_local Instruction* const OP_INSTANCES_PTR[OP_OPERATIONS_COUNT];
 
     private:
     uint8_t opcode;
@@ -126,7 +184,7 @@ class PushInstruction: public Instruction {
     public:
     PushInstruction();
     PushInstruction(const Var& value);
-    void read(const std::vector<uint8_t>& buffer, Address* index);
+    void read(const uint8_t* buffer, Address* index);
     void write(std::vector<uint8_t>& buffer) const;
     void execute(Vm& vm) const;
     void read_string(const std::vector<std::string>& strings);
@@ -143,12 +201,13 @@ class JumpInstruction: public Instruction {
     JumpInstruction(const Address& address);
     JumpInstruction(const uint8_t& opcode);
     JumpInstruction(const uint8_t& opcode, const Address& address);
-    void read(const std::vector<uint8_t>& buffer, Address* index);
+    void read(const uint8_t* buffer, Address* index);
     void write(std::vector<uint8_t>& buffer) const;
     void execute(Vm& vm) const;
     void read_string(const std::vector<std::string>& strings);
     std::string to_string() const;
     void set_address(const Address& address);
+    Address get_address() const;
     uint8_t size() const;
 
     protected:
@@ -173,28 +232,35 @@ class CallInstruction: public Instruction {
     public:
     CallInstruction();
     CallInstruction(const Address& address, const uint8_t& param_count);
-    void read(const std::vector<uint8_t>& buffer, Address* index);
+    CallInstruction(const std::string& symbol, const uint8_t& param_count);
+    void read(const uint8_t* buffer, Address* index);
     void write(std::vector<uint8_t>& buffer) const;
     void execute(Vm& vm) const;
     void read_string(const std::vector<std::string>& strings);
     std::string to_string() const;
     uint8_t size() const;
+    uint8_t pops() const;
+    Address get_address() const;
+    std::string get_symbol() const;
 
     private:
     Address address;
     uint8_t param_count;
+    // name of the external function, resolved by the linker
+    std::string symbol;
 };
 
 class RetInstruction: public Instruction {
     public:
     RetInstruction();
     RetInstruction(const uint8_t& values_count);
-    void read(const std::vector<uint8_t>& buffer, Address* index);
+    void read(const uint8_t* buffer, Address* index);
     void write(std::vector<uint8_t>& buffer) const;
     void execute(Vm& vm) const;
     void read_string(const std::vector<std::string>& strings);
     std::string to_string() const;
     uint8_t size() const;
+    uint8_t pops() const;
 
     private:
     uint8_t values_count;
@@ -264,7 +330,7 @@ class StoreInstruction: public Instruction {
     public:
     StoreInstruction();
     StoreInstruction(const Address& address);
-    void read(const std::vector<uint8_t>& buffer, Address* index);
+    void read(const uint8_t* buffer, Address* index);
     void write(std::vector<uint8_t>& buffer) const;
     void execute(Vm& vm) const;
     void read_string(const std::vector<std::string>& strings);
@@ -279,7 +345,7 @@ class LoadInstruction: public Instruction {
     public:
     LoadInstruction();
     LoadInstruction(const Address& address);
-    void read(const std::vector<uint8_t>& buffer, Address* index);
+    void read(const uint8_t* buffer, Address* index);
     void write(std::vector<uint8_t>& buffer) const;
     void execute(Vm& vm) const;
     void read_string(const std::vector<std::string>& strings);
@@ -294,7 +360,7 @@ class ConvertInstruction: public Instruction {
     public:
     ConvertInstruction();
     ConvertInstruction(const var::DataType& type);
-    void read(const std::vector<uint8_t>& buffer, Address* index);
+    void read(const uint8_t* buffer, Address* index);
     void write(std::vector<uint8_t>& buffer) const;
     void execute(Vm& vm) const;
     void read_string(const std::vector<std::string>& strings);
@@ -305,22 +371,465 @@ class ConvertInstruction: public Instruction {
     var::DataType type;
 };
 
-class NativeInstruction: public Instruction {
+// Instruction referring to an entry of the constant pool of the program.
+class ConstInstruction: public Instruction {
+    public:
+    ConstInstruction(const uint8_t& opcode);
+    ConstInstruction(const uint8_t& opcode, const uint32_t& index);
+    void read(const uint8_t* buffer, Address* index);
+    void write(std::vector<uint8_t>& buffer) const;
+    void read_string(const std::vector<std::string>& strings);
+    std::string to_string() const;
+    uint8_t size() const;
+    uint32_t get_index() const;
+
+    protected:
+    uint32_t index;
+};
+
+// Calls the native function whose name is the string at the index.
+class NativeInstruction: public ConstInstruction {
     public:
     NativeInstruction();
-    NativeInstruction(const std::string& function_name);
-    void read(const std::vector<uint8_t>& buffer, Address* index);
+    NativeInstruction(const uint32_t& index, const uint8_t& args_count);
+    void read(const uint8_t* buffer, Address* index);
     void write(std::vector<uint8_t>& buffer) const;
     void execute(Vm& vm) const;
     void read_string(const std::vector<std::string>& strings);
     std::string to_string() const;
     uint8_t size() const;
+    uint8_t pops() const;
 
     private:
-    std::string function_name;
-    uint64_t function_hash;
-    
-    inline static std::hash<std::string> hasher;
+    uint8_t args_count;
+};
+
+class PopInstruction: public Instruction {
+    public:
+    PopInstruction();
+    void execute(Vm& vm) const;
+};
+
+class PushConstInstruction: public ConstInstruction {
+    public:
+    PushConstInstruction();
+    PushConstInstruction(const uint32_t& index);
+    void execute(Vm& vm) const;
+};
+
+class PrintConstInstruction: public ConstInstruction {
+    public:
+    PrintConstInstruction();
+    PrintConstInstruction(const uint32_t& index);
+    void execute(Vm& vm) const;
+};
+
+class FlushInstruction: public Instruction {
+    public:
+    FlushInstruction();
+    void execute(Vm& vm) const;
+};
+
+class ReadLongInstruction: public Instruction {
+    public:
+    ReadLongInstruction();
+    void execute(Vm& vm) const;
+};
+
+class ReadIntInstruction: public Instruction {
+    public:
+    ReadIntInstruction();
+    void execute(Vm& vm) const;
+};
+
+class ReadCharInstruction: public Instruction {
+    public:
+    ReadCharInstruction();
+    void execute(Vm& vm) const;
+};
+
+class EofInstruction: public Instruction {
+    public:
+    EofInstruction();
+    void execute(Vm& vm) const;
+};
+
+// Maps the file whose path is the string at the index, and pushes its handle.
+class MapFileInstruction: public ConstInstruction {
+    public:
+    MapFileInstruction();
+    MapFileInstruction(const uint32_t& index);
+    void execute(Vm& vm) const;
+};
+
+class MappedSizeInstruction: public Instruction {
+    public:
+    MappedSizeInstruction();
+    void execute(Vm& vm) const;
+};
+
+// Mapped reads pop the offset, then the handle of the file.
+class MappedByteInstruction: public Instruction {
+    public:
+    MappedByteInstruction();
+    void execute(Vm& vm) const;
+};
+
+class MappedIntInstruction: public Instruction {
+    public:
+    MappedIntInstruction();
+    void execute(Vm& vm) const;
+};
+
+class MappedLongInstruction: public Instruction {
+    public:
+    MappedLongInstruction();
+    void execute(Vm& vm) const;
+};
+
+// Pops the length, the offset and the handle of the file, and pushes a slice of its bytes.
+class MappedSliceInstruction: public Instruction {
+    public:
+    MappedSliceInstruction();
+    void execute(Vm& vm) const;
+};
+
+// Zeroes the elements of an array, which follow its local in the frame, and stores
+// a slice of them in the local.
+class NewArrayInstruction: public Instruction {
+    public:
+    NewArrayInstruction();
+    NewArrayInstruction(const Address& address, const uint32_t& length);
+    void read(const uint8_t* buffer, Address* index);
+    void write(std::vector<uint8_t>& buffer) const;
+    void execute(Vm& vm) const;
+    void read_string(const std::vector<std::string>& strings);
+    std::string to_string() const;
+    uint8_t size() const;
+
+    private:
+    Address address;
+    // bytes of the elements
+    uint32_t length;
+};
+
+// Element of type char, int or long of the slice stored in a local.
+class IndexInstruction: public Instruction {
+    public:
+    IndexInstruction(const uint8_t& opcode);
+    IndexInstruction(const uint8_t& opcode, const Address& address, const var::DataType& type);
+    void read(const uint8_t* buffer, Address* index);
+    void write(std::vector<uint8_t>& buffer) const;
+    void read_string(const std::vector<std::string>& strings);
+    std::string to_string() const;
+    uint8_t size() const;
+
+    protected:
+    Address address;
+    var::DataType type;
+};
+
+// Pops the index and pushes the element.
+class LoadIndexInstruction: public IndexInstruction {
+    public:
+    LoadIndexInstruction();
+    LoadIndexInstruction(const Address& address, const var::DataType& type);
+    void execute(Vm& vm) const;
+};
+
+// Pops the value, then the index, and writes the element.
+class StoreIndexInstruction: public IndexInstruction {
+    public:
+    StoreIndexInstruction();
+    StoreIndexInstruction(const Address& address, const var::DataType& type);
+    void execute(Vm& vm) const;
+};
+
+// Operation on every element of arrays, whose elements have the type of the instruction.
+class ArrayInstruction: public Instruction {
+    public:
+    ArrayInstruction(const uint8_t& opcode);
+    ArrayInstruction(const uint8_t& opcode, const var::DataType& type);
+    void read(const uint8_t* buffer, Address* index);
+    void write(std::vector<uint8_t>& buffer) const;
+    void read_string(const std::vector<std::string>& strings);
+    std::string to_string() const;
+    uint8_t size() const;
+
+    protected:
+    var::DataType type;
+};
+
+// Pops the value, then the array, and stores the value in every element.
+class ArrayFillInstruction: public ArrayInstruction {
+    public:
+    ArrayFillInstruction();
+    ArrayFillInstruction(const var::DataType& type);
+    void execute(Vm& vm) const;
+};
+
+// Pops the source, then the destination, and copies the source to the start of the destination.
+class ArrayCopyInstruction: public ArrayInstruction {
+    public:
+    ArrayCopyInstruction();
+    ArrayCopyInstruction(const var::DataType& type);
+    void execute(Vm& vm) const;
+};
+
+// Replaces the array by the sum of its elements, as a long.
+class ArraySumInstruction: public ArrayInstruction {
+    public:
+    ArraySumInstruction();
+    ArraySumInstruction(const var::DataType& type);
+    void execute(Vm& vm) const;
+};
+
+// Replaces the array, which must not be empty, by its smallest element as a long.
+class ArrayMinInstruction: public ArrayInstruction {
+    public:
+    ArrayMinInstruction();
+    ArrayMinInstruction(const var::DataType& type);
+    void execute(Vm& vm) const;
+};
+
+// Replaces the array, which must not be empty, by its largest element as a long.
+class ArrayMaxInstruction: public ArrayInstruction {
+    public:
+    ArrayMaxInstruction();
+    ArrayMaxInstruction(const var::DataType& type);
+    void execute(Vm& vm) const;
+};
+
+// Pops the second array and replaces the first one by the sum of the products of their elements.
+class ArrayDotInstruction: public ArrayInstruction {
+    public:
+    ArrayDotInstruction();
+    ArrayDotInstruction(const var::DataType& type);
+    void execute(Vm& vm) const;
+};
+
+// Pops the value and replaces the array by the number of elements equal to it.
+class ArrayCountInstruction: public ArrayInstruction {
+    public:
+    ArrayCountInstruction();
+    ArrayCountInstruction(const var::DataType& type);
+    void execute(Vm& vm) const;
+};
+
+// Pops the value, then the array, and adds the value to every element.
+class ArrayAddInstruction: public ArrayInstruction {
+    public:
+    ArrayAddInstruction();
+    ArrayAddInstruction(const var::DataType& type);
+    void execute(Vm& vm) const;
+};
+
+// Pops the value, then the array, and multiplies every element by the value.
+class ArrayMulInstruction: public ArrayInstruction {
+    public:
+    ArrayMulInstruction();
+    ArrayMulInstruction(const var::DataType& type);
+    void execute(Vm& vm) const;
+};
+
+// Pops the second array, then the first one, and adds the elements of the second one to the first one.
+class ArrayAddArrayInstruction: public ArrayInstruction {
+    public:
+    ArrayAddArrayInstruction();
+    ArrayAddArrayInstruction(const var::DataType& type);
+    void execute(Vm& vm) const;
+};
+
+// Pops the second array, then the first one, and multiplies the elements of the first one by the second one.
+class ArrayMulArrayInstruction: public ArrayInstruction {
+    public:
+    ArrayMulArrayInstruction();
+    ArrayMulArrayInstruction(const var::DataType& type);
+    void execute(Vm& vm) const;
+};
+
+// Pops the array and sorts its elements in ascending order.
+class ArraySortInstruction: public ArrayInstruction {
+    public:
+    ArraySortInstruction();
+    ArraySortInstruction(const var::DataType& type);
+    void execute(Vm& vm) const;
+};
+
+// Pops the value and replaces the sorted array by the index of the first element equal to it, or -1.
+class ArraySearchInstruction: public ArrayInstruction {
+    public:
+    ArraySearchInstruction();
+    ArraySearchInstruction(const var::DataType& type);
+    void execute(Vm& vm) const;
+};
+
+// Pushes the string at the index, interned when the program is loaded.
+class PushStringInstruction: public ConstInstruction {
+    public:
+    PushStringInstruction();
+    PushStringInstruction(const uint32_t& index);
+    void execute(Vm& vm) const;
+};
+
+class StringLengthInstruction: public Instruction {
+    public:
+    StringLengthInstruction();
+    void execute(Vm& vm) const;
+};
+
+// Pops the index, then the string, and pushes the character.
+class StringIndexInstruction: public Instruction {
+    public:
+    StringIndexInstruction();
+    void execute(Vm& vm) const;
+};
+
+// Pushes the handle of a new, empty builder.
+class StringBuilderInstruction: public Instruction {
+    public:
+    StringBuilderInstruction();
+    void execute(Vm& vm) const;
+};
+
+// Appends pop the string or the character, then the handle of the builder.
+class StringAppendInstruction: public Instruction {
+    public:
+    StringAppendInstruction();
+    void execute(Vm& vm) const;
+};
+
+class StringAppendCharInstruction: public Instruction {
+    public:
+    StringAppendCharInstruction();
+    void execute(Vm& vm) const;
+};
+
+// Replaces the handle of the builder by its interned content, and empties the builder.
+class StringBuildInstruction: public Instruction {
+    public:
+    StringBuildInstruction();
+    void execute(Vm& vm) const;
+};
+
+// Consecutive locals moved with the operand stack at once, such as the fields of a struct.
+class BlockInstruction: public Instruction {
+    public:
+    BlockInstruction(const uint8_t& opcode);
+    BlockInstruction(const uint8_t& opcode, const Address& address, const uint8_t& count);
+    void read(const uint8_t* buffer, Address* index);
+    void write(std::vector<uint8_t>& buffer) const;
+    void read_string(const std::vector<std::string>& strings);
+    std::string to_string() const;
+    uint8_t size() const;
+    uint8_t pops() const;
+    uint8_t pushes() const;
+
+    protected:
+    Address address;
+    uint8_t count;
+};
+
+// Pushes the locals, the first one is the deepest on the stack.
+class LoadBlockInstruction: public BlockInstruction {
+    public:
+    LoadBlockInstruction();
+    LoadBlockInstruction(const Address& address, const uint8_t& count);
+    void execute(Vm& vm) const;
+};
+
+// Pops the values into the locals, in the order of load_block.
+class StoreBlockInstruction: public BlockInstruction {
+    public:
+    StoreBlockInstruction();
+    StoreBlockInstruction(const Address& address, const uint8_t& count);
+    void execute(Vm& vm) const;
+};
+
+// Globals are reached from every frame, at their address in the data section.
+class StoreGlobalInstruction: public Instruction {
+    public:
+    StoreGlobalInstruction();
+    StoreGlobalInstruction(const Address& address);
+    void read(const uint8_t* buffer, Address* index);
+    void write(std::vector<uint8_t>& buffer) const;
+    void execute(Vm& vm) const;
+    void read_string(const std::vector<std::string>& strings);
+    std::string to_string() const;
+    uint8_t size() const;
+
+    private:
+    Address address;
+};
+
+class LoadGlobalInstruction: public Instruction {
+    public:
+    LoadGlobalInstruction();
+    LoadGlobalInstruction(const Address& address);
+    void read(const uint8_t* buffer, Address* index);
+    void write(std::vector<uint8_t>& buffer) const;
+    void execute(Vm& vm) const;
+    void read_string(const std::vector<std::string>& strings);
+    std::string to_string() const;
+    uint8_t size() const;
+
+    private:
+    Address address;
+};
+
+// Pushes the handle of a new, empty map of longs to longs.
+class MapNewInstruction: public Instruction {
+    public:
+    MapNewInstruction();
+    void execute(Vm& vm) const;
+};
+
+// Pops the key, then the handle of the map, and pushes the value of the key, zero when it is missing.
+class MapGetInstruction: public Instruction {
+    public:
+    MapGetInstruction();
+    void execute(Vm& vm) const;
+};
+
+// Pops the value, the key, then the handle of the map.
+class MapPutInstruction: public Instruction {
+    public:
+    MapPutInstruction();
+    void execute(Vm& vm) const;
+};
+
+// Pops the key, then the handle of the map, and pushes whether the map has the key.
+class MapContainsInstruction: public Instruction {
+    public:
+    MapContainsInstruction();
+    void execute(Vm& vm) const;
+};
+
+// Pops the key, then the handle of the map, and pushes whether the key was removed.
+class MapRemoveInstruction: public Instruction {
+    public:
+    MapRemoveInstruction();
+    void execute(Vm& vm) const;
+};
+
+// Replaces the handle of the map by its number of keys.
+class MapSizeInstruction: public Instruction {
+    public:
+    MapSizeInstruction();
+    void execute(Vm& vm) const;
+};
+
+// Pops the handle of a map and frees the map, whose handle is given again by map_new.
+class MapFreeInstruction: public Instruction {
+    public:
+    MapFreeInstruction();
+    void execute(Vm& vm) const;
+};
+
+class SnapshotInstruction: public Instruction {
+    public:
+    SnapshotInstruction();
+    void execute(Vm& vm) const;
 };
 
 class HaltInstruction: public Instruction {
@@ -0,0 +1,455 @@
+#include "module.h"
+#include "verifier.h"
+#include "byteutils.h"
+#include "fileutils.h"
+#include "instructions.h"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <set>
+#include <map>
+
+namespace module {
+const std::map<ast::AstVarType, var::DataType> AST_TO_VAR = {
+    {ast::BOOL, var::BOOL},
+    {ast::CHAR, var::CHAR},
+    {ast::INT, var::INT},
+    {ast::LONG, var::LONG},
+    {ast::DOUBLE, var::DOUBLE},
+    {ast::STRING, var::STRING},
+    {ast::CHAR_ARRAY, var::SLICE},
+    {ast::INT_ARRAY, var::SLICE},
+    {ast::LONG_ARRAY, var::SLICE},
+};
+
+void malformed(const std::string& message) {
+    std::cout << "Malformed module: " << message << std::endl;
+    exit(1);
+}
+
+uint8_t read_byte(const std::vector<uint8_t>& bytes, uint64_t* index) {
+    if (*index >= bytes.size()) {
+        malformed("truncated module.");
+    }
+    return bytes[(*index)++];
+}
+
+uint64_t read_ulong(const std::vector<uint8_t>& bytes, uint64_t* index) {
+    if (bytes.size() - *index < SIZE_OF_LONG) {
+        malformed("truncated module.");
+    }
+    uint64_t value = byteutils::read_ulong(bytes, *index);
+    *index += SIZE_OF_LONG;
+    return value;
+}
+
+// Number of records of at least record_size bytes, which must all fit in the rest of the module.
+uint64_t read_count(const std::vector<uint8_t>& bytes, uint64_t* index, const uint64_t& record_size) {
+    uint64_t count = read_ulong(bytes, index);
+    if (count > (bytes.size() - *index) / record_size) {
+        malformed("truncated module.");
+    }
+    return count;
+}
+
+std::string read_string(const std::vector<uint8_t>& bytes, uint64_t* index) {
+    uint64_t length = read_count(bytes, index, SIZE_OF_BYTE);
+    std::string str(bytes.begin() + *index, bytes.begin() + *index + length);
+    *index += length;
+    return str;
+}
+
+std::vector<ast::AstVarType> read_types(const std::vector<uint8_t>& bytes, uint64_t* index) {
+    std::vector<ast::AstVarType> types;
+    uint8_t count = read_byte(bytes, index);
+    for (uint8_t i = 0; i < count; i++) {
+        ast::AstVarType type = (ast::AstVarType) read_byte(bytes, index);
+        if (AST_TO_VAR.find(type) == AST_TO_VAR.end()) {
+            malformed("invalid function type.");
+        }
+        types.push_back(type);
+    }
+    return types;
+}
+
+// Bytes of the operand changed by the relocation.
+uint64_t relocation_size(const RelocationType& type) {
+    return type == CONSTANT || type == STRING ? SIZE_OF_INT : SIZE_OF_LONG;
+}
+
+void load_imports(
+    const Module& module,
+    const std::string& directory,
+    std::vector<Module>& modules,
+    std::set<std::string>& loaded,
+    std::set<std::string>& loading
+) {
+    for (const auto& import_path : module.imports) {
+        std::string path = resolve(directory, import_path);
+        if (loaded.find(path) != loaded.end()) {
+            continue;
+        }
+        if (loading.find(path) != loading.end()) {
+            std::cout << "Circular import of module '" << path << "'." << std::endl;
+            exit(1);
+        }
+        loading.insert(path);
+        Module dependency = read(filename(path));
+        load_imports(dependency, fileutils::directory(path), modules, loaded, loading);
+        loading.erase(path);
+        loaded.insert(path);
+        modules.push_back(dependency);
+    }
+}
+}
+
+Module module::compile(const std::shared_ptr<AbstractSyntaxTree>& root) {
+    Code instructions;
+    root->write(instructions);
+
+    Module module;
+    module.frame_size = VariableNode::count(root);
+    for (const auto& instruction : instructions.get_instructions()) {
+        // address operands are always right after the opcode
+        Address operand = module.code.size() + SIZE_OF_BYTE;
+        if (dynamic_cast<const PushConstInstruction*>(instruction)) {
+            module.relocations.push_back({operand, CONSTANT, ""});
+        } else if (dynamic_cast<const PrintConstInstruction*>(instruction) ||
+            dynamic_cast<const PushStringInstruction*>(instruction) ||
+            dynamic_cast<const MapFileInstruction*>(instruction) ||
+            dynamic_cast<const NativeInstruction*>(instruction)) {
+            module.relocations.push_back({operand, STRING, ""});
+        } else if (dynamic_cast<const LoadGlobalInstruction*>(instruction) || dynamic_cast<const StoreGlobalInstruction*>(instruction)) {
+            module.relocations.push_back({operand, GLOBAL, ""});
+        } else if (dynamic_cast<const JumpInstruction*>(instruction)) {
+            module.relocations.push_back({operand, INTERNAL, ""});
+        } else if (const auto call = dynamic_cast<const CallInstruction*>(instruction)) {
+            if (call->get_symbol().empty()) {
+                module.relocations.push_back({operand, INTERNAL, ""});
+            } else {
+                module.relocations.push_back({operand, EXTERNAL, call->get_symbol()});
+            }
+        }
+        instruction->write(module.code);
+        delete instruction;
+    }
+
+    const auto module_node = std::dynamic_pointer_cast<ModuleNode>(root);
+    if (module_node == nullptr) {
+        return module;
+    }
+    module.imports = module_node->get_imports();
+    module.constants = module_node->get_constant_pool().get_constants();
+    module.strings = module_node->get_constant_pool().get_strings();
+    module.globals = module_node->get_globals();
+    for (const auto& [name, native] : module_node->get_natives()) {
+        module.natives.push_back(native);
+    }
+    for (const auto& function : module_node->get_functions()) {
+        Symbol symbol;
+        symbol.name = function->get_name();
+        symbol.address = function->get_program_address();
+        symbol.return_types = function->get_return_types();
+        symbol.parameter_types = function->get_parameter_types();
+        symbol.frame_size = VariableNode::count(function);
+        module.exports.push_back(symbol);
+    }
+    if (module_node->get_main() != nullptr) {
+        // main shares the top-level frame but numbers its variables from zero
+        module.frame_size = std::max(module.frame_size, VariableNode::count(module_node->get_main()));
+    }
+    for (const auto& [statement, line] : module_node->get_lines()) {
+        module.lines.push_back({statement->get_program_address(), line});
+    }
+    std::stable_sort(module.lines.begin(), module.lines.end(), [](const executable::Line& a, const executable::Line& b) {
+        return a.address < b.address;
+    });
+    return module;
+}
+
+std::vector<uint8_t> module::link(const Module& main, const std::string& directory) {
+    std::vector<Module> modules;
+    std::set<std::string> loaded;
+    std::set<std::string> loading;
+    load_imports(main, directory, modules, loaded, loading);
+    modules.push_back(main);
+
+    std::vector<uint8_t> program;
+    std::vector<Address> bases;
+    // the globals of every module follow each other in the data section
+    std::vector<Var> globals;
+    std::vector<Address> global_bases;
+    std::map<std::string, Address> symbols;
+    // the top-level code of every module runs in the first frame, at address 0
+    std::map<Address, executable::Function> functions = {{0, {0, 0, 0, 0, 0, {}, {}}}};
+    std::vector<executable::Line> lines;
+    // constants of every module are merged into one pool, shared values are stored once
+    ConstantPool pool;
+    std::vector<std::vector<uint32_t>> constant_indexes;
+    std::vector<std::vector<uint32_t>> string_indexes;
+    std::map<std::string, executable::Native> natives;
+    for (const auto& module : modules) {
+        Address base = program.size();
+        for (const auto& symbol : module.exports) {
+            if (symbols.find(symbol.name) != symbols.end()) {
+                std::cout << "Function '" << symbol.name << "' is exported by several modules." << std::endl;
+                exit(1);
+            }
+            symbols[symbol.name] = base + symbol.address;
+            executable::Function function = {base + symbol.address, 0, 0, symbol.frame_size, 0, {}, {}};
+            for (const auto& type : symbol.parameter_types) {
+                function.parameter_types.push_back(AST_TO_VAR.at(type));
+            }
+            for (const auto& type : symbol.return_types) {
+                function.return_types.push_back(AST_TO_VAR.at(type));
+            }
+            function.params = function.parameter_types.size();
+            function.returns = function.return_types.size();
+            functions[function.entry] = function;
+        }
+        functions[0].frame_size = std::max(functions[0].frame_size, module.frame_size);
+        for (const auto& line : module.lines) {
+            lines.push_back({base + line.address, line.line});
+        }
+        constant_indexes.push_back({});
+        for (const auto& constant : module.constants) {
+            constant_indexes.back().push_back(pool.add(constant));
+        }
+        string_indexes.push_back({});
+        for (const auto& str : module.strings) {
+            string_indexes.back().push_back(pool.add(str));
+        }
+        for (const auto& native : module.natives) {
+            natives[native.name] = native;
+        }
+        global_bases.push_back(globals.size());
+        globals.insert(globals.end(), module.globals.begin(), module.globals.end());
+        program.insert(program.end(), module.code.begin(), module.code.end());
+        bases.push_back(base);
+    }
+
+    for (size_t i = 0; i < modules.size(); i++) {
+        for (const auto& relocation : modules[i].relocations) {
+            if (relocation.offset > modules[i].code.size() || modules[i].code.size() - relocation.offset < relocation_size(relocation.type)) {
+                std::cout << "Relocation at " << relocation.offset << " outside of the code of its module." << std::endl;
+                exit(1);
+            }
+            Address offset = bases[i] + relocation.offset;
+            if (relocation.type == INTERNAL) {
+                byteutils::write_ulong(program, offset, byteutils::read_ulong(program, offset) + bases[i]);
+                continue;
+            }
+            if (relocation.type == GLOBAL) {
+                byteutils::write_ulong(program, offset, byteutils::read_ulong(program, offset) + global_bases[i]);
+                continue;
+            }
+            if (relocation.type == CONSTANT || relocation.type == STRING) {
+                const auto& indexes = relocation.type == CONSTANT ? constant_indexes[i] : string_indexes[i];
+                uint32_t index = byteutils::read_int(program, offset);
+                if (index >= indexes.size()) {
+                    std::cout << "Constant " << index << " outside of the constant pool of its module." << std::endl;
+                    exit(1);
+                }
+                byteutils::write_int(program, offset, indexes[index]);
+                continue;
+            }
+            if (symbols.find(relocation.symbol) == symbols.end()) {
+                std::cout << "Undefined reference to function '" << relocation.symbol << "'." << std::endl;
+                exit(1);
+            }
+            byteutils::write_ulong(program, offset, symbols.at(relocation.symbol));
+        }
+    }
+
+    HaltInstruction().write(program);
+
+    Executable executable;
+    executable.code = program.data();
+    executable.code_size = program.size();
+    executable.lines = lines;
+    executable.constants = pool.get_constants();
+    executable.strings = pool.get_strings();
+    executable.globals = globals;
+    for (const auto& [name, native] : natives) {
+        executable.natives.push_back(native);
+    }
+    for (const auto& [entry, function] : functions) {
+        executable.functions.push_back(function);
+    }
+    // native functions are checked when the program is loaded, along with their libraries
+    const auto verified = verifier::verify(executable, nullptr);
+    for (auto& function : executable.functions) {
+        function.max_stack = verified.at(function.entry).max_stack;
+    }
+    return executable::to_bytes(executable);
+}
+
+std::vector<uint8_t> module::to_bytes(const Module& module) {
+    std::vector<uint8_t> bytes(MAGIC.begin(), MAGIC.end());
+    bytes.push_back(VERSION);
+
+    byteutils::push_ulong(bytes, module.code.size());
+    bytes.insert(bytes.end(), module.code.begin(), module.code.end());
+
+    byteutils::push_ulong(bytes, module.imports.size());
+    for (const auto& path : module.imports) {
+        byteutils::push_string(bytes, path);
+    }
+
+    byteutils::push_ulong(bytes, module.exports.size());
+    for (const auto& symbol : module.exports) {
+        byteutils::push_string(bytes, symbol.name);
+        byteutils::push_ulong(bytes, symbol.address);
+        bytes.push_back(symbol.return_types.size());
+        for (const auto& type : symbol.return_types) {
+            bytes.push_back(type);
+        }
+        bytes.push_back(symbol.parameter_types.size());
+        for (const auto& type : symbol.parameter_types) {
+            bytes.push_back(type);
+        }
+        byteutils::push_ulong(bytes, symbol.frame_size);
+    }
+
+    byteutils::push_ulong(bytes, module.relocations.size());
+    for (const auto& relocation : module.relocations) {
+        byteutils::push_ulong(bytes, relocation.offset);
+        bytes.push_back(relocation.type);
+        byteutils::push_string(bytes, relocation.symbol);
+    }
+
+    byteutils::push_ulong(bytes, module.frame_size);
+    byteutils::push_ulong(bytes, module.lines.size());
+    for (const auto& line : module.lines) {
+        byteutils::push_ulong(bytes, line.address);
+        byteutils::push_ulong(bytes, line.line);
+    }
+
+    byteutils::push_ulong(bytes, module.constants.size());
+    for (const auto& constant : module.constants) {
+        var::push(constant, bytes);
+    }
+    byteutils::push_ulong(bytes, module.strings.size());
+    for (const auto& str : module.strings) {
+        byteutils::push_string(bytes, str);
+    }
+    byteutils::push_ulong(bytes, module.natives.size());
+    for (const auto& native : module.natives) {
+        byteutils::push_string(bytes, native.name);
+        byteutils::push_string(bytes, native.library);
+        bytes.push_back(native.return_type);
+    }
+    byteutils::push_ulong(bytes, module.globals.size());
+    for (const auto& value : module.globals) {
+        executable::push_global(value, bytes);
+    }
+    return bytes;
+}
+
+Module module::from_bytes(const std::vector<uint8_t>& bytes) {
+    if (bytes.size() < MAGIC.size() + SIZE_OF_BYTE || !std::equal(MAGIC.begin(), MAGIC.end(), bytes.begin())) {
+        std::cout << "Not a banana module." << std::endl;
+        exit(1);
+    }
+    uint64_t index = MAGIC.size();
+    if (bytes[index] != VERSION) {
+        std::cout << "Unsupported module version: " << (int) bytes[index] << std::endl;
+        exit(1);
+    }
+    index += SIZE_OF_BYTE;
+
+    Module module;
+    uint64_t code_size = read_count(bytes, &index, SIZE_OF_BYTE);
+    module.code.insert(module.code.end(), bytes.begin() + index, bytes.begin() + index + code_size);
+    index += code_size;
+
+    uint64_t imports_count = read_count(bytes, &index, SIZE_OF_LONG);
+    for (uint64_t i = 0; i < imports_count; i++) {
+        module.imports.push_back(read_string(bytes, &index));
+    }
+
+    uint64_t exports_count = read_count(bytes, &index, SIZE_OF_LONG);
+    for (uint64_t i = 0; i < exports_count; i++) {
+        Symbol symbol;
+        symbol.name = read_string(bytes, &index);
+        symbol.address = read_ulong(bytes, &index);
+        if (symbol.address >= module.code.size()) {
+            malformed("function '" + symbol.name + "' outside of the code.");
+        }
+        symbol.return_types = read_types(bytes, &index);
+        symbol.parameter_types = read_types(bytes, &index);
+        symbol.frame_size = read_ulong(bytes, &index);
+        module.exports.push_back(symbol);
+    }
+
+    uint64_t relocations_count = read_count(bytes, &index, SIZE_OF_LONG);
+    for (uint64_t i = 0; i < relocations_count; i++) {
+        Relocation relocation;
+        relocation.offset = read_ulong(bytes, &index);
+        relocation.type = (RelocationType) read_byte(bytes, &index);
+        if (relocation.type > GLOBAL) {
+            malformed("invalid relocation.");
+        }
+        relocation.symbol = read_string(bytes, &index);
+        module.relocations.push_back(relocation);
+    }
+
+    module.frame_size = read_ulong(bytes, &index);
+    uint64_t lines_count = read_count(bytes, &index, 2 * SIZE_OF_LONG);
+    for (uint64_t i = 0; i < lines_count; i++) {
+        executable::Line line;
+        line.address = read_ulong(bytes, &index);
+        line.line = read_ulong(bytes, &index);
+        module.lines.push_back(line);
+    }
+
+    uint64_t constants_count = read_count(bytes, &index, SIZE_OF_BYTE);
+    for (uint64_t i = 0; i < constants_count; i++) {
+        if (index >= bytes.size()) {
+            malformed("truncated module.");
+        }
+        Var value;
+        value.type = (var::DataType) bytes[index];
+        if (var::TYPE_NAME.find(value.type) == var::TYPE_NAME.end() || var::size(value) > bytes.size() - index) {
+            malformed("invalid constant.");
+        }
+        module.constants.push_back(var::read(bytes.data(), &index));
+    }
+    uint64_t strings_count = read_count(bytes, &index, SIZE_OF_LONG);
+    for (uint64_t i = 0; i < strings_count; i++) {
+        module.strings.push_back(read_string(bytes, &index));
+    }
+    uint64_t natives_count = read_count(bytes, &index, 2 * SIZE_OF_LONG + SIZE_OF_BYTE);
+    for (uint64_t i = 0; i < natives_count; i++) {
+        executable::Native native;
+        native.name = read_string(bytes, &index);
+        native.library = read_string(bytes, &index);
+        native.return_type = (var::DataType) read_byte(bytes, &index);
+        if (var::TYPE_NAME.find(native.return_type) == var::TYPE_NAME.end()) {
+            malformed("invalid native function type.");
+        }
+        module.natives.push_back(native);
+    }
+    uint64_t globals_count = read_count(bytes, &index, SIZE_OF_BYTE);
+    for (uint64_t i = 0; i < globals_count; i++) {
+        module.globals.push_back(executable::read_global(bytes.data(), bytes.size(), &index));
+    }
+    return module;
+}
+
+std::string module::resolve(const std::string& directory, const std::string& import_path) {
+    // absolute paths are kept, the others are normalized so that a module is loaded once
+    return (std::filesystem::path(directory) / import_path).lexically_normal().string();
+}
+
+std::string module::filename(const std::string& import_path) {
+    return import_path + "." + EXTENSION;
+}
+
+Module module::read(const std::string& filename) {
+    return from_bytes(fileutils::read_bytes(filename));
+}
+
+void module::write(const Module& module, const std::string& filename) {
+    fileutils::write_bytes(to_bytes(module), filename);
+}
@@ -0,0 +1,74 @@
+#if !defined(MODULE)
+#define MODULE
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include "ast.h"
+#include "executable.h"
+
+namespace module {
+enum RelocationType {
+    // address inside the module, shifted by the module base when linking
+    INTERNAL,
+    // call to a function exported by another module
+    EXTERNAL,
+    // index into the constants or the strings of the module, remapped into the merged pool when linking
+    CONSTANT,
+    STRING,
+    // address of a global of the module, shifted by the globals of the modules before it when linking
+    GLOBAL
+};
+
+struct Symbol {
+    std::string name;
+    Address address;
+    // structs are passed and returned as their values
+    std::vector<ast::AstVarType> return_types;
+    std::vector<ast::AstVarType> parameter_types;
+    uint64_t frame_size;
+};
+
+struct Relocation {
+    Address offset;
+    RelocationType type;
+    std::string symbol;
+};
+}
+
+struct Module {
+    std::vector<uint8_t> code;
+    std::vector<std::string> imports;
+    std::vector<module::Symbol> exports;
+    std::vector<module::Relocation> relocations;
+    // number of variables of the top-level code, including the main function
+    uint64_t frame_size;
+    std::vector<executable::Line> lines;
+    std::vector<Var> constants;
+    std::vector<std::string> strings;
+    std::vector<executable::Native> natives;
+    // initial values of the globals of the module
+    std::vector<Var> globals;
+};
+
+namespace module {
+const std::string MAGIC = "BNMD";
+const uint8_t VERSION = 10;
+const std::string EXTENSION = "mod";
+
+Module compile(const std::shared_ptr<AbstractSyntaxTree>& root);
+// Imports of the main module are relative to the directory, the ones of the others to their own.
+std::vector<uint8_t> link(const Module& main, const std::string& directory = "");
+
+std::vector<uint8_t> to_bytes(const Module& module);
+Module from_bytes(const std::vector<uint8_t>& bytes);
+
+// Path of the module imported by a file of the directory, without extension.
+std::string resolve(const std::string& directory, const std::string& import_path);
+std::string filename(const std::string& import_path);
+Module read(const std::string& filename);
+void write(const Module& module, const std::string& filename);
+}
+
+#endif // MODULE
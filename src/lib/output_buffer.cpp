@@ -0,0 +1,91 @@
+#include "output_buffer.h"
+#include <charconv>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+
+namespace output {
+// longest text of a value: a double with its sign and exponent
+const size_t MAX_VALUE_SIZE = var::MAX_DOUBLE_SIZE;
+}
+
+OutputBuffer::OutputBuffer(const std::shared_ptr<OutputSink>& sink) : buffer(new char[CAPACITY]), size(0) {
+    this->sink = sink != nullptr ? sink : std::make_shared<FileSink>(STDOUT_FILENO);
+    policy = this->sink->is_interactive() ? output::LINE : output::BLOCK;
+}
+
+OutputBuffer::~OutputBuffer() {
+    flush();
+}
+
+void OutputBuffer::write(const char* data, const size_t& size) {
+    if (this->size + size > CAPACITY) {
+        flush();
+        if (size >= CAPACITY) {
+            sink->write(data, size);
+            return;
+        }
+    }
+    memcpy(buffer.get() + this->size, data, size);
+    this->size += size;
+    if (policy == output::LINE && memchr(data, '\n', size) != nullptr) {
+        flush();
+    }
+}
+
+void OutputBuffer::write(const Var& value) {
+    // strings can be longer than the other values, they are written in bulk
+    if (value.type == var::STRING) {
+        write(var::string_data(value), value.length);
+        return;
+    }
+    if (size + output::MAX_VALUE_SIZE > CAPACITY) {
+        flush();
+    }
+    char* begin = buffer.get() + size;
+    char* end = begin;
+    switch (value.type) {
+        case var::BOOL:
+            end = value.data._bool ? std::copy_n("true", 4, begin) : std::copy_n("false", 5, begin);
+            break;
+        case var::CHAR:
+            *end++ = value.data._char;
+            break;
+        case var::INT:
+            end = std::to_chars(begin, begin + output::MAX_VALUE_SIZE, value.data._int).ptr;
+            break;
+        case var::LONG:
+            end = std::to_chars(begin, begin + output::MAX_VALUE_SIZE, value.data._long).ptr;
+            break;
+        case var::DOUBLE:
+            end = var::format_double(begin, value.data._double);
+            break;
+        default:
+            std::cout << "Type not found: " << (int) value.type << std::endl;
+            exit(1);
+    }
+    size = end - buffer.get();
+    if (policy == output::LINE && value.type == var::CHAR && value.data._char == '\n') {
+        flush();
+    }
+}
+
+void OutputBuffer::flush() {
+    if (size > 0) {
+        sink->write(buffer.get(), size);
+        size = 0;
+    }
+}
+
+void OutputBuffer::set_policy(const output::FlushPolicy& policy) {
+    this->policy = policy;
+}
+
+output::FlushPolicy OutputBuffer::get_policy() const {
+    return policy;
+}
+
+std::shared_ptr<OutputSink> OutputBuffer::get_sink() const {
+    return sink;
+}
@@ -0,0 +1,45 @@
+#if !defined(OUTPUT_BUFFER)
+#define OUTPUT_BUFFER
+
+#include <memory>
+#include <stddef.h>
+#include "output_sink.h"
+#include "var.h"
+
+namespace output {
+enum FlushPolicy {
+    // flushes at every new line, for terminals
+    LINE,
+    // flushes when the buffer is full
+    BLOCK
+};
+}
+
+// Output of the programs, given to the sink in as few writes as possible.
+// The buffer is also flushed explicitly, when the program halts and when it is destroyed.
+class OutputBuffer {
+    public:
+    // Writes to the standard output when the sink is null.
+    // The policy is LINE if the sink is interactive, BLOCK otherwise.
+    OutputBuffer(const std::shared_ptr<OutputSink>& sink = nullptr);
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+    ~OutputBuffer();
+
+    void write(const char* data, const size_t& size);
+    void write(const Var& value);
+    void flush();
+    void set_policy(const output::FlushPolicy& policy);
+    output::FlushPolicy get_policy() const;
+    std::shared_ptr<OutputSink> get_sink() const;
+
+    static constexpr size_t CAPACITY = 1 << 16;
+
+    private:
+    std::shared_ptr<OutputSink> sink;
+    output::FlushPolicy policy;
+    std::unique_ptr<char[]> buffer;
+    size_t size;
+};
+
+#endif // OUTPUT_BUFFER
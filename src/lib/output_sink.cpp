@@ -0,0 +1,54 @@
+#include "output_sink.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+
+OutputSink::~OutputSink() {}
+
+bool OutputSink::is_interactive() const {
+    return false;
+}
+
+FileSink::FileSink(const int& fd) {
+    this->fd = fd;
+}
+
+void FileSink::write(const char* data, const size_t& size) {
+    size_t written = 0;
+    while (written < size) {
+        ssize_t count = ::write(fd, data + written, size - written);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cout << "Could not write output: " << strerror(errno) << std::endl;
+            exit(1);
+        }
+        written += count;
+    }
+}
+
+bool FileSink::is_interactive() const {
+    return isatty(fd);
+}
+
+void MemorySink::write(const char* data, const size_t& size) {
+    content.append(data, size);
+}
+
+const std::string& MemorySink::get_content() const {
+    return content;
+}
+
+void MemorySink::clear() {
+    content.clear();
+}
+
+CallbackSink::CallbackSink(const std::function<void(const char*, size_t)>& callback) {
+    this->callback = callback;
+}
+
+void CallbackSink::write(const char* data, const size_t& size) {
+    callback(data, size);
+}
@@ -0,0 +1,49 @@
+#if !defined(OUTPUT_SINK)
+#define OUTPUT_SINK
+
+#include <functional>
+#include <string>
+#include <stddef.h>
+
+// Destination of the output of a VM. Each VM writes to its own sink, from the thread running it.
+class OutputSink {
+    public:
+    virtual ~OutputSink();
+    virtual void write(const char* data, const size_t& size) = 0;
+    // interactive sinks get their output at every new line
+    virtual bool is_interactive() const;
+};
+
+// Writes to a file descriptor, which is not closed by the sink.
+class FileSink: public OutputSink {
+    public:
+    FileSink(const int& fd);
+    void write(const char* data, const size_t& size);
+    bool is_interactive() const;
+
+    private:
+    int fd;
+};
+
+// Keeps the output in memory.
+class MemorySink: public OutputSink {
+    public:
+    void write(const char* data, const size_t& size);
+    const std::string& get_content() const;
+    void clear();
+
+    private:
+    std::string content;
+};
+
+// Gives the output to a function, a chunk at a time.
+class CallbackSink: public OutputSink {
+    public:
+    CallbackSink(const std::function<void(const char*, size_t)>& callback);
+    void write(const char* data, const size_t& size);
+
+    private:
+    std::function<void(const char*, size_t)> callback;
+};
+
+#endif // OUTPUT_SINK
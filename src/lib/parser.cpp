@@ -1,5 +1,6 @@
 #include "c_functions.h"
 #include "maputils.h"
+#include "module.h"
 #include "parser.h"
 #include "var.h"
 #include <sstream>
@@ -34,17 +35,105 @@ const std::map<TokenType, ast::AstVarType> TOKEN_TO_AST = {
     {TOKEN_CHAR, ast::CHAR},
     {TOKEN_INT, ast::INT},
     {TOKEN_LONG, ast::LONG},
+    {TOKEN_DOUBLE, ast::DOUBLE},
+    {TOKEN_STRING_TYPE, ast::STRING},
     {TOKEN_VOID, ast::VOID},
 };
 
 const std::map<ast::AstVarType, TokenType> AST_TO_TOKEN = maputils::reverse(TOKEN_TO_AST);
 
+// types of the arrays declared with '[]' after the type of their elements
+const std::map<TokenType, ast::AstVarType> ARRAY_OF = {
+    {TOKEN_CHAR, ast::CHAR_ARRAY},
+    {TOKEN_INT, ast::INT_ARRAY},
+    {TOKEN_LONG, ast::LONG_ARRAY},
+};
+
+const std::map<ast::AstVarType, TokenType> ELEMENT_OF = maputils::reverse(ARRAY_OF);
+
+// types of literals and constants
+const std::map<var::DataType, ast::AstVarType> VAR_TO_AST = {
+    {var::BOOL, ast::BOOL},
+    {var::CHAR, ast::CHAR},
+    {var::INT, ast::INT},
+    {var::LONG, ast::LONG},
+    {var::DOUBLE, ast::DOUBLE},
+    {var::STRING, ast::STRING},
+};
+
+struct Builtin {
+    ast::AstBuiltin builtin;
+    ast::AstVarType return_type;
+    std::vector<ast::AstVarType> parameter_types;
+};
+
+// functions of the language, map_file takes a string literal instead of typed parameters
+const std::map<std::string, Builtin> BUILTINS = {
+    {"read_long", {ast::READ_LONG, ast::LONG, {}}},
+    {"read_int", {ast::READ_INT, ast::INT, {}}},
+    {"read_char", {ast::READ_CHAR, ast::CHAR, {}}},
+    {"eof", {ast::END_OF_INPUT, ast::BOOL, {}}},
+    {"map_file", {ast::MAP_FILE, ast::INT, {}}},
+    {"mapped_size", {ast::MAPPED_SIZE, ast::LONG, {ast::INT}}},
+    {"mapped_byte", {ast::MAPPED_BYTE, ast::INT, {ast::INT, ast::LONG}}},
+    {"mapped_int", {ast::MAPPED_INT, ast::INT, {ast::INT, ast::LONG}}},
+    {"mapped_long", {ast::MAPPED_LONG, ast::LONG, {ast::INT, ast::LONG}}},
+    {"mapped_slice", {ast::MAPPED_SLICE, ast::CHAR_ARRAY, {ast::INT, ast::LONG, ast::LONG}}},
+    {"string_length", {ast::STRING_LENGTH, ast::LONG, {ast::STRING}}},
+    {"string_builder", {ast::STRING_BUILDER, ast::INT, {}}},
+    {"string_append", {ast::STRING_APPEND, ast::VOID, {ast::INT, ast::STRING}}},
+    {"string_append_char", {ast::STRING_APPEND_CHAR, ast::VOID, {ast::INT, ast::CHAR}}},
+    {"string_build", {ast::STRING_BUILD, ast::STRING, {ast::INT}}},
+    {"map_new", {ast::MAP_NEW, ast::INT, {}}},
+    {"map_get", {ast::MAP_GET, ast::LONG, {ast::INT, ast::LONG}}},
+    {"map_put", {ast::MAP_PUT, ast::VOID, {ast::INT, ast::LONG, ast::LONG}}},
+    {"map_contains", {ast::MAP_CONTAINS, ast::BOOL, {ast::INT, ast::LONG}}},
+    {"map_remove", {ast::MAP_REMOVE, ast::BOOL, {ast::INT, ast::LONG}}},
+    {"map_size", {ast::MAP_SIZE, ast::LONG, {ast::INT}}},
+    {"map_free", {ast::MAP_FREE, ast::VOID, {ast::INT}}},
+};
+
+// Parameters of the array builtins after their first one: an array, a value of the type of the
+// elements, or either of them.
+enum ArrayParameter {
+    ARRAY, ELEMENT, ARRAY_OR_ELEMENT
+};
+
+struct ArrayBuiltin {
+    ast::AstArrayBuiltin builtin;
+    // compiled instead when an ARRAY_OR_ELEMENT argument is an array
+    ast::AstArrayBuiltin array_builtin;
+    ast::AstVarType return_type;
+    std::vector<ArrayParameter> parameter_types;
+};
+
+// Builtins on whole arrays, whose first argument is an array variable. The type of its
+// elements is the one of the other arrays and values.
+const std::map<std::string, ArrayBuiltin> ARRAY_BUILTINS = {
+    {"array_fill", {ast::ARRAY_FILL, ast::ARRAY_FILL, ast::VOID, {ELEMENT}}},
+    {"array_copy", {ast::ARRAY_COPY, ast::ARRAY_COPY, ast::VOID, {ARRAY}}},
+    {"array_sum", {ast::ARRAY_SUM, ast::ARRAY_SUM, ast::LONG, {}}},
+    {"array_min", {ast::ARRAY_MIN, ast::ARRAY_MIN, ast::LONG, {}}},
+    {"array_max", {ast::ARRAY_MAX, ast::ARRAY_MAX, ast::LONG, {}}},
+    {"array_dot", {ast::ARRAY_DOT, ast::ARRAY_DOT, ast::LONG, {ARRAY}}},
+    {"array_count", {ast::ARRAY_COUNT, ast::ARRAY_COUNT, ast::LONG, {ELEMENT}}},
+    {"array_add", {ast::ARRAY_ADD, ast::ARRAY_ADD_ARRAY, ast::VOID, {ARRAY_OR_ELEMENT}}},
+    {"array_mul", {ast::ARRAY_MUL, ast::ARRAY_MUL_ARRAY, ast::VOID, {ARRAY_OR_ELEMENT}}},
+    {"array_sort", {ast::ARRAY_SORT, ast::ARRAY_SORT, ast::VOID, {}}},
+    {"array_search", {ast::ARRAY_SEARCH, ast::ARRAY_SEARCH, ast::LONG, {ELEMENT}}},
+};
+
 const std::set<TokenType> TYPES = {
-    TOKEN_BOOL, TOKEN_CHAR, TOKEN_INT, TOKEN_LONG
+    TOKEN_BOOL, TOKEN_CHAR, TOKEN_INT, TOKEN_LONG, TOKEN_DOUBLE, TOKEN_STRING_TYPE
+};
+
+const std::set<TokenType> ASSIGNS = {
+    TOKEN_EQUAL, TOKEN_PLUS_EQUAL, TOKEN_MINUS_EQUAL, TOKEN_STAR_EQUAL, TOKEN_SLASH_EQUAL, TOKEN_MOD_EQUAL,
+    TOKEN_XOR_EQUAL, TOKEN_AMPERSAND_EQUAL, TOKEN_PIPE_EQUAL, TOKEN_PLUS_PLUS, TOKEN_MINUS_MINUS
 };
 
 const std::set<TokenType> RETURN_TYPES = {
-    TOKEN_BOOL, TOKEN_CHAR, TOKEN_INT, TOKEN_LONG, TOKEN_VOID
+    TOKEN_BOOL, TOKEN_CHAR, TOKEN_INT, TOKEN_LONG, TOKEN_DOUBLE, TOKEN_STRING_TYPE, TOKEN_VOID
 };
 
 const std::map<TokenType, std::string> TYPE_NAME = {
@@ -52,6 +141,8 @@ const std::map<TokenType, std::string> TYPE_NAME = {
     {TOKEN_CHAR, "char"},
     {TOKEN_INT, "int"},
     {TOKEN_LONG, "long"},
+    {TOKEN_DOUBLE, "double"},
+    {TOKEN_STRING_TYPE, "string"},
     {TOKEN_VOID, "void"},
 };
 
@@ -60,6 +151,13 @@ const std::map<cinterface::ArgType, std::string> C_TYPE_NAME = {
     {cinterface::CHAR, "char"},
     {cinterface::INT, "int"},
     {cinterface::LONG, "long"},
+    {cinterface::DOUBLE, "double"},
+    {cinterface::CHAR_ARRAY, "char[]"},
+    {cinterface::INT_ARRAY, "int[]"},
+    {cinterface::LONG_ARRAY, "long[]"},
+    {cinterface::CONST_CHAR_ARRAY, "char[]"},
+    {cinterface::CONST_INT_ARRAY, "int[]"},
+    {cinterface::CONST_LONG_ARRAY, "long[]"},
 };
 
 const std::map<ast::AstVarType, std::string> AST_TYPE_NAME = {
@@ -67,7 +165,13 @@ const std::map<ast::AstVarType, std::string> AST_TYPE_NAME = {
     {ast::CHAR, "char"},
     {ast::INT, "int"},
     {ast::LONG, "long"},
+    {ast::DOUBLE, "double"},
+    {ast::STRING, "string"},
     {ast::VOID, "void"},
+    {ast::CHAR_ARRAY, "char[]"},
+    {ast::INT_ARRAY, "int[]"},
+    {ast::LONG_ARRAY, "long[]"},
+    {ast::STRUCT, "struct"},
 };
 
 const std::map<cinterface::ArgType, ast::AstVarType> C_TYPE_TO_AST_TYPE = {
@@ -75,10 +179,35 @@ const std::map<cinterface::ArgType, ast::AstVarType> C_TYPE_TO_AST_TYPE = {
     {cinterface::CHAR, ast::CHAR},
     {cinterface::INT, ast::INT},
     {cinterface::LONG, ast::LONG},
+    {cinterface::DOUBLE, ast::DOUBLE},
+    {cinterface::CHAR_ARRAY, ast::CHAR_ARRAY},
+    {cinterface::INT_ARRAY, ast::INT_ARRAY},
+    {cinterface::LONG_ARRAY, ast::LONG_ARRAY},
+    {cinterface::CONST_CHAR_ARRAY, ast::CHAR_ARRAY},
+    {cinterface::CONST_INT_ARRAY, ast::INT_ARRAY},
+    {cinterface::CONST_LONG_ARRAY, ast::LONG_ARRAY},
 };
 
+bool is_array(const ast::AstVarType& type) {
+    return type == ast::CHAR_ARRAY || type == ast::INT_ARRAY || type == ast::LONG_ARRAY;
+}
+
 typedef std::map<std::string, std::shared_ptr<VariableNode>> Identifiers;
 
+typedef struct {
+    // from the first value of the struct
+    Address offset;
+    ast::AstVarType type;
+    // struct of the fields that are structs
+    std::string struct_name;
+} Field;
+
+// Structs are flat: the values of their fields, the ones of nested structs included, follow each other.
+typedef struct {
+    std::map<std::string, Field> fields;
+    std::vector<ast::AstVarType> values;
+} Struct;
+
 typedef struct {
     std::map<std::shared_ptr<AbstractSyntaxTree>, Identifiers> identifiers;
     std::vector<std::shared_ptr<AbstractSyntaxTree>> scope_stack;
@@ -90,7 +219,12 @@ typedef struct {
     std::map<std::shared_ptr<AbstractSyntaxTree>, Frame> frames;
     std::stack<std::shared_ptr<AbstractSyntaxTree>> frame_stack;
     std::map<std::string, std::shared_ptr<FunctionNode>> functions;
+    std::map<std::string, Struct> structs;
+    // struct of the variables and functions giving structs
+    std::map<const AbstractSyntaxTree*, std::string> struct_names;
+    std::shared_ptr<ModuleNode> module;
     CFunctions c_functions;
+    std::string directory;
 } Parser;
 
 std::shared_ptr<AbstractSyntaxTree> expression(Parser& parser, const TokenType& expected_type);
@@ -100,24 +234,83 @@ std::shared_ptr<AbstractSyntaxTree> assign_statement(Parser& parser, const Token
 std::shared_ptr<AbstractSyntaxTree> assign_expression(Parser& parser);
 std::shared_ptr<AbstractSyntaxTree> call_statement(Parser& parser, const Token& id, const TokenType& expected_type, const bool& expect_semicolon = true);
 bool match_assign(Parser& parser);
+bool match_index_assign(Parser& parser);
+bool match_field_assign(Parser& parser);
+std::shared_ptr<AbstractSyntaxTree> field_assign_statement(Parser& parser, const Token& id, const bool& expect_semicolon);
+std::shared_ptr<AbstractSyntaxTree> index_assign_statement(Parser& parser, const Token& id, const bool& expect_semicolon = true);
 
 void print_error(const Parser& parser, const std::string& message);
 std::shared_ptr<BlockNode> block(Parser& parser);
 
-std::shared_ptr<LiteralNode> literal(const std::string& value, const TokenType& type) {
+bool is_double_literal(const std::string& value) {
+    return value.find_first_of(".eE") != std::string::npos;
+}
+
+// Integers and doubles are stored in the constant pool, booleans and chars are smaller inline.
+// Literals with a fraction or an exponent are doubles, where integers are not expected.
+std::shared_ptr<AbstractSyntaxTree> literal(Parser& parser, const std::string& value, const TokenType& type) {
+    ConstantPool& pool = parser.module->get_constant_pool();
+    if (type == TOKEN_DOUBLE || (type == TOKEN_BANG && is_double_literal(value))) {
+        return std::shared_ptr<ConstantNode>(new ConstantNode(pool.add(var::create_double(stod(value)))));
+    }
+    // doubles are cast where integers are expected, like the other values
+    if ((type == TOKEN_CHAR || type == TOKEN_INT || type == TOKEN_LONG) && is_double_literal(value)) {
+        return std::shared_ptr<ConvertNode>(new ConvertNode(literal(parser, value, TOKEN_DOUBLE), TOKEN_TO_AST.at(type)));
+    }
+    if (type != TOKEN_BOOL && is_double_literal(value)) {
+        print_error(parser, "Expected an integer but got '" + value + "'.");
+        exit(1);
+    }
     switch (type) {
         case TOKEN_BOOL:
             return std::shared_ptr<LiteralNode>(new LiteralNode(var::create_bool(value == "true")));
         case TOKEN_CHAR:
             return std::shared_ptr<LiteralNode>(new LiteralNode(var::create_char(stoi(value))));
         case TOKEN_INT:
-            return std::shared_ptr<LiteralNode>(new LiteralNode(var::create_int(stoi(value))));
+            return std::shared_ptr<ConstantNode>(new ConstantNode(pool.add(var::create_int(stoi(value)))));
         case TOKEN_LONG:
         default:
-            return std::shared_ptr<LiteralNode>(new LiteralNode(var::create_long(stol(value))));
+            return std::shared_ptr<ConstantNode>(new ConstantNode(pool.add(var::create_long(stol(value)))));
+    }
+}
+
+std::string unescape(const std::string& str);
+
+// Strings are values of their own type, they are never converted.
+void expect_string(const Parser& parser, const TokenType& expected_type) {
+    if (expected_type != TOKEN_BANG && expected_type != TOKEN_STRING_TYPE) {
+        print_error(parser, "Expected " + TYPE_NAME.at(expected_type) + " but got a string.");
+        exit(1);
     }
 }
 
+std::shared_ptr<AbstractSyntaxTree> string_literal(Parser& parser, const std::string& value, const TokenType& expected_type) {
+    expect_string(parser, expected_type);
+    return std::shared_ptr<StringNode>(new StringNode(parser.module->get_constant_pool().add(unescape(value))));
+}
+
+std::string unescape(const std::string& str) {
+    std::string result;
+    for (size_t i = 0; i < str.size(); i++) {
+        if (str[i] != '\\' || i + 1 == str.size()) {
+            result += str[i];
+            continue;
+        }
+        switch (str[++i]) {
+            case 'n':
+                result += '\n';
+                break;
+            case 't':
+                result += '\t';
+                break;
+            default:
+                result += str[i];
+                break;
+        }
+    }
+    return result;
+}
+
 bool eof(const Parser& parser) {
     return parser.current == parser.tokens.size();
 }
@@ -218,7 +411,8 @@ void pop_scope(Parser& parser) {
     frame.scope_stack.pop_back();
 }
 
-std::shared_ptr<VariableNode> get_variable_by_name(const Parser& parser, const std::string& name) {
+// Null when no variable has the name in the current scope, functions see the globals after their own variables.
+std::shared_ptr<VariableNode> find_variable(const Parser& parser, const std::string& name) {
     const Frame& frame = parser.frames.at(current_frame(parser));
     for (const auto& scope : frame.scope_stack) {
         const auto& mapping = frame.identifiers.at(scope);
@@ -226,14 +420,33 @@ std::shared_ptr<VariableNode> get_variable_by_name(const Parser& parser, const s
             return mapping.at(name);
         }
     }
-    print_error(parser, "Could not find '" + name + "' in current scope.");
-    exit(1);
+    if (current_frame(parser) != parser.module) {
+        const auto& globals = parser.frames.at(parser.module).identifiers.at(parser.module);
+        const auto it = globals.find(name);
+        if (it != globals.end() && it->second->is_global()) {
+            return it->second;
+        }
+    }
+    return nullptr;
+}
+
+// Variables of the outermost scope of the top-level code are globals.
+bool is_global_scope(const Parser& parser) {
+    return current_frame(parser) == parser.module && parser.frames.at(parser.module).scope_stack.size() == 1;
+}
+
+std::shared_ptr<VariableNode> get_variable_by_name(const Parser& parser, const std::string& name) {
+    std::shared_ptr<VariableNode> variable = find_variable(parser, name);
+    if (variable == nullptr) {
+        print_error(parser, "Could not find '" + name + "' in current scope.");
+        exit(1);
+    }
+    return variable;
 }
 
-std::shared_ptr<VariableNode> new_variable(Parser& parser, const TokenType& type, const std::string& name) {
+void add_variable(Parser& parser, const std::string& name, const std::shared_ptr<VariableNode>& variable) {
     std::shared_ptr<AbstractSyntaxTree> frame = current_frame(parser);
     std::shared_ptr<AbstractSyntaxTree> scope = current_scope(parser);
-    std::shared_ptr<VariableNode> variable(new VariableNode(frame, TOKEN_TO_AST.at(type)));
     const Frame& fr = parser.frames.at(frame);
     for (const auto& scope : fr.scope_stack) {
         const auto& mapping = fr.identifiers.at(scope);
@@ -243,6 +456,58 @@ std::shared_ptr<VariableNode> new_variable(Parser& parser, const TokenType& type
         }
     }
     parser.frames[frame].identifiers[scope][name] = variable;
+}
+
+std::shared_ptr<VariableNode> new_variable(
+    Parser& parser,
+    const ast::AstVarType& type,
+    const std::string& name,
+    const uint32_t& length = 0,
+    const bool& has_elements = false
+) {
+    std::shared_ptr<VariableNode> variable(new VariableNode(current_frame(parser), type, length, has_elements));
+    add_variable(parser, name, variable);
+    return variable;
+}
+
+bool is_struct(const Parser& parser, const std::string& name) {
+    return parser.structs.find(name) != parser.structs.end();
+}
+
+const Struct& get_struct(const Parser& parser, const std::string& name) {
+    if (!is_struct(parser, name)) {
+        print_error(parser, "Unknown type '" + name + "'.");
+        exit(1);
+    }
+    return parser.structs.at(name);
+}
+
+std::shared_ptr<VariableNode> new_struct_variable(Parser& parser, const std::string& struct_name, const std::string& name) {
+    std::shared_ptr<VariableNode> variable(new VariableNode(current_frame(parser), get_struct(parser, struct_name).values));
+    add_variable(parser, name, variable);
+    parser.struct_names[variable.get()] = struct_name;
+    return variable;
+}
+
+// Field named after the '.' following a struct, fields of nested structs are read at their offset too.
+std::shared_ptr<VariableNode> field(Parser& parser, std::shared_ptr<VariableNode> variable) {
+    do {
+        Token id = consume(parser, TOKEN_IDENTIFIER, "Expected field name after '.'.");
+        const std::string& struct_name = parser.struct_names.at(variable.get());
+        const Struct& structure = get_struct(parser, struct_name);
+        const auto it = structure.fields.find(id.value);
+        if (it == structure.fields.end()) {
+            print_error(parser, "Struct '" + struct_name + "' has no field '" + id.value + "'.");
+            exit(1);
+        }
+        const Field& found = it->second;
+        if (found.type == ast::STRUCT) {
+            variable = std::shared_ptr<VariableNode>(new VariableNode(variable, found.offset, ast::STRUCT, get_struct(parser, found.struct_name).values));
+            parser.struct_names[variable.get()] = found.struct_name;
+        } else {
+            variable = std::shared_ptr<VariableNode>(new VariableNode(variable, found.offset, found.type));
+        }
+    } while (variable->get_type() == ast::STRUCT && match(parser, {TOKEN_DOT}));
     return variable;
 }
 
@@ -252,6 +517,11 @@ void register_function(Parser& parser, const std::shared_ptr<FunctionNode>& fun,
         exit(1);
     }
     parser.functions[name] = fun;
+    if (name == MAIN) {
+        parser.module->set_main(fun);
+    } else if (!fun->is_external()) {
+        parser.module->add_function(fun);
+    }
 }
 
 std::shared_ptr<FunctionNode> get_function(const Parser& parser, const std::string& name) {
@@ -262,21 +532,93 @@ std::shared_ptr<FunctionNode> get_function(const Parser& parser, const std::stri
     return parser.functions.at(name);
 }
 
+// Fields of the struct returned by a call are read from a struct of the frame the call is stored into.
+std::shared_ptr<AbstractSyntaxTree> returned_field(Parser& parser, const Token& id, const TokenType& expected_type) {
+    std::shared_ptr<FunctionNode> function = get_function(parser, id.value);
+    std::shared_ptr<AbstractSyntaxTree> call = call_statement(parser, id, TOKEN_BANG, /* expect_semicolon */ false);
+    const auto struct_name = parser.struct_names.find(function.get());
+    if (!match(parser, {TOKEN_DOT}) || struct_name == parser.struct_names.end()) {
+        print_error(parser, "Structs can only be assigned, passed to functions and returned.");
+        exit(1);
+    }
+    std::shared_ptr<VariableNode> returned(new VariableNode(current_frame(parser), function->get_return_types()));
+    parser.struct_names[returned.get()] = struct_name->second;
+    std::shared_ptr<VariableNode> member = field(parser, returned);
+    if (member->get_type() == ast::STRUCT) {
+        print_error(parser, "Structs can only be assigned, passed to functions and returned.");
+        exit(1);
+    }
+    std::shared_ptr<ReturnedFieldNode> value(new ReturnedFieldNode(std::shared_ptr<AssignNode>(new AssignNode(returned, call)), member));
+    if (member->get_type() == ast::STRING) {
+        expect_string(parser, expected_type);
+        return value;
+    }
+    if (expected_type != TOKEN_BANG && expected_type != AST_TO_TOKEN.at(member->get_type())) {
+        return std::shared_ptr<ConvertNode>(new ConvertNode(value, TOKEN_TO_AST.at(expected_type)));
+    }
+    return value;
+}
+
 std::shared_ptr<AbstractSyntaxTree> primary_expression(Parser& parser, const TokenType& expected_type) {
     if (match(parser, {TOKEN_TRUE, TOKEN_FALSE})) {
         Token token = previous(parser);
-        return literal(token.value, TOKEN_BOOL);
+        return literal(parser, token.value, TOKEN_BOOL);
     }
-    if (match(parser, {TOKEN_NUMBER, TOKEN_STRING})) {
+    if (match(parser, {TOKEN_NUMBER})) {
         Token token = previous(parser);
-        return literal(token.value, expected_type);
+        return literal(parser, token.value, expected_type);
+    }
+    if (match(parser, {TOKEN_STRING})) {
+        return string_literal(parser, previous(parser).value, expected_type);
     }
     if (match(parser, {TOKEN_IDENTIFIER})) {
         if (match(parser, {TOKEN_LEFT_PAREN})) {
+            const std::string& name = previous(parser, 2).value;
+            const auto builtin = BUILTINS.find(name);
+            if (builtin != BUILTINS.end() && is_array(builtin->second.return_type)) {
+                print_error(parser, "Arrays can only be passed to functions.");
+                exit(1);
+            }
+            if (builtin == BUILTINS.end() && ARRAY_BUILTINS.find(name) == ARRAY_BUILTINS.end() && get_function(parser, name)->get_return_type() == ast::STRUCT) {
+                return returned_field(parser, previous(parser, 2), expected_type);
+            }
             return call_statement(parser, previous(parser, 2), expected_type, /* expect_semicolon */ false);
         }
         Token token = previous(parser);
         auto variable = get_variable_by_name(parser, token.value);
+        if (variable->get_type() == ast::STRUCT && match(parser, {TOKEN_DOT})) {
+            variable = field(parser, variable);
+        }
+        if (variable->get_type() == ast::STRUCT) {
+            print_error(parser, "Structs can only be assigned, passed to functions and returned.");
+            exit(1);
+        }
+        if (is_array(variable->get_type()) && match(parser, {TOKEN_LEFT_BRACKET})) {
+            std::shared_ptr<AbstractSyntaxTree> index = expression(parser, TOKEN_LONG);
+            consume(parser, TOKEN_RIGHT_BRACKET, "Expected ']' after index.");
+            std::shared_ptr<IndexNode> element(new IndexNode(variable, index));
+            if (expected_type != TOKEN_BANG && expected_type != ELEMENT_OF.at(variable->get_type())) {
+                return std::shared_ptr<ConvertNode>(new ConvertNode(element, TOKEN_TO_AST.at(expected_type)));
+            }
+            return element;
+        }
+        if (is_array(variable->get_type())) {
+            print_error(parser, "Arrays can only be passed to functions.");
+            exit(1);
+        }
+        if (variable->get_type() == ast::STRING && match(parser, {TOKEN_LEFT_BRACKET})) {
+            std::shared_ptr<AbstractSyntaxTree> index = expression(parser, TOKEN_LONG);
+            consume(parser, TOKEN_RIGHT_BRACKET, "Expected ']' after index.");
+            std::shared_ptr<BuiltinNode> character(new BuiltinNode(ast::STRING_INDEX, {variable, index}));
+            if (expected_type != TOKEN_BANG && expected_type != TOKEN_CHAR) {
+                return std::shared_ptr<ConvertNode>(new ConvertNode(character, TOKEN_TO_AST.at(expected_type)));
+            }
+            return character;
+        }
+        if (variable->get_type() == ast::STRING) {
+            expect_string(parser, expected_type);
+            return variable;
+        }
         if (expected_type != TOKEN_BANG && expected_type != AST_TO_TOKEN.at(variable->get_type())) {
             return std::shared_ptr<ConvertNode>(new ConvertNode(variable, TOKEN_TO_AST.at(expected_type)));
         }
@@ -291,15 +633,98 @@ std::shared_ptr<AbstractSyntaxTree> primary_expression(Parser& parser, const Tok
     exit(1);
 }
 
+// Type of the value of an expression when it is known while parsing, void otherwise.
+ast::AstVarType value_type(const Parser& parser, const std::shared_ptr<AbstractSyntaxTree>& node) {
+    if (const auto literal = std::dynamic_pointer_cast<LiteralNode>(node)) {
+        return VAR_TO_AST.at(literal->get_value().type);
+    }
+    if (const auto constant = std::dynamic_pointer_cast<ConstantNode>(node)) {
+        return VAR_TO_AST.at(parser.module->get_constant_pool().get_constants()[constant->get_index()].type);
+    }
+    if (const auto variable = std::dynamic_pointer_cast<VariableNode>(node)) {
+        return variable->get_type();
+    }
+    if (const auto element = std::dynamic_pointer_cast<IndexNode>(node)) {
+        return ELEMENT_OF.find(element->get_node()->get_type()) == ELEMENT_OF.end() ? ast::VOID : TOKEN_TO_AST.at(ELEMENT_OF.at(element->get_node()->get_type()));
+    }
+    if (const auto convert = std::dynamic_pointer_cast<ConvertNode>(node)) {
+        return convert->get_type();
+    }
+    if (const auto returned = std::dynamic_pointer_cast<ReturnedFieldNode>(node)) {
+        return returned->get_field()->get_type();
+    }
+    if (const auto call = std::dynamic_pointer_cast<CallNode>(node)) {
+        return call->get_function()->get_return_type();
+    }
+    if (const auto builtin = std::dynamic_pointer_cast<BuiltinNode>(node)) {
+        if (builtin->get_builtin() == ast::STRING_INDEX) {
+            return ast::CHAR;
+        }
+        for (const auto& [name, found] : BUILTINS) {
+            if (found.builtin == builtin->get_builtin()) {
+                return found.return_type;
+            }
+        }
+        return ast::VOID;
+    }
+    if (const auto negation = std::dynamic_pointer_cast<BooleanNotNode>(node)) {
+        ast::AstVarType type = value_type(parser, negation->get_expression());
+        return type == ast::DOUBLE ? ast::BOOL : type;
+    }
+    if (const auto negation = std::dynamic_pointer_cast<BinaryNotNode>(node)) {
+        return value_type(parser, negation->get_expression());
+    }
+    if (const auto operation = std::dynamic_pointer_cast<BinaryOperationNode>(node)) {
+        if (operation->get_operation() >= ast::LT) {
+            return ast::BOOL;
+        }
+        ast::AstVarType left = value_type(parser, operation->get_left());
+        ast::AstVarType right = value_type(parser, operation->get_right());
+        if (left == ast::VOID || right == ast::VOID) {
+            return ast::VOID;
+        }
+        if (left == ast::DOUBLE || right == ast::DOUBLE) {
+            return ast::DOUBLE;
+        }
+        // like the arithmetic on integers of the VM, a bool operand gives a bool
+        if (left == ast::BOOL || right == ast::BOOL) {
+            return ast::BOOL;
+        }
+        return std::max(left, right);
+    }
+    return ast::VOID;
+}
+
+// Doubles only have the operations of the arithmetic, not the ones on bits or the modulo.
+void expect_integers(const Parser& parser, const Token& op, const std::vector<std::shared_ptr<AbstractSyntaxTree>>& operands) {
+    for (const auto& operand : operands) {
+        if (value_type(parser, operand) == ast::DOUBLE) {
+            print_error(parser, "Operator '" + op.value + "' can't be applied to a double.");
+            exit(1);
+        }
+    }
+}
+
 std::shared_ptr<AbstractSyntaxTree> unary_expression(Parser& parser, const TokenType& expected_type) {
     if (match(parser, {TOKEN_MINUS})) {
-        return std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(literal("0", expected_type), unary_expression(parser, expected_type), ast::SUB));
+        // negative literals are constants, and keep the sign of -0.0
+        if (match(parser, {TOKEN_NUMBER})) {
+            return literal(parser, "-" + previous(parser).value, expected_type);
+        }
+        std::shared_ptr<AbstractSyntaxTree> operand = unary_expression(parser, expected_type);
+        if (value_type(parser, operand) == ast::DOUBLE) {
+            return std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(literal(parser, "-1", TOKEN_DOUBLE), operand, ast::MUL));
+        }
+        return std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(literal(parser, "0", expected_type), operand, ast::SUB));
     }
     if (match(parser, {TOKEN_BANG})) {
         return std::shared_ptr<BooleanNotNode>(new BooleanNotNode(unary_expression(parser, expected_type)));
     }
     if (match(parser, {TOKEN_TILDE})) {
-        return std::shared_ptr<BinaryNotNode>(new BinaryNotNode(unary_expression(parser, expected_type)));
+        Token op = previous(parser);
+        std::shared_ptr<AbstractSyntaxTree> operand = unary_expression(parser, expected_type);
+        expect_integers(parser, op, {operand});
+        return std::shared_ptr<BinaryNotNode>(new BinaryNotNode(operand));
     }
     return primary_expression(parser, expected_type);
 }
@@ -318,15 +743,19 @@ std::shared_ptr<AbstractSyntaxTree> binary_expression(
     }
     std::shared_ptr<AbstractSyntaxTree> left = binary_expression(parser, types, expected_type, index + 1);
     while (match(parser, types.at(index))) {
-        ast::AstBinaryOperation op = BIN_OP.at(previous(parser).type);
+        Token token = previous(parser);
+        ast::AstBinaryOperation op = BIN_OP.at(token.type);
         std::shared_ptr<AbstractSyntaxTree> right = binary_expression(parser, types, expected_type, index + 1);
+        if (op == ast::MOD || op == ast::XOR || op == ast::BIN_AND || op == ast::BIN_OR) {
+            expect_integers(parser, token, {left, right});
+        }
         left = std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(left, right, op));
     }
     return left;
 }
 
 std::shared_ptr<AbstractSyntaxTree> expression(Parser& parser, const TokenType& expected_type) {
-    return binary_expression(
+    std::shared_ptr<AbstractSyntaxTree> exp = binary_expression(
         parser,
         {
             // binary operators to be parsed in order of priority
@@ -338,18 +767,174 @@ std::shared_ptr<AbstractSyntaxTree> expression(Parser& parser, const TokenType&
         },
         expected_type
     );
+    // conditions and bools are true or false, the other values are true when they are not zero
+    if (expected_type == TOKEN_BOOL && value_type(parser, exp) != ast::BOOL) {
+        return std::shared_ptr<ConvertNode>(new ConvertNode(exp, ast::BOOL));
+    }
+    return exp;
 }
 
 std::shared_ptr<AbstractSyntaxTree> print_statement(Parser& parser) {
-    return std::shared_ptr<PrintNode>(new PrintNode(expression_statement(parser, TOKEN_BANG)));
+    ConstantPool& pool = parser.module->get_constant_pool();
+    // string literals printed alone are written with a new line, without being made values
+    if (match_sequence(parser, {{TOKEN_STRING}, {TOKEN_SEMICOLON}})) {
+        parser.current--;
+        std::string str = unescape(previous(parser).value);
+        consume(parser, TOKEN_SEMICOLON, "Expected ';' after string.");
+        return std::shared_ptr<PrintStringNode>(new PrintStringNode(pool.add(str + "\n")));
+    }
+    std::shared_ptr<AbstractSyntaxTree> exp = expression_statement(parser, TOKEN_BANG);
+    return std::shared_ptr<PrintNode>(new PrintNode(exp, std::shared_ptr<PrintStringNode>(new PrintStringNode(pool.add("\n")))));
+}
+
+// Number of elements of an array, whose elements must fit in a slice.
+uint32_t array_length(const Parser& parser, const Token& type, const Token& length) {
+    if (ARRAY_OF.find(type.type) == ARRAY_OF.end()) {
+        print_error(parser, "Arrays hold chars, ints or longs.");
+        exit(1);
+    }
+    uint64_t elements = stoul(length.value);
+    if (elements == 0 || elements > UINT32_MAX / ast::element_size(ARRAY_OF.at(type.type))) {
+        print_error(parser, "Invalid array length: " + length.value + ".");
+        exit(1);
+    }
+    return elements;
+}
+
+// Arrays are declared without a value, their elements start at zero.
+std::shared_ptr<AbstractSyntaxTree> array_statement(Parser& parser, const Token& type, const Token& length, const Token& id) {
+    uint32_t elements = array_length(parser, type, length);
+    consume(parser, TOKEN_SEMICOLON, "Expected ';' after array declaration.");
+    return std::shared_ptr<ArrayNode>(new ArrayNode(new_variable(parser, ARRAY_OF.at(type.type), id.value, elements, true)));
+}
+
+// Globals initialized with a literal start with its value in the data section, without code.
+std::shared_ptr<AbstractSyntaxTree> global_statement(Parser& parser, const Token& type, const Token& id) {
+    ast::AstVarType var_type = TOKEN_TO_AST.at(type.type);
+    Var value = var_type == ast::STRING ? var::create_string("", 0) : var::convert(var::create_long(0), ast::var_type(var_type));
+    std::shared_ptr<VariableNode> variable(new VariableNode(parser.module->add_global(value), var_type));
+    add_variable(parser, id.value, variable);
+    std::shared_ptr<AbstractSyntaxTree> exp = expression_statement(parser, type.type);
+    if (const auto literal = std::dynamic_pointer_cast<LiteralNode>(exp)) {
+        parser.module->set_global(variable->get_address(), literal->get_value());
+        return std::shared_ptr<BlockNode>(new BlockNode());
+    }
+    if (const auto constant = std::dynamic_pointer_cast<ConstantNode>(exp)) {
+        parser.module->set_global(variable->get_address(), parser.module->get_constant_pool().get_constants()[constant->get_index()]);
+        return std::shared_ptr<BlockNode>(new BlockNode());
+    }
+    return std::shared_ptr<AssignNode>(new AssignNode(variable, exp));
 }
 
 std::shared_ptr<AbstractSyntaxTree> var_statement(Parser& parser, const Token& type, const Token& id) {
-    std::shared_ptr<VariableNode> variable = new_variable(parser, type.type, id.value);
+    if (is_global_scope(parser)) {
+        return global_statement(parser, type, id);
+    }
+    std::shared_ptr<VariableNode> variable = new_variable(parser, TOKEN_TO_AST.at(type.type), id.value);
     std::shared_ptr<AbstractSyntaxTree> exp = expression_statement(parser, type.type);
     return std::shared_ptr<AssignNode>(new AssignNode(variable, exp));
 }
 
+// Values of a struct: a struct or a field holding one, or the call of a function giving one.
+std::shared_ptr<AbstractSyntaxTree> struct_expression(Parser& parser, const std::string& struct_name) {
+    Token id = consume(parser, TOKEN_IDENTIFIER, "Expected a '" + struct_name + "'.");
+    std::shared_ptr<AbstractSyntaxTree> value;
+    const AbstractSyntaxTree* node = nullptr;
+    if (match(parser, {TOKEN_LEFT_PAREN})) {
+        if (BUILTINS.find(id.value) == BUILTINS.end() && ARRAY_BUILTINS.find(id.value) == ARRAY_BUILTINS.end()) {
+            node = get_function(parser, id.value).get();
+        }
+        value = call_statement(parser, id, TOKEN_BANG, /* expect_semicolon */ false);
+    } else {
+        std::shared_ptr<VariableNode> variable = get_variable_by_name(parser, id.value);
+        if (variable->get_type() == ast::STRUCT && match(parser, {TOKEN_DOT})) {
+            variable = field(parser, variable);
+        }
+        node = variable.get();
+        value = variable;
+    }
+    const auto it = parser.struct_names.find(node);
+    if (it == parser.struct_names.end() || it->second != struct_name) {
+        print_error(parser, "Expected a '" + struct_name + "'.");
+        exit(1);
+    }
+    return value;
+}
+
+// Strings are made by the VM, the empty one is in the constant pool.
+std::shared_ptr<AbstractSyntaxTree> zero(Parser& parser, const ast::AstVarType& type) {
+    switch (type) {
+        case ast::BOOL:
+            return std::shared_ptr<LiteralNode>(new LiteralNode(var::create_bool(false)));
+        case ast::CHAR:
+            return std::shared_ptr<LiteralNode>(new LiteralNode(var::create_char(0)));
+        case ast::INT:
+            return std::shared_ptr<LiteralNode>(new LiteralNode(var::create_int(0)));
+        case ast::DOUBLE:
+            return std::shared_ptr<LiteralNode>(new LiteralNode(var::create_double(0)));
+        case ast::STRING:
+            return std::shared_ptr<StringNode>(new StringNode(parser.module->get_constant_pool().add("")));
+        default:
+            return std::shared_ptr<LiteralNode>(new LiteralNode(var::create_long(0)));
+    }
+}
+
+// Structs declared without a value start with zeros and empty strings.
+std::shared_ptr<AbstractSyntaxTree> struct_var_statement(Parser& parser, const Token& type, const Token& id) {
+    std::shared_ptr<VariableNode> variable = new_struct_variable(parser, type.value, id.value);
+    std::shared_ptr<AbstractSyntaxTree> value;
+    if (match(parser, {TOKEN_EQUAL})) {
+        value = struct_expression(parser, type.value);
+    } else {
+        std::shared_ptr<BlockNode> zeros(new BlockNode());
+        for (const auto& field_type : variable->get_fields()) {
+            zeros->add(zero(parser, field_type));
+        }
+        value = zeros;
+    }
+    consume(parser, TOKEN_SEMICOLON, "Expected ';' after struct declaration.");
+    return std::shared_ptr<AssignNode>(new AssignNode(variable, value));
+}
+
+// Fields hold values or structs declared before, arrays are only locals.
+std::shared_ptr<AbstractSyntaxTree> struct_statement(Parser& parser) {
+    Token name = consume(parser, TOKEN_IDENTIFIER, "Expected struct name after 'struct'.");
+    if (is_struct(parser, name.value)) {
+        print_error(parser, "Struct '" + name.value + "' already declared.");
+        exit(1);
+    }
+    consume(parser, TOKEN_LEFT_BRACE, "Expected '{' after struct name.");
+    Struct structure;
+    while (!check(parser, TOKEN_RIGHT_BRACE)) {
+        Field member = {structure.values.size(), ast::STRUCT, ""};
+        if (match_sequence(parser, {TYPES, {TOKEN_IDENTIFIER}})) {
+            member.type = TOKEN_TO_AST.at(previous(parser, 2).type);
+            structure.values.push_back(member.type);
+        } else if (match_sequence(parser, {{TOKEN_IDENTIFIER}, {TOKEN_IDENTIFIER}})) {
+            member.struct_name = previous(parser, 2).value;
+            const auto& values = get_struct(parser, member.struct_name).values;
+            structure.values.insert(structure.values.end(), values.begin(), values.end());
+        } else {
+            print_error(parser, "Expected a field declaration in struct '" + name.value + "'.");
+            exit(1);
+        }
+        Token id = previous(parser);
+        if (structure.fields.find(id.value) != structure.fields.end()) {
+            print_error(parser, "Field '" + id.value + "' already declared in struct '" + name.value + "'.");
+            exit(1);
+        }
+        structure.fields[id.value] = member;
+        consume(parser, TOKEN_SEMICOLON, "Expected ';' after field declaration.");
+    }
+    if (structure.values.empty() || structure.values.size() > UINT8_MAX) {
+        print_error(parser, "Structs hold from 1 to " + std::to_string(UINT8_MAX) + " values.");
+        exit(1);
+    }
+    consume(parser, TOKEN_RIGHT_BRACE, "Expected '}' after struct fields.");
+    parser.structs[name.value] = structure;
+    return std::shared_ptr<BlockNode>(new BlockNode());
+}
+
 std::shared_ptr<AbstractSyntaxTree> if_statement(Parser& parser) {
     consume(parser, TOKEN_LEFT_PAREN, "Missing '(' after 'if'.");
     std::shared_ptr<AbstractSyntaxTree> condition = expression(parser, TOKEN_BOOL);
@@ -391,7 +976,27 @@ std::vector<std::shared_ptr<VariableNode>> fun_parameters(Parser& parser) {
             }
             Token var_type = previous(parser, 2);
             Token var_id = previous(parser);
-            parameters.push_back(new_variable(parser, var_type.type, var_id.value));
+            parameters.push_back(new_variable(parser, TOKEN_TO_AST.at(var_type.type), var_id.value));
+        } else if (
+            match_sequence(parser, {TYPES, {TOKEN_LEFT_BRACKET}, {TOKEN_RIGHT_BRACKET}, {TOKEN_IDENTIFIER}}) ||
+            match_sequence(parser, {TYPES, {TOKEN_LEFT_BRACKET}, {TOKEN_NUMBER}, {TOKEN_RIGHT_BRACKET}, {TOKEN_IDENTIFIER}})
+        ) {
+            bool sized = previous(parser, 3).type == TOKEN_NUMBER;
+            Token var_type = previous(parser, sized ? 5 : 4);
+            Token var_id = previous(parser);
+            if (previous_token != TOKEN_LEFT_PAREN && previous_token != TOKEN_COMMA) {
+                print_error(parser, "Unexpected token '" + previous(parser).value + "'.");
+                exit(1);
+            }
+            // parameters refer to the elements of the argument
+            uint32_t length = sized ? array_length(parser, var_type, previous(parser, 3)) : 0;
+            parameters.push_back(new_variable(parser, ARRAY_OF.at(var_type.type), var_id.value, length));
+        } else if (check(parser, TOKEN_IDENTIFIER) && is_struct(parser, peek(parser).value) && match_sequence(parser, {{TOKEN_IDENTIFIER}, {TOKEN_IDENTIFIER}})) {
+            if (previous_token != TOKEN_LEFT_PAREN && previous_token != TOKEN_COMMA) {
+                print_error(parser, "Unexpected token '" + previous(parser).value + "'.");
+                exit(1);
+            }
+            parameters.push_back(new_struct_variable(parser, previous(parser, 2).value, previous(parser).value));
         } else if (match(parser, {TOKEN_COMMA})) {
             if (previous_token != TOKEN_IDENTIFIER) {
                 print_error(parser, "Unexpected token '" + previous(parser).value + "'.");
@@ -409,15 +1014,28 @@ std::vector<std::shared_ptr<VariableNode>> fun_parameters(Parser& parser) {
         }
         previous_token = previous(parser).type;
     }
+    size_t values = 0;
+    for (const auto& parameter : parameters) {
+        values += parameter->get_type() == ast::STRUCT ? parameter->get_fields().size() : 1;
+    }
+    if (values > UINT8_MAX) {
+        print_error(parser, "Functions take at most " + std::to_string(UINT8_MAX) + " values.");
+        exit(1);
+    }
     return parameters;
 }
 
 std::shared_ptr<AbstractSyntaxTree> fun_statement(Parser& parser, const Token& type, const Token& id) {
-    std::shared_ptr<FunctionNode> fun_node(new FunctionNode(id.value == MAIN));
+    std::shared_ptr<FunctionNode> fun_node(new FunctionNode(id.value, id.value == MAIN));
     register_function(parser, fun_node, id.value);
     push_frame(parser, fun_node);
     push_scope(parser, fun_node);
-    fun_node->set_return_type(TOKEN_TO_AST.at(type.type));
+    if (type.type == TOKEN_IDENTIFIER) {
+        fun_node->set_return_type(ast::STRUCT, get_struct(parser, type.value).values);
+        parser.struct_names[fun_node.get()] = type.value;
+    } else {
+        fun_node->set_return_type(TOKEN_TO_AST.at(type.type));
+    }
     fun_node->set_parameters(fun_parameters(parser));
     fun_node->set_body(block(parser));
     pop_scope(parser);
@@ -430,6 +1048,11 @@ std::shared_ptr<AbstractSyntaxTree> return_statement(Parser& parser) {
         return std::shared_ptr<ReturnNode>(new ReturnNode());
     }
     FunctionNode* fun = (FunctionNode*) current_frame(parser).get();
+    if (fun->get_return_type() == ast::STRUCT) {
+        std::shared_ptr<AbstractSyntaxTree> value = struct_expression(parser, parser.struct_names.at(fun));
+        consume(parser, TOKEN_SEMICOLON, "Expected ';' after expression.");
+        return std::shared_ptr<ReturnNode>(new ReturnNode(value, fun->get_return_types().size()));
+    }
     TokenType type = AST_TO_TOKEN.at(fun->get_return_type());
     std::shared_ptr<AbstractSyntaxTree> exp = expression_statement(parser, type);
     return std::shared_ptr<ReturnNode>(new ReturnNode({exp}));
@@ -470,9 +1093,9 @@ void check_native_function(
     std::cout << ");";
 
     std::cout << std::endl << "But got this instead: " << AST_TYPE_NAME.at(node->get_return_type()) << " " << id << "(";
-    for (size_t i = 0; i < node->get_parameters_count(); i++) {
+    for (size_t i = 0; i < actual_types.size(); i++) {
         std::cout << AST_TYPE_NAME.at(actual_types.at(i)->get_type());
-        if (i + 1 < node->get_parameters_count()) {
+        if (i + 1 < actual_types.size()) {
             std::cout << ", ";
         }
     }
@@ -492,7 +1115,7 @@ std::shared_ptr<AbstractSyntaxTree> native_statement(Parser& parser) {
     Token return_type = previous(parser, 3);
     Token fun_id = previous(parser, 2);
 
-    std::shared_ptr<FunctionNode> fun_node(new FunctionNode());
+    std::shared_ptr<FunctionNode> fun_node(new FunctionNode(fun_id.value));
     register_function(parser, fun_node, fun_id.value);
     push_frame(parser, fun_node);
     push_scope(parser, fun_node);
@@ -503,7 +1126,15 @@ std::shared_ptr<AbstractSyntaxTree> native_statement(Parser& parser) {
     
     consume(parser, TOKEN_SEMICOLON, "Expected ';' after '@native' function signature.");
 
-    auto native_call_result = std::shared_ptr<NativeNode>(new NativeNode(fun_name.value, parameters));
+    const NativeFunction* native = parser.c_functions.find(fun_name.value);
+    if (native == nullptr) {
+        print_error(parser, "Could not find native function '" + fun_name.value + "'.");
+        exit(1);
+    }
+    parser.module->add_native({fun_name.value, native->library, native->return_type});
+    uint32_t index = parser.module->get_constant_pool().add(fun_name.value);
+    fun_node->set_native(index);
+    auto native_call_result = std::shared_ptr<NativeNode>(new NativeNode(index, parameters));
     fun_node->set_body(std::shared_ptr<ReturnNode>(new ReturnNode({native_call_result})));
 
     pop_scope(parser);
@@ -512,18 +1143,149 @@ std::shared_ptr<AbstractSyntaxTree> native_statement(Parser& parser) {
     return fun_node;
 }
 
+std::shared_ptr<AbstractSyntaxTree> import_statement(Parser& parser) {
+    Token path = consume(parser, TOKEN_STRING, "Expected module path after 'import'.");
+    consume(parser, TOKEN_SEMICOLON, "Expected ';' after 'import' statement.");
+    for (const auto& symbol : module::read(module::filename(module::resolve(parser.directory, path.value))).exports) {
+        std::shared_ptr<FunctionNode> fun_node(new FunctionNode(symbol.name));
+        fun_node->set_external(true);
+        // structs of other modules are their values
+        const auto& types = symbol.return_types;
+        fun_node->set_return_type(types.empty() ? ast::VOID : types.size() == 1 ? types[0] : ast::STRUCT, types);
+        std::vector<std::shared_ptr<VariableNode>> parameters;
+        for (const auto& type : symbol.parameter_types) {
+            parameters.push_back(std::shared_ptr<VariableNode>(new VariableNode(fun_node, type)));
+        }
+        fun_node->set_parameters(parameters);
+        register_function(parser, fun_node, symbol.name);
+    }
+    parser.module->add_import(path.value);
+    return std::shared_ptr<BlockNode>(new BlockNode());
+}
+
+// Arrays are passed as they are, by naming an array parameter or calling a builtin giving one.
+// The length of the parameter is 0 when it takes arrays of any length.
+std::shared_ptr<AbstractSyntaxTree> array_argument(Parser& parser, const ast::AstVarType& type, const uint32_t& length) {
+    Token id = consume(parser, TOKEN_IDENTIFIER, "Expected " + AST_TYPE_NAME.at(type) + " argument.");
+    if (match(parser, {TOKEN_LEFT_PAREN})) {
+        const auto builtin = BUILTINS.find(id.value);
+        // mapped files are bytes, their slices are read as arrays of any type
+        if (builtin == BUILTINS.end() || !is_array(builtin->second.return_type)) {
+            print_error(parser, "Expected " + AST_TYPE_NAME.at(type) + " argument.");
+            exit(1);
+        }
+        return call_statement(parser, id, TOKEN_BANG, /* expect_semicolon */ false);
+    }
+    auto variable = get_variable_by_name(parser, id.value);
+    if (variable->get_type() != type) {
+        print_error(parser, "Expected " + AST_TYPE_NAME.at(type) + " argument.");
+        exit(1);
+    }
+    if (length != 0 && variable->get_length() != 0 && length != variable->get_length()) {
+        print_error(parser, "Expected an array of " + std::to_string(length) + " elements.");
+        exit(1);
+    }
+    return variable;
+}
+
+// Arguments are arrays when they name an array, without indexing it, or call a builtin giving one.
+bool is_array_argument(const Parser& parser) {
+    if (!check(parser, TOKEN_IDENTIFIER) || parser.current + 1 >= parser.tokens.size()) {
+        return false;
+    }
+    const std::string& name = parser.tokens[parser.current].value;
+    const TokenType next = parser.tokens[parser.current + 1].type;
+    if (next == TOKEN_LEFT_PAREN) {
+        const auto builtin = BUILTINS.find(name);
+        return builtin != BUILTINS.end() && is_array(builtin->second.return_type);
+    }
+    std::shared_ptr<VariableNode> variable = find_variable(parser, name);
+    return next != TOKEN_LEFT_BRACKET && variable != nullptr && is_array(variable->get_type());
+}
+
+std::shared_ptr<AbstractSyntaxTree> array_builtin_statement(
+    Parser& parser,
+    const Token& id,
+    const ArrayBuiltin& builtin,
+    const TokenType& expected_type,
+    const bool& expect_semicolon
+) {
+    Token name = consume(parser, TOKEN_IDENTIFIER, "Expected array as first argument of '" + id.value + "'.");
+    std::shared_ptr<VariableNode> array = get_variable_by_name(parser, name.value);
+    if (!is_array(array->get_type())) {
+        print_error(parser, "Expected array as first argument of '" + id.value + "'.");
+        exit(1);
+    }
+    ast::AstArrayBuiltin compiled = builtin.builtin;
+    std::vector<std::shared_ptr<AbstractSyntaxTree>> values = {array};
+    for (const auto& parameter : builtin.parameter_types) {
+        consume(parser, TOKEN_COMMA, "Expected ',' after function parameter.");
+        if (parameter == ARRAY || (parameter == ARRAY_OR_ELEMENT && is_array_argument(parser))) {
+            values.push_back(array_argument(parser, array->get_type(), 0));
+            compiled = builtin.array_builtin;
+        } else {
+            values.push_back(expression(parser, ELEMENT_OF.at(array->get_type())));
+        }
+    }
+    consume(parser, TOKEN_RIGHT_PAREN, "Expected ')' after '" + id.value + "' parameters.");
+    if (expect_semicolon) {
+        consume(parser, TOKEN_SEMICOLON, "Expected ';' after function call.");
+    }
+    std::shared_ptr<ArrayBuiltinNode> node(new ArrayBuiltinNode(compiled, array->get_type(), values));
+    if (expected_type != TOKEN_BANG && builtin.return_type != TOKEN_TO_AST.at(expected_type)) {
+        return std::shared_ptr<ConvertNode>(new ConvertNode(node, TOKEN_TO_AST.at(expected_type)));
+    }
+    return node;
+}
+
 std::shared_ptr<AbstractSyntaxTree> call_statement(
     Parser& parser,
     const Token& id,
     const TokenType& expected_type,
     const bool& expect_semicolon
 ) {
+    const auto array_builtin = ARRAY_BUILTINS.find(id.value);
+    if (array_builtin != ARRAY_BUILTINS.end()) {
+        return array_builtin_statement(parser, id, array_builtin->second, expected_type, expect_semicolon);
+    }
+    const auto builtin = BUILTINS.find(id.value);
+    if (builtin != BUILTINS.end()) {
+        const auto& parameter_types = builtin->second.parameter_types;
+        std::vector<std::shared_ptr<AbstractSyntaxTree>> values;
+        uint32_t index = 0;
+        if (builtin->second.builtin == ast::MAP_FILE) {
+            Token path = consume(parser, TOKEN_STRING, "Expected file path as argument of 'map_file'.");
+            index = parser.module->get_constant_pool().add(unescape(path.value));
+        }
+        for (size_t i = 0; i < parameter_types.size(); i++) {
+            values.push_back(expression(parser, AST_TO_TOKEN.at(parameter_types[i])));
+            if (i != parameter_types.size() - 1) {
+                consume(parser, TOKEN_COMMA, "Expected ',' after function parameter.");
+            }
+        }
+        consume(parser, TOKEN_RIGHT_PAREN, "Expected ')' after '" + id.value + "' parameters.");
+        if (expect_semicolon) {
+            consume(parser, TOKEN_SEMICOLON, "Expected ';' after function call.");
+        }
+        std::shared_ptr<BuiltinNode> builtin_node(new BuiltinNode(builtin->second.builtin, values, index));
+        if (expected_type != TOKEN_BANG && builtin->second.return_type != TOKEN_TO_AST.at(expected_type)) {
+            return std::shared_ptr<ConvertNode>(new ConvertNode(builtin_node, TOKEN_TO_AST.at(expected_type)));
+        }
+        return builtin_node;
+    }
     std::shared_ptr<FunctionNode> fun_node = get_function(parser, id.value);
     std::vector<std::shared_ptr<AbstractSyntaxTree>> values;
-    for (int i=0; i<fun_node->get_parameters_count(); i++) {
-        auto type = fun_node->get_parameters().at(i)->get_type();
-        values.push_back(expression(parser, AST_TO_TOKEN.at(type)));
-        if (i != fun_node->get_parameters_count() - 1) {
+    const auto parameters = fun_node->get_parameters();
+    for (size_t i = 0; i < parameters.size(); i++) {
+        auto type = parameters.at(i)->get_type();
+        if (is_array(type)) {
+            values.push_back(array_argument(parser, type, parameters.at(i)->get_length()));
+        } else if (type == ast::STRUCT) {
+            values.push_back(struct_expression(parser, parser.struct_names.at(parameters.at(i).get())));
+        } else {
+            values.push_back(expression(parser, AST_TO_TOKEN.at(type)));
+        }
+        if (i != parameters.size() - 1) {
             consume(parser, TOKEN_COMMA, "Expected ',' after function parameter.");
         }
     }
@@ -547,63 +1309,128 @@ std::shared_ptr<AbstractSyntaxTree> assign_expression(Parser& parser) {
             /* expect_semicolon */ false
         );
     }
+    if (match_index_assign(parser)) {
+        return index_assign_statement(parser, previous(parser, 2), /* expect_semicolon */ false);
+    }
+    if (match_field_assign(parser)) {
+        return field_assign_statement(parser, previous(parser), /* expect_semicolon */ false);
+    }
     print_error(parser, "Expected assign expression.");
     exit(1);
 }
 
-std::shared_ptr<AbstractSyntaxTree> assign_statement(
+// Value stored by an assignment, from the current value for the assignments that update it.
+std::shared_ptr<AbstractSyntaxTree> assigned_value(
     Parser& parser,
-    const Token& id,
-    const Token& assign,
-    const bool& expect_semicolon
+    const std::shared_ptr<AbstractSyntaxTree>& current,
+    const TokenType& type,
+    const Token& assign
 ) {
-    std::shared_ptr<VariableNode> variable = get_variable_by_name(parser, id.value);
-    std::shared_ptr<AbstractSyntaxTree> exp;
-    TokenType type = AST_TO_TOKEN.at(variable->get_type());
+    if (assign.type == TOKEN_MOD_EQUAL || assign.type == TOKEN_XOR_EQUAL || assign.type == TOKEN_AMPERSAND_EQUAL || assign.type == TOKEN_PIPE_EQUAL) {
+        expect_integers(parser, assign, {current});
+    }
     switch (assign.type) {
         case TOKEN_EQUAL:
-            exp = expression(parser, type);
-            break;
+            return expression(parser, type);
         case TOKEN_PLUS_EQUAL:
-            exp = std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(variable, expression(parser, type), ast::ADD));
-            break;
+            return std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(current, expression(parser, type), ast::ADD));
         case TOKEN_MINUS_EQUAL:
-            exp = std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(variable, expression(parser, type), ast::SUB));
-            break;
+            return std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(current, expression(parser, type), ast::SUB));
         case TOKEN_STAR_EQUAL:
-            exp = std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(variable, expression(parser, type), ast::MUL));
-            break;
+            return std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(current, expression(parser, type), ast::MUL));
         case TOKEN_SLASH_EQUAL:
-            exp = std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(variable, expression(parser, type), ast::DIV));
-            break;
+            return std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(current, expression(parser, type), ast::DIV));
         case TOKEN_MOD_EQUAL:
-            exp = std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(variable, expression(parser, type), ast::MOD));
-            break;
+            return std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(current, expression(parser, type), ast::MOD));
         case TOKEN_XOR_EQUAL:
-            exp = std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(variable, expression(parser, type), ast::XOR));
-            break;
+            return std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(current, expression(parser, type), ast::XOR));
         case TOKEN_AMPERSAND_EQUAL:
-            exp = std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(variable, expression(parser, type), ast::BIN_AND));
-            break;
+            return std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(current, expression(parser, type), ast::BIN_AND));
         case TOKEN_PIPE_EQUAL:
-            exp = std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(variable, expression(parser, type), ast::BIN_OR));
-            break;
+            return std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(current, expression(parser, type), ast::BIN_OR));
         case TOKEN_PLUS_PLUS:
-            exp = std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(variable, literal("1", type), ast::ADD));
-            break;
+            return std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(current, literal(parser, "1", type), ast::ADD));
         case TOKEN_MINUS_MINUS:
-            exp = std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(variable, literal("1", type), ast::SUB));
-            break;
+            return std::shared_ptr<BinaryOperationNode>(new BinaryOperationNode(current, literal(parser, "1", type), ast::SUB));
         default:
             print_error(parser, "Could not recognize assignment type!");
             exit(1);
     }
+}
+
+// Structs are assigned all their values at once.
+std::shared_ptr<AbstractSyntaxTree> assign_variable(
+    Parser& parser,
+    const std::shared_ptr<VariableNode>& variable,
+    const Token& assign,
+    const bool& expect_semicolon
+) {
+    if (is_array(variable->get_type())) {
+        print_error(parser, "Arrays can't be assigned.");
+        exit(1);
+    }
+    std::shared_ptr<AbstractSyntaxTree> exp;
+    if (variable->get_type() == ast::STRUCT) {
+        if (assign.type != TOKEN_EQUAL) {
+            print_error(parser, "Structs are only assigned with '='.");
+            exit(1);
+        }
+        exp = struct_expression(parser, parser.struct_names.at(variable.get()));
+    } else {
+        exp = assigned_value(parser, variable, AST_TO_TOKEN.at(variable->get_type()), assign);
+    }
     if (expect_semicolon) {
         consume(parser, TOKEN_SEMICOLON, "Expected ';' after statement.");
     }
     return std::shared_ptr<AssignNode>(new AssignNode(variable, exp));
 }
 
+std::shared_ptr<AbstractSyntaxTree> assign_statement(
+    Parser& parser,
+    const Token& id,
+    const Token& assign,
+    const bool& expect_semicolon
+) {
+    return assign_variable(parser, get_variable_by_name(parser, id.value), assign, expect_semicolon);
+}
+
+// Assignment of a field, the fields of nested structs are named one after the other.
+std::shared_ptr<AbstractSyntaxTree> field_assign_statement(Parser& parser, const Token& id, const bool& expect_semicolon) {
+    std::shared_ptr<VariableNode> variable = get_variable_by_name(parser, id.value);
+    if (variable->get_type() != ast::STRUCT) {
+        print_error(parser, "'" + id.value + "' is not a struct.");
+        exit(1);
+    }
+    consume(parser, TOKEN_DOT, "Expected '.' after struct.");
+    std::shared_ptr<VariableNode> member = field(parser, variable);
+    return assign_variable(parser, member, advance(parser), expect_semicolon);
+}
+
+// Assignment of an element of an array, the index is evaluated again by the assignments that update it.
+std::shared_ptr<AbstractSyntaxTree> index_assign_statement(Parser& parser, const Token& id, const bool& expect_semicolon) {
+    std::shared_ptr<VariableNode> variable = get_variable_by_name(parser, id.value);
+    if (!is_array(variable->get_type())) {
+        print_error(parser, "'" + id.value + "' is not an array.");
+        exit(1);
+    }
+    size_t start = parser.current;
+    std::shared_ptr<AbstractSyntaxTree> index = expression(parser, TOKEN_LONG);
+    consume(parser, TOKEN_RIGHT_BRACKET, "Expected ']' after index.");
+    Token assign = advance(parser);
+    std::shared_ptr<AbstractSyntaxTree> current = nullptr;
+    if (assign.type != TOKEN_EQUAL) {
+        size_t end = parser.current;
+        parser.current = start;
+        current = std::shared_ptr<IndexNode>(new IndexNode(variable, expression(parser, TOKEN_LONG)));
+        parser.current = end;
+    }
+    std::shared_ptr<AbstractSyntaxTree> exp = assigned_value(parser, current, ELEMENT_OF.at(variable->get_type()), assign);
+    if (expect_semicolon) {
+        consume(parser, TOKEN_SEMICOLON, "Expected ';' after statement.");
+    }
+    return std::shared_ptr<AssignIndexNode>(new AssignIndexNode(variable, index, exp));
+}
+
 std::shared_ptr<AbstractSyntaxTree> expression_statement(Parser& parser, const TokenType& expected_type) {
     std::shared_ptr<AbstractSyntaxTree> exp = expression(parser, expected_type);
     consume(parser, TOKEN_SEMICOLON, "Expected ';' after expression.");
@@ -611,17 +1438,43 @@ std::shared_ptr<AbstractSyntaxTree> expression_statement(Parser& parser, const T
 }
 
 bool match_assign(Parser& parser) {
-    return match_sequence(parser, {{TOKEN_IDENTIFIER}, {TOKEN_EQUAL}}) ||
-        match_sequence(parser, {{TOKEN_IDENTIFIER}, {TOKEN_PLUS_EQUAL}}) ||
-        match_sequence(parser, {{TOKEN_IDENTIFIER}, {TOKEN_MINUS_EQUAL}}) ||
-        match_sequence(parser, {{TOKEN_IDENTIFIER}, {TOKEN_STAR_EQUAL}}) ||
-        match_sequence(parser, {{TOKEN_IDENTIFIER}, {TOKEN_SLASH_EQUAL}}) ||
-        match_sequence(parser, {{TOKEN_IDENTIFIER}, {TOKEN_MOD_EQUAL}}) ||
-        match_sequence(parser, {{TOKEN_IDENTIFIER}, {TOKEN_XOR_EQUAL}}) ||
-        match_sequence(parser, {{TOKEN_IDENTIFIER}, {TOKEN_AMPERSAND_EQUAL}}) ||
-        match_sequence(parser, {{TOKEN_IDENTIFIER}, {TOKEN_PIPE_EQUAL}}) ||
-        match_sequence(parser, {{TOKEN_IDENTIFIER}, {TOKEN_PLUS_PLUS}}) ||
-        match_sequence(parser, {{TOKEN_IDENTIFIER}, {TOKEN_MINUS_MINUS}});
+    return match_sequence(parser, {{TOKEN_IDENTIFIER}, ASSIGNS});
+}
+
+// Matches 'id[' when an element of the array is assigned, the index is parsed next.
+bool match_index_assign(Parser& parser) {
+    if (!check(parser, TOKEN_IDENTIFIER) || parser.current + 1 >= parser.tokens.size() || parser.tokens[parser.current + 1].type != TOKEN_LEFT_BRACKET) {
+        return false;
+    }
+    size_t depth = 0;
+    for (size_t i = parser.current + 1; i < parser.tokens.size(); i++) {
+        if (parser.tokens[i].type == TOKEN_LEFT_BRACKET) {
+            depth++;
+        } else if (parser.tokens[i].type == TOKEN_RIGHT_BRACKET && --depth == 0) {
+            if (i + 1 < parser.tokens.size() && ASSIGNS.find(parser.tokens[i + 1].type) != ASSIGNS.end()) {
+                parser.current += 2;
+                return true;
+            }
+            return false;
+        }
+    }
+    return false;
+}
+
+// Matches 'id' when a field of the struct is assigned, the fields are parsed next.
+bool match_field_assign(Parser& parser) {
+    if (!check(parser, TOKEN_IDENTIFIER)) {
+        return false;
+    }
+    size_t i = parser.current + 1;
+    while (i + 1 < parser.tokens.size() && parser.tokens[i].type == TOKEN_DOT && parser.tokens[i + 1].type == TOKEN_IDENTIFIER) {
+        i += 2;
+    }
+    if (i == parser.current + 1 || i >= parser.tokens.size() || ASSIGNS.find(parser.tokens[i].type) == ASSIGNS.end()) {
+        return false;
+    }
+    parser.current++;
+    return true;
 }
 
 std::shared_ptr<AbstractSyntaxTree> statement(Parser& parser) {
@@ -643,9 +1496,41 @@ std::shared_ptr<AbstractSyntaxTree> statement(Parser& parser) {
     if (match(parser, {TOKEN_AT_NATIVE})) {
         return native_statement(parser);
     }
+    if (match(parser, {TOKEN_IMPORT})) {
+        return import_statement(parser);
+    }
+    if (match(parser, {TOKEN_STRUCT})) {
+        return struct_statement(parser);
+    }
+    if (match(parser, {TOKEN_FLUSH})) {
+        consume(parser, TOKEN_SEMICOLON, "Expected ';' after 'flush'.");
+        return std::shared_ptr<FlushNode>(new FlushNode());
+    }
+    if (match(parser, {TOKEN_SNAPSHOT})) {
+        consume(parser, TOKEN_SEMICOLON, "Expected ';' after 'snapshot'.");
+        return std::shared_ptr<SnapshotNode>(new SnapshotNode());
+    }
     if (match_assign(parser)) {
         return assign_statement(parser, previous(parser, 2), previous(parser));
     }
+    if (match_index_assign(parser)) {
+        return index_assign_statement(parser, previous(parser, 2));
+    }
+    if (match_field_assign(parser)) {
+        return field_assign_statement(parser, previous(parser), /* expect_semicolon */ true);
+    }
+    // declarations of variables and functions whose type is a struct
+    if (check(parser, TOKEN_IDENTIFIER) && is_struct(parser, peek(parser).value)) {
+        if (match_sequence(parser, {{TOKEN_IDENTIFIER}, {TOKEN_IDENTIFIER}, {TOKEN_LEFT_PAREN}})) {
+            return fun_statement(parser, previous(parser, 3), previous(parser, 2));
+        }
+        if (match_sequence(parser, {{TOKEN_IDENTIFIER}, {TOKEN_IDENTIFIER}})) {
+            return struct_var_statement(parser, previous(parser, 2), previous(parser));
+        }
+    }
+    if (match_sequence(parser, {TYPES, {TOKEN_LEFT_BRACKET}, {TOKEN_NUMBER}, {TOKEN_RIGHT_BRACKET}, {TOKEN_IDENTIFIER}})) {
+        return array_statement(parser, previous(parser, 5), previous(parser, 3), previous(parser));
+    }
     if (match_sequence(parser, {TYPES, {TOKEN_IDENTIFIER}, {TOKEN_EQUAL}})) {
         return var_statement(parser, previous(parser, 3), previous(parser, 2));
     }
@@ -653,9 +1538,29 @@ std::shared_ptr<AbstractSyntaxTree> statement(Parser& parser) {
         return fun_statement(parser, previous(parser, 3), previous(parser, 2));
     }
     if (match_sequence(parser, {{TOKEN_IDENTIFIER}, {TOKEN_LEFT_PAREN}})) {
-        return call_statement(parser, previous(parser, 2), TOKEN_BANG);
+        Token id = previous(parser, 2);
+        std::shared_ptr<AbstractSyntaxTree> call = call_statement(parser, id, TOKEN_BANG);
+        const auto array_builtin = ARRAY_BUILTINS.find(id.value);
+        const auto builtin = BUILTINS.find(id.value);
+        ast::AstVarType return_type =
+            array_builtin != ARRAY_BUILTINS.end() ? array_builtin->second.return_type :
+            builtin != BUILTINS.end() ? builtin->second.return_type :
+            get_function(parser, id.value)->get_return_type();
+        if (return_type == ast::VOID) {
+            return call;
+        }
+        // the returned values are unused, don't leave them on the stack
+        uint8_t count = return_type == ast::STRUCT ? get_function(parser, id.value)->get_return_types().size() : 1;
+        return std::shared_ptr<PopNode>(new PopNode(call, count));
     }
-    return expression_statement(parser, TOKEN_BANG);
+    return std::shared_ptr<PopNode>(new PopNode(expression_statement(parser, TOKEN_BANG)));
+}
+
+std::shared_ptr<AbstractSyntaxTree> line_statement(Parser& parser) {
+    uint64_t line = peek(parser).line;
+    std::shared_ptr<AbstractSyntaxTree> node = statement(parser);
+    parser.module->add_line(node, line);
+    return node;
 }
 
 std::shared_ptr<BlockNode> block(Parser& parser) {
@@ -670,7 +1575,7 @@ std::shared_ptr<BlockNode> block(Parser& parser) {
             (frame.scope_stack.size() == nest_level && !check(parser, TOKEN_RIGHT_BRACE))
         )
     ) {
-        block->add(statement(parser));
+        block->add(line_statement(parser));
     }
     if (eof(parser)) {
         print_error(parser, "Missing '} after block.");
@@ -681,11 +1586,12 @@ std::shared_ptr<BlockNode> block(Parser& parser) {
 }
 
 std::shared_ptr<AbstractSyntaxTree> program(Parser& parser) {
-    std::shared_ptr<BlockNode> root(new BlockNode());
+    std::shared_ptr<ModuleNode> root(new ModuleNode());
+    parser.module = root;
     push_frame(parser, root);
     push_scope(parser, root);
     while (!eof(parser)) {
-        root->add(statement(parser));
+        root->add(line_statement(parser));
     }
     pop_scope(parser);
     pop_frame(parser);
@@ -695,11 +1601,13 @@ std::shared_ptr<AbstractSyntaxTree> program(Parser& parser) {
 
 std::shared_ptr<AbstractSyntaxTree> parser::parse(
     const std::vector<Token>& tokens,
-    const std::vector<std::string>& shared_libraries
+    const std::vector<std::string>& shared_libraries,
+    const std::string& directory
 ) {
     Parser parser;
     parser.current = 0;
     parser.tokens = tokens;
-    parser.c_functions.load(shared_libraries);
+    parser.directory = directory;
+    parser.c_functions.set_libraries(shared_libraries);
     return program(parser);
 }
@@ -9,7 +9,9 @@
 namespace parser {
 std::shared_ptr<AbstractSyntaxTree> parse(
     const std::vector<Token>& tokens,
-    const std::vector<std::string>& shared_libraries = std::vector<std::string>()
+    const std::vector<std::string>& shared_libraries = std::vector<std::string>(),
+    // directory of the source, which imports are relative to
+    const std::string& directory = ""
 );
 }
 
@@ -1,4 +1,5 @@
 #include "scanner.h"
+#include "textutils.h"
 #include <iostream>
 
 namespace scanner {
@@ -17,10 +18,6 @@ Token create_token(const TokenType& type, const Scanner& scanner) {
     return token;
 }
 
-bool is_digit(const char& c) {
-    return '0' <= c && c <= '9';
-}
-
 bool is_character(const char& c) {
     return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || c == '_';
 }
@@ -40,33 +37,47 @@ bool match_string(const Scanner& scanner, const std::string& str, const bool& ke
 
 int match_quote(const Scanner& scanner) {
     size_t p = scanner.current + 1;
-    while (p < scanner.code.size() && scanner.code[p] != '\n') {
+    for (;;) {
+        p = textutils::find_string_delimiter(scanner.code.data(), p, scanner.code.size());
+        if (p >= scanner.code.size() || scanner.code[p] == '\n') {
+            return -1;
+        }
         if (scanner.code[p] == '\\') {
             p += 2;
             continue;
         }
-        if (scanner.code[p] == '"') {
-            return p + 1;
-        }
-        p++;
+        return p + 1;
     }
-    return -1;
 }
 
+bool is_digit(const char& c) {
+    return '0' <= c && c <= '9';
+}
+
+// Integers, and doubles with a fraction or an exponent: 1.5, 2e-3.
 int match_number(const Scanner& scanner) {
-    int p = scanner.current;
-    while (is_digit(scanner.code[p])) {
-         p++;
+    const char* code = scanner.code.data();
+    size_t p = textutils::skip_digits(code, scanner.current, scanner.code.size());
+    if (code[p] == '.' && is_digit(code[p + 1])) {
+        p = textutils::skip_digits(code, p + 1, scanner.code.size());
+    }
+    if (code[p] == 'e' || code[p] == 'E') {
+        size_t exponent = code[p + 1] == '+' || code[p + 1] == '-' ? p + 2 : p + 1;
+        if (is_digit(code[exponent])) {
+            p = textutils::skip_digits(code, exponent, scanner.code.size());
+        }
     }
     return p;
 }
 
 int match_identifier(const Scanner& scanner) {
-    int p = scanner.current;
-    while (is_character(scanner.code[p]) || is_digit(scanner.code[p])) {
-        p++;
-    }
-    return p;
+    return textutils::skip_identifier(scanner.code.data(), scanner.current, scanner.code.size());
+}
+
+void skip_whitespace(Scanner& scanner) {
+    size_t newlines = 0;
+    scanner.current = textutils::skip_whitespace(scanner.code.data(), scanner.current, scanner.code.size(), &newlines);
+    scanner.line += newlines;
 }
 
 int next_line(const Scanner& scanner) {
@@ -102,13 +113,8 @@ std::vector<Token> scanner::scan(const std::string& code) {
             case ' ':
             case '\r':
             case '\t':
-                scanner.start++;
-                scanner.current++;
-                break;
             case '\n':
-                scanner.start++;
-                scanner.current++;
-                scanner.line++;
+                skip_whitespace(scanner);
                 break;
             case '(':
                 scanner.current++;
@@ -126,6 +132,14 @@ std::vector<Token> scanner::scan(const std::string& code) {
                 scanner.current++;
                 tokens.push_back(create_token(TOKEN_RIGHT_BRACE, scanner));
                 break;
+            case '[':
+                scanner.current++;
+                tokens.push_back(create_token(TOKEN_LEFT_BRACKET, scanner));
+                break;
+            case ']':
+                scanner.current++;
+                tokens.push_back(create_token(TOKEN_RIGHT_BRACKET, scanner));
+                break;
             case ',':
                 scanner.current++;
                 tokens.push_back(create_token(TOKEN_COMMA, scanner));
@@ -266,6 +280,9 @@ std::vector<Token> scanner::scan(const std::string& code) {
                 } else if (match_string(scanner, "false", /* keyword */ true)) {
                     scanner.current += 5;
                     tokens.push_back(create_token(TOKEN_FALSE, scanner));
+                } else if (match_string(scanner, "flush", /* keyword */ true)) {
+                    scanner.current += 5;
+                    tokens.push_back(create_token(TOKEN_FLUSH, scanner));
                 } else {
                     scanner.current = match_identifier(scanner);
                     tokens.push_back(create_token(TOKEN_IDENTIFIER, scanner));
@@ -288,6 +305,9 @@ std::vector<Token> scanner::scan(const std::string& code) {
                 } else if (match_string(scanner, "int", /* keyword */ true)) {
                     scanner.current += 3;
                     tokens.push_back(create_token(TOKEN_INT, scanner));
+                } else if (match_string(scanner, "import", /* keyword */ true)) {
+                    scanner.current += 6;
+                    tokens.push_back(create_token(TOKEN_IMPORT, scanner));
                 } else {
                     scanner.current = match_identifier(scanner);
                     tokens.push_back(create_token(TOKEN_IDENTIFIER, scanner));
@@ -418,6 +438,14 @@ std::vector<Token> scanner::scan(const std::string& code) {
                 break;
             case '_':
             case 'd':
+                if (match_string(scanner, "double", /* keyword */ true)) {
+                    scanner.current += 6;
+                    tokens.push_back(create_token(TOKEN_DOUBLE, scanner));
+                } else {
+                    scanner.current = match_identifier(scanner);
+                    tokens.push_back(create_token(TOKEN_IDENTIFIER, scanner));
+                }
+                break;
             case 'g':
             case 'h':
             case 'j':
@@ -425,6 +453,20 @@ std::vector<Token> scanner::scan(const std::string& code) {
             case 'm':
             case 'n':
             case 's':
+                if (match_string(scanner, "snapshot", /* keyword */ true)) {
+                    scanner.current += 8;
+                    tokens.push_back(create_token(TOKEN_SNAPSHOT, scanner));
+                } else if (match_string(scanner, "string", /* keyword */ true)) {
+                    scanner.current += 6;
+                    tokens.push_back(create_token(TOKEN_STRING_TYPE, scanner));
+                } else if (match_string(scanner, "struct", /* keyword */ true)) {
+                    scanner.current += 6;
+                    tokens.push_back(create_token(TOKEN_STRUCT, scanner));
+                } else {
+                    scanner.current = match_identifier(scanner);
+                    tokens.push_back(create_token(TOKEN_IDENTIFIER, scanner));
+                }
+                break;
             case 'q':
             case 'u':
             case 'x':
@@ -434,7 +476,13 @@ std::vector<Token> scanner::scan(const std::string& code) {
                 tokens.push_back(create_token(TOKEN_IDENTIFIER, scanner));
                 break;
             default:
-                error(scanner);
+                // identifiers may start with a capital letter, like the names of structs
+                if ('A' <= scanner.code[scanner.current] && scanner.code[scanner.current] <= 'Z') {
+                    scanner.current = match_identifier(scanner);
+                    tokens.push_back(create_token(TOKEN_IDENTIFIER, scanner));
+                } else {
+                    error(scanner);
+                }
                 break;
         }
         scanner.start = scanner.current;
@@ -8,6 +8,7 @@ enum TokenType {
     // Single-character tokens.
     TOKEN_LEFT_PAREN, TOKEN_RIGHT_PAREN,
     TOKEN_LEFT_BRACE, TOKEN_RIGHT_BRACE,
+    TOKEN_LEFT_BRACKET, TOKEN_RIGHT_BRACKET,
     TOKEN_COMMA, TOKEN_DOT, TOKEN_SEMICOLON,
     TOKEN_TILDE,
     // One or two character tokens.
@@ -28,8 +29,9 @@ enum TokenType {
     // Keywords.
     TOKEN_RETURN, TOKEN_IF, TOKEN_ELSE, TOKEN_FOR,
     TOKEN_WHILE, TOKEN_AND, TOKEN_OR, TOKEN_PRINT,
-    TOKEN_BOOL, TOKEN_CHAR, TOKEN_INT, TOKEN_LONG, 
-    TOKEN_TRUE, TOKEN_FALSE, TOKEN_VOID, TOKEN_AT_NATIVE
+    TOKEN_BOOL, TOKEN_CHAR, TOKEN_INT, TOKEN_LONG, TOKEN_DOUBLE, TOKEN_STRING_TYPE,
+    TOKEN_TRUE, TOKEN_FALSE, TOKEN_VOID, TOKEN_AT_NATIVE,
+    TOKEN_IMPORT, TOKEN_FLUSH, TOKEN_SNAPSHOT, TOKEN_STRUCT
 };
 
 struct Token{
@@ -0,0 +1,16 @@
+#include "string_table.h"
+
+Var StringTable::intern(const std::string_view& str) {
+    if (var::is_inline(str.size())) {
+        return var::create_string(str.data(), str.size());
+    }
+    auto it = strings.find(str);
+    if (it == strings.end()) {
+        it = strings.emplace(str).first;
+    }
+    return var::create_string(it->data(), it->size());
+}
+
+size_t StringTable::size() const {
+    return strings.size();
+}
@@ -0,0 +1,26 @@
+#if !defined(STRING_TABLE)
+#define STRING_TABLE
+
+#include <set>
+#include <string>
+#include <string_view>
+#include "var.h"
+
+// Strings made by a program, kept until the VM is destroyed. The ones that don't fit in a value
+// are stored once: equal strings share the same copy, and are compared by pointer.
+class StringTable {
+    public:
+    StringTable() = default;
+    StringTable(const StringTable&) = delete;
+    StringTable& operator=(const StringTable&) = delete;
+
+    Var intern(const std::string_view& str);
+    // number of strings stored out of line
+    size_t size() const;
+
+    private:
+    // nodes never move, so the characters of a string stay where they are
+    std::set<std::string, std::less<>> strings;
+};
+
+#endif // STRING_TABLE
@@ -0,0 +1,300 @@
+#include "textutils.h"
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TEXT_UTILS_X86
+#include <immintrin.h>
+#endif
+
+// Consumes blocks of characters as long as all of them belong to the class,
+// then hands the remaining tail (shorter than a block) to the scalar version.
+#define SKIP_BLOCKS(block_size, full_mask, class_mask, scalar_skip) \
+    while (p + block_size <= end) { \
+        uint32_t outside = ~class_mask(text + p) & full_mask; \
+        if (outside != 0) { \
+            return p + __builtin_ctz(outside); \
+        } \
+        p += block_size; \
+    } \
+    return scalar_skip(text, p, end); \
+
+// Same as SKIP_BLOCKS for whitespace, counting the new lines that were skipped.
+#define SKIP_WHITESPACE_BLOCKS(block_size, full_mask, whitespace_mask, new_line_mask) \
+    while (p + block_size <= end) { \
+        uint32_t new_lines = new_line_mask(text + p); \
+        uint32_t outside = ~whitespace_mask(text + p) & full_mask; \
+        if (outside != 0) { \
+            uint32_t stop = __builtin_ctz(outside); \
+            *newlines += __builtin_popcount(new_lines & ((1u << stop) - 1)); \
+            return p + stop; \
+        } \
+        *newlines += __builtin_popcount(new_lines); \
+        p += block_size; \
+    } \
+    return skip_whitespace_scalar(text, p, end, newlines); \
+
+namespace textutils {
+bool is_whitespace(const char& c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool is_identifier(const char& c) {
+    return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') || c == '_';
+}
+
+bool is_digit(const char& c) {
+    return '0' <= c && c <= '9';
+}
+
+bool is_string_delimiter(const char& c) {
+    return c == '"' || c == '\\' || c == '\n';
+}
+
+size_t skip_whitespace_scalar(const char* text, size_t p, const size_t& end, size_t* newlines) {
+    while (p < end && is_whitespace(text[p])) {
+        *newlines += text[p] == '\n';
+        p++;
+    }
+    return p;
+}
+
+size_t skip_identifier_scalar(const char* text, size_t p, const size_t& end) {
+    while (p < end && is_identifier(text[p])) {
+        p++;
+    }
+    return p;
+}
+
+size_t skip_digits_scalar(const char* text, size_t p, const size_t& end) {
+    while (p < end && is_digit(text[p])) {
+        p++;
+    }
+    return p;
+}
+
+size_t find_string_delimiter_scalar(const char* text, size_t p, const size_t& end) {
+    while (p < end && !is_string_delimiter(text[p])) {
+        p++;
+    }
+    return p;
+}
+
+#if defined(TEXT_UTILS_X86)
+// Class masks: bit i is set when text[i] belongs to the class. Characters are compared
+// as signed bytes, so non-ASCII characters (negative) never fall in an ASCII range.
+
+__attribute__((target("sse2")))
+__m128i in_range_sse2(const __m128i& chunk, const char& low, const char& high) {
+    return _mm_and_si128(
+        _mm_cmpgt_epi8(chunk, _mm_set1_epi8(low - 1)),
+        _mm_cmplt_epi8(chunk, _mm_set1_epi8(high + 1))
+    );
+}
+
+__attribute__((target("sse2")))
+uint32_t new_line_mask_sse2(const char* text) {
+    __m128i chunk = _mm_loadu_si128((const __m128i*) text);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')));
+}
+
+__attribute__((target("sse2")))
+uint32_t whitespace_mask_sse2(const char* text) {
+    __m128i chunk = _mm_loadu_si128((const __m128i*) text);
+    return _mm_movemask_epi8(_mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t'))),
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')))
+    ));
+}
+
+__attribute__((target("sse2")))
+uint32_t identifier_mask_sse2(const char* text) {
+    __m128i chunk = _mm_loadu_si128((const __m128i*) text);
+    __m128i lower = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+    return _mm_movemask_epi8(_mm_or_si128(
+        _mm_or_si128(in_range_sse2(lower, 'a', 'z'), in_range_sse2(chunk, '0', '9')),
+        _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_'))
+    ));
+}
+
+__attribute__((target("sse2")))
+uint32_t digit_mask_sse2(const char* text) {
+    return _mm_movemask_epi8(in_range_sse2(_mm_loadu_si128((const __m128i*) text), '0', '9'));
+}
+
+__attribute__((target("sse2")))
+uint32_t string_body_mask_sse2(const char* text) {
+    __m128i chunk = _mm_loadu_si128((const __m128i*) text);
+    return ~_mm_movemask_epi8(_mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'))),
+        _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'))
+    ));
+}
+
+__attribute__((target("sse2")))
+size_t skip_whitespace_sse2(const char* text, size_t p, const size_t& end, size_t* newlines) {
+    SKIP_WHITESPACE_BLOCKS(16, 0xffffu, whitespace_mask_sse2, new_line_mask_sse2);
+}
+
+__attribute__((target("sse2")))
+size_t skip_identifier_sse2(const char* text, size_t p, const size_t& end) {
+    SKIP_BLOCKS(16, 0xffffu, identifier_mask_sse2, skip_identifier_scalar);
+}
+
+__attribute__((target("sse2")))
+size_t skip_digits_sse2(const char* text, size_t p, const size_t& end) {
+    SKIP_BLOCKS(16, 0xffffu, digit_mask_sse2, skip_digits_scalar);
+}
+
+__attribute__((target("sse2")))
+size_t find_string_delimiter_sse2(const char* text, size_t p, const size_t& end) {
+    SKIP_BLOCKS(16, 0xffffu, string_body_mask_sse2, find_string_delimiter_scalar);
+}
+
+__attribute__((target("avx2")))
+__m256i in_range_avx2(const __m256i& chunk, const char& low, const char& high) {
+    return _mm256_and_si256(
+        _mm256_cmpgt_epi8(chunk, _mm256_set1_epi8(low - 1)),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8(high + 1), chunk)
+    );
+}
+
+__attribute__((target("avx2")))
+uint32_t new_line_mask_avx2(const char* text) {
+    __m256i chunk = _mm256_loadu_si256((const __m256i*) text);
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')));
+}
+
+__attribute__((target("avx2")))
+uint32_t whitespace_mask_avx2(const char* text) {
+    __m256i chunk = _mm256_loadu_si256((const __m256i*) text);
+    return _mm256_movemask_epi8(_mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')))
+    ));
+}
+
+__attribute__((target("avx2")))
+uint32_t identifier_mask_avx2(const char* text) {
+    __m256i chunk = _mm256_loadu_si256((const __m256i*) text);
+    __m256i lower = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20));
+    return _mm256_movemask_epi8(_mm256_or_si256(
+        _mm256_or_si256(in_range_avx2(lower, 'a', 'z'), in_range_avx2(chunk, '0', '9')),
+        _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('_'))
+    ));
+}
+
+__attribute__((target("avx2")))
+uint32_t digit_mask_avx2(const char* text) {
+    return _mm256_movemask_epi8(in_range_avx2(_mm256_loadu_si256((const __m256i*) text), '0', '9'));
+}
+
+__attribute__((target("avx2")))
+uint32_t string_body_mask_avx2(const char* text) {
+    __m256i chunk = _mm256_loadu_si256((const __m256i*) text);
+    return ~_mm256_movemask_epi8(_mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'))),
+        _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n'))
+    ));
+}
+
+__attribute__((target("avx2")))
+size_t skip_whitespace_avx2(const char* text, size_t p, const size_t& end, size_t* newlines) {
+    SKIP_WHITESPACE_BLOCKS(32, 0xffffffffu, whitespace_mask_avx2, new_line_mask_avx2);
+}
+
+__attribute__((target("avx2")))
+size_t skip_identifier_avx2(const char* text, size_t p, const size_t& end) {
+    SKIP_BLOCKS(32, 0xffffffffu, identifier_mask_avx2, skip_identifier_scalar);
+}
+
+__attribute__((target("avx2")))
+size_t skip_digits_avx2(const char* text, size_t p, const size_t& end) {
+    SKIP_BLOCKS(32, 0xffffffffu, digit_mask_avx2, skip_digits_scalar);
+}
+
+__attribute__((target("avx2")))
+size_t find_string_delimiter_avx2(const char* text, size_t p, const size_t& end) {
+    SKIP_BLOCKS(32, 0xffffffffu, string_body_mask_avx2, find_string_delimiter_scalar);
+}
+#endif
+
+Implementation detect_implementation() {
+#if defined(TEXT_UTILS_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SSE2;
+    }
+#endif
+    return SCALAR;
+}
+
+const Implementation BEST_IMPLEMENTATION = detect_implementation();
+Implementation implementation = BEST_IMPLEMENTATION;
+}
+
+size_t textutils::skip_whitespace(const char* text, const size_t& begin, const size_t& end, size_t* newlines) {
+    switch (implementation) {
+#if defined(TEXT_UTILS_X86)
+        case AVX2:
+            return skip_whitespace_avx2(text, begin, end, newlines);
+        case SSE2:
+            return skip_whitespace_sse2(text, begin, end, newlines);
+#endif
+        default:
+            return skip_whitespace_scalar(text, begin, end, newlines);
+    }
+}
+
+size_t textutils::skip_identifier(const char* text, const size_t& begin, const size_t& end) {
+    switch (implementation) {
+#if defined(TEXT_UTILS_X86)
+        case AVX2:
+            return skip_identifier_avx2(text, begin, end);
+        case SSE2:
+            return skip_identifier_sse2(text, begin, end);
+#endif
+        default:
+            return skip_identifier_scalar(text, begin, end);
+    }
+}
+
+size_t textutils::skip_digits(const char* text, const size_t& begin, const size_t& end) {
+    switch (implementation) {
+#if defined(TEXT_UTILS_X86)
+        case AVX2:
+            return skip_digits_avx2(text, begin, end);
+        case SSE2:
+            return skip_digits_sse2(text, begin, end);
+#endif
+        default:
+            return skip_digits_scalar(text, begin, end);
+    }
+}
+
+size_t textutils::find_string_delimiter(const char* text, const size_t& begin, const size_t& end) {
+    switch (implementation) {
+#if defined(TEXT_UTILS_X86)
+        case AVX2:
+            return find_string_delimiter_avx2(text, begin, end);
+        case SSE2:
+            return find_string_delimiter_sse2(text, begin, end);
+#endif
+        default:
+            return find_string_delimiter_scalar(text, begin, end);
+    }
+}
+
+bool textutils::is_supported(const Implementation& implementation) {
+    return implementation <= BEST_IMPLEMENTATION;
+}
+
+textutils::Implementation textutils::get_implementation() {
+    return implementation;
+}
+
+void textutils::set_implementation(const Implementation& implementation) {
+    textutils::implementation = is_supported(implementation) ? implementation : BEST_IMPLEMENTATION;
+}
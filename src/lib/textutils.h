@@ -0,0 +1,24 @@
+#if !defined(TEXT_UTILS)
+#define TEXT_UTILS
+
+#include <stddef.h>
+
+namespace textutils {
+enum Implementation {
+    SCALAR, SSE2, AVX2
+};
+
+// Character classification over runs of text. Each function scans text[begin, end)
+// and returns the index of the first character that does not belong to the run.
+size_t skip_whitespace(const char* text, const size_t& begin, const size_t& end, size_t* newlines);
+size_t skip_identifier(const char* text, const size_t& begin, const size_t& end);
+size_t skip_digits(const char* text, const size_t& begin, const size_t& end);
+// Returns the index of the first '"', '\' or new line, which end the body of a string literal.
+size_t find_string_delimiter(const char* text, const size_t& begin, const size_t& end);
+
+bool is_supported(const Implementation& implementation);
+Implementation get_implementation();
+void set_implementation(const Implementation& implementation);
+}
+
+#endif // TEXT_UTILS
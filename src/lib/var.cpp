@@ -1,8 +1,11 @@
 #include "var.h"
 #include "../lib/byteutils.h"
+#include <charconv>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
+// Operations on integers only: doubles are rejected by the verifier.
 #define BINARY_OPERATION(left, right, op) \
     switch (left.type) { \
         case CHAR: \
@@ -66,7 +69,17 @@
             exit(1); \
     } \
 
+// A double operand makes the other one a double, like in C.
+#define ARITHMETIC_OPERATION(left, right, op) \
+    if (left.type == DOUBLE || right.type == DOUBLE) { \
+        return create_double(var::to_double(left) op var::to_double(right)); \
+    } \
+    BINARY_OPERATION(left, right, op) \
+
 #define COMPARE_OPERATION(left, right, op) \
+    if (left.type == DOUBLE || right.type == DOUBLE) { \
+        return create_bool(var::to_double(left) op var::to_double(right)); \
+    } \
     switch (left.type) { \
         case CHAR: \
             switch (right.type) { \
@@ -145,8 +158,36 @@
     } \
 
 namespace var {
+// Interned strings are equal when they are the same copy, inline ones when their padded bytes are.
+bool string_equal(const Var& left, const Var& right) {
+    if (left.type != STRING || right.type != STRING || left.length != right.length) {
+        return false;
+    }
+    if (is_inline(left.length)) {
+        return memcmp(left.data._chars, right.data._chars, sizeof(Data)) == 0;
+    }
+    return left.data._pointer == right.data._pointer;
+}
+
 void type_not_found(const DataType& type) {
-    std::cout << "Type not found: " << type << std::endl;
+    std::cout << "Type not found: " << (int) type << std::endl;
+}
+
+double to_double(const Var& var) {
+    return var.type == DOUBLE ? var.data._double : convert(var, DOUBLE).data._double;
+}
+
+// Doubles are stored as the bits of a long.
+int64_t double_bits(const double& value) {
+    int64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double bits_double(const int64_t& bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
 }
 }
 
@@ -165,13 +206,16 @@ void var::push(const Var &var, std::vector<uint8_t>& bytes) {
         case LONG:
             byteutils::push_long(bytes, var.data._long);
             break;
+        case DOUBLE:
+            byteutils::push_long(bytes, double_bits(var.data._double));
+            break;
         default:
             var::type_not_found(var.type);
             exit(1);
     }
 }
 
-Var var::read(const std::vector<uint8_t>& bytes, uint64_t* index) {
+Var var::read(const uint8_t* bytes, uint64_t* index) {
     Var var;
     var.type = (DataType) bytes[*index];
     *index += SIZE_OF_BYTE;
@@ -192,6 +236,10 @@ Var var::read(const std::vector<uint8_t>& bytes, uint64_t* index) {
             var.data._long = byteutils::read_long(bytes, *index);
             *index += SIZE_OF_LONG;
             break;
+        case DOUBLE:
+            var.data._double = bits_double(byteutils::read_long(bytes, *index));
+            *index += SIZE_OF_LONG;
+            break;
         default:
             var::type_not_found(var.type);
             exit(1);
@@ -215,6 +263,11 @@ std::string var::to_string(const Var& var) {
         case LONG:
             ss << var.data._long;
             break;
+        case DOUBLE: {
+            char buffer[MAX_DOUBLE_SIZE];
+            ss << std::string(buffer, format_double(buffer, var.data._double));
+            break;
+        }
         default:
             var::type_not_found(var.type);
             exit(1);
@@ -238,6 +291,9 @@ Var var::from_string(const std::vector<std::string>& strings) {
         case LONG:
             var.data._long = stol(strings[1]);
             break;
+        case DOUBLE:
+            var.data._double = stod(strings[1]);
+            break;
         default:
             var::type_not_found(var.type);
             exit(1);
@@ -258,6 +314,7 @@ uint8_t var::size(const Var& var) {
             size += SIZE_OF_INT;
             break;
         case LONG:
+        case DOUBLE:
             size += SIZE_OF_LONG;
             break;
         default:
@@ -279,6 +336,8 @@ Var var::convert(const Var& var, const DataType& type) {
                     return create_int(var.data._char);
                 case LONG:
                     return create_long(var.data._char);
+                case DOUBLE:
+                    return create_double(var.data._char);
                 default:
                     var::type_not_found(var.type);
                     exit(1);
@@ -293,6 +352,8 @@ Var var::convert(const Var& var, const DataType& type) {
                     return var;
                 case LONG:
                     return create_long(var.data._int);
+                case DOUBLE:
+                    return create_double(var.data._int);
                 default:
                     var::type_not_found(var.type);
                     exit(1);
@@ -307,6 +368,8 @@ Var var::convert(const Var& var, const DataType& type) {
                     return create_int(var.data._long);
                 case LONG:
                     return var;
+                case DOUBLE:
+                    return create_double(var.data._long);
                 default:
                     var::type_not_found(var.type);
                     exit(1);
@@ -321,6 +384,24 @@ Var var::convert(const Var& var, const DataType& type) {
                     return create_int(var.data._bool);
                 case LONG:
                     return create_long(var.data._bool);
+                case DOUBLE:
+                    return create_double(var.data._bool);
+                default:
+                    var::type_not_found(var.type);
+                    exit(1);
+            }
+        case DOUBLE:
+            switch (type) {
+                case BOOL:
+                    return create_bool(var.data._double);
+                case CHAR:
+                    return create_char(var.data._double);
+                case INT:
+                    return create_int(var.data._double);
+                case LONG:
+                    return create_long(var.data._double);
+                case DOUBLE:
+                    return var;
                 default:
                     var::type_not_found(var.type);
                     exit(1);
@@ -331,6 +412,10 @@ Var var::convert(const Var& var, const DataType& type) {
     }
 }
 
+char* var::format_double(char* begin, const double& value) {
+    return std::to_chars(begin, begin + MAX_DOUBLE_SIZE, value).ptr;
+}
+
 void* var::to_ptr(const Var& var) {
     switch (var.type) {
         case BOOL:
@@ -341,6 +426,8 @@ void* var::to_ptr(const Var& var) {
             return (void*) &var.data._int;
         case LONG:
             return (void*) &var.data._long;
+        case DOUBLE:
+            return (void*) &var.data._double;
         default:
             var::type_not_found(var.type);
             exit(1);
@@ -375,20 +462,57 @@ Var var::create_bool(const bool& value) {
     return var;
 }
 
+Var var::create_double(const double& value) {
+    Var var;
+    var.type = DOUBLE;
+    var.data._double = value;
+    return var;
+}
+
+Var var::create_string(const char* data, const uint32_t& length) {
+    Var var;
+    var.type = STRING;
+    var.length = length;
+    if (is_inline(length)) {
+        memset(var.data._chars, 0, sizeof(Data));
+        memcpy(var.data._chars, data, length);
+    } else {
+        var.data._pointer = (uint8_t*) data;
+    }
+    return var;
+}
+
+bool var::is_inline(const uint32_t& length) {
+    return length <= sizeof(Data);
+}
+
+const char* var::string_data(const Var& var) {
+    return is_inline(var.length) ? var.data._chars : (const char*) var.data._pointer;
+}
+
+Var var::create_slice(uint8_t* data, const uint32_t& length, const bool& read_only) {
+    Var var;
+    var.type = SLICE;
+    var.data._pointer = data;
+    var.read_only = read_only;
+    var.length = length;
+    return var;
+}
+
 Var var::add(const Var& left, const Var& right) {
-    BINARY_OPERATION(left, right, +);
+    ARITHMETIC_OPERATION(left, right, +);
 }
 
 Var var::sub(const Var& left, const Var& right) {
-    BINARY_OPERATION(left, right, -);
+    ARITHMETIC_OPERATION(left, right, -);
 }
 
 Var var::mul(const Var& left, const Var& right) {
-    BINARY_OPERATION(left, right, *);
+    ARITHMETIC_OPERATION(left, right, *);
 }
 
 Var var::div(const Var& left, const Var& right) {
-    BINARY_OPERATION(left, right, /);
+    ARITHMETIC_OPERATION(left, right, /);
 }
 
 Var var::mod(const Var& left, const Var& right) {
@@ -424,10 +548,16 @@ Var var::gte(const Var& left, const Var& right) {
 }
 
 Var var::eq(const Var& left, const Var& right) {
+    if (left.type == STRING || right.type == STRING) {
+        return create_bool(string_equal(left, right));
+    }
     COMPARE_OPERATION(left, right, ==);
 }
 
 Var var::neq(const Var& left, const Var& right) {
+    if (left.type == STRING || right.type == STRING) {
+        return create_bool(!string_equal(left, right));
+    }
     COMPARE_OPERATION(left, right, !=);
 }
 
@@ -444,6 +574,9 @@ Var var::binary_not(const Var& var) {
 }
 
 Var var::boolean_not(const Var& var) {
+    if (var.type == DOUBLE) {
+        return create_bool(!var.data._double);
+    }
     UNARY_OPERATION(var, !);
 }
 
@@ -461,6 +594,14 @@ void var::print(const Var& var) {
         case LONG:
             std::cout << var.data._long;
             break;
+        case DOUBLE: {
+            char buffer[MAX_DOUBLE_SIZE];
+            std::cout << std::string(buffer, format_double(buffer, var.data._double));
+            break;
+        }
+        case STRING:
+            std::cout << std::string(string_data(var), var.length);
+            break;
         default:
             var::type_not_found(var.type);
             exit(1);
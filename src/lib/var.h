@@ -12,17 +12,26 @@ union Data {
     char _char;
     int _int;
     long _long;
+    double _double;
+    uint8_t* _pointer;
+    // strings that fit in a value are stored inline, padded with zeros
+    char _chars[8];
 };
 
 namespace var {
-enum DataType {
-    BOOL, CHAR, INT, LONG
+enum DataType : uint8_t {
+    // types are stored by value in programs and snapshots, new ones are added at the end
+    BOOL, CHAR, INT, LONG, SLICE, DOUBLE, STRING
 };
 }
 
 struct Var {
     Data data;
     var::DataType type;
+    // slices of mapped files can't be written to
+    bool read_only;
+    // bytes of VM memory a slice spans, from data._pointer, or bytes of a string
+    uint32_t length;
 };
 
 namespace var {
@@ -31,12 +40,15 @@ const std::map<DataType, std::string> TYPE_NAME = {
     {CHAR, "char"},
     {INT, "int"},
     {LONG, "long"},
+    {SLICE, "slice"},
+    {DOUBLE, "double"},
+    {STRING, "string"},
 };
 
 const std::map<std::string, DataType> TYPE_NAME_REVERSED = maputils::reverse(TYPE_NAME);
 
 void push(const Var &var, std::vector<uint8_t>& bytes);
-Var read(const std::vector<uint8_t>& bytes, uint64_t* index);
+Var read(const uint8_t* bytes, uint64_t* index);
 
 std::string to_string(const Var& var);
 Var from_string(const std::vector<std::string>& strings);
@@ -46,10 +58,20 @@ Var convert(const Var& var, const DataType& type);
 
 void* to_ptr(const Var& var);
 
+// Shortest text reading back as the same double, at most MAX_DOUBLE_SIZE characters.
+const size_t MAX_DOUBLE_SIZE = 24;
+char* format_double(char* begin, const double& value);
+
 Var create_char(const char& value);
 Var create_int(const int& value);
 Var create_long(const long& value);
 Var create_bool(const bool& value);
+Var create_double(const double& value);
+Var create_slice(uint8_t* data, const uint32_t& length, const bool& read_only);
+// The characters are copied in the value when they fit in it, the others must be interned.
+Var create_string(const char* data, const uint32_t& length);
+bool is_inline(const uint32_t& length);
+const char* string_data(const Var& var);
 
 Var add(const Var& left, const Var& right);
 Var sub(const Var& left, const Var& right);
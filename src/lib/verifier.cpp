@@ -0,0 +1,795 @@
+#include "verifier.h"
+#include "byteutils.h"
+#include "instructions.h"
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include <set>
+
+namespace verifier {
+// type of values that can't be known before running, such as parameters of flat programs
+const uint8_t UNKNOWN = 0xff;
+// type of locals that are not stored on every path leading to an instruction
+const uint8_t UNSET = 0xfe;
+
+// type of the result of arithmetic instructions, by type of the left and right integer operands
+const uint8_t ARITHMETIC_TYPE[4][4] = {
+    {var::BOOL, var::LONG, var::LONG, var::LONG},
+    {var::BOOL, var::CHAR, var::INT, var::LONG},
+    {var::BOOL, var::INT, var::INT, var::LONG},
+    {var::BOOL, var::LONG, var::LONG, var::LONG},
+};
+
+// Slots of the frame holding the elements of the arrays of a function, as raw bytes: the end
+// of each run of slots by its first slot. They are the same on every path, so that states
+// only track the locals of a function and not its arrays.
+typedef std::map<Address, Address> Elements;
+
+struct State {
+    std::vector<uint8_t> stack;
+    std::vector<uint8_t> locals;
+};
+
+struct Program {
+    const uint8_t* code;
+    uint64_t size;
+    CFunctions* c_functions;
+    const std::vector<Var>& constants;
+    const std::vector<std::string>& strings;
+    const std::vector<Var>& globals;
+    const std::vector<executable::Native>& natives;
+    // without a function table, frames are sized from the locals they use
+    bool flat;
+    std::vector<bool> boundaries;
+    // instructions starting a basic block: branch targets and instructions after a branch
+    std::vector<bool> leaders;
+    std::map<Address, executable::Function> functions;
+};
+
+void reject(const Address& address, const std::string& message) {
+    std::cout << "Invalid program at address " << address << ": " << message << std::endl;
+    exit(1);
+}
+
+Instruction* decode(const Program& program, Address* index) {
+    Instruction* instruction = Instruction::OP_INSTANCES_PTR[program.code[*index]];
+    *index += SIZE_OF_BYTE;
+    instruction->read(program.code, index);
+    return instruction;
+}
+
+Address target(const Instruction* instruction) {
+    if (const auto jump = dynamic_cast<const JumpInstruction*>(instruction)) {
+        return jump->get_address();
+    }
+    return ((const CallInstruction*) instruction)->get_address();
+}
+
+// addresses where execution continues after the instruction
+std::vector<Address> successors(const Program& program, const Instruction* instruction, const Address& address, const Address& next) {
+    switch (instruction->get_opcode()) {
+        case OP_RET:
+        case OP_HALT:
+            return {};
+        case OP_JUMP:
+            return {target(instruction)};
+        case OP_JUMP_IF:
+        case OP_JUMP_IF_FALSE:
+            if (next == program.size) {
+                reject(address, "execution runs past the end of the program.");
+            }
+            return {next, target(instruction)};
+        default:
+            if (next == program.size) {
+                reject(address, "execution runs past the end of the program.");
+            }
+            return {next};
+    }
+}
+
+// Decodes the whole code once, checking that branches land on instruction boundaries,
+// and gives the targets of the calls along with the number of parameters they pass.
+std::map<Address, uint8_t> sweep(Program& program) {
+    std::vector<bool>& boundaries = program.boundaries;
+    boundaries.assign(program.size, false);
+    program.leaders.assign(program.size, false);
+    std::vector<std::pair<Address, Address>> branches;
+    std::map<Address, uint8_t> calls;
+    Address index = 0;
+    while (index < program.size) {
+        if (!Instruction::is_valid(program.code, program.size, index)) {
+            reject(index, "invalid instruction.");
+        }
+        boundaries[index] = true;
+        Address address = index;
+        const Instruction* instruction = decode(program, &index);
+        uint8_t opcode = instruction->get_opcode();
+        if (opcode == OP_JUMP || opcode == OP_JUMP_IF || opcode == OP_JUMP_IF_FALSE || opcode == OP_CALL) {
+            branches.push_back({address, target(instruction)});
+        }
+        if ((opcode == OP_JUMP || opcode == OP_JUMP_IF || opcode == OP_JUMP_IF_FALSE || opcode == OP_RET || opcode == OP_HALT) && index < program.size) {
+            program.leaders[index] = true;
+        }
+        if (opcode == OP_PUSH_CONST && ((const ConstInstruction*) instruction)->get_index() >= program.constants.size()) {
+            reject(address, "constant outside of the constant pool.");
+        }
+        if ((opcode == OP_PRINT_CONST || opcode == OP_MAP_FILE || opcode == OP_NATIVE || opcode == OP_PUSH_STRING) && ((const ConstInstruction*) instruction)->get_index() >= program.strings.size()) {
+            reject(address, "string outside of the constant pool.");
+        }
+        if ((opcode == OP_LOAD_GLOBAL || opcode == OP_STORE_GLOBAL) && byteutils::read_ulong(program.code, address + SIZE_OF_BYTE) >= program.globals.size()) {
+            reject(address, "global outside of the data section.");
+        }
+        if (opcode == OP_CALL) {
+            Address callee = target(instruction);
+            if (calls.find(callee) != calls.end() && calls.at(callee) != instruction->pops()) {
+                reject(address, "function called with different numbers of parameters.");
+            }
+            calls[callee] = instruction->pops();
+        }
+    }
+    for (const auto& [address, destination] : branches) {
+        if (destination >= program.size || !boundaries[destination]) {
+            reject(address, "branches outside of an instruction.");
+        }
+        program.leaders[destination] = true;
+    }
+    return calls;
+}
+
+// Values returned by a function of a flat program, from the 'ret' instructions it reaches.
+uint8_t infer_returns(const Program& program, const Address& entry) {
+    std::set<Address> visited;
+    std::vector<Address> pending = {entry};
+    std::set<uint8_t> returns;
+    while (!pending.empty()) {
+        Address address = pending.back();
+        pending.pop_back();
+        if (!visited.insert(address).second) {
+            continue;
+        }
+        Address next = address;
+        const Instruction* instruction = decode(program, &next);
+        if (instruction->get_opcode() == OP_RET) {
+            returns.insert(instruction->pops());
+        }
+        for (const auto& successor : successors(program, instruction, address, next)) {
+            pending.push_back(successor);
+        }
+    }
+    if (returns.size() > 1) {
+        reject(entry, "function returns different numbers of values.");
+    }
+    return returns.empty() ? 0 : *returns.begin();
+}
+
+void expect_type(const Address& address, const uint8_t& actual, const uint8_t& expected) {
+    if (actual != UNKNOWN && expected != UNKNOWN && actual != expected) {
+        reject(address, "expected '" + var::TYPE_NAME.at((var::DataType) expected) + "' but got '" + var::TYPE_NAME.at((var::DataType) actual) + "'.");
+    }
+}
+
+uint8_t pop(State& state, const Address& address) {
+    if (state.stack.empty()) {
+        reject(address, "operand stack underflow.");
+    }
+    uint8_t type = state.stack.back();
+    state.stack.pop_back();
+    return type;
+}
+
+// Doubles only have the operations of the arithmetic, not the ones on bits or the modulo.
+void expect_arithmetic(const Address& address, const Instruction* instruction) {
+    uint8_t opcode = instruction->get_opcode();
+    if (opcode != OP_ADD && opcode != OP_SUB && opcode != OP_MUL && opcode != OP_DIV) {
+        reject(address, "'" + instruction->to_string() + "' on a double.");
+    }
+}
+
+// Slices point to the memory of the VM, programs can only move them around.
+uint8_t pop_scalar(State& state, const Address& address) {
+    uint8_t type = pop(state, address);
+    if (type == var::SLICE) {
+        reject(address, "slice used as a value.");
+    }
+    return type;
+}
+
+// Values of the operations on numbers, which strings don't have.
+uint8_t pop_number(State& state, const Address& address, const Instruction* instruction) {
+    uint8_t type = pop_scalar(state, address);
+    if (type == var::STRING) {
+        reject(address, "'" + instruction->to_string() + "' on a string.");
+    }
+    return type;
+}
+
+// Arrays must be known to be slices, values of unknown type could be forged.
+void pop_slice(State& state, const Address& address) {
+    if (pop(state, address) != var::SLICE) {
+        reject(address, "expected an array.");
+    }
+}
+
+// Characters of strings are read from the memory of the VM, like the elements of slices.
+void pop_string(State& state, const Address& address) {
+    if (pop(state, address) != var::STRING) {
+        reject(address, "expected a string.");
+    }
+}
+
+// Checks that the locals are in the frame and makes room for the first one in the state.
+void use_locals(const Program& program, const executable::Function& function, const Address& address, State& state, const Address& local, const Address& count) {
+    // a flat program never needs more locals than it has bytes of code
+    uint64_t limit = program.flat ? program.size : function.frame_size;
+    if (local >= limit || count > limit - local) {
+        reject(address, "local address " + std::to_string(local) + " outside of the frame.");
+    }
+    if (local + 1 > state.locals.size()) {
+        state.locals.resize(local + 1, UNSET);
+    }
+}
+
+bool is_element(const Elements& elements, const Address& local) {
+    auto run = elements.upper_bound(local);
+    return run != elements.begin() && local < (--run)->second;
+}
+
+// Simulates the instruction on the types of the operand stack and locals.
+void step(const Program& program, const executable::Function& function, const Elements& elements, const Address& address, const Instruction* instruction, State& state) {
+    switch (instruction->get_opcode()) {
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_MOD:
+        case OP_XOR:
+        case OP_BINARY_AND:
+        case OP_BINARY_OR: {
+            uint8_t right = pop_number(state, address, instruction);
+            uint8_t left = pop_number(state, address, instruction);
+            if (left == UNKNOWN || right == UNKNOWN) {
+                state.stack.push_back(UNKNOWN);
+            } else if (left == var::DOUBLE || right == var::DOUBLE) {
+                expect_arithmetic(address, instruction);
+                state.stack.push_back(var::DOUBLE);
+            } else {
+                state.stack.push_back(ARITHMETIC_TYPE[left][right]);
+            }
+            break;
+        }
+        case OP_LT:
+        case OP_LTE:
+        case OP_GT:
+        case OP_GTE:
+        case OP_EQ:
+        case OP_NOT_EQ:
+        case OP_BOOLEAN_AND:
+        case OP_BOOLEAN_OR: {
+            uint8_t right = pop_scalar(state, address);
+            uint8_t left = pop_scalar(state, address);
+            // strings are only compared for equality, with strings
+            if (left == var::STRING || right == var::STRING) {
+                uint8_t opcode = instruction->get_opcode();
+                if (opcode != OP_EQ && opcode != OP_NOT_EQ) {
+                    reject(address, "'" + instruction->to_string() + "' on a string.");
+                }
+                expect_type(address, left, var::STRING);
+                expect_type(address, right, var::STRING);
+            }
+            state.stack.push_back(var::BOOL);
+            break;
+        }
+        case OP_BINARY_NOT: {
+            uint8_t type = pop_number(state, address, instruction);
+            if (type == var::DOUBLE) {
+                expect_arithmetic(address, instruction);
+            }
+            state.stack.push_back(type);
+            break;
+        }
+        case OP_BOOLEAN_NOT: {
+            uint8_t type = pop_number(state, address, instruction);
+            state.stack.push_back(type == var::DOUBLE ? var::BOOL : type);
+            break;
+        }
+        case OP_PUSH: {
+            // push operands are read again, the instruction doesn't expose its value
+            Address index = address + SIZE_OF_BYTE;
+            state.stack.push_back(var::read(program.code, &index).type);
+            break;
+        }
+        case OP_READ_LONG:
+            state.stack.push_back(var::LONG);
+            break;
+        case OP_READ_INT:
+            state.stack.push_back(var::INT);
+            break;
+        case OP_READ_CHAR:
+            state.stack.push_back(var::CHAR);
+            break;
+        case OP_EOF:
+            state.stack.push_back(var::BOOL);
+            break;
+        case OP_MAP_FILE:
+            state.stack.push_back(var::INT);
+            break;
+        case OP_MAPPED_SIZE:
+            expect_type(address, pop(state, address), var::INT);
+            state.stack.push_back(var::LONG);
+            break;
+        case OP_MAPPED_BYTE:
+        case OP_MAPPED_INT:
+        case OP_MAPPED_LONG:
+            expect_type(address, pop(state, address), var::LONG);
+            expect_type(address, pop(state, address), var::INT);
+            state.stack.push_back(instruction->get_opcode() == OP_MAPPED_LONG ? var::LONG : var::INT);
+            break;
+        case OP_PUSH_STRING:
+            state.stack.push_back(var::STRING);
+            break;
+        case OP_STRING_LENGTH:
+            pop_string(state, address);
+            state.stack.push_back(var::LONG);
+            break;
+        case OP_STRING_INDEX:
+            expect_type(address, pop(state, address), var::LONG);
+            pop_string(state, address);
+            state.stack.push_back(var::CHAR);
+            break;
+        case OP_STRING_BUILDER:
+            state.stack.push_back(var::INT);
+            break;
+        case OP_STRING_APPEND:
+            pop_string(state, address);
+            expect_type(address, pop(state, address), var::INT);
+            break;
+        case OP_STRING_APPEND_CHAR:
+            expect_type(address, pop(state, address), var::CHAR);
+            expect_type(address, pop(state, address), var::INT);
+            break;
+        case OP_STRING_BUILD:
+            expect_type(address, pop(state, address), var::INT);
+            state.stack.push_back(var::STRING);
+            break;
+        case OP_MAPPED_SLICE:
+            expect_type(address, pop(state, address), var::LONG);
+            expect_type(address, pop(state, address), var::LONG);
+            expect_type(address, pop(state, address), var::INT);
+            state.stack.push_back(var::SLICE);
+            break;
+        case OP_PUSH_CONST:
+            state.stack.push_back(program.constants[((const ConstInstruction*) instruction)->get_index()].type);
+            break;
+        case OP_JUMP_IF:
+        case OP_JUMP_IF_FALSE:
+            expect_type(address, pop(state, address), var::BOOL);
+            break;
+        case OP_CALL: {
+            // the last parameter is on top of the stack
+            const auto& callee = program.functions.at(target(instruction));
+            for (uint8_t i = callee.params; i > 0; i--) {
+                uint8_t type = pop(state, address);
+                expect_type(address, type, callee.parameter_types.empty() ? UNKNOWN : callee.parameter_types[i - 1]);
+            }
+            for (uint8_t i = 0; i < callee.returns; i++) {
+                state.stack.push_back(callee.return_types.empty() ? UNKNOWN : callee.return_types[i]);
+            }
+            break;
+        }
+        case OP_RET:
+            if (function.entry == 0) {
+                reject(address, "'ret' outside of a function.");
+            }
+            if (instruction->pops() != function.returns) {
+                reject(address, "function returns a different number of values than declared.");
+            }
+            // slices of the frame would outlive it, the last value is on top of the stack
+            for (uint8_t i = function.returns; i > 0; i--) {
+                expect_type(address, pop_scalar(state, address), function.return_types.empty() ? UNKNOWN : function.return_types[i - 1]);
+            }
+            break;
+        case OP_PRINT:
+            pop_scalar(state, address);
+            break;
+        case OP_POP:
+            pop(state, address);
+            break;
+        case OP_STORE:
+        case OP_LOAD: {
+            Address index = address + SIZE_OF_BYTE;
+            Address local = byteutils::read_ulong(program.code, index);
+            use_locals(program, function, address, state, local, 1);
+            if (is_element(elements, local)) {
+                reject(address, "local " + std::to_string(local) + " holds elements of an array.");
+            }
+            if (instruction->get_opcode() == OP_STORE) {
+                state.locals[local] = pop(state, address);
+            } else if (state.locals[local] == UNSET) {
+                reject(address, "load of local " + std::to_string(local) + " before it is stored.");
+            } else {
+                state.stack.push_back(state.locals[local]);
+            }
+            break;
+        }
+        case OP_MAP_NEW:
+            state.stack.push_back(var::INT);
+            break;
+        case OP_MAP_GET:
+        case OP_MAP_CONTAINS:
+        case OP_MAP_REMOVE:
+            expect_type(address, pop(state, address), var::LONG);
+            expect_type(address, pop(state, address), var::INT);
+            state.stack.push_back(instruction->get_opcode() == OP_MAP_GET ? var::LONG : var::BOOL);
+            break;
+        case OP_MAP_PUT:
+            expect_type(address, pop(state, address), var::LONG);
+            expect_type(address, pop(state, address), var::LONG);
+            expect_type(address, pop(state, address), var::INT);
+            break;
+        case OP_MAP_SIZE:
+            expect_type(address, pop(state, address), var::INT);
+            state.stack.push_back(var::LONG);
+            break;
+        case OP_MAP_FREE:
+            expect_type(address, pop(state, address), var::INT);
+            break;
+        case OP_LOAD_GLOBAL:
+            state.stack.push_back(program.globals[byteutils::read_ulong(program.code, address + SIZE_OF_BYTE)].type);
+            break;
+        case OP_STORE_GLOBAL: {
+            // globals keep their type, so that every function reads the one they were declared with,
+            // and never hold slices, whose memory may be freed with their frame
+            uint8_t type = pop(state, address);
+            if (type == UNKNOWN) {
+                reject(address, "store of a value of unknown type into a global.");
+            }
+            expect_type(address, type, program.globals[byteutils::read_ulong(program.code, address + SIZE_OF_BYTE)].type);
+            break;
+        }
+        case OP_LOAD_BLOCK:
+        case OP_STORE_BLOCK: {
+            Address index = address + SIZE_OF_BYTE;
+            Address local = byteutils::read_ulong(program.code, index);
+            uint8_t count = program.code[index + SIZE_OF_LONG];
+            use_locals(program, function, address, state, local, count);
+            if (local + count > state.locals.size()) {
+                state.locals.resize(local + count, UNSET);
+            }
+            for (Address i = local; i < local + count; i++) {
+                if (is_element(elements, i)) {
+                    reject(address, "local " + std::to_string(i) + " holds elements of an array.");
+                }
+            }
+            if (instruction->get_opcode() == OP_STORE_BLOCK) {
+                for (Address i = local + count; i > local; i--) {
+                    state.locals[i - 1] = pop(state, address);
+                }
+                break;
+            }
+            for (Address i = local; i < local + count; i++) {
+                if (state.locals[i] == UNSET) {
+                    reject(address, "load of local " + std::to_string(i) + " before it is stored.");
+                }
+                state.stack.push_back(state.locals[i]);
+            }
+            break;
+        }
+        case OP_NEW_ARRAY: {
+            Address index = address + SIZE_OF_BYTE;
+            Address local = byteutils::read_ulong(program.code, index);
+            uint32_t length = byteutils::read_int(program.code, index + SIZE_OF_LONG);
+            Address slots = (length + sizeof(Var) - 1) / sizeof(Var);
+            use_locals(program, function, address, state, local, 1 + slots);
+            if (is_element(elements, local)) {
+                reject(address, "local " + std::to_string(local) + " holds elements of an array.");
+            }
+            state.locals[local] = var::SLICE;
+            break;
+        }
+        case OP_LOAD_INDEX:
+        case OP_STORE_INDEX: {
+            Address index = address + SIZE_OF_BYTE;
+            Address local = byteutils::read_ulong(program.code, index);
+            uint8_t type = program.code[index + SIZE_OF_LONG];
+            use_locals(program, function, address, state, local, 1);
+            if (state.locals[local] != var::SLICE) {
+                reject(address, "local " + std::to_string(local) + " is not known to be an array.");
+            }
+            if (instruction->get_opcode() == OP_STORE_INDEX) {
+                expect_type(address, pop_scalar(state, address), type);
+            }
+            expect_type(address, pop(state, address), var::LONG);
+            if (instruction->get_opcode() == OP_LOAD_INDEX) {
+                state.stack.push_back(type);
+            }
+            break;
+        }
+        case OP_ARRAY_FILL:
+        case OP_ARRAY_COUNT:
+        case OP_ARRAY_ADD:
+        case OP_ARRAY_MUL:
+        case OP_ARRAY_SEARCH:
+            // the value has the type of the elements
+            expect_type(address, pop_scalar(state, address), program.code[address + SIZE_OF_BYTE]);
+            pop_slice(state, address);
+            if (instruction->get_opcode() == OP_ARRAY_COUNT || instruction->get_opcode() == OP_ARRAY_SEARCH) {
+                state.stack.push_back(var::LONG);
+            }
+            break;
+        case OP_ARRAY_COPY:
+        case OP_ARRAY_DOT:
+        case OP_ARRAY_ADD_ARRAY:
+        case OP_ARRAY_MUL_ARRAY:
+            pop_slice(state, address);
+            pop_slice(state, address);
+            if (instruction->get_opcode() == OP_ARRAY_DOT) {
+                state.stack.push_back(var::LONG);
+            }
+            break;
+        case OP_ARRAY_SUM:
+        case OP_ARRAY_MIN:
+        case OP_ARRAY_MAX:
+        case OP_ARRAY_SORT:
+            pop_slice(state, address);
+            if (instruction->get_opcode() != OP_ARRAY_SORT) {
+                state.stack.push_back(var::LONG);
+            }
+            break;
+        case OP_CONVERT:
+            pop_number(state, address, instruction);
+            if (program.code[address + SIZE_OF_BYTE] == var::SLICE || program.code[address + SIZE_OF_BYTE] == var::STRING) {
+                reject(address, "conversion to a slice or a string.");
+            }
+            state.stack.push_back(program.code[address + SIZE_OF_BYTE]);
+            break;
+        case OP_NATIVE: {
+            const std::string& name = program.strings[((const ConstInstruction*) instruction)->get_index()];
+            // programs record the type returned by their native functions, so that linking types them too
+            auto recorded = std::find_if(program.natives.begin(), program.natives.end(),
+                [&name](const executable::Native& native) { return native.name == name; });
+            if (program.c_functions == nullptr) {
+                for (uint8_t i = 0; i < instruction->pops(); i++) {
+                    pop(state, address);
+                }
+                state.stack.push_back(recorded == program.natives.end() ? UNKNOWN : recorded->return_type);
+                break;
+            }
+            const NativeFunction* found = program.c_functions->find(name);
+            if (found == nullptr) {
+                reject(address, "unknown native function '" + name + "'.");
+            }
+            const NativeFunction& native = *found;
+            if (recorded != program.natives.end() && recorded->return_type != native.return_type) {
+                reject(address, "native function '" + name + "' doesn't return the type it was compiled with.");
+            }
+            if (native.arg_types.size() != instruction->pops()) {
+                reject(address, "native function '" + name + "' called with a wrong number of arguments.");
+            }
+            // the last argument is on top of the stack
+            for (auto it = native.arg_types.rbegin(); it != native.arg_types.rend(); it++) {
+                const var::DataType& type = *it;
+                uint8_t actual = pop(state, address);
+                // native functions read and write the memory of slices, which must be known to be ones
+                if (type == var::SLICE && actual != var::SLICE) {
+                    reject(address, "native function '" + name + "' expects a slice.");
+                }
+                expect_type(address, actual, type);
+            }
+            state.stack.push_back(native.return_type);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Merges the state reaching an instruction from another path, returns true if it changed.
+bool merge(State& into, const State& from, const Address& address) {
+    if (into.stack.size() != from.stack.size()) {
+        reject(address, "operand stack depth differs between paths.");
+    }
+    bool changed = false;
+    for (size_t i = 0; i < into.stack.size(); i++) {
+        if (into.stack[i] != from.stack[i] && into.stack[i] != UNKNOWN) {
+            into.stack[i] = UNKNOWN;
+            changed = true;
+        }
+    }
+    if (into.locals.size() < from.locals.size()) {
+        into.locals.resize(from.locals.size(), UNSET);
+    }
+    for (size_t i = 0; i < into.locals.size(); i++) {
+        uint8_t type = i < from.locals.size() ? from.locals[i] : UNSET;
+        uint8_t merged = into.locals[i];
+        if (merged == UNSET || type == UNSET) {
+            merged = UNSET;
+        } else if (merged != type) {
+            merged = UNKNOWN;
+        }
+        if (merged != into.locals[i]) {
+            into.locals[i] = merged;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+// Records the types of the frame where it is resumed after a snapshot instruction, or after a call
+// whose results are not pushed yet. Paths reaching the same point are merged like the ones of blocks.
+void add_resumption(const Program& program, executable::Function& function, const Instruction* instruction, const Address& next, const State& state) {
+    executable::Resumption resumption = {false, 0, state.stack, state.locals};
+    if (instruction->get_opcode() == OP_CALL) {
+        resumption.call = true;
+        resumption.callee = target(instruction);
+        resumption.stack.resize(resumption.stack.size() - program.functions.at(resumption.callee).returns);
+    }
+    const auto it = function.resumptions.find(next);
+    if (it == function.resumptions.end()) {
+        function.resumptions[next] = resumption;
+        return;
+    }
+    State merged = {it->second.stack, it->second.locals};
+    merge(merged, {resumption.stack, resumption.locals}, next);
+    it->second.stack = merged.stack;
+    it->second.locals = merged.locals;
+}
+
+bool matches(const uint8_t& type, const Var& value) {
+    return type == UNKNOWN || type == UNSET || type == value.type;
+}
+
+// Element slots of the arrays created by the instructions reachable from the entry of the function.
+Elements find_elements(const Program& program, const executable::Function& function) {
+    std::vector<std::pair<Address, Address>> runs;
+    std::set<Address> visited;
+    std::vector<Address> pending = {function.entry};
+    while (!pending.empty()) {
+        Address address = pending.back();
+        pending.pop_back();
+        if (!visited.insert(address).second) {
+            continue;
+        }
+        Address next = address;
+        const Instruction* instruction = decode(program, &next);
+        if (instruction->get_opcode() == OP_NEW_ARRAY) {
+            Address local = byteutils::read_ulong(program.code, address + SIZE_OF_BYTE);
+            uint32_t length = byteutils::read_int(program.code, address + SIZE_OF_BYTE + SIZE_OF_LONG);
+            if (length > 0) {
+                runs.push_back({local + 1, local + 1 + (length + sizeof(Var) - 1) / sizeof(Var)});
+            }
+        }
+        for (const auto& successor : successors(program, instruction, address, next)) {
+            pending.push_back(successor);
+        }
+    }
+    // overlapping runs are merged
+    std::sort(runs.begin(), runs.end());
+    Elements elements;
+    Address first = 0;
+    for (const auto& [begin, end] : runs) {
+        if (elements.empty() || begin > elements.at(first)) {
+            first = begin;
+            elements[first] = end;
+        } else {
+            elements[first] = std::max(elements.at(first), end);
+        }
+    }
+    return elements;
+}
+
+executable::Function analyze(const Program& program, const executable::Function& function) {
+    executable::Function result = function;
+    result.frame_size = 0;
+    result.max_stack = function.params;
+
+    State entry;
+    for (uint8_t i = 0; i < function.params; i++) {
+        entry.stack.push_back(function.parameter_types.empty() ? UNKNOWN : function.parameter_types[i]);
+    }
+    Elements elements = find_elements(program, function);
+    // States are kept only where basic blocks start, one state runs through each block.
+    std::map<Address, State> states = {{function.entry, entry}};
+    std::vector<Address> pending = {function.entry};
+    while (!pending.empty()) {
+        Address address = pending.back();
+        pending.pop_back();
+        State state = states.at(address);
+
+        while (true) {
+            Address next = address;
+            const Instruction* instruction = decode(program, &next);
+            if (instruction->get_opcode() == OP_CALL && program.functions.find(target(instruction)) == program.functions.end()) {
+                reject(address, "call to an address that is not a function entry.");
+            }
+            step(program, function, elements, address, instruction, state);
+            if (instruction->get_opcode() == OP_CALL || instruction->get_opcode() == OP_SNAPSHOT) {
+                add_resumption(program, result, instruction, next, state);
+            }
+            result.max_stack = std::max<uint64_t>(result.max_stack, state.stack.size());
+            result.frame_size = std::max<uint64_t>(result.frame_size, state.locals.size());
+
+            std::vector<Address> following = successors(program, instruction, address, next);
+            if (following.size() == 1 && following[0] == next && !program.leaders[next]) {
+                address = next;
+                continue;
+            }
+            for (const auto& successor : following) {
+                const auto it = states.find(successor);
+                if (it == states.end()) {
+                    states[successor] = state;
+                    pending.push_back(successor);
+                } else if (merge(it->second, state, successor)) {
+                    pending.push_back(successor);
+                }
+            }
+            break;
+        }
+    }
+    for (const auto& [first, end] : elements) {
+        result.frame_size = std::max<uint64_t>(result.frame_size, end);
+    }
+    result.elements.assign(result.frame_size, false);
+    for (const auto& [first, end] : elements) {
+        std::fill(result.elements.begin() + first, result.elements.begin() + end, true);
+    }
+    return result;
+}
+}
+
+std::map<uint64_t, executable::Function> verifier::verify(const Executable& executable, CFunctions* c_functions) {
+    Program program = {executable.code, executable.code_size, c_functions, executable.constants, executable.strings, executable.globals, executable.natives, executable.functions.empty(), {}, {}};
+    if (program.size == 0) {
+        reject(0, "empty program.");
+    }
+    std::map<Address, uint8_t> calls = sweep(program);
+
+    for (const auto& function : executable.functions) {
+        program.functions[function.entry] = function;
+    }
+    if (program.flat) {
+        // flat programs: the top-level code and every call target are functions
+        program.functions[0] = {0, 0, 0, 0, 0, {}, {}};
+        for (const auto& [entry, params] : calls) {
+            if (entry == 0) {
+                reject(entry, "call to the top-level code.");
+            }
+            program.functions[entry] = {entry, params, infer_returns(program, entry), 0, 0, {}, {}};
+        }
+    }
+    for (const auto& [entry, params] : calls) {
+        const auto it = program.functions.find(entry);
+        if (it != program.functions.end() && it->second.params != params) {
+            reject(entry, "function called with a wrong number of parameters.");
+        }
+    }
+    if (program.functions.find(0) == program.functions.end()) {
+        reject(0, "missing the top-level code in the function table.");
+    }
+
+    std::map<uint64_t, executable::Function> functions;
+    for (const auto& [entry, function] : program.functions) {
+        if (entry >= program.size || !program.boundaries[entry]) {
+            reject(entry, "function entry outside of an instruction.");
+        }
+        functions[entry] = analyze(program, function);
+    }
+    return functions;
+}
+
+bool verifier::is_resumable(const executable::Function& function, const executable::Resumption& resumption, const Var* locals, const Var* stack, const uint64_t& stack_size) {
+    if (stack_size != resumption.stack.size()) {
+        return false;
+    }
+    for (uint64_t i = 0; i < stack_size; i++) {
+        if (!matches(resumption.stack[i], stack[i])) {
+            return false;
+        }
+    }
+    // elements of arrays are raw bytes
+    for (uint64_t i = 0; i < resumption.locals.size(); i++) {
+        if (!function.elements[i] && !matches(resumption.locals[i], locals[i])) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,26 @@
+#if !defined(VERIFIER)
+#define VERIFIER
+
+#include <map>
+#include <stdint.h>
+#include "c_functions.h"
+#include "executable.h"
+
+namespace verifier {
+// Checks once, before running, everything the interpreter doesn't check while running:
+// every instruction decodes, branches land on instruction boundaries, the operand stack
+// neither underflows nor changes depth where paths merge, values have the types their
+// instructions expect, globals keep the types of the data section, and locals are stored
+// before being loaded.
+//
+// Gives the function table to execute the code with, where frame sizes and stack depths
+// are the ones computed here. Functions of flat programs are inferred from call sites.
+// Native functions are bound and checked when c_functions is given.
+std::map<uint64_t, executable::Function> verify(const Executable& executable, CFunctions* c_functions);
+
+// Checks the values of a frame resumed from a snapshot against the types the verifier
+// found where it is resumed. Values of unknown types and locals not stored yet may be anything.
+bool is_resumable(const executable::Function& function, const executable::Resumption& resumption, const Var* locals, const Var* stack, const uint64_t& stack_size);
+}
+
+#endif // VERIFIER
@@ -1,38 +1,433 @@
 #include "vm.h"
 #include "instructions.h"
+#include "byteutils.h"
+#include "verifier.h"
 #include <string>
+#include <algorithm>
 #include <dlfcn.h>
 #include <iostream>
 #include <functional>
+#include <set>
 
-Vm::Vm(const std::vector<uint8_t>& program, const std::vector<std::string>& shared_libraries) {
-    this->program = program;
+namespace snapshot {
+void malformed() {
+    std::cout << "Malformed snapshot." << std::endl;
+    exit(1);
+}
+
+// Checks that the snapshot has the given number of bytes left at the index.
+void expect_bytes(const uint64_t& size, const uint64_t& index, const uint64_t& count) {
+    if (index > size || count > size - index) {
+        malformed();
+    }
+}
+
+uint64_t read_ulong(const uint8_t* bytes, const uint64_t& size, uint64_t* index) {
+    expect_bytes(size, *index, SIZE_OF_LONG);
+    uint64_t value = byteutils::read_ulong(bytes, *index);
+    *index += SIZE_OF_LONG;
+    return value;
+}
+
+// Memory slices can point to: the mapped files, then the frames from the bottom of the call stack.
+struct Region {
+    uint8_t* data;
+    uint64_t size;
+    bool read_only;
+};
+
+// Slices are saved as the region they point to, their offset in it and their length.
+// Strings are saved as their characters, and interned again when resuming.
+void push_var(const std::vector<Region>& regions, const Var& value, std::vector<uint8_t>& bytes) {
+    if (value.type == var::STRING) {
+        bytes.push_back(var::STRING);
+        byteutils::push_string(bytes, std::string(var::string_data(value), value.length));
+        return;
+    }
+    if (value.type != var::SLICE) {
+        var::push(value, bytes);
+        return;
+    }
+    for (size_t i = 0; i < regions.size(); i++) {
+        const Region& region = regions[i];
+        if (value.data._pointer >= region.data && value.data._pointer + value.length <= region.data + region.size) {
+            bytes.push_back(var::SLICE);
+            byteutils::push_ulong(bytes, i);
+            byteutils::push_ulong(bytes, value.data._pointer - region.data);
+            byteutils::push_ulong(bytes, value.length);
+            return;
+        }
+    }
+    std::cout << "Could not find the memory of a slice." << std::endl;
+    exit(1);
+}
+
+std::string read_string(const uint8_t* bytes, const uint64_t& size, uint64_t* index) {
+    uint64_t length = read_ulong(bytes, size, index);
+    expect_bytes(size, *index, length);
+    std::string str(bytes + *index, bytes + *index + length);
+    *index += length;
+    return str;
+}
+
+Var read_var(const std::vector<Region>& regions, StringTable& interned, const uint8_t* bytes, const uint64_t& size, uint64_t* index) {
+    expect_bytes(size, *index, SIZE_OF_BYTE);
+    Var value;
+    value.type = (var::DataType) bytes[*index];
+    if (var::TYPE_NAME.find(value.type) == var::TYPE_NAME.end()) {
+        malformed();
+    }
+    if (value.type == var::SLICE) {
+        *index += SIZE_OF_BYTE;
+        uint64_t region = read_ulong(bytes, size, index);
+        uint64_t offset = read_ulong(bytes, size, index);
+        uint64_t length = read_ulong(bytes, size, index);
+        if (region >= regions.size() || offset > regions[region].size || length > regions[region].size - offset || length > UINT32_MAX) {
+            malformed();
+        }
+        return var::create_slice(regions[region].data + offset, length, regions[region].read_only);
+    }
+    if (value.type == var::STRING) {
+        *index += SIZE_OF_BYTE;
+        std::string str = read_string(bytes, size, index);
+        if (str.size() > UINT32_MAX) {
+            malformed();
+        }
+        return interned.intern(str);
+    }
+    expect_bytes(size, *index, var::size(value));
+    return var::read(bytes, index);
+}
+
+std::vector<Region> mapped_regions(const Vm& vm) {
+    std::vector<Region> regions;
+    for (const auto& file : vm.mapped_files) {
+        regions.push_back({(uint8_t*) file.data, file.size, true});
+    }
+    return regions;
+}
+
+template <class T>
+std::vector<T> bottom_up(std::stack<T> stack) {
+    std::vector<T> values;
+    while (!stack.empty()) {
+        values.push_back(stack.top());
+        stack.pop();
+    }
+    std::reverse(values.begin(), values.end());
+    return values;
+}
+}
+
+Vm::Vm(const std::shared_ptr<OutputSink>& sink) : output(sink) {}
+
+Vm::Vm(
+    const std::vector<uint8_t>& program,
+    const std::vector<std::string>& shared_libraries,
+    const std::shared_ptr<OutputSink>& sink
+) : output(sink) {
+    program_bytes = program;
+    this->program = program_bytes.data();
+    program_size = program_bytes.size();
+    init(shared_libraries);
+}
+
+Vm::Vm(
+    const std::shared_ptr<const MappedFile>& program,
+    const std::vector<std::string>& shared_libraries,
+    const std::shared_ptr<OutputSink>& sink
+) : output(sink) {
+    program_file = program;
+    this->program = program_file->data();
+    program_size = program_file->size();
+    init(shared_libraries);
+}
+
+void Vm::load(const std::vector<std::string>& shared_libraries) {
+    this->shared_libraries = shared_libraries;
+    c_functions.set_libraries(shared_libraries);
+    image = program;
+    image_size = program_size;
+    Executable executable = executable::from_bytes(program, program_size);
+    // only the libraries recorded by the program are opened, the others are searched for unknown functions
+    for (const auto& native : executable.natives) {
+        c_functions.bind(native.name, native.library);
+    }
+    program = executable.code;
+    program_size = executable.code_size;
+    functions = verifier::verify(executable, &c_functions);
+    constants = executable.constants;
+    globals = executable.globals;
+    strings = executable.strings;
+    for (const auto& str : strings) {
+        string_values.push_back(interned.intern(str));
+    }
+    natives.assign(strings.size(), nullptr);
+    for (size_t i = 0; i < strings.size(); i++) {
+        if (c_functions.has_function(strings[i])) {
+            natives[i] = &c_functions.get_native(strings[i]);
+        }
+    }
+}
+
+void Vm::init(const std::vector<std::string>& shared_libraries) {
+    load(shared_libraries);
     ip = 0;
     running = true;
-    push_frame();
-    c_functions.load(shared_libraries);
+    push_frame(0);
 }
 
 void Vm::execute() {
+    // instances of the running thread, looked up once
+    Instruction* const* instances = Instruction::OP_INSTANCES_PTR;
     while (running) {
         uint8_t opcode = program[ip++];
-        auto instruction = Instruction::OP_INSTANCES_PTR[opcode];
+        auto instruction = instances[opcode];
         instruction->read(program, &ip);
         instruction->execute(*this);
     }
 }
 
-void Vm::push_frame() {
-    stacks.push(std::vector<Var>());
+// Locals and operand stack of a frame are allocated together, with the sizes
+// computed by the verifier.
+void Vm::push_frame(const uint64_t& entry) {
+    const executable::Function& function = functions.at(entry);
+    Var* frame = new Var[function.frame_size + function.max_stack]();
+    heaps.push(frame);
+    entries.push(entry);
+    heap = frame;
+    stacks.push(OperandStack(frame + function.frame_size));
     stack = &stacks.top();
-    heaps.push(new Var[HEAP_MEMORY]);
-    heap = heaps.top();
 }
 
 void Vm::pop_frame() {
     stacks.pop();
     stack = &stacks.top();
-    delete heaps.top();
+    delete[] heaps.top();
     heaps.pop();
+    entries.pop();
     heap = heaps.top();
 }
+
+int Vm::map_file(const std::string& path) {
+    std::shared_ptr<const MappedFile> file = fileutils::map_file(path);
+    mapped_files.push_back({path, file, file->data(), file->size()});
+    return mapped_files.size() - 1;
+}
+
+// The snapshot holds the executable followed by the state of the VM, so that
+// resuming only needs the snapshot file.
+void Vm::save_snapshot(const std::string& filename) const {
+    std::vector<uint8_t> bytes(snapshot::MAGIC.begin(), snapshot::MAGIC.end());
+    bytes.push_back(snapshot::VERSION);
+    byteutils::push_ulong(bytes, image_size);
+    bytes.insert(bytes.end(), image, image + image_size);
+
+    byteutils::push_ulong(bytes, shared_libraries.size());
+    for (const auto& library : shared_libraries) {
+        byteutils::push_string(bytes, library);
+    }
+
+    // files are mapped again when resuming, in the same order to keep their handles
+    byteutils::push_ulong(bytes, mapped_files.size());
+    for (const auto& region : mapped_files) {
+        byteutils::push_string(bytes, region.path);
+    }
+
+    byteutils::push_ulong(bytes, builders.size());
+    for (const auto& builder : builders) {
+        byteutils::push_string(bytes, builder);
+    }
+
+    // freed maps are saved as the slots map_new gives again, in the same order
+    byteutils::push_ulong(bytes, maps.size());
+    for (size_t i = 0; i < maps.size(); i++) {
+        const auto& map = maps[i];
+        bytes.push_back(map.has_value());
+        bytes.push_back(map_generations[i]);
+        if (!map) {
+            continue;
+        }
+        const auto entries = map->entries();
+        byteutils::push_ulong(bytes, entries.size());
+        for (const auto& [key, value] : entries) {
+            byteutils::push_long(bytes, key);
+            byteutils::push_long(bytes, value);
+        }
+    }
+    byteutils::push_ulong(bytes, free_maps.size());
+    for (const auto& handle : free_maps) {
+        byteutils::push_ulong(bytes, handle);
+    }
+
+    byteutils::push_ulong(bytes, ip);
+    std::vector<uint64_t> returns = snapshot::bottom_up(call_stack);
+    byteutils::push_ulong(bytes, returns.size());
+    for (const auto& address : returns) {
+        byteutils::push_ulong(bytes, address);
+    }
+
+    std::vector<uint64_t> frame_entries = snapshot::bottom_up(entries);
+    std::vector<Var*> frames = snapshot::bottom_up(heaps);
+    std::vector<OperandStack> operands = snapshot::bottom_up(stacks);
+    std::vector<snapshot::Region> regions = snapshot::mapped_regions(*this);
+    for (size_t i = 0; i < frames.size(); i++) {
+        regions.push_back({(uint8_t*) frames[i], functions.at(frame_entries[i]).frame_size * sizeof(Var), false});
+    }
+    byteutils::push_ulong(bytes, frames.size());
+    for (size_t i = 0; i < frames.size(); i++) {
+        const executable::Function& function = functions.at(frame_entries[i]);
+        byteutils::push_ulong(bytes, function.entry);
+        for (uint64_t j = 0; j < function.frame_size; j++) {
+            if (function.elements[j]) {
+                // elements of arrays are raw bytes
+                bytes.insert(bytes.end(), (const uint8_t*) &frames[i][j], (const uint8_t*) &frames[i][j + 1]);
+            } else {
+                snapshot::push_var(regions, frames[i][j], bytes);
+            }
+        }
+        byteutils::push_ulong(bytes, operands[i].size());
+        for (size_t j = 0; j < operands[i].size(); j++) {
+            snapshot::push_var(regions, operands[i].data()[j], bytes);
+        }
+    }
+    for (const auto& value : globals) {
+        snapshot::push_var(regions, value, bytes);
+    }
+    fileutils::write_bytes(bytes, filename);
+}
+
+std::unique_ptr<Vm> Vm::resume(const std::shared_ptr<const MappedFile>& snapshot, const std::shared_ptr<OutputSink>& sink) {
+    const uint8_t* bytes = snapshot->data();
+    uint64_t size = snapshot->size();
+    if (size < snapshot::MAGIC.size() + SIZE_OF_BYTE || !std::equal(snapshot::MAGIC.begin(), snapshot::MAGIC.end(), bytes)) {
+        std::cout << "Not a banana snapshot." << std::endl;
+        exit(1);
+    }
+    uint64_t index = snapshot::MAGIC.size();
+    if (bytes[index] != snapshot::VERSION) {
+        std::cout << "Unsupported snapshot version: " << (int) bytes[index] << std::endl;
+        exit(1);
+    }
+    index += SIZE_OF_BYTE;
+
+    std::unique_ptr<Vm> vm(new Vm(sink));
+    // the executable is used in place, from the mapping of the snapshot
+    vm->program_file = snapshot;
+    vm->program_size = snapshot::read_ulong(bytes, size, &index);
+    snapshot::expect_bytes(size, index, vm->program_size);
+    vm->program = bytes + index;
+    index += vm->program_size;
+
+    std::vector<std::string> shared_libraries;
+    uint64_t libraries_count = snapshot::read_ulong(bytes, size, &index);
+    for (uint64_t i = 0; i < libraries_count; i++) {
+        shared_libraries.push_back(snapshot::read_string(bytes, size, &index));
+    }
+    vm->load(shared_libraries);
+
+    uint64_t mapped_count = snapshot::read_ulong(bytes, size, &index);
+    for (uint64_t i = 0; i < mapped_count; i++) {
+        vm->map_file(snapshot::read_string(bytes, size, &index));
+    }
+
+    uint64_t builders_count = snapshot::read_ulong(bytes, size, &index);
+    for (uint64_t i = 0; i < builders_count; i++) {
+        vm->builders.push_back(snapshot::read_string(bytes, size, &index));
+    }
+
+    uint64_t maps_count = snapshot::read_ulong(bytes, size, &index);
+    uint64_t freed_count = 0;
+    for (uint64_t i = 0; i < maps_count; i++) {
+        snapshot::expect_bytes(size, index, 2 * SIZE_OF_BYTE);
+        uint8_t in_use = bytes[index++];
+        uint8_t generation = bytes[index++];
+        if (in_use > 1 || generation >= MAP_GENERATIONS) {
+            snapshot::malformed();
+        }
+        vm->map_generations.push_back(generation);
+        if (!in_use) {
+            vm->maps.emplace_back();
+            freed_count++;
+            continue;
+        }
+        HashMap& map = vm->maps.emplace_back(std::in_place).value();
+        uint64_t entries_count = snapshot::read_ulong(bytes, size, &index);
+        for (uint64_t j = 0; j < entries_count; j++) {
+            int64_t key = snapshot::read_ulong(bytes, size, &index);
+            map.put(key, snapshot::read_ulong(bytes, size, &index));
+        }
+    }
+    // every freed map is given again once
+    if (snapshot::read_ulong(bytes, size, &index) != freed_count) {
+        snapshot::malformed();
+    }
+    std::set<uint64_t> freed;
+    for (uint64_t i = 0; i < freed_count; i++) {
+        uint64_t handle = snapshot::read_ulong(bytes, size, &index);
+        if (handle >= maps_count || vm->maps[handle] || !freed.insert(handle).second) {
+            snapshot::malformed();
+        }
+        vm->free_maps.push_back(handle);
+    }
+
+    vm->ip = snapshot::read_ulong(bytes, size, &index);
+    // each frame continues at the return address of its call, the last one at the ip
+    std::vector<uint64_t> addresses;
+    uint64_t returns_count = snapshot::read_ulong(bytes, size, &index);
+    for (uint64_t i = 0; i < returns_count; i++) {
+        addresses.push_back(snapshot::read_ulong(bytes, size, &index));
+        vm->call_stack.push(addresses.back());
+    }
+    addresses.push_back(vm->ip);
+    uint64_t frames_count = snapshot::read_ulong(bytes, size, &index);
+    if (frames_count != returns_count + 1) {
+        snapshot::malformed();
+    }
+    std::vector<snapshot::Region> regions = snapshot::mapped_regions(*vm);
+    const executable::Resumption* caller = nullptr;
+    for (uint64_t i = 0; i < frames_count; i++) {
+        uint64_t entry = snapshot::read_ulong(bytes, size, &index);
+        if (vm->functions.find(entry) == vm->functions.end() || (i == 0 && entry != 0) || (caller != nullptr && caller->callee != entry)) {
+            snapshot::malformed();
+        }
+        vm->push_frame(entry);
+        const executable::Function& function = vm->functions.at(entry);
+        // frames can only be resumed where the verifier knows their types
+        const auto resumption = function.resumptions.find(addresses[i]);
+        if (resumption == function.resumptions.end() || resumption->second.call != (i + 1 < frames_count)) {
+            snapshot::malformed();
+        }
+        regions.push_back({(uint8_t*) vm->heap, function.frame_size * sizeof(Var), false});
+        for (uint64_t j = 0; j < function.frame_size; j++) {
+            if (function.elements[j]) {
+                snapshot::expect_bytes(size, index, sizeof(Var));
+                std::copy(bytes + index, bytes + index + sizeof(Var), (uint8_t*) &vm->heap[j]);
+                index += sizeof(Var);
+            } else {
+                vm->heap[j] = snapshot::read_var(regions, vm->interned, bytes, size, &index);
+            }
+        }
+        uint64_t stack_size = snapshot::read_ulong(bytes, size, &index);
+        if (stack_size > function.max_stack) {
+            snapshot::malformed();
+        }
+        for (uint64_t j = 0; j < stack_size; j++) {
+            vm->stack->push_back(snapshot::read_var(regions, vm->interned, bytes, size, &index));
+        }
+        if (!verifier::is_resumable(function, resumption->second, vm->heap, vm->stack->data(), vm->stack->size())) {
+            snapshot::malformed();
+        }
+        caller = &resumption->second;
+    }
+    // globals keep the types of the data section, which the code was verified with
+    for (auto& value : vm->globals) {
+        Var saved = snapshot::read_var(regions, vm->interned, bytes, size, &index);
+        if (saved.type != value.type) {
+            snapshot::malformed();
+        }
+        value = saved;
+    }
+    vm->running = true;
+    return vm;
+}
@@ -1,33 +1,143 @@
 #if !defined(VM)
 #define VM
-#define HEAP_MEMORY (2 << 16)
 
 #include <map>
 #include <stack>
+#include <algorithm>
 #include <memory>
+#include <optional>
 #include <vector>
 #include <stdint.h>
+#include <unistd.h>
 #include "c_interface.h"
 #include "c_functions.h"
+#include "executable.h"
+#include "fileutils.h"
+#include "hash_map.h"
+#include "input_buffer.h"
+#include "output_buffer.h"
+#include "string_table.h"
 #include "var.h"
 
+// Operand stack of a frame. Its capacity is the depth computed by the verifier,
+// so pushes and pops neither check bounds nor reallocate.
+class OperandStack {
+    public:
+    OperandStack(Var* base) : base(base), top(base) {}
+    void push_back(const Var& value) { *top++ = value; }
+    void push_back(const Var* values, const size_t& count) {
+        // most blocks hold a single value, which is not worth a call to memmove
+        if (count == 1) { *top++ = *values; return; }
+        std::copy(values, values + count, top);
+        top += count;
+    }
+    void pop_back() { top--; }
+    Var pop() { return *--top; }
+    // Drops the last values, which stay readable until the next push.
+    Var* pop(const size_t& count) { top -= count; return top; }
+    Var& back() { return top[-1]; }
+    const Var* data() const { return base; }
+    bool empty() const { return top == base; }
+    size_t size() const { return top - base; }
+
+    private:
+    Var* base;
+    Var* top;
+};
+
+// File mapped by a program, the handle of map_file is its index in the VM.
+struct MappedRegion {
+    std::string path;
+    std::shared_ptr<const MappedFile> file;
+    const uint8_t* data;
+    uint64_t size;
+};
+
+namespace snapshot {
+const std::string MAGIC = "BNSS";
+const uint8_t VERSION = 11;
+}
+
+// Handles of maps hold the slot of the map in their low bits and the generation of the slot above,
+// so that the handle of a freed map doesn't reach the map given its slot later.
+const int MAP_SLOT_BITS = 24;
+const int MAP_GENERATIONS = 1 << (31 - MAP_SLOT_BITS);
+
 class Vm {
     public:
-    Vm(const std::vector<uint8_t>& program, const std::vector<std::string>& shared_libraries = std::vector<std::string>());
+    // The output goes to the sink, or to the standard output when the sink is null.
+    Vm(
+        const std::vector<uint8_t>& program,
+        const std::vector<std::string>& shared_libraries = std::vector<std::string>(),
+        const std::shared_ptr<OutputSink>& sink = nullptr
+    );
+    Vm(
+        const std::shared_ptr<const MappedFile>& program,
+        const std::vector<std::string>& shared_libraries = std::vector<std::string>(),
+        const std::shared_ptr<OutputSink>& sink = nullptr
+    );
+
+    // Continues a program from the state saved by save_snapshot.
+    static std::unique_ptr<Vm> resume(const std::shared_ptr<const MappedFile>& snapshot, const std::shared_ptr<OutputSink>& sink = nullptr);
 
     void execute();
-    void push_frame();
+    void save_snapshot(const std::string& filename) const;
+    void push_frame(const uint64_t& entry);
     void pop_frame();
+    // Maps the file read-only and gives its handle.
+    int map_file(const std::string& path);
 
     Var* heap;
-    std::vector<Var>* stack;
-    std::vector<uint8_t> program;
+    // globals of every module, from the data section
+    std::vector<Var> globals;
+    OperandStack* stack;
+    const uint8_t* program;
+    uint64_t program_size;
     std::stack<uint64_t> call_stack;
-    std::stack<std::vector<Var>> stacks;
+    std::stack<OperandStack> stacks;
     std::stack<Var*> heaps;
+    // entry address of the function of each frame
+    std::stack<uint64_t> entries;
     uint64_t ip;
     bool running;
     CFunctions c_functions;
+    // verified function table, by entry address
+    std::map<uint64_t, executable::Function> functions;
+    // constant pool, referred to by index from the code
+    std::vector<Var> constants;
+    std::vector<std::string> strings;
+    // strings made by the program, and the values of the strings of the constant pool
+    StringTable interned;
+    std::vector<Var> string_values;
+    // contents of the string builders, the handle of a builder is its index
+    std::vector<std::string> builders;
+    // maps made by the program by slot, freed maps are empty
+    std::vector<std::optional<HashMap>> maps;
+    // times each slot was freed, modulo MAP_GENERATIONS, which the handles of its maps hold
+    std::vector<uint8_t> map_generations;
+    // slots of the freed maps, given again by map_new
+    std::vector<int> free_maps;
+    // native functions by the index of their name in the strings, null for other strings
+    std::vector<const NativeFunction*> natives;
+    OutputBuffer output;
+    InputBuffer input{STDIN_FILENO};
+    std::vector<MappedRegion> mapped_files;
+    // when set, the program stops at its first snapshot point and is saved to this file
+    std::string snapshot_path;
+
+    private:
+    Vm(const std::shared_ptr<OutputSink>& sink);
+    void load(const std::vector<std::string>& shared_libraries);
+    void init(const std::vector<std::string>& shared_libraries);
+
+    std::vector<std::string> shared_libraries;
+    // whole executable the code was read from
+    const uint8_t* image;
+    uint64_t image_size;
+
+    // owners of the memory pointed by program
+    std::vector<uint8_t> program_bytes;
+    std::shared_ptr<const MappedFile> program_file;
 };
 
 #endif // VM